@@ -0,0 +1,139 @@
+/* ********************************************************************************************* */
+/* * Animation Header for playback of delta-encoded animations                                 * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <stdint.h>
+
+#include "display.h"
+
+/* Return codes */
+#define ANIMATION_OK 0x0
+#define ANIMATION_INVALID_ARGS 0x100
+#define ANIMATION_NO_MEMORY 0x200
+#define ANIMATION_FILE_ERROR 0x300
+#define ANIMATION_INVALID_FORMAT 0x400
+
+/* File identification */
+#define ANIMATION_MAGIC "PDAN"
+#define ANIMATION_VERSION 1
+
+/* RLE token flag. Tokens with this bit set are runs: (token & ANIMATION_RLE_MAX) copies of the next word. Otherwise, the
+ * token is the amount of literal pixels that follow */
+#define ANIMATION_RLE_RUN 0x8000
+#define ANIMATION_RLE_MAX 0x7FFF
+
+/**
+ * @brief Animation file header. All fields are little-endian.
+ *        File layout: header, frame table with (frameCount + 1) entries, frame data. The extra frame is the loop frame,
+ *        which updates the last frame to the first one, so looping does not need a full redraw.
+ */
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint16_t width;
+	uint16_t height;
+	uint32_t frameCount;
+	uint32_t frameTableOffset;
+} animation_header;
+
+/**
+ * @brief Frame table entry. Frame data starts with a 16-bit rectangle count, a 16-bit pad and then, for each dirty
+ *        rectangle, an animation_rect followed by the RLE tokens of its pixels in panel-native RGB565. Frame 0 is a
+ *        single rectangle covering the whole animation.
+ */
+typedef struct {
+	uint32_t offset;
+	uint32_t size;
+	uint32_t delay;
+} animation_frame;
+
+/**
+ * @brief Dirty rectangle of a frame, relative to the animation origin.
+ */
+typedef struct {
+	uint16_t x;
+	uint16_t y;
+	uint16_t w;
+	uint16_t h;
+} animation_rect;
+
+/**
+ * @brief Opaque animation handle.
+ */
+typedef struct animation_s animation;
+
+/**
+ * @brief Map an animation file and validate it, so that playback performs no checks.
+ * @param anim Pointer where the animation handle will be written.
+ * @param path Path to animation file (see bin/animconv).
+ * @return One of the following error codes:
+ *         ANIMATION_OK: No errors occurred.
+ *         ANIMATION_NO_MEMORY: Out of memory.
+ *         ANIMATION_FILE_ERROR: File could not be opened or mapped.
+ *         ANIMATION_INVALID_FORMAT: File is not a valid animation.
+ */
+int animation_open(animation **anim, const char *path);
+
+/**
+ * @brief Get animation information.
+ * @param anim Animation handle.
+ * @param width Pointer where width will be written.
+ * @param height Pointer where height will be written.
+ * @param frames Pointer where the amount of frames (not counting the loop frame) will be written.
+ */
+void animation_get_info(animation *anim, unsigned int *width, unsigned int *height, unsigned int *frames);
+
+/**
+ * @brief Draw the dirty rectangles of a frame. Frames must be drawn in sequence, since each one only holds what changed
+ *        since the previous.
+ * @param anim Animation handle.
+ * @param driver Initialised display driver.
+ * @param x Leftmost column of the animation on the screen.
+ * @param y Topmost row of the animation on the screen.
+ * @param frame Frame index. Index equal to the amount of frames is the loop frame.
+ * @return One of the following error codes:
+ *         ANIMATION_OK: No errors occurred.
+ *         ANIMATION_INVALID_ARGS: Invalid frame or animation does not fit the screen at (x,y).
+ */
+int animation_draw_frame(animation *anim, display_driver *driver, int x, int y, unsigned int frame);
+
+/**
+ * @brief Play an animation, keeping the frame delays on an absolute timeline so that drawing time does not add drift.
+ *        If driver synchronisation is on (see display_set_vsync()), each frame is drawn on the first refresh after
+ *        its time, right behind the panel scan, so that it does not tear.
+ * @param anim Animation handle.
+ * @param driver Initialised display driver.
+ * @param x Leftmost column of the animation on the screen.
+ * @param y Topmost row of the animation on the screen.
+ * @param loops Amount of times the animation is played. Zero plays until stop is set.
+ * @param stop Pointer to a flag checked between frames. Playback ends when it becomes non-zero. May be NULL.
+ * @return Same codes as animation_draw_frame().
+ */
+int animation_play(animation *anim, display_driver *driver, int x, int y, unsigned int loops, volatile int *stop);
+
+/**
+ * @brief Unmap animation.
+ * @param anim Animation handle.
+ */
+void animation_close(animation *anim);
+
+#endif
@@ -0,0 +1,153 @@
+/* ********************************************************************************************* */
+/* * Baked Font Header for FreeType-free text                                                  * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef BAKEDFONT_H
+#define BAKEDFONT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "display.h"
+
+/* Return codes */
+#define BAKEDFONT_OK 0x0
+#define BAKEDFONT_INVALID_ARGS 0x100
+#define BAKEDFONT_FILE_ERROR 0x200
+#define BAKEDFONT_INVALID_FORMAT 0x300
+
+/* File identification */
+#define BAKEDFONT_MAGIC "PDFN"
+#define BAKEDFONT_VERSION 1
+
+/**
+ * @brief Font file header. All fields are little-endian.
+ *        File layout: header, size table with sizeCount entries, then for each size its glyph table, kerning table
+ *        and glyph bitmaps (8-bit coverage, width * height bytes, no padding).
+ */
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t sizeCount;
+	uint32_t sizeTableOffset;
+} bakedfont_header;
+
+/**
+ * @brief Size table entry.
+ */
+typedef struct {
+	uint16_t size;
+	int16_t ascent;
+	int16_t descent;
+	uint16_t reserved;
+	uint32_t glyphCount;
+	uint32_t glyphOffset;
+	uint32_t kernCount;
+	uint32_t kernOffset;
+} bakedfont_size;
+
+/**
+ * @brief Glyph table entry. Entries are sorted by code point. Advance is in 1/64 pixels.
+ */
+typedef struct {
+	uint32_t code;
+	uint16_t width;
+	uint16_t height;
+	int16_t left;
+	int16_t top;
+	int32_t advance;
+	uint32_t bitmapOffset;
+} bakedfont_glyph;
+
+/**
+ * @brief Kerning table entry. Glyphs are indices in the glyph table of the same size, entries are sorted by (left,
+ *        right). Kerning is in 1/64 pixels. Pairs with no kerning are not stored.
+ */
+typedef struct {
+	uint16_t left;
+	uint16_t right;
+	int32_t kerning;
+} bakedfont_kern;
+
+/**
+ * @brief Mapped font file. The caller provides the storage, nothing is allocated on the heap.
+ */
+typedef struct {
+	const unsigned char *data;
+	size_t size;
+} bakedfont;
+
+/**
+ * @brief Map and validate a font file created by bin/fontbake.
+ * @param font Font to be filled.
+ * @param path Path to font file.
+ * @return One of the following error codes:
+ *         BAKEDFONT_OK: No errors occurred.
+ *         BAKEDFONT_FILE_ERROR: File could not be opened or mapped.
+ *         BAKEDFONT_INVALID_FORMAT: File is not a valid font file.
+ */
+int bakedfont_open(bakedfont *font, const char *path);
+
+/**
+ * @brief Get vertical metrics of a baked size.
+ * @param font Font.
+ * @param size Pixel size.
+ * @param ascent Pointer where the distance from the top of a line to the baseline will be written.
+ * @param descent Pointer where the distance from the baseline to the bottom of a line will be written.
+ * @return BAKEDFONT_OK or BAKEDFONT_INVALID_ARGS if the size was not baked.
+ */
+int bakedfont_get_metrics(const bakedfont *font, unsigned int size, int *ascent, int *descent);
+
+/**
+ * @brief Measure a UTF-8 string. Characters not baked in the font are skipped.
+ * @param font Font.
+ * @param size Pixel size.
+ * @param str String.
+ * @param width Pointer where the width in pixels will be written.
+ * @param height Pointer where the line height in pixels will be written.
+ * @return BAKEDFONT_OK or BAKEDFONT_INVALID_ARGS if the size was not baked.
+ */
+int bakedfont_measure(const bakedfont *font, unsigned int size, const char *str, unsigned int *width,
+		unsigned int *height);
+
+/**
+ * @brief Draw a UTF-8 string on an opaque box, like textrender_draw(). Uses only stack memory: the box is written
+ *        in vertical strips, one window blit each.
+ * @param font Font.
+ * @param driver Initialised display driver.
+ * @param size Pixel size.
+ * @param x Left of the box.
+ * @param y Top of the box (the baseline is at y plus the font ascent).
+ * @param minWidth Minimum box width. Extra width is filled with the background colour.
+ * @param str String.
+ * @param fg Text colour (RGB565).
+ * @param bg Background colour (RGB565).
+ * @param width Pointer where the box width will be written. May be NULL.
+ * @return BAKEDFONT_OK or BAKEDFONT_INVALID_ARGS if the size was not baked.
+ */
+int bakedfont_draw(const bakedfont *font, display_driver *driver, unsigned int size, int x, int y,
+		unsigned int minWidth, const char *str, unsigned short fg, unsigned short bg, unsigned int *width);
+
+/**
+ * @brief Unmap font file.
+ * @param font Font.
+ */
+void bakedfont_close(bakedfont *font);
+
+#endif
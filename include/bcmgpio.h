@@ -21,6 +21,9 @@
 #ifndef BCMGPIO
 #define BCMGPIO
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* Return codes */
 #define BCMGPIO_OK 0x0
 #define BCMGPIO_ALREADY_INIT 0x100
@@ -28,11 +31,77 @@
 #define BCMGPIO_DEV_INACCESSIBLE 0x300
 #define BCMGPIO_MMAP_ERROR 0x400
 #define BCMGPIO_INVALID_ARGS 0x500
+#define BCMGPIO_NO_MEMORY 0x600
+#define BCMGPIO_FILE_ERROR 0x700
 
 /* Pin direction macros */
 #define BCMGPIO_DIR_IN 0
 #define BCMGPIO_DIR_OUT 1
 
+/* Offsets of the set and clear registers, in words */
+#define BCMGPIO_SET_OFFSET 0x7
+#define BCMGPIO_CLEAR_OFFSET 0xA
+
+/* Operations of bcmgpio_exec(). Stores match the BCMGPIO_TRACE_CLEAR flag of trace records */
+#define BCMGPIO_OP_SET 0
+#define BCMGPIO_OP_CLEAR 1
+#define BCMGPIO_OP_DELAY 2
+
+/* Operations per unrolled block of bcmgpio_exec_burst() */
+#define BCMGPIO_BURST 8
+
+/* Trace file identification */
+#define BCMGPIO_TRACE_MAGIC "PDGT"
+#define BCMGPIO_TRACE_VERSION 1
+
+/* Trace record flag: the store went to the clear register (otherwise to the set register) */
+#define BCMGPIO_TRACE_CLEAR 0x1
+
+/**
+ * @brief Trace file header. Records follow immediately, oldest first.
+ */
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	/* Records in the file */
+	uint32_t count;
+	/* Older records overwritten in the ring before the dump */
+	uint32_t dropped;
+} bcmgpio_trace_header;
+
+/**
+ * @brief Trace record: one store to the set or clear register.
+ */
+typedef struct {
+	/* Stored value (one bit per pin) */
+	uint32_t value;
+	/* BCMGPIO_TRACE_CLEAR in bit 0, nanoseconds since the previous store in the other bits (saturated) */
+	uint32_t meta;
+} bcmgpio_trace_record;
+
+/**
+ * @brief Operation of a sequence run by bcmgpio_exec().
+ */
+typedef struct {
+	/* BCMGPIO_OP_SET, BCMGPIO_OP_CLEAR or BCMGPIO_OP_DELAY */
+	uint32_t op;
+	/* Pins to set or clear (one bit per pin), or delay in nanoseconds */
+	uint32_t value;
+} bcmgpio_op;
+
+/* Mapped GPIO registers, NULL until bcmgpio_init() */
+extern volatile unsigned *bcmgpio_base;
+
+/* Trace ring, NULL unless capturing (see bcmgpio_trace_start()) */
+extern bcmgpio_trace_record *bcmgpio_traceRing;
+
+/**
+ * @brief Append a store to the trace ring. Only called by the unchecked writes below, while capturing.
+ * @param value Stored value.
+ * @param clear BCMGPIO_TRACE_CLEAR for the clear register, 0 for the set register.
+ */
+void bcmgpio_trace_store(unsigned int value, unsigned int clear);
+
 /**
  * @brief Initialise library.
  * @return One of the following error codes:
@@ -91,9 +160,16 @@ int bcmgpio_write_mask(unsigned int pinMask, unsigned int value);
  * @param pin Pin number.
  * @param value Bit to be written.
  *
- * @note Since there are no error checks, make sure bcmgpio_init() was executed before with success!
+ * @note Since there are no error checks, make sure bcmgpio_init() was executed before with success! It is defined
+ *       here so that it is inlined into the bus loops of drivers, leaving a single store (and a test of the trace
+ *       ring) per call.
  */
-inline void bcmgpio_write_uns(unsigned int pin, unsigned char value);
+static inline void bcmgpio_write_uns(unsigned int pin, unsigned char value) {
+	*(bcmgpio_base + (value? BCMGPIO_SET_OFFSET : BCMGPIO_CLEAR_OFFSET)) = 1 << pin;
+
+	if(bcmgpio_traceRing)
+		bcmgpio_trace_store(1 << pin, value? 0 : BCMGPIO_TRACE_CLEAR);
+}
 
 /**
  * @brief Write bits to the first 32 pins. Its behaviour is similar to bcmgpio_write_mask(), but there are no error checks.
@@ -102,7 +178,42 @@ inline void bcmgpio_write_uns(unsigned int pin, unsigned char value);
  *
  * @note Since there are no error checks, make sure bcmgpio_init() was executed before with success!
  */
-inline void bcmgpio_write_mask_uns(unsigned int pinMask, unsigned int value);
+static inline void bcmgpio_write_mask_uns(unsigned int pinMask, unsigned int value) {
+	*(bcmgpio_base + BCMGPIO_SET_OFFSET) = pinMask & value;
+	*(bcmgpio_base + BCMGPIO_CLEAR_OFFSET) = pinMask & ~value;
+
+	if(bcmgpio_traceRing) {
+		bcmgpio_trace_store(pinMask & value, 0);
+		bcmgpio_trace_store(pinMask & ~value, BCMGPIO_TRACE_CLEAR);
+	}
+}
+
+/**
+ * @brief Run a sequence of stores and delays, pre-encoded once (e.g. a command sequence or a whole scanline) and then
+ *        run as often as needed. The registers are held in locals for the whole loop. A memory barrier is placed
+ *        before the first operation, before each delay and after the last one, so that the stores are issued in
+ *        order around them. Delays are counted from the previous delay (or the start of the sequence), so the time
+ *        taken by the stores in between is part of them and timing does not drift along a sequence.
+ * @param ops Operations.
+ * @param n Number of operations.
+ * @return One of the following error codes:
+ *         BCMGPIO_OK: No errors occurred.
+ *         BCMGPIO_INVALID_ARGS: An operation is not a BCMGPIO_OP_* value. Nothing was run.
+ *         BCMGPIO_NOT_INIT: Library was not initialised. Run bcmgpio_init();
+ */
+int bcmgpio_exec(const bcmgpio_op *ops, size_t n);
+
+/**
+ * @brief Run a sequence of stores unrolled in blocks of BCMGPIO_BURST, without branches. Sequences with delays must be
+ *        run by bcmgpio_exec(). While capturing a trace, the sequence is run by bcmgpio_exec() so that it is traced.
+ * @param ops Operations, only BCMGPIO_OP_SET and BCMGPIO_OP_CLEAR.
+ * @param n Number of operations, a multiple of BCMGPIO_BURST.
+ * @return One of the following error codes:
+ *         BCMGPIO_OK: No errors occurred.
+ *         BCMGPIO_INVALID_ARGS: n is not a multiple of BCMGPIO_BURST, or an operation is not a store.
+ *         BCMGPIO_NOT_INIT: Library was not initialised. Run bcmgpio_init();
+ */
+int bcmgpio_exec_burst(const bcmgpio_op *ops, size_t n);
 
 /**
  * @brief Read bit from a pin.
@@ -118,6 +229,39 @@ unsigned char bcmgpio_read(unsigned int pin);
  */
 unsigned int bcmgpio_read_mask(unsigned int pinMask);
 
+/**
+ * @brief Start capturing every store to the set and clear registers, with its time, in a ring of records. Once the
+ *        ring is full, the oldest records are overwritten. Capturing adds a clock read and a record per store, so it
+ *        slows the bus down; times between stores should be read with that in mind.
+ * @param records Ring size in records (8 bytes each).
+ * @return One of the following error codes:
+ *         BCMGPIO_OK: No errors occurred.
+ *         BCMGPIO_INVALID_ARGS: Ring size is zero or a capture is already running.
+ *         BCMGPIO_NO_MEMORY: Ring could not be allocated.
+ */
+int bcmgpio_trace_start(unsigned int records);
+
+/**
+ * @brief Stop capturing and write the captured stores to a trace file.
+ * @param path Path to output file, or NULL to drop the captured stores.
+ * @return One of the following error codes:
+ *         BCMGPIO_OK: No errors occurred, or no capture was running.
+ *         BCMGPIO_FILE_ERROR: Trace file could not be written.
+ */
+int bcmgpio_trace_stop(const char *path);
+
+/**
+ * @brief Replay the stores of a trace file. Every pin the trace writes to is made an output first.
+ * @param path Path to trace file.
+ * @param timed Non-zero to keep the time between stores (busy waiting), zero to store as fast as possible.
+ * @return One of the following error codes:
+ *         BCMGPIO_OK: No errors occurred.
+ *         BCMGPIO_NOT_INIT: Library was not initialised. Run bcmgpio_init();
+ *         BCMGPIO_NO_MEMORY: Trace could not be loaded.
+ *         BCMGPIO_FILE_ERROR: Trace file could not be read or is not valid.
+ */
+int bcmgpio_trace_replay(const char *path, int timed);
+
 /**
  * @brief Free stuff and finish library.
  * @return One of the following error codes:
@@ -0,0 +1,122 @@
+/* ********************************************************************************************* */
+/* * Blitter Header for sprites over a static background                                       * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef BLITTER_H
+#define BLITTER_H
+
+#include "display.h"
+
+/* Return codes */
+#define BLITTER_OK 0x0
+#define BLITTER_INVALID_ARGS 0x100
+#define BLITTER_NO_MEMORY 0x200
+
+/* Sprite transparency modes */
+#define BLITTER_OPAQUE 0
+#define BLITTER_COLOURKEY 1
+#define BLITTER_ALPHA 2
+
+/**
+ * @brief Opaque blitter handle.
+ */
+typedef struct blitter_s blitter;
+
+/**
+ * @brief Create a blitter. As the panel cannot be read back, the blitter needs the scene beneath the sprites in host
+ *        memory: the background buffer acts as the save-under of every sprite, and moved sprites are erased by copying
+ *        from it. The buffer is not copied and must outlive the blitter.
+ * @param b Pointer where the blitter handle will be written.
+ * @param driver Initialised display driver.
+ * @param background RGB565 background with the size of the screen.
+ * @param stride Distance between background lines, in pixels.
+ * @return BLITTER_OK, BLITTER_INVALID_ARGS or BLITTER_NO_MEMORY.
+ */
+int blitter_create(blitter **b, display_driver *driver, const unsigned short *background, int stride);
+
+/**
+ * @brief Add a sprite on top of the existing ones. Sprites start hidden at (0, 0). The image is not copied and must
+ *        remain valid while the sprite exists.
+ * @param b Blitter handle.
+ * @param pixels RGB565 image.
+ * @param alpha Opacity of each pixel (0 to 255) for BLITTER_ALPHA, otherwise ignored.
+ * @param width Image width.
+ * @param height Image height.
+ * @param mode One of BLITTER_OPAQUE, BLITTER_COLOURKEY (pixels equal to key are transparent) or BLITTER_ALPHA.
+ * @param key Transparent colour for BLITTER_COLOURKEY.
+ * @param id Pointer where the sprite identifier will be written.
+ * @return BLITTER_OK, BLITTER_INVALID_ARGS or BLITTER_NO_MEMORY.
+ */
+int blitter_add_sprite(blitter *b, const unsigned short *pixels, const unsigned char *alpha, int width, int height,
+		int mode, unsigned short key, int *id);
+
+/**
+ * @brief Replace the image of a sprite (e.g. next animation frame), keeping its size and mode.
+ * @param b Blitter handle.
+ * @param id Sprite identifier.
+ * @param pixels RGB565 image.
+ * @param alpha Opacity of each pixel for BLITTER_ALPHA, otherwise ignored.
+ */
+void blitter_set_image(blitter *b, int id, const unsigned short *pixels, const unsigned char *alpha);
+
+/**
+ * @brief Move a sprite. Its top-left corner may lie off screen; sprites are clipped to the screen.
+ * @param b Blitter handle.
+ * @param id Sprite identifier.
+ * @param x New X coordinate.
+ * @param y New Y coordinate.
+ */
+void blitter_move(blitter *b, int id, int x, int y);
+
+/**
+ * @brief Show or hide a sprite.
+ * @param b Blitter handle.
+ * @param id Sprite identifier.
+ * @param visible Non-zero to show the sprite.
+ */
+void blitter_show(blitter *b, int id, int visible);
+
+/**
+ * @brief Mark a screen region for redraw, e.g. after the background buffer changed there.
+ * @param b Blitter handle.
+ * @param x Region X coordinate.
+ * @param y Region Y coordinate.
+ * @param w Region width.
+ * @param h Region height.
+ * @return BLITTER_OK or BLITTER_NO_MEMORY.
+ */
+int blitter_invalidate(blitter *b, int x, int y, int w, int h);
+
+/**
+ * @brief Send pending changes to the display. Each changed sprite contributes the box it left and the box it now
+ *        covers; overlapping boxes are merged into their union, and every resulting box is composed line by line from
+ *        the background and the sprites over it, then sent with a single window.
+ * @param b Blitter handle.
+ * @param pixels Pointer where the amount of sent pixels will be written. May be NULL.
+ * @return BLITTER_OK or BLITTER_NO_MEMORY.
+ */
+int blitter_flush(blitter *b, unsigned int *pixels);
+
+/**
+ * @brief Free blitter. Background and sprite images are not freed.
+ * @param b Blitter handle.
+ */
+void blitter_destroy(blitter *b);
+
+#endif
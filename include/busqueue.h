@@ -0,0 +1,180 @@
+/* ********************************************************************************************* */
+/* * Bus Queue Header for multi-threaded drawing                                               * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef BUSQUEUE_H
+#define BUSQUEUE_H
+
+#include "display.h"
+
+/* Return codes */
+#define BUSQUEUE_OK 0x0
+#define BUSQUEUE_INVALID_ARGS 0x100
+#define BUSQUEUE_NO_MEMORY 0x200
+#define BUSQUEUE_THREAD_ERROR 0x300
+#define BUSQUEUE_FULL 0x400
+#define BUSQUEUE_RT_ERROR 0x500
+
+/* Core selection for busqueue_set_realtime() */
+#define BUSQUEUE_CPU_ISOLATED -1
+#define BUSQUEUE_CPU_ANY -2
+
+/* Histogram bins. Bin 0 counts durations under 1 us, bin i > 0 from 2^(i - 1) to 2^i us, the last one anything longer */
+#define BUSQUEUE_HIST_BINS 24
+
+/**
+ * @brief Flush statistics. A batch is what one busqueue_submit() call placed in the ring.
+ */
+typedef struct {
+	/* Batches sent */
+	unsigned int batches;
+	/* Time from submission until the last command of a batch was sent */
+	unsigned int latency[BUSQUEUE_HIST_BINS];
+	/* Time the bus thread was preempted while sending a batch */
+	unsigned int gaps[BUSQUEUE_HIST_BINS];
+	/* Longest latency and gap, in microseconds */
+	unsigned int maxLatency;
+	unsigned int maxGap;
+	/* Frames sent on a refresh boundary (see busqueue_vsync()) */
+	unsigned int frames;
+	/* Time from the refresh boundary of a frame until all of it was sent, and the longest one, in microseconds */
+	unsigned int present[BUSQUEUE_HIST_BINS];
+	unsigned int maxPresent;
+} busqueue_stats;
+
+/**
+ * @brief Opaque queue handle.
+ */
+typedef struct busqueue_s busqueue;
+
+/**
+ * @brief Opaque batch handle. Each producer thread uses its own batch.
+ */
+typedef struct busqueue_batch_s busqueue_batch;
+
+/**
+ * @brief Create a drawing queue and its bus thread. Draw commands are placed by any number of producer threads in a
+ *        lock-free ring of fixed-size slots (large blits take several slots), and a single consumer thread, the only
+ *        one using the driver, sends them to the display. The consumer keeps track of the open window and cursor, so
+ *        commands that continue where the previous one ended are sent without addressing, and consecutive fills of
+ *        one colour are merged.
+ * @param q Pointer where the queue handle will be written.
+ * @param driver Initialised display driver. It must not be used by anyone else while the queue exists.
+ * @param slots Ring size in slots (a power of two).
+ * @return One of the following error codes:
+ *         BUSQUEUE_OK: No errors occurred.
+ *         BUSQUEUE_INVALID_ARGS: Ring size is not a power of two.
+ *         BUSQUEUE_NO_MEMORY: Out of memory.
+ *         BUSQUEUE_THREAD_ERROR: Bus thread could not be created.
+ */
+int busqueue_create(busqueue **q, display_driver *driver, unsigned int slots);
+
+/**
+ * @brief Create a batch, where a producer stages commands before submitting them at once.
+ * @param q Queue handle.
+ * @param b Pointer where the batch handle will be written.
+ * @param slots Staging size in slots (at most half the ring). Staging more is submitted on the way, waiting for room.
+ * @return BUSQUEUE_OK, BUSQUEUE_INVALID_ARGS or BUSQUEUE_NO_MEMORY.
+ */
+int busqueue_batch_create(busqueue *q, busqueue_batch **b, unsigned int slots);
+
+/**
+ * @brief Stage a rectangle fill, clipped to the screen.
+ * @param b Batch handle.
+ * @param x Rectangle X coordinate.
+ * @param y Rectangle Y coordinate.
+ * @param w Rectangle width.
+ * @param h Rectangle height.
+ * @param colour RGB565 colour.
+ */
+void busqueue_fill(busqueue_batch *b, int x, int y, int w, int h, unsigned short colour);
+
+/**
+ * @brief Stage an image blit, clipped to the screen. Pixels are copied, so the image may be reused right away.
+ * @param b Batch handle.
+ * @param x Destination X coordinate.
+ * @param y Destination Y coordinate.
+ * @param w Image width.
+ * @param h Image height.
+ * @param pixels RGB565 image.
+ * @param stride Distance between image lines, in pixels.
+ */
+void busqueue_blit(busqueue_batch *b, int x, int y, int w, int h, const unsigned short *pixels, int stride);
+
+/**
+ * @brief Stage a refresh boundary. The commands staged after it, up to the next boundary or the end of the batch, are
+ *        a frame: the bus thread waits until the panel scan has just left the area they cover before sending them, so
+ *        they do not tear (see display_wait_vsync()). A frame should be staged and submitted as one batch, starting
+ *        with this call; a frame larger than the batch is synchronised for the whole screen. Producers waiting for
+ *        room in the ring are paced by the panel instead of sending frames that would never be seen. Without driver
+ *        synchronisation (display_set_vsync()), frames are sent right away.
+ * @param b Batch handle.
+ */
+void busqueue_vsync(busqueue_batch *b);
+
+/**
+ * @brief Submit staged commands. All of them are reserved in the ring with a single atomic operation.
+ * @param b Batch handle.
+ * @param wait Non-zero to wait while the ring is full (backpressure), zero to give up.
+ * @return BUSQUEUE_OK, or BUSQUEUE_FULL if not waiting and there is no room (commands stay staged).
+ */
+int busqueue_submit(busqueue_batch *b, int wait);
+
+/**
+ * @brief Free batch. Staged commands are dropped.
+ * @param b Batch handle.
+ */
+void busqueue_batch_destroy(busqueue_batch *b);
+
+/**
+ * @brief Wait until every command submitted so far has been sent.
+ * @param q Queue handle.
+ */
+void busqueue_sync(busqueue *q);
+
+/**
+ * @brief Put the bus thread in real-time mode, so that the kernel does not stall it in the middle of a transfer. The
+ *        thread is pinned to a core and scheduled with SCHED_FIFO, and all memory of the process (ring, framebuffers,
+ *        stacks, code and the driver GPIO mapping) is locked and faulted in with mlockall(), which also covers later
+ *        allocations. The heap is set to never return memory to the kernel, so locked pages stay. Steps applied
+ *        before a failure are kept. It usually needs root privileges.
+ * @param q Queue handle.
+ * @param cpu Core to pin the bus thread to, BUSQUEUE_CPU_ISOLATED for the first core isolated with isolcpus= (or the
+ *        last core if none is) or BUSQUEUE_CPU_ANY to leave it unpinned.
+ * @param priority SCHED_FIFO priority (1 to 99), or 0 to keep normal scheduling.
+ * @return BUSQUEUE_OK, BUSQUEUE_INVALID_ARGS or BUSQUEUE_RT_ERROR if a step failed.
+ */
+int busqueue_set_realtime(busqueue *q, int cpu, int priority);
+
+/**
+ * @brief Get flush statistics, collected since the queue was created or last reset. The preemption gap of a batch is
+ *        the time spent in driver calls minus the CPU time of the bus thread, so waiting for producers does not count.
+ * @param q Queue handle.
+ * @param stats Pointer where the statistics will be written.
+ * @param reset Non-zero to start collecting again from zero.
+ */
+void busqueue_get_stats(busqueue *q, busqueue_stats *stats, int reset);
+
+/**
+ * @brief Send remaining commands, stop the bus thread and free the queue. Batches must be freed before.
+ * @param q Queue handle.
+ */
+void busqueue_destroy(busqueue *q);
+
+#endif
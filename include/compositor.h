@@ -0,0 +1,118 @@
+/* ********************************************************************************************* */
+/* * Compositor Header for layered screens                                                     * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "display.h"
+
+/* Return codes */
+#define COMPOSITOR_OK 0x0
+#define COMPOSITOR_INVALID_ARGS 0x100
+#define COMPOSITOR_NO_MEMORY 0x200
+
+/* Layer formats */
+#define COMPOSITOR_RGB565 0
+#define COMPOSITOR_ARGB8888 1
+
+/* Side of the square tiles damage is tracked in */
+#define COMPOSITOR_TILE 16
+
+/**
+ * @brief Opaque compositor handle.
+ */
+typedef struct compositor_s compositor;
+
+/**
+ * @brief Create a compositor covering the screen. The screen is split in COMPOSITOR_TILE x COMPOSITOR_TILE tiles;
+ *        changes mark tiles as damaged, and only those are composed and sent by compositor_flush().
+ * @param c Pointer where the compositor handle will be written.
+ * @param driver Initialised display driver.
+ * @return COMPOSITOR_OK or COMPOSITOR_NO_MEMORY.
+ */
+int compositor_create(compositor **c, display_driver *driver);
+
+/**
+ * @brief Add a layer on top of the existing ones. Layers start visible at (0, 0), fully opaque and damaged. The buffer
+ *        is not copied; the caller draws into it and reports changes with compositor_damage().
+ * @param c Compositor handle.
+ * @param format COMPOSITOR_RGB565 (unsigned short pixels, opaque) or COMPOSITOR_ARGB8888 (unsigned int pixels as
+ *        0xAARRGGBB, with premultiplied alpha: no channel may exceed alpha).
+ * @param pixels Layer buffer.
+ * @param width Layer width.
+ * @param height Layer height.
+ * @param stride Distance between buffer lines, in pixels.
+ * @param id Pointer where the layer identifier will be written.
+ * @return COMPOSITOR_OK, COMPOSITOR_INVALID_ARGS or COMPOSITOR_NO_MEMORY.
+ */
+int compositor_add_layer(compositor *c, int format, const void *pixels, int width, int height, int stride, int *id);
+
+/**
+ * @brief Move a layer. Damages the areas it leaves and covers.
+ * @param c Compositor handle.
+ * @param id Layer identifier.
+ * @param x New X coordinate of the top-left corner (may be off screen).
+ * @param y New Y coordinate of the top-left corner (may be off screen).
+ */
+void compositor_set_position(compositor *c, int id, int x, int y);
+
+/**
+ * @brief Set the opacity a layer is blended with, on top of its own alpha.
+ * @param c Compositor handle.
+ * @param id Layer identifier.
+ * @param opacity Opacity, from 0 (invisible) to 255.
+ */
+void compositor_set_opacity(compositor *c, int id, unsigned int opacity);
+
+/**
+ * @brief Show or hide a layer.
+ * @param c Compositor handle.
+ * @param id Layer identifier.
+ * @param visible Non-zero to show the layer.
+ */
+void compositor_show(compositor *c, int id, int visible);
+
+/**
+ * @brief Report a change in a layer buffer.
+ * @param c Compositor handle.
+ * @param id Layer identifier.
+ * @param x Changed region X coordinate, in layer coordinates.
+ * @param y Changed region Y coordinate, in layer coordinates.
+ * @param w Changed region width.
+ * @param h Changed region height.
+ */
+void compositor_damage(compositor *c, int id, int x, int y, int w, int h);
+
+/**
+ * @brief Compose damaged tiles and send them to the display. Layers are blended bottom to top with premultiplied
+ *        alpha, 8 pixels at a time, starting from the topmost layer that covers a tile line opaquely. Horizontal runs
+ *        of damaged tiles are sent through one window.
+ * @param c Compositor handle.
+ * @param tiles Pointer where the amount of sent tiles will be written. May be NULL.
+ */
+void compositor_flush(compositor *c, unsigned int *tiles);
+
+/**
+ * @brief Free compositor. Layer buffers are not freed.
+ * @param c Compositor handle.
+ */
+void compositor_destroy(compositor *c);
+
+#endif
@@ -0,0 +1,122 @@
+/* ********************************************************************************************* */
+/* * Console Header for text terminal on the display                                           * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stddef.h>
+
+#include "display.h"
+#include "textrender.h"
+
+/* Return codes */
+#define CONSOLE_OK 0x0
+#define CONSOLE_INVALID_ARGS 0x100
+#define CONSOLE_NO_MEMORY 0x200
+#define CONSOLE_FONT_ERROR 0x300
+
+/* Colours (indices in the 16-colour ANSI palette) */
+#define CONSOLE_BLACK 0
+#define CONSOLE_RED 1
+#define CONSOLE_GREEN 2
+#define CONSOLE_YELLOW 3
+#define CONSOLE_BLUE 4
+#define CONSOLE_MAGENTA 5
+#define CONSOLE_CYAN 6
+#define CONSOLE_WHITE 7
+#define CONSOLE_BRIGHT 8
+
+/* Attribute flags */
+#define CONSOLE_ATTR_UNDERLINE 0x1
+#define CONSOLE_ATTR_REVERSE 0x2
+#define CONSOLE_ATTR_BOLD 0x4
+
+/**
+ * @brief Opaque console handle.
+ */
+typedef struct console_s console;
+
+/**
+ * @brief Create a text console covering the screen. The console is a grid of character cells, sized after the widest
+ *        of the printable ASCII glyphs of a (preferably monospace) font. Writes only update the grid; changed cells are
+ *        sent to the display by console_flush().
+ * @param con Pointer where the console handle will be written.
+ * @param driver Initialised display driver.
+ * @param tr Text renderer used for glyph lookup.
+ * @param font Font identifier in tr.
+ * @param size Pixel size.
+ * @return One of the following error codes:
+ *         CONSOLE_OK: No errors occurred.
+ *         CONSOLE_INVALID_ARGS: Cells do not fit the screen.
+ *         CONSOLE_NO_MEMORY: Out of memory.
+ *         CONSOLE_FONT_ERROR: Glyph lookup failed.
+ */
+int console_create(console **con, display_driver *driver, textrender *tr, int font, unsigned int size);
+
+/**
+ * @brief Get grid size.
+ * @param con Console handle.
+ * @param cols Pointer where the amount of columns will be written.
+ * @param rows Pointer where the amount of rows will be written.
+ */
+void console_get_size(console *con, unsigned int *cols, unsigned int *rows);
+
+/**
+ * @brief Set attributes of the text written next.
+ * @param con Console handle.
+ * @param fg Foreground colour (0 to 15).
+ * @param bg Background colour (0 to 15).
+ * @param attr Attribute flags (CONSOLE_ATTR_*). Bold text is drawn with the bright variant of its colour.
+ */
+void console_set_attr(console *con, unsigned int fg, unsigned int bg, unsigned int attr);
+
+/**
+ * @brief Write UTF-8 text at the cursor. Handles \\n, \\r, \\t and \\b, and the following escape sequences: SGR
+ *        (ESC [ ... m: 0, 1, 4, 7, 22, 24, 27, 30-37, 39, 40-47, 49, 90-97, 100-107), cursor position (ESC [ row ; col
+ *        H), erase display (ESC [ 2 J) and erase to end of line (ESC [ K). Sequences may be split across calls.
+ *        Writing past the last line scrolls the grid up.
+ * @param con Console handle.
+ * @param text Text.
+ * @param len Text length in bytes.
+ */
+void console_write(console *con, const char *text, size_t len);
+
+/**
+ * @brief Clear the grid and move the cursor home.
+ * @param con Console handle.
+ */
+void console_clear(console *con);
+
+/**
+ * @brief Send changed cells to the display. Cells are compared against what is on screen, and consecutive changed
+ *        cells of a line are written with one window blit.
+ * @param con Console handle.
+ * @param cells Pointer where the amount of redrawn cells will be written. May be NULL.
+ * @return CONSOLE_OK, CONSOLE_NO_MEMORY or CONSOLE_FONT_ERROR.
+ */
+int console_flush(console *con, unsigned int *cells);
+
+/**
+ * @brief Free console. The renderer is not freed.
+ * @param con Console handle.
+ */
+void console_destroy(console *con);
+
+#endif
@@ -0,0 +1,68 @@
+/* ********************************************************************************************* */
+/* * Dirty Rectangle List Header for PiDisplayLibs                                             * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef DIRTYRECT_H
+#define DIRTYRECT_H
+
+/* Return codes */
+#define DIRTYRECT_OK 0x0
+#define DIRTYRECT_NO_MEMORY 0x100
+
+/**
+ * @brief Screen rectangle (inclusive).
+ */
+typedef struct {
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+} dirtyrect;
+
+/**
+ * @brief List of disjoint rectangles to redraw.
+ */
+typedef struct {
+	dirtyrect *rects;
+	int n;
+	int capacity;
+} dirtyrect_list;
+
+/**
+ * @brief Initialise an empty list with room for at least one rectangle, so that it can always hold the whole screen.
+ * @param l List.
+ * @return DIRTYRECT_OK or DIRTYRECT_NO_MEMORY.
+ */
+int dirtyrect_init(dirtyrect_list *l);
+
+/**
+ * @brief Add a rectangle, merging it with every rectangle it overlaps. Rectangles in the list stay disjoint.
+ * @param l List.
+ * @param r Rectangle.
+ * @return DIRTYRECT_OK or DIRTYRECT_NO_MEMORY (the list is left as it was).
+ */
+int dirtyrect_add(dirtyrect_list *l, dirtyrect r);
+
+/**
+ * @brief Free the rectangles of a list.
+ * @param l List.
+ */
+void dirtyrect_free(dirtyrect_list *l);
+
+#endif
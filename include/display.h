@@ -24,6 +24,80 @@
 /* Return codes */
 #define DISPLAY_OK 0x0
 #define DISPLAY_GPIO_ERROR 0x10000
+#define DISPLAY_INVALID_ARGS 0x20000
+#define DISPLAY_SHM_ERROR 0x30000
+#define DISPLAY_TIMEOUT 0x40000
+
+/* Flags for display_set_stats() */
+#define DISPLAY_STATS_ENABLE 0x1
+#define DISPLAY_STATS_SHARED 0x2
+
+/* Panel selection for display_select(): every panel side by side */
+#define DISPLAY_CANVAS -1
+
+/* Transfer time bins. Bin 0 counts transfers under 1 us, bin i > 0 from 2^(i - 1) to 2^i us, the last one longer ones */
+#define DISPLAY_STATS_BINS 24
+
+/**
+ * @brief Pack 8-bit colour components into a 16-bit RGB565 colour, as accepted by display_write_rgb565().
+ */
+#define DISPLAY_RGB565(r, g, b) ((((r) << 8) & 0xF800) | (((g) << 3) & 0x7E0) | (((b) >> 3) & 0x1F))
+
+/**
+ * @brief Driver counters, as returned by display_get_stats().
+ */
+typedef struct {
+	/* Register selections */
+	unsigned long long commands;
+	/* Register writes (a selection plus a value) */
+	unsigned long long registers;
+	/* Calls to display_set_xy() and display_set_window() */
+	unsigned long long readdresses;
+	/* Pixels written */
+	unsigned long long pixels;
+	/* WR strobes, one per byte on the bus */
+	unsigned long long strobes;
+	/* Stores to GPIO registers */
+	unsigned long long gpioStores;
+	/* Pixel transfers (display_write_rgb565(), display_fill_rgb565() and display_write_words() calls) */
+	unsigned long long transfers;
+	/* Time spent in pixel transfers, in nanoseconds, and its histogram */
+	unsigned long long transferNs;
+	unsigned long long transferTime[DISPLAY_STATS_BINS];
+} display_stats;
+
+/**
+ * @brief Panel on a bus shared with other panels, as passed to display_init() by drivers that support several.
+ */
+typedef struct {
+	/* Chip select and reset pins */
+	int cs;
+	int rst;
+} display_panel;
+
+/**
+ * @brief Table of driver functions, as retrieved from a driver library by driverloader_open(). Modules that talk to the
+ *        display (e.g. slideshow) receive a pointer to this structure instead of calling dlsym() by themselves.
+ */
+typedef struct {
+	int (* init)(void *, int);
+	int (* set_xy)(int, int);
+	int (* draw)(unsigned char, unsigned char, unsigned char);
+	int (* set_window)(int, int, int, int);
+	int (* write_rgb565)(const unsigned short *, unsigned int);
+	int (* fill_rgb565)(unsigned short, unsigned int);
+	int (* scroll)(int);
+	int (* get_resolution)(int *, int *);
+	int (* encode_words)(const unsigned short *, unsigned int, unsigned int *);
+	int (* write_words)(const unsigned int *, unsigned int);
+	int (* get_bus_id)(unsigned int *);
+	int (* set_stats)(unsigned int);
+	int (* get_stats)(display_stats *);
+	int (* set_vsync)(int);
+	int (* wait_vsync)(int, int, int, int, unsigned long long *);
+	int (* select)(int);
+	int (* finish)(void);
+} display_driver;
 
 #ifndef DISPLAY_NOFUNCS
 
@@ -52,12 +126,143 @@ int display_set_xy(int x, int y);
  */
 int display_draw(unsigned char r, unsigned char g, unsigned char b);
 
+/**
+ * @brief Set a rectangular drawing window and move to its top-left corner. Subsequent pixels are written left to right,
+ *        top to bottom, wrapping inside the window. Use display_set_xy() or a full-screen window to return to normal
+ *        drawing.
+ * @param x0 Leftmost column.
+ * @param y0 Topmost row.
+ * @param x1 Rightmost column (inclusive).
+ * @param y1 Bottommost row (inclusive).
+ * @return Return code. See specific notes for each driver.
+ */
+int display_set_window(int x0, int y0, int x1, int y1);
+
+/**
+ * @brief Write a sequence of pixels in RGB565 format starting on current memory position.
+ * @param pixels Pixel array. Each element is a colour in RGB565 format (see display_draw() notes of each driver).
+ * @param n Number of pixels in the array.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_write_rgb565(const unsigned short *pixels, unsigned int n);
+
+/**
+ * @brief Write the same RGB565 colour n times starting on current memory position.
+ * @param colour Colour in RGB565 format.
+ * @param n Number of pixels.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_fill_rgb565(unsigned short colour, unsigned int n);
+
+/**
+ * @brief Scroll the screen horizontally using the controller scroll register. No pixel is transferred.
+ *        After this call, screen column x shows memory column (x + offset) mod xres. Drawing functions keep addressing
+ *        memory columns, so callers using scroll must translate their coordinates (and split windows that wrap).
+ * @param offset Scroll offset in columns. Zero disables scrolling.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_scroll(int offset);
+
+/**
+ * @brief Get display resolution.
+ * @param xres Pointer where the amount of columns will be written.
+ * @param yres Pointer where the amount of rows will be written.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_get_resolution(int *xres, int *yres);
+
+/**
+ * @brief Encode RGB565 pixels into the GPIO words that the driver puts on the data bus, so that they can be stored and
+ *        later written with display_write_words() without any conversion.
+ * @param pixels Pixel array in RGB565 format.
+ * @param n Number of pixels in the array.
+ * @param words Output array. Its length depends on the bus width of the driver: 2 * n for 8-bit buses.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_encode_words(const unsigned short *pixels, unsigned int n, unsigned int *words);
+
+/**
+ * @brief Write a sequence of GPIO words produced by display_encode_words() starting on current memory position.
+ * @param words Word array.
+ * @param n Number of words in the array.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_write_words(const unsigned int *words, unsigned int n);
+
+/**
+ * @brief Get an identifier of the data bus pin map. Words from display_encode_words() are only valid for drivers with
+ *        the same identifier.
+ * @param id Pointer where the identifier will be written.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_get_bus_id(unsigned int *id);
+
+/**
+ * @brief Turn driver counters on or off. Counting is compiled in and costs a few increments per driver call (never
+ *        per GPIO store) while on, and a single test while off. It may also be turned on without code changes by
+ *        setting the PIDISPLAY_STATS environment variable to "1", or to "shared" for the shared page, before
+ *        display_init().
+ * @param flags Zero to stop counting, DISPLAY_STATS_ENABLE to count, plus DISPLAY_STATS_SHARED to also keep the
+ *        counters in a shared memory page named "/pidisplaylibs.PID", that the displaystat tool reads live (and may
+ *        turn on or off). Counters keep their values across calls.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_set_stats(unsigned int flags);
+
+/**
+ * @brief Get driver counters, summed over every thread that used the driver.
+ * @param stats Pointer where the counters will be written.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_get_stats(display_stats *stats);
+
+/**
+ * @brief Turn tear-free synchronisation on or off. When on, the panel signals the start of each refresh on a GPIO
+ *        input (the FMARK output of ILI932x controllers) and display_wait_vsync() times writes against its scan. It
+ *        may also be turned on without code changes by setting the PIDISPLAY_VSYNC environment variable to "1" before
+ *        display_init().
+ * @param enable Non-zero to turn synchronisation on, zero to turn it off.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_set_vsync(int enable);
+
+/**
+ * @brief Wait until a window may be written without tearing: right after the panel scan has refreshed it, so that a
+ *        write has the longest possible time before the scan comes back to it.
+ * @param x0 Leftmost column of the window.
+ * @param y0 Topmost row of the window.
+ * @param x1 Rightmost column of the window (inclusive).
+ * @param y1 Bottommost row of the window (inclusive).
+ * @param timestamp Pointer where the time the scan left the window will be written (CLOCK_MONOTONIC, in nanoseconds).
+ *        May be NULL.
+ * @return Return code. See specific notes for each driver.
+ */
+int display_wait_vsync(int x0, int y0, int x1, int y1, unsigned long long *timestamp);
+
+/**
+ * @brief Select which panel the following calls address, when several panels share the bus. Each panel can then be
+ *        drawn on with its own coordinates, or all of them as a single canvas, one next to the other.
+ * @param panel Panel index, or DISPLAY_CANVAS for the canvas (the default).
+ * @return Return code. See specific notes for each driver.
+ */
+int display_select(int panel);
+
 /**
  * @brief Close handles, free memory, finish use.
  * @return Return code. See specific notes for each driver.
  */
 int display_finish(void);
 
+/**
+ * @brief Initialiser of a function table for a driver linked into the program (e.g. lib/libili9325.a) instead of loaded
+ *        with driverloader_open(), e.g. display_driver driver = DISPLAY_DRIVER_STATIC;
+ */
+#define DISPLAY_DRIVER_STATIC { \
+	display_init, display_set_xy, display_draw, display_set_window, display_write_rgb565, display_fill_rgb565, \
+	display_scroll, display_get_resolution, display_encode_words, display_write_words, display_get_bus_id, \
+	display_set_stats, display_get_stats, display_set_vsync, display_wait_vsync, display_select, display_finish \
+}
+
 #endif
 
 #endif
@@ -0,0 +1,133 @@
+/* ********************************************************************************************* */
+/* * Display List Header for PiDisplayLibs                                                     * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef DISPLAYLIST_H
+#define DISPLAYLIST_H
+
+#include <stddef.h>
+
+#include "display.h"
+
+/* Return codes */
+#define DISPLAYLIST_OK 0x0
+#define DISPLAYLIST_INVALID_ARGS 0x100
+#define DISPLAYLIST_NO_MEMORY 0x200
+#define DISPLAYLIST_FILE_ERROR 0x300
+#define DISPLAYLIST_BUS_MISMATCH 0x400
+#define DISPLAYLIST_DRIVER_ERROR 0x500
+
+/**
+ * @brief Opaque display list handle.
+ */
+typedef struct displaylist_s displaylist;
+
+/**
+ * @brief Create an empty display list. A display list is a recorded sequence of driver calls (addressing, pixels,
+ *        fills and scrolls) kept in an arena of large chunks, so recording does not allocate per call and replaying
+ *        neither allocates nor validates anything.
+ * @param l Pointer where the display list handle will be written.
+ * @param xres Amount of columns of the target display.
+ * @param yres Amount of rows of the target display.
+ * @return DISPLAYLIST_OK, DISPLAYLIST_INVALID_ARGS or DISPLAYLIST_NO_MEMORY.
+ */
+int displaylist_create(displaylist **l, int xres, int yres);
+
+/**
+ * @brief Start recording. The recorder table has the same functions as a display driver, so it can be used directly
+ *        or handed to any module that draws through a display_driver (e.g. raster). Calls are validated as they are
+ *        recorded; single pixels from draw() are packed into runs and consecutive writes or fills of the same colour
+ *        are merged. Only one list may be recorded at a time on each thread, from that thread. encode_words(),
+ *        write_words() and get_bus_id() are not available while recording (see displaylist_encode()), nor are the
+ *        driver counters, synchronisation and panel selection.
+ * @param l Display list handle. Calls are appended to what the list already holds.
+ * @param recorder Pointer to a function table to be filled. It is valid until displaylist_end().
+ * @return DISPLAYLIST_OK or DISPLAYLIST_INVALID_ARGS if a list is already being recorded on this thread.
+ */
+int displaylist_begin(displaylist *l, display_driver *recorder);
+
+/**
+ * @brief Stop recording. The list may then be replayed from any thread.
+ * @param l Display list handle.
+ * @return DISPLAYLIST_OK or the first error found while recording: DISPLAYLIST_INVALID_ARGS for a call with invalid
+ *         arguments (it was not recorded) or DISPLAYLIST_NO_MEMORY (the list misses calls from that point on).
+ */
+int displaylist_end(displaylist *l);
+
+/**
+ * @brief Convert the recorded RGB565 pixels into the GPIO words of a driver, so that replaying skips the conversion.
+ *        The list then only replays on drivers with the same bus identifier. Pixels recorded afterwards are kept in
+ *        RGB565 until this function is called again.
+ * @param l Display list handle.
+ * @param driver Initialised display driver.
+ * @return DISPLAYLIST_OK, DISPLAYLIST_NO_MEMORY or DISPLAYLIST_BUS_MISMATCH if the list was already encoded for a
+ *         different bus.
+ */
+int displaylist_encode(displaylist *l, display_driver *driver);
+
+/**
+ * @brief Replay a display list. Resolution and bus identifier are checked once; the calls themselves are replayed as
+ *        recorded. The list is not modified, so it may be replayed as many times as needed.
+ * @param l Display list handle.
+ * @param driver Initialised display driver.
+ * @return One of the following error codes:
+ *         DISPLAYLIST_OK: No errors occurred.
+ *         DISPLAYLIST_INVALID_ARGS: The driver resolution differs from the one of the list.
+ *         DISPLAYLIST_BUS_MISMATCH: The list was encoded for a different bus.
+ *         DISPLAYLIST_DRIVER_ERROR: A driver call failed. Calls after it were not replayed.
+ */
+int displaylist_replay(displaylist *l, display_driver *driver);
+
+/**
+ * @brief Empty a display list. Its chunks are kept and reused by the next recording.
+ * @param l Display list handle.
+ */
+void displaylist_clear(displaylist *l);
+
+/**
+ * @brief Save a display list to a file.
+ * @param l Display list handle.
+ * @param path Path to output file.
+ * @return DISPLAYLIST_OK or DISPLAYLIST_FILE_ERROR.
+ */
+int displaylist_save(displaylist *l, const char *path);
+
+/**
+ * @brief Load a display list saved by displaylist_save(). Its calls are validated once, when loading.
+ * @param l Pointer where the display list handle will be written.
+ * @param path Path to input file.
+ * @return DISPLAYLIST_OK, DISPLAYLIST_NO_MEMORY or DISPLAYLIST_FILE_ERROR if the file could not be read or is not a
+ *         valid display list.
+ */
+int displaylist_load(displaylist **l, const char *path);
+
+/**
+ * @brief Get the memory taken by recorded calls.
+ * @param l Display list handle.
+ * @return Size in bytes.
+ */
+size_t displaylist_get_size(displaylist *l);
+
+/**
+ * @brief Free display list and its chunks.
+ * @param l Display list handle.
+ */
+void displaylist_destroy(displaylist *l);
+
+#endif
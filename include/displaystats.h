@@ -0,0 +1,147 @@
+/* ********************************************************************************************* */
+/* * Display Statistics Header for PiDisplayLibs                                               * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef DISPLAYSTATS_H
+#define DISPLAYSTATS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "display.h"
+
+/* Shared page identification. The name takes the PID of the process using the driver */
+#define DISPLAYSTATS_MAGIC "PDST"
+#define DISPLAYSTATS_VERSION 2
+#define DISPLAYSTATS_SHM_NAME "/pidisplaylibs.%d"
+
+/* Threads with counters of their own. Further threads share an overflow block, counting there with atomics */
+#define DISPLAYSTATS_THREADS 8
+
+/* Cache line size. Blocks start on a line and are padded to whole lines */
+#define DISPLAYSTATS_LINE 64
+
+/**
+ * @brief Counters of one thread, alone in their cache lines.
+ */
+typedef struct {
+	display_stats stats;
+} __attribute__((aligned(DISPLAYSTATS_LINE))) displaystats_block;
+
+/**
+ * @brief Counter page. Each thread counts in its own block, so counting needs neither atomics nor shared cache lines;
+ *        readers sum the blocks.
+ */
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	/* Non-zero while counting. External readers (see displaystat) may change it */
+	volatile uint32_t enabled;
+	/* Threads that claimed a block (those beyond DISPLAYSTATS_THREADS share the last one) */
+	volatile uint32_t nThreads;
+	displaystats_block threads[DISPLAYSTATS_THREADS + 1];
+} displaystats_page;
+
+/* Page in use: a private one, or the shared one */
+extern displaystats_page *displaystats_current;
+
+/* Block of the calling thread, -1 until it first counts */
+extern _Thread_local int displaystats_slot __attribute__((tls_model("initial-exec")));
+
+/**
+ * @brief Assign a block to the calling thread.
+ * @return Block index.
+ */
+int displaystats_claim(void);
+
+/**
+ * @brief Get the counters of the calling thread.
+ * @return Counters to update, or NULL if counting is off.
+ */
+static inline display_stats *displaystats_get(void) {
+	displaystats_page *page = displaystats_current;
+
+	if(!page->enabled)
+		return NULL;
+
+	return &(page->threads[(displaystats_slot >= 0)? displaystats_slot : displaystats_claim()].stats);
+}
+
+/**
+ * @brief Add to a counter of the calling thread, from displaystats_get(). Plain additions in a block of its own, atomic
+ *        ones in the overflow block.
+ * @param stats Counters of the calling thread.
+ * @param counter Counter member.
+ * @param n Amount to add.
+ */
+#define DISPLAYSTATS_ADD(stats, counter, n) do { \
+		if(displaystats_slot < DISPLAYSTATS_THREADS) \
+			(stats)->counter += (n); \
+		else \
+			__atomic_fetch_add(&((stats)->counter), (n), __ATOMIC_RELAXED); \
+	} while(0)
+
+/**
+ * @brief Read the clock used for transfer times.
+ * @return Time in nanoseconds.
+ */
+static inline uint64_t displaystats_now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Account a pixel transfer.
+ * @param stats Counters of the calling thread.
+ * @param pixels Pixels transferred.
+ * @param start Time when the transfer started, from displaystats_now().
+ */
+void displaystats_transfer(display_stats *stats, unsigned int pixels, uint64_t start);
+
+/**
+ * @brief Apply the PIDISPLAY_STATS environment variable, if set.
+ * @return DISPLAY_OK or DISPLAY_SHM_ERROR.
+ */
+int displaystats_init(void);
+
+/**
+ * @brief Turn counters on or off, optionally moving them to the shared page (see display_set_stats()).
+ * @param flags DISPLAY_STATS_* flags.
+ * @return DISPLAY_OK or DISPLAY_SHM_ERROR.
+ */
+int displaystats_set(unsigned int flags);
+
+/**
+ * @brief Sum the counters of every thread.
+ * @param page Counter page (e.g. displaystats_current, or a shared page mapped by another process).
+ * @param stats Pointer where the sum will be written.
+ */
+void displaystats_sum(const displaystats_page *page, display_stats *stats);
+
+/**
+ * @brief Remove the name of the shared page, if any, so that other processes can no longer open it. The page stays
+ *        mapped and counting goes on in it, as other threads may still hold pointers into it. A later
+ *        displaystats_set() with DISPLAY_STATS_SHARED publishes it again at the same address.
+ */
+void displaystats_finish(void);
+
+#endif
@@ -0,0 +1,49 @@
+/* ********************************************************************************************* */
+/* * Driver Loader Header for loading display drivers at runtime                               * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef DRIVERLOADER_H
+#define DRIVERLOADER_H
+
+#include "display.h"
+
+/* Return codes */
+#define DRIVERLOADER_OK 0x0
+#define DRIVERLOADER_DLOPEN_ERROR 0x100
+#define DRIVERLOADER_DLSYM_ERROR 0x200
+
+/**
+ * @brief Load a display driver library and retrieve its functions.
+ * @param path Path to a display driver (*.so).
+ * @param driver Pointer to a function table to be filled.
+ * @param handle Pointer where the library handle will be written. Use it with driverloader_close().
+ * @return One of the following error codes:
+ *         DRIVERLOADER_OK: No errors occurred.
+ *         DRIVERLOADER_DLOPEN_ERROR: dlopen() failed. Use dlerror() for details.
+ *         DRIVERLOADER_DLSYM_ERROR: A function is missing from the library. Use dlerror() for details.
+ */
+int driverloader_open(const char *path, display_driver *driver, void **handle);
+
+/**
+ * @brief Close a driver library opened by driverloader_open().
+ * @param handle Library handle.
+ */
+void driverloader_close(void *handle);
+
+#endif
@@ -0,0 +1,128 @@
+/* ********************************************************************************************* */
+/* * Frame Scheduler Header for PiDisplayLibs                                                  * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef FRAMESCHED_H
+#define FRAMESCHED_H
+
+/* Return codes */
+#define FRAMESCHED_OK 0x0
+#define FRAMESCHED_INVALID_ARGS 0x100
+#define FRAMESCHED_NO_MEMORY 0x200
+
+/* Return value of a callback to be called no more */
+#define FRAMESCHED_END 0x1
+
+/**
+ * @brief Frame information passed to callbacks.
+ */
+typedef struct {
+	/* Frame number of the client, skipped frames included */
+	unsigned long long frame;
+	/* Time the frame started, and time by which it should be on the screen (CLOCK_MONOTONIC, in nanoseconds) */
+	unsigned long long start;
+	unsigned long long deadline;
+	/* Time since the previous frame of the client started, 0 for the first one (in nanoseconds) */
+	unsigned long long elapsed;
+	/* Current frame period (in nanoseconds). It is doubled from the target one when the client keeps missing */
+	unsigned int period;
+	/* Quality level: 0 for full quality, higher levels ask the client to update a smaller region or less detail */
+	int level;
+} framesched_frame;
+
+/**
+ * @brief Client statistics.
+ */
+typedef struct {
+	/* Frames drawn, frames done after their deadline and frames dropped to catch up */
+	unsigned long long frames;
+	unsigned long long missed;
+	unsigned long long skipped;
+	/* Average (over the last frames) and longest render and flush times (in nanoseconds) */
+	unsigned int renderAvg;
+	unsigned int renderMax;
+	unsigned int flushAvg;
+	unsigned int flushMax;
+	/* Current frame period (in nanoseconds) and quality level */
+	unsigned int period;
+	int level;
+} framesched_stats;
+
+/**
+ * @brief Render callback: prepare a frame, or draw it straight away if there is no flush callback.
+ * @param arg User argument.
+ * @param frame Frame information.
+ * @return FRAMESCHED_OK, or FRAMESCHED_END to stop calling this client.
+ */
+typedef int (* framesched_fn)(void *arg, const framesched_frame *frame);
+
+/**
+ * @brief Opaque scheduler handle.
+ */
+typedef struct framesched_s framesched;
+
+/**
+ * @brief Create a frame scheduler. Clients are drawn at their own fixed rate on an absolute timeline: the scheduler
+ *        sleeps until the next frame is due, times render and flush against the frame deadline (the start of the
+ *        next frame) and drops frames that are already late rather than drawing them in a burst. A client that keeps
+ *        missing deadlines is first asked for a lower quality level, then its rate is halved; both are restored once
+ *        it has been using less than half of its time for a while.
+ * @param s Pointer where the scheduler handle will be written.
+ * @return FRAMESCHED_OK or FRAMESCHED_NO_MEMORY.
+ */
+int framesched_create(framesched **s);
+
+/**
+ * @brief Add a client.
+ * @param s Scheduler handle.
+ * @param render Render callback.
+ * @param flush Flush callback, called right after render to send the frame to the display. May be NULL.
+ * @param arg Argument passed to the callbacks.
+ * @param rate Target rate in frames per second.
+ * @param levels Amount of quality levels the client can draw at (1 if it only has full quality; its rate is then
+ *        lowered right away when missing).
+ * @param id Pointer where the client identifier will be written. May be NULL.
+ * @return FRAMESCHED_OK, FRAMESCHED_INVALID_ARGS (rate not from 1 to 1000 or no level) or FRAMESCHED_NO_MEMORY.
+ */
+int framesched_add(framesched *s, framesched_fn render, framesched_fn flush, void *arg, unsigned int rate,
+		int levels, int *id);
+
+/**
+ * @brief Draw frames until every client ended or stop is set. The calling thread does the drawing.
+ * @param s Scheduler handle.
+ * @param stop Pointer to a flag checked before each frame. May be NULL.
+ */
+void framesched_run(framesched *s, volatile int *stop);
+
+/**
+ * @brief Get client statistics.
+ * @param s Scheduler handle.
+ * @param id Client identifier.
+ * @param stats Pointer where the statistics will be written.
+ * @return FRAMESCHED_OK or FRAMESCHED_INVALID_ARGS.
+ */
+int framesched_get_stats(framesched *s, int id, framesched_stats *stats);
+
+/**
+ * @brief Free scheduler.
+ * @param s Scheduler handle.
+ */
+void framesched_destroy(framesched *s);
+
+#endif
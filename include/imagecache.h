@@ -0,0 +1,83 @@
+/* ********************************************************************************************* */
+/* * Image Cache Header for disk-backed panel-ready images                                     * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "display.h"
+
+/* Return codes */
+#define IMAGECACHE_OK 0x0
+#define IMAGECACHE_INVALID_ARGS 0x100
+#define IMAGECACHE_NO_MEMORY 0x200
+#define IMAGECACHE_DIR_ERROR 0x300
+#define IMAGECACHE_FILE_ERROR 0x400
+#define IMAGECACHE_DECODE_ERROR 0x500
+
+/* Storage formats */
+#define IMAGECACHE_FMT_RGB565 0
+#define IMAGECACHE_FMT_WORDS 1
+
+/**
+ * @brief Opaque cache handle.
+ */
+typedef struct imagecache_s imagecache;
+
+/**
+ * @brief Open an image cache. Entries are files in dir keyed by image content hash, orientation, scaling mode and, for
+ *        IMAGECACHE_FMT_WORDS, the driver bus identifier. Each file holds the image in its exact on-bus form, so
+ *        showing a cached image is a single mmap() plus a bus stream.
+ * @param cache Pointer where the cache handle will be written.
+ * @param dir Cache directory. It is created if it does not exist.
+ * @param driver Initialised display driver.
+ * @param format IMAGECACHE_FMT_RGB565 to store RGB565 pixels or IMAGECACHE_FMT_WORDS to store pre-scrambled GPIO words
+ *        (larger, but skips scrambling when shown).
+ * @param maxSize Maximum size of all entries in bytes. Least recently shown entries are evicted to respect it.
+ * @return One of the following error codes:
+ *         IMAGECACHE_OK: No errors occurred.
+ *         IMAGECACHE_INVALID_ARGS: Invalid format.
+ *         IMAGECACHE_NO_MEMORY: Out of memory.
+ *         IMAGECACHE_DIR_ERROR: Cache directory could not be created.
+ */
+int imagecache_open(imagecache **cache, const char *dir, display_driver *driver, int format,
+		unsigned long long maxSize);
+
+/**
+ * @brief Show an image, from the cache if present. Otherwise the image is decoded, shown and stored.
+ * @param cache Cache handle.
+ * @param path Path to image file (PNG or JPEG).
+ * @param orientation Image rotation in steps of 90 degrees (0 to 3), with the same semantics as test3.
+ * @param mode Scaling mode (see SCALER_MODE_* in scaler.h).
+ * @param hit Pointer where 1 is written on cache hit, 0 otherwise. May be NULL.
+ * @return One of the following error codes:
+ *         IMAGECACHE_OK: No errors occurred. Failing to store a new entry is not considered an error.
+ *         IMAGECACHE_NO_MEMORY: Out of memory.
+ *         IMAGECACHE_FILE_ERROR: Image file could not be read.
+ *         IMAGECACHE_DECODE_ERROR: Image could not be decoded.
+ */
+int imagecache_show(imagecache *cache, const char *path, int orientation, int mode, int *hit);
+
+/**
+ * @brief Close cache. Entries are kept on disk.
+ * @param cache Cache handle.
+ */
+void imagecache_close(imagecache *cache);
+
+#endif
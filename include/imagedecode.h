@@ -0,0 +1,121 @@
+/* ********************************************************************************************* */
+/* * Image Decode Header for streaming PNG/JPEG decoding                                       * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef IMAGEDECODE_H
+#define IMAGEDECODE_H
+
+/* Return codes */
+#define IMAGEDECODE_OK 0x0
+#define IMAGEDECODE_FILE_ERROR 0x100
+#define IMAGEDECODE_INVALID_FORMAT 0x200
+#define IMAGEDECODE_DECODE_ERROR 0x300
+#define IMAGEDECODE_NO_MEMORY 0x400
+#define IMAGEDECODE_CANCELLED 0x500
+#define IMAGEDECODE_INVALID_ARGS 0x600
+
+/**
+ * @brief Opaque decoder handle.
+ */
+typedef struct imagedecode_s imagedecode;
+
+/**
+ * @brief Cancellation callback. Polled between decoded rows.
+ * @param arg User argument.
+ * @return Non-zero if decoding should be aborted.
+ */
+typedef int (* imagedecode_cancel_fn)(void *arg);
+
+/**
+ * @brief Open an image file for row-by-row decoding. PNG and JPEG files are supported.
+ * @param path Path to image file.
+ * @param dec Pointer where the decoder handle will be written.
+ * @return One of the following error codes:
+ *         IMAGEDECODE_OK: No errors occurred.
+ *         IMAGEDECODE_FILE_ERROR: File could not be opened.
+ *         IMAGEDECODE_INVALID_FORMAT: File is neither PNG nor JPEG.
+ *         IMAGEDECODE_DECODE_ERROR: Image header is corrupt.
+ *         IMAGEDECODE_NO_MEMORY: Out of memory.
+ */
+int imagedecode_open(const char *path, imagedecode **dec);
+
+/**
+ * @brief Restrict decoding to a region of the image. Must be called before the first row is read. JPEG files are
+ *        decoded with DCT scaling when shrink allows it and, with libjpeg-turbo, only the iMCU columns covering the
+ *        region are decoded and rows above it are skipped. PNG files are decoded up to the region, then cropped.
+ * @param dec Decoder handle.
+ * @param shrink Reduction factor the caller is going to apply. The decoder may apply part of it (a power of 2).
+ * @param x Leftmost column of the region, in full image coordinates.
+ * @param y Topmost row of the region, in full image coordinates.
+ * @param w Region width. Clamped to the image.
+ * @param h Region height. Clamped to the image.
+ * @param applied Pointer where the reduction applied by the decoder will be written. May be NULL.
+ *        imagedecode_get_size() afterwards returns the size of the decoded region.
+ * @return One of the following error codes:
+ *         IMAGEDECODE_OK: No errors occurred.
+ *         IMAGEDECODE_INVALID_ARGS: Rows were already read or region is out of the image.
+ *         IMAGEDECODE_NO_MEMORY: Out of memory.
+ *         IMAGEDECODE_DECODE_ERROR: Image data is corrupt.
+ */
+int imagedecode_set_region(imagedecode *dec, unsigned int shrink, unsigned int x, unsigned int y, unsigned int w,
+		unsigned int h, unsigned int *applied);
+
+/**
+ * @brief Get image dimensions, or region dimensions if imagedecode_set_region() was called.
+ * @param dec Decoder handle.
+ * @param width Pointer where image width will be written.
+ * @param height Pointer where image height will be written.
+ */
+void imagedecode_get_size(imagedecode *dec, unsigned int *width, unsigned int *height);
+
+/**
+ * @brief Decode next row of the image.
+ * @param dec Decoder handle.
+ * @param row Buffer with at least 3 * width bytes, where the row is written as packed RGB888.
+ * @return One of the following error codes:
+ *         IMAGEDECODE_OK: No errors occurred.
+ *         IMAGEDECODE_DECODE_ERROR: Image data is corrupt or all rows were already read.
+ */
+int imagedecode_read_row(imagedecode *dec, unsigned char *row);
+
+/**
+ * @brief Close decoder and free its resources.
+ * @param dec Decoder handle.
+ */
+void imagedecode_close(imagedecode *dec);
+
+/**
+ * @brief Decode an image straight into a panel-ready RGB565 buffer. Decoded rows are streamed through the scaler, so
+ *        only one source row is kept in memory at a time.
+ * @param path Path to image file.
+ * @param orientation Image rotation in steps of 90 degrees (0 to 3), with the same semantics as test3.
+ * @param mode Scaling mode (see SCALER_MODE_* in scaler.h). With SCALER_MODE_NONE, images larger than the panel are
+ *        cropped and smaller ones are padded with black.
+ * @param out Output buffer with xres * yres elements.
+ * @param xres Panel width.
+ * @param yres Panel height.
+ * @param cancel Cancellation callback. May be NULL.
+ * @param cancelArg Argument passed to cancel.
+ * @return Any of the codes from imagedecode_open() and imagedecode_read_row(), or:
+ *         IMAGEDECODE_CANCELLED: cancel returned non-zero. Contents of out are undefined.
+ */
+int imagedecode_to_rgb565(const char *path, int orientation, int mode, unsigned short *out, int xres, int yres,
+		imagedecode_cancel_fn cancel, void *cancelArg);
+
+#endif
@@ -0,0 +1,99 @@
+/* ********************************************************************************************* */
+/* * Page Store Header for compressed screens                                                  * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef PAGESTORE_H
+#define PAGESTORE_H
+
+#include <stddef.h>
+
+#include "display.h"
+
+/* Return codes */
+#define PAGESTORE_OK 0x0
+#define PAGESTORE_INVALID_ARGS 0x100
+#define PAGESTORE_NO_MEMORY 0x200
+
+/**
+ * @brief Opaque page store handle.
+ */
+typedef struct pagestore_s pagestore;
+
+/**
+ * @brief Create a page store. Pages are full-screen images kept compressed with a codec made for flat UI content:
+ *        runs of one colour, pixels repeated from the line above and literal pixels. Showing a page decompresses it
+ *        one line at a time straight to the bus, so neither the page nor the screen is ever held uncompressed.
+ * @param ps Pointer where the page store handle will be written.
+ * @param driver Initialised display driver.
+ * @return PAGESTORE_OK or PAGESTORE_NO_MEMORY.
+ */
+int pagestore_create(pagestore **ps, display_driver *driver);
+
+/**
+ * @brief Compress and add a page.
+ * @param ps Page store handle.
+ * @param pixels RGB565 image with the size of the screen.
+ * @param stride Distance between image lines, in pixels.
+ * @param id Pointer where the page identifier will be written.
+ * @return PAGESTORE_OK, PAGESTORE_INVALID_ARGS or PAGESTORE_NO_MEMORY.
+ */
+int pagestore_add(pagestore *ps, const unsigned short *pixels, int stride, int *id);
+
+/**
+ * @brief Replace the contents of a page. If the page is on screen, the screen keeps the old contents until the page
+ *        is shown again.
+ * @param ps Page store handle.
+ * @param id Page identifier.
+ * @param pixels RGB565 image with the size of the screen.
+ * @param stride Distance between image lines, in pixels.
+ * @return PAGESTORE_OK, PAGESTORE_INVALID_ARGS or PAGESTORE_NO_MEMORY.
+ */
+int pagestore_replace(pagestore *ps, int id, const unsigned short *pixels, int stride);
+
+/**
+ * @brief Show a page. Both the page and what is on screen are decompressed side by side to find the changed span of
+ *        each line; if sending those spans (plus the addressing of each window) is cheaper than the whole page, only
+ *        they are sent, with lines of equal spans sharing one window. Otherwise the whole page is streamed.
+ * @param ps Page store handle.
+ * @param id Page identifier.
+ * @param pixels Pointer where the amount of sent pixels will be written. May be NULL.
+ * @return PAGESTORE_OK or PAGESTORE_INVALID_ARGS.
+ */
+int pagestore_show(pagestore *ps, int id, unsigned int *pixels);
+
+/**
+ * @brief Forget what is on screen, e.g. after something else drew on it. The next page is sent whole.
+ * @param ps Page store handle.
+ */
+void pagestore_invalidate(pagestore *ps);
+
+/**
+ * @brief Get the memory taken by compressed pages.
+ * @param ps Page store handle.
+ * @return Size in bytes.
+ */
+size_t pagestore_get_size(pagestore *ps);
+
+/**
+ * @brief Free page store and its pages.
+ * @param ps Page store handle.
+ */
+void pagestore_destroy(pagestore *ps);
+
+#endif
@@ -0,0 +1,186 @@
+/* ********************************************************************************************* */
+/* * Raster Header for 2D primitives                                                           * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "display.h"
+
+/* Return codes */
+#define RASTER_OK 0x0
+#define RASTER_INVALID_ARGS 0x100
+#define RASTER_NO_MEMORY 0x200
+
+/**
+ * @brief Opaque rasteriser handle.
+ */
+typedef struct raster_s raster;
+
+/**
+ * @brief Create a rasteriser drawing on the display. Shapes are scan converted into horizontal spans; spans of
+ *        consecutive lines with the same horizontal extent share one window, so addressing is only sent when the
+ *        extent changes. As the panel cannot be read back, anti-aliased edges are blended against the background
+ *        colour (see raster_set_background()).
+ * @param r Pointer where the rasteriser handle will be written.
+ * @param driver Initialised display driver.
+ * @return RASTER_OK or RASTER_NO_MEMORY.
+ */
+int raster_create(raster **r, display_driver *driver);
+
+/**
+ * @brief Create a rasteriser drawing on an RGB565 buffer. Anti-aliased edges are blended against the buffer contents.
+ * @param r Pointer where the rasteriser handle will be written.
+ * @param pixels Buffer.
+ * @param width Buffer width.
+ * @param height Buffer height.
+ * @param stride Distance between buffer lines, in pixels.
+ * @return RASTER_OK, RASTER_INVALID_ARGS or RASTER_NO_MEMORY.
+ */
+int raster_create_buffer(raster **r, unsigned short *pixels, int width, int height, int stride);
+
+/**
+ * @brief Restrict drawing to a rectangle (inclusive). It is intersected with the target.
+ * @param r Rasteriser handle.
+ * @param x0 Left.
+ * @param y0 Top.
+ * @param x1 Right.
+ * @param y1 Bottom.
+ */
+void raster_set_clip(raster *r, int x0, int y0, int x1, int y1);
+
+/**
+ * @brief Enable or disable anti-aliasing (enabled by default). Anti-aliased shapes are sampled on 4 sub-lines per
+ *        line, with exact horizontal coverage.
+ * @param r Rasteriser handle.
+ * @param enable Non-zero to enable.
+ */
+void raster_set_antialias(raster *r, int enable);
+
+/**
+ * @brief Set the colour anti-aliased edges are blended against, when drawing on the display.
+ * @param r Rasteriser handle.
+ * @param colour Colour (RGB565).
+ */
+void raster_set_background(raster *r, unsigned short colour);
+
+/**
+ * @brief Paint following shapes with a solid colour.
+ * @param r Rasteriser handle.
+ * @param colour Colour (RGB565).
+ */
+void raster_set_solid(raster *r, unsigned short colour);
+
+/**
+ * @brief Paint following shapes with a linear gradient. Colours are clamped beyond the end points.
+ * @param r Rasteriser handle.
+ * @param x0 Start point X.
+ * @param y0 Start point Y.
+ * @param x1 End point X.
+ * @param y1 End point Y.
+ * @param c0 Colour at start point (RGB565).
+ * @param c1 Colour at end point (RGB565).
+ */
+void raster_set_linear(raster *r, int x0, int y0, int x1, int y1, unsigned short c0, unsigned short c1);
+
+/**
+ * @brief Paint following shapes with a radial gradient. Colours are clamped beyond the radius.
+ * @param r Rasteriser handle.
+ * @param cx Centre X.
+ * @param cy Centre Y.
+ * @param radius Radius.
+ * @param c0 Colour at centre (RGB565).
+ * @param c1 Colour at radius (RGB565).
+ */
+void raster_set_radial(raster *r, int cx, int cy, int radius, unsigned short c0, unsigned short c1);
+
+/**
+ * @brief Fill a rectangle.
+ * @param r Rasteriser handle.
+ * @param x Left.
+ * @param y Top.
+ * @param w Width.
+ * @param h Height.
+ * @return RASTER_OK or RASTER_NO_MEMORY.
+ */
+int raster_fill_rect(raster *r, int x, int y, int w, int h);
+
+/**
+ * @brief Fill a rectangle with rounded corners.
+ * @param r Rasteriser handle.
+ * @param x Left.
+ * @param y Top.
+ * @param w Width.
+ * @param h Height.
+ * @param radius Corner radius. Clamped to half the smallest side.
+ * @return RASTER_OK or RASTER_NO_MEMORY.
+ */
+int raster_fill_round_rect(raster *r, int x, int y, int w, int h, int radius);
+
+/**
+ * @brief Fill a circle centred on a pixel.
+ * @param r Rasteriser handle.
+ * @param cx Centre X.
+ * @param cy Centre Y.
+ * @param radius Radius.
+ * @return RASTER_OK or RASTER_NO_MEMORY.
+ */
+int raster_fill_circle(raster *r, int cx, int cy, int radius);
+
+/**
+ * @brief Draw an arc (a ring section) centred on a pixel. A full turn draws a ring.
+ * @param r Rasteriser handle.
+ * @param cx Centre X.
+ * @param cy Centre Y.
+ * @param radius Radius of the middle of the stroke.
+ * @param width Stroke width.
+ * @param start Start angle in degrees, clockwise from the positive X axis.
+ * @param sweep Angle covered in degrees, clockwise. Values of 360 or more draw a ring.
+ * @return RASTER_OK, RASTER_INVALID_ARGS or RASTER_NO_MEMORY.
+ */
+int raster_arc(raster *r, int cx, int cy, int radius, int width, int start, int sweep);
+
+/**
+ * @brief Draw a line between two pixel centres, with square ends.
+ * @param r Rasteriser handle.
+ * @param x0 Start X.
+ * @param y0 Start Y.
+ * @param x1 End X.
+ * @param y1 End Y.
+ * @param width Line width.
+ * @return RASTER_OK, RASTER_INVALID_ARGS or RASTER_NO_MEMORY.
+ */
+int raster_line(raster *r, int x0, int y0, int x1, int y1, int width);
+
+/**
+ * @brief Fill a polygon with the non-zero winding rule. Vertices are pixel corners.
+ * @param r Rasteriser handle.
+ * @param points Vertices as X, Y pairs.
+ * @param n Amount of vertices.
+ * @return RASTER_OK, RASTER_INVALID_ARGS or RASTER_NO_MEMORY.
+ */
+int raster_fill_polygon(raster *r, const int *points, unsigned int n);
+
+/**
+ * @brief Free rasteriser.
+ * @param r Rasteriser handle.
+ */
+void raster_destroy(raster *r);
+
+#endif
@@ -0,0 +1,59 @@
+/* ********************************************************************************************* */
+/* * RGB565 colour helpers                                                                     * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef RGB565_H
+#define RGB565_H
+
+#include <stdint.h>
+
+/**
+ * @brief Blend two RGB565 colours, all channels at once in a 32-bit word.
+ * @param fg Colour at full weight.
+ * @param bg Colour at zero weight.
+ * @param weight Weight of fg, 0 to 32.
+ * @return Blended colour.
+ */
+static inline uint16_t rgb565_blend(uint16_t fg, uint16_t bg, unsigned int weight) {
+	uint32_t f = (fg | ((uint32_t) fg << 16)) & 0x07E0F81F;
+	uint32_t b = (bg | ((uint32_t) bg << 16)) & 0x07E0F81F;
+	uint32_t res = (b + (((f - b) * weight) >> 5)) & 0x07E0F81F;
+
+	return res | (res >> 16);
+}
+
+/**
+ * @brief Fill a table of the 256 coverage levels between two RGB565 colours, rounded per channel.
+ * @param fg Colour at full coverage (255).
+ * @param bg Colour at zero coverage.
+ * @param lut Table to fill.
+ */
+static inline void rgb565_blend_lut(uint16_t fg, uint16_t bg, uint16_t lut[256]) {
+	unsigned int i;
+
+	for(i = 0; i < 256; i++) {
+		unsigned int r = ((bg >> 11) * (255 - i) + (fg >> 11) * i + 127) / 255;
+		unsigned int g = (((bg >> 5) & 0x3F) * (255 - i) + ((fg >> 5) & 0x3F) * i + 127) / 255;
+		unsigned int b = ((bg & 0x1F) * (255 - i) + (fg & 0x1F) * i + 127) / 255;
+
+		lut[i] = (r << 11) | (g << 5) | b;
+	}
+}
+
+#endif
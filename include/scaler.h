@@ -0,0 +1,97 @@
+/* ********************************************************************************************* */
+/* * Scaler Header for streaming fixed-point image scaling                                     * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef SCALER_H
+#define SCALER_H
+
+/* Return codes */
+#define SCALER_OK 0x0
+#define SCALER_INVALID_ARGS 0x100
+#define SCALER_NO_MEMORY 0x200
+
+/* Scaling modes */
+#define SCALER_MODE_NONE 0
+#define SCALER_MODE_FIT 1
+#define SCALER_MODE_FILL 2
+#define SCALER_MODE_STRETCH 3
+
+/* Filters */
+#define SCALER_FILTER_BILINEAR 0
+#define SCALER_FILTER_BOX 1
+
+/**
+ * @brief Opaque scaler handle.
+ */
+typedef struct scaler_s scaler;
+
+/**
+ * @brief Output callback. Called once for each destination row, in order.
+ * @param arg User argument.
+ * @param y Destination row index.
+ * @param row Destination row as packed RGB888, with the destination width.
+ */
+typedef void (* scaler_emit_fn)(void *arg, unsigned int y, const unsigned char *row);
+
+/**
+ * @brief Create a streaming scaler. Source rows are pushed one at a time and destination rows are emitted as soon as
+ *        the source rows they depend on are available, so no full-size intermediate buffer is needed.
+ * @param sc Pointer where the scaler handle will be written.
+ * @param srcWidth Source width.
+ * @param srcHeight Source height.
+ * @param dstWidth Destination width.
+ * @param dstHeight Destination height.
+ * @param mode One of the following:
+ *        SCALER_MODE_NONE: No scaling. Source is cropped or padded with black on the right and bottom;
+ *        SCALER_MODE_FIT: Keep aspect ratio, whole source visible, padded with black (letterbox);
+ *        SCALER_MODE_FILL: Keep aspect ratio, destination fully covered, source cropped at the centre;
+ *        SCALER_MODE_STRETCH: Ignore aspect ratio.
+ * @param filter SCALER_FILTER_BILINEAR or SCALER_FILTER_BOX. Box filtering is only applied on axes being reduced,
+ *        bilinear is used otherwise.
+ * @param emit Output callback.
+ * @param emitArg Argument passed to emit.
+ * @return One of the following error codes:
+ *         SCALER_OK: No errors occurred.
+ *         SCALER_INVALID_ARGS: A dimension is zero or mode/filter are invalid.
+ *         SCALER_NO_MEMORY: Out of memory.
+ */
+int scaler_create(scaler **sc, unsigned int srcWidth, unsigned int srcHeight, unsigned int dstWidth,
+		unsigned int dstHeight, int mode, int filter, scaler_emit_fn emit, void *emitArg);
+
+/**
+ * @brief Push next source row.
+ * @param sc Scaler handle.
+ * @param row Source row as packed RGB888.
+ */
+void scaler_push_row(scaler *sc, const unsigned char *row);
+
+/**
+ * @brief Check whether all destination rows were emitted. Remaining source rows may then be skipped.
+ * @param sc Scaler handle.
+ * @return Non-zero if done.
+ */
+int scaler_done(scaler *sc);
+
+/**
+ * @brief Free scaler.
+ * @param sc Scaler handle.
+ */
+void scaler_destroy(scaler *sc);
+
+#endif
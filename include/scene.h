@@ -0,0 +1,200 @@
+/* ********************************************************************************************* */
+/* * Scene Header for retained widget trees                                                    * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "display.h"
+#include "textrender.h"
+
+/* Return codes */
+#define SCENE_OK 0x0
+#define SCENE_INVALID_ARGS 0x100
+#define SCENE_NO_MEMORY 0x200
+#define SCENE_FONT_ERROR 0x300
+
+/* Identifier of the root container, which covers the screen */
+#define SCENE_ROOT 0
+
+/* Container layouts */
+#define SCENE_LAYOUT_NONE 0
+#define SCENE_LAYOUT_ROW 1
+#define SCENE_LAYOUT_COLUMN 2
+
+/* Label alignments */
+#define SCENE_ALIGN_LEFT 0
+#define SCENE_ALIGN_CENTRE 1
+#define SCENE_ALIGN_RIGHT 2
+
+/**
+ * @brief Opaque scene handle.
+ */
+typedef struct scene_s scene;
+
+/**
+ * @brief Create a scene. Widgets are kept in a tree and drawn into a screen-sized buffer; property changes only mark
+ *        the widget rectangle as invalid, and scene_flush() repaints invalid rectangles (clipped to them) and sends
+ *        just those to the display.
+ * @param s Pointer where the scene handle will be written.
+ * @param driver Initialised display driver.
+ * @param tr Text renderer for labels. May be NULL if no labels are used.
+ * @return SCENE_OK or SCENE_NO_MEMORY.
+ */
+int scene_create(scene **s, display_driver *driver, textrender *tr);
+
+/**
+ * @brief Add a container. Children are clipped to it and placed according to its layout: SCENE_LAYOUT_NONE uses the
+ *        child geometry as is, relative to the container; SCENE_LAYOUT_ROW and SCENE_LAYOUT_COLUMN stack children
+ *        horizontally or vertically, sharing the space left by fixed-size children among those with zero size.
+ * @param s Scene handle.
+ * @param parent Parent container identifier.
+ * @param layout One of SCENE_LAYOUT_*.
+ * @param id Pointer where the widget identifier will be written.
+ * @return SCENE_OK, SCENE_INVALID_ARGS or SCENE_NO_MEMORY.
+ */
+int scene_add_container(scene *s, int parent, int layout, int *id);
+
+/**
+ * @brief Add a text label, vertically centred in its rectangle.
+ * @param s Scene handle.
+ * @param parent Parent container identifier.
+ * @param font Font identifier in the scene text renderer.
+ * @param size Pixel size.
+ * @param id Pointer where the widget identifier will be written.
+ * @return SCENE_OK, SCENE_INVALID_ARGS, SCENE_NO_MEMORY or SCENE_FONT_ERROR.
+ */
+int scene_add_label(scene *s, int parent, int font, unsigned int size, int *id);
+
+/**
+ * @brief Add a bar. It fills from the left if wider than tall, from the bottom otherwise.
+ * @param s Scene handle.
+ * @param parent Parent container identifier.
+ * @param id Pointer where the widget identifier will be written.
+ * @return SCENE_OK, SCENE_INVALID_ARGS or SCENE_NO_MEMORY.
+ */
+int scene_add_bar(scene *s, int parent, int *id);
+
+/**
+ * @brief Add a gauge: a 270 degree arc centred in its rectangle, filled clockwise with the value.
+ * @param s Scene handle.
+ * @param parent Parent container identifier.
+ * @param id Pointer where the widget identifier will be written.
+ * @return SCENE_OK, SCENE_INVALID_ARGS or SCENE_NO_MEMORY.
+ */
+int scene_add_gauge(scene *s, int parent, int *id);
+
+/**
+ * @brief Add an image, centred in its rectangle. The image is not copied and must remain valid while it is used.
+ * @param s Scene handle.
+ * @param parent Parent container identifier.
+ * @param pixels RGB565 image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param id Pointer where the widget identifier will be written.
+ * @return SCENE_OK, SCENE_INVALID_ARGS or SCENE_NO_MEMORY.
+ */
+int scene_add_image(scene *s, int parent, const unsigned short *pixels, int width, int height, int *id);
+
+/**
+ * @brief Set widget geometry. Widgets start at (0, 0) with zero size.
+ * @param s Scene handle.
+ * @param id Widget identifier.
+ * @param x X coordinate relative to the parent (only used by SCENE_LAYOUT_NONE parents).
+ * @param y Y coordinate relative to the parent (only used by SCENE_LAYOUT_NONE parents).
+ * @param w Width, or 0 to take the available width.
+ * @param h Height, or 0 to take the available height.
+ */
+void scene_set_geometry(scene *s, int id, int x, int y, int w, int h);
+
+/**
+ * @brief Set container padding and spacing between children.
+ * @param s Scene handle.
+ * @param id Container identifier.
+ * @param padding Space between the container edges and its children.
+ * @param spacing Space between stacked children.
+ */
+void scene_set_padding(scene *s, int id, int padding, int spacing);
+
+/**
+ * @brief Set widget colours. Widgets start white on black.
+ * @param s Scene handle.
+ * @param id Widget identifier.
+ * @param fg Foreground colour (text, bar or gauge fill).
+ * @param bg Background colour, filling the widget rectangle.
+ */
+void scene_set_colours(scene *s, int id, unsigned short fg, unsigned short bg);
+
+/**
+ * @brief Show or hide a widget.
+ * @param s Scene handle.
+ * @param id Widget identifier.
+ * @param visible Non-zero to show the widget.
+ */
+void scene_set_visible(scene *s, int id, int visible);
+
+/**
+ * @brief Set label text. Nothing is invalidated if the text did not change.
+ * @param s Scene handle.
+ * @param id Label identifier.
+ * @param text UTF-8 text. It is copied.
+ * @return SCENE_OK, SCENE_NO_MEMORY or SCENE_FONT_ERROR.
+ */
+int scene_set_text(scene *s, int id, const char *text);
+
+/**
+ * @brief Set label alignment.
+ * @param s Scene handle.
+ * @param id Label identifier.
+ * @param align One of SCENE_ALIGN_*.
+ */
+void scene_set_align(scene *s, int id, int align);
+
+/**
+ * @brief Set bar or gauge range. Widgets start with a range from 0 to 100.
+ * @param s Scene handle.
+ * @param id Widget identifier.
+ * @param min Value shown empty.
+ * @param max Value shown full.
+ */
+void scene_set_range(scene *s, int id, int min, int max);
+
+/**
+ * @brief Set bar or gauge value. Nothing is invalidated if the value did not change.
+ * @param s Scene handle.
+ * @param id Widget identifier.
+ * @param value Value, clamped to the range.
+ */
+void scene_set_value(scene *s, int id, int value);
+
+/**
+ * @brief Lay out changed containers, repaint invalid rectangles and send them to the display.
+ * @param s Scene handle.
+ * @param pixels Pointer where the amount of sent pixels will be written. May be NULL.
+ * @return SCENE_OK, SCENE_NO_MEMORY or SCENE_FONT_ERROR.
+ */
+int scene_flush(scene *s, unsigned int *pixels);
+
+/**
+ * @brief Free scene and its widgets. The text renderer is not freed.
+ * @param s Scene handle.
+ */
+void scene_destroy(scene *s);
+
+#endif
@@ -0,0 +1,90 @@
+/* ********************************************************************************************* */
+/* * Slideshow Header for prefetching image playback                                           * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef SLIDESHOW_H
+#define SLIDESHOW_H
+
+#include <stddef.h>
+
+#include "display.h"
+
+/* Return codes */
+#define SLIDESHOW_OK 0x0
+#define SLIDESHOW_INVALID_ARGS 0x100
+#define SLIDESHOW_NO_MEMORY 0x200
+#define SLIDESHOW_THREAD_ERROR 0x300
+#define SLIDESHOW_EMPTY_PLAYLIST 0x400
+#define SLIDESHOW_DECODE_ERROR 0x500
+
+/**
+ * @brief Opaque slideshow handle.
+ */
+typedef struct slideshow_s slideshow;
+
+/**
+ * @brief Create a slideshow engine. A pool of worker threads decodes, scales and converts the next images of the
+ *        playlist to panel-ready RGB565 while the current one is being shown.
+ * @param show Pointer where the slideshow handle will be written.
+ * @param driver Initialised display driver.
+ * @param workers Number of worker threads.
+ * @param prefetch Maximum number of images to be kept decoded ahead of time.
+ * @param memBudget Maximum amount of bytes used by decoded images. The effective prefetch depth is reduced to fit this
+ *        budget, but at least one image is always kept.
+ * @return One of the following error codes:
+ *         SLIDESHOW_OK: No errors occurred.
+ *         SLIDESHOW_INVALID_ARGS: workers or prefetch is zero.
+ *         SLIDESHOW_NO_MEMORY: Out of memory.
+ *         SLIDESHOW_THREAD_ERROR: Worker threads could not be created.
+ */
+int slideshow_create(slideshow **show, display_driver *driver, unsigned int workers, unsigned int prefetch,
+		size_t memBudget);
+
+/**
+ * @brief Replace the playlist. Decoding of images from the previous playlist is cancelled and the next call to
+ *        slideshow_next() shows the first image of the new one.
+ * @param show Slideshow handle.
+ * @param paths Array of image paths (PNG or JPEG). Strings are copied.
+ * @param n Number of elements in paths.
+ * @param orientation Image rotation in steps of 90 degrees (0 to 3), with the same semantics as test3.
+ * @param mode Scaling mode (see SCALER_MODE_* in scaler.h).
+ * @return One of the following error codes:
+ *         SLIDESHOW_OK: No errors occurred.
+ *         SLIDESHOW_NO_MEMORY: Out of memory. The previous playlist is kept.
+ */
+int slideshow_set_playlist(slideshow *show, char **paths, unsigned int n, int orientation, int mode);
+
+/**
+ * @brief Wait for the next image to be ready and transfer it to the display. The playlist loops when it ends.
+ * @param show Slideshow handle.
+ * @param index Pointer where the playlist index of the shown image will be written. May be NULL.
+ * @return One of the following error codes:
+ *         SLIDESHOW_OK: No errors occurred.
+ *         SLIDESHOW_EMPTY_PLAYLIST: No playlist was set.
+ *         SLIDESHOW_DECODE_ERROR: Image could not be decoded. It is skipped and nothing is transferred.
+ */
+int slideshow_next(slideshow *show, unsigned int *index);
+
+/**
+ * @brief Stop workers and free the slideshow.
+ * @param show Slideshow handle.
+ */
+void slideshow_destroy(slideshow *show);
+
+#endif
@@ -0,0 +1,140 @@
+/* ********************************************************************************************* */
+/* * Surface Header for indexed-colour buffers                                                 * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include "display.h"
+
+/* Return codes */
+#define SURFACE_OK 0x0
+#define SURFACE_INVALID_ARGS 0x100
+#define SURFACE_NO_MEMORY 0x200
+
+/**
+ * @brief Opaque surface handle.
+ */
+typedef struct surface_s surface;
+
+/**
+ * @brief Create an indexed-colour surface. Pixels are palette indices packed in bytes, leftmost pixel in the most
+ *        significant bits, and are only expanded to RGB565 while being sent by surface_flush(). The palette starts as
+ *        a grey ramp from black (index 0) to white (last index), and the surface starts cleared to index 0.
+ * @param s Pointer where the surface handle will be written.
+ * @param width Surface width.
+ * @param height Surface height.
+ * @param bpp Bits per pixel: 1, 2, 4 or 8 (2, 4, 16 or 256 colours).
+ * @return SURFACE_OK, SURFACE_INVALID_ARGS or SURFACE_NO_MEMORY.
+ */
+int surface_create(surface **s, int width, int height, int bpp);
+
+/**
+ * @brief Get the packed pixel buffer, for direct drawing. Changes made through it must be reported with
+ *        surface_invalidate().
+ * @param s Surface handle.
+ * @param stride Pointer where the distance between lines, in bytes, will be written. May be NULL.
+ * @return Pixel buffer.
+ */
+unsigned char *surface_get_buffer(surface *s, unsigned int *stride);
+
+/**
+ * @brief Set palette entries. Pixels are not touched; the next flush sends the whole surface with the new colours.
+ * @param s Surface handle.
+ * @param first First index to be set.
+ * @param count Amount of entries.
+ * @param colours RGB565 colours.
+ */
+void surface_set_palette(surface *s, unsigned int first, unsigned int count, const unsigned short *colours);
+
+/**
+ * @brief Set a pixel. Coordinates outside the surface are ignored.
+ * @param s Surface handle.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @param index Palette index.
+ */
+void surface_set_pixel(surface *s, int x, int y, unsigned int index);
+
+/**
+ * @brief Get a pixel.
+ * @param s Surface handle.
+ * @param x X coordinate.
+ * @param y Y coordinate.
+ * @return Palette index, or 0 outside the surface.
+ */
+unsigned int surface_get_pixel(surface *s, int x, int y);
+
+/**
+ * @brief Fill a rectangle, clipped to the surface.
+ * @param s Surface handle.
+ * @param x Rectangle X coordinate.
+ * @param y Rectangle Y coordinate.
+ * @param w Rectangle width.
+ * @param h Rectangle height.
+ * @param index Palette index.
+ */
+void surface_fill_rect(surface *s, int x, int y, int w, int h, unsigned int index);
+
+/**
+ * @brief Draw 8-bit coverage (e.g. a glyph from textrender or bakedfont) as a ramp of palette entries, clipped to the
+ *        surface. Zero coverage leaves pixels untouched; other values map to the entries from first to first + levels
+ *        - 1, so anti-aliased text needs a matching ramp in the palette.
+ * @param s Surface handle.
+ * @param x Destination X coordinate.
+ * @param y Destination Y coordinate.
+ * @param coverage Coverage values.
+ * @param w Width.
+ * @param h Height.
+ * @param stride Distance between coverage lines, in bytes.
+ * @param first Palette index for the lowest non-zero coverage.
+ * @param levels Amount of palette entries in the ramp (1 draws every covered pixel with first).
+ */
+void surface_draw_coverage(surface *s, int x, int y, const unsigned char *coverage, int w, int h, int stride,
+		unsigned int first, unsigned int levels);
+
+/**
+ * @brief Mark a region as changed (e.g. after drawing through the buffer, or to resend a surface that was hidden).
+ * @param s Surface handle.
+ * @param x Region X coordinate.
+ * @param y Region Y coordinate.
+ * @param w Region width.
+ * @param h Region height.
+ */
+void surface_invalidate(surface *s, int x, int y, int w, int h);
+
+/**
+ * @brief Send the changed region of the surface to the display, expanding it to RGB565 line by line through a lookup
+ *        table that maps each packed byte to its pixels. The changed region is the bounding box of all changes since
+ *        the last flush, or the whole surface after a palette change. Parts outside the screen are clipped.
+ * @param s Surface handle.
+ * @param driver Initialised display driver.
+ * @param x Screen X coordinate of the surface.
+ * @param y Screen Y coordinate of the surface.
+ * @param pixels Pointer where the amount of sent pixels will be written. May be NULL.
+ */
+void surface_flush(surface *s, display_driver *driver, int x, int y, unsigned int *pixels);
+
+/**
+ * @brief Free surface.
+ * @param s Surface handle.
+ */
+void surface_destroy(surface *s);
+
+#endif
@@ -0,0 +1,159 @@
+/* ********************************************************************************************* */
+/* * Text Rendering Header with glyph atlas                                                    * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef TEXTRENDER_H
+#define TEXTRENDER_H
+
+#include "display.h"
+
+/* Return codes */
+#define TEXTRENDER_OK 0x0
+#define TEXTRENDER_INVALID_ARGS 0x100
+#define TEXTRENDER_NO_MEMORY 0x200
+#define TEXTRENDER_FONT_ERROR 0x300
+#define TEXTRENDER_ATLAS_FULL 0x400
+
+/**
+ * @brief Opaque text renderer handle.
+ */
+typedef struct textrender_s textrender;
+
+/**
+ * @brief Rasterised glyph, as stored in the atlas. Coverage is 8-bit (0 transparent, 255 opaque).
+ */
+typedef struct {
+	const unsigned char *coverage;
+	unsigned int stride;
+	unsigned int width;
+	unsigned int height;
+	int left;
+	int top;
+	int advance;
+	unsigned int index;
+} textrender_glyph;
+
+/**
+ * @brief Create a text renderer. Glyphs are rasterised by FreeType the first time they are used and packed into an
+ *        8-bit coverage atlas keyed by font, size and character, so later draws never reach FreeType. When the atlas
+ *        is full it is emptied and refilled on demand.
+ * @param tr Pointer where the renderer handle will be written.
+ * @param driver Initialised display driver. May be NULL if only glyph lookup is used.
+ * @param atlasWidth Atlas width in pixels.
+ * @param atlasHeight Atlas height in pixels.
+ * @return One of the following error codes:
+ *         TEXTRENDER_OK: No errors occurred.
+ *         TEXTRENDER_INVALID_ARGS: Atlas size is zero.
+ *         TEXTRENDER_NO_MEMORY: Out of memory.
+ *         TEXTRENDER_FONT_ERROR: FreeType could not be initialised.
+ */
+int textrender_create(textrender **tr, display_driver *driver, unsigned int atlasWidth, unsigned int atlasHeight);
+
+/**
+ * @brief Load a font file.
+ * @param tr Renderer handle.
+ * @param path Path to font file (any format supported by FreeType).
+ * @param font Pointer where the font identifier will be written.
+ * @return One of the following error codes:
+ *         TEXTRENDER_OK: No errors occurred.
+ *         TEXTRENDER_NO_MEMORY: Out of memory.
+ *         TEXTRENDER_FONT_ERROR: Font could not be loaded.
+ */
+int textrender_load_font(textrender *tr, const char *path, int *font);
+
+/**
+ * @brief Get vertical metrics of a font at a given size.
+ * @param tr Renderer handle.
+ * @param font Font identifier.
+ * @param size Pixel size.
+ * @param ascent Pointer where the distance from the top of a line to the baseline will be written.
+ * @param descent Pointer where the distance from the baseline to the bottom of a line will be written.
+ * @return TEXTRENDER_OK, TEXTRENDER_INVALID_ARGS or TEXTRENDER_FONT_ERROR.
+ */
+int textrender_get_metrics(textrender *tr, int font, unsigned int size, int *ascent, int *descent);
+
+/**
+ * @brief Get a glyph, rasterising it into the atlas if needed.
+ * @param tr Renderer handle.
+ * @param font Font identifier.
+ * @param size Pixel size.
+ * @param code Unicode code point.
+ * @param glyph Pointer where the glyph will be written. Its advance is in 1/64 pixels. The coverage pointer is valid
+ *        until the atlas is emptied, which may happen on any later call that rasterises a glyph.
+ * @return One of the following error codes:
+ *         TEXTRENDER_OK: No errors occurred.
+ *         TEXTRENDER_INVALID_ARGS: Invalid font.
+ *         TEXTRENDER_FONT_ERROR: Glyph could not be rasterised.
+ *         TEXTRENDER_ATLAS_FULL: Glyph is larger than the atlas.
+ */
+int textrender_get_glyph(textrender *tr, int font, unsigned int size, unsigned long code, textrender_glyph *glyph);
+
+/**
+ * @brief Get kerning between two glyphs.
+ * @param tr Renderer handle.
+ * @param font Font identifier.
+ * @param size Pixel size.
+ * @param left Glyph index of the left glyph.
+ * @param right Glyph index of the right glyph.
+ * @param kerning Pointer where the horizontal adjustment in 1/64 pixels will be written.
+ * @return TEXTRENDER_OK, TEXTRENDER_INVALID_ARGS or TEXTRENDER_FONT_ERROR.
+ */
+int textrender_get_kerning(textrender *tr, int font, unsigned int size, unsigned int left, unsigned int right,
+		int *kerning);
+
+/**
+ * @brief Measure a UTF-8 string.
+ * @param tr Renderer handle.
+ * @param font Font identifier.
+ * @param size Pixel size.
+ * @param str String.
+ * @param width Pointer where the width in pixels will be written on success.
+ * @param height Pointer where the line height in pixels will be written on success.
+ * @return Same codes as textrender_get_glyph().
+ */
+int textrender_measure(textrender *tr, int font, unsigned int size, const char *str, unsigned int *width,
+		unsigned int *height);
+
+/**
+ * @brief Draw a UTF-8 string on an opaque box. The box is written with one window blit, with text coverage blended
+ *        between both colours through a lookup table. Parts outside the screen are clipped.
+ * @param tr Renderer handle.
+ * @param font Font identifier.
+ * @param size Pixel size.
+ * @param x Left of the box.
+ * @param y Top of the box (the baseline is at y plus the font ascent).
+ * @param minWidth Minimum box width. Extra width is filled with the background colour, which is useful to erase
+ *        longer previous text in place.
+ * @param str String.
+ * @param fg Text colour (RGB565).
+ * @param bg Background colour (RGB565).
+ * @param width Pointer where the box width will be written. May be NULL.
+ * @return Same codes as textrender_get_glyph(), or:
+ *         TEXTRENDER_NO_MEMORY: Out of memory.
+ */
+int textrender_draw(textrender *tr, int font, unsigned int size, int x, int y, unsigned int minWidth, const char *str,
+		unsigned short fg, unsigned short bg, unsigned int *width);
+
+/**
+ * @brief Free renderer, its atlas and fonts.
+ * @param tr Renderer handle.
+ */
+void textrender_destroy(textrender *tr);
+
+#endif
@@ -0,0 +1,99 @@
+/* ********************************************************************************************* */
+/* * Ticker Header for streaming scrolling text                                                * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef TICKER_H
+#define TICKER_H
+
+#include <stddef.h>
+
+#include "display.h"
+#include "textrender.h"
+
+/* Return codes */
+#define TICKER_OK 0x0
+#define TICKER_INVALID_ARGS 0x100
+#define TICKER_NO_MEMORY 0x200
+#define TICKER_READ_ERROR 0x300
+#define TICKER_END 0x400
+
+/**
+ * @brief Opaque ticker handle.
+ */
+typedef struct ticker_s ticker;
+
+/**
+ * @brief Text source callback.
+ * @param arg User argument.
+ * @param buffer Buffer where UTF-8 text is written.
+ * @param len Buffer size.
+ * @return Amount of bytes written, 0 if no text is available right now (blank space is scrolled meanwhile), or -1
+ *         when the source is exhausted.
+ */
+typedef int (* ticker_read_fn)(void *arg, char *buffer, size_t len);
+
+/**
+ * @brief Text source reading from a file descriptor (e.g. stdin or a FIFO) without blocking.
+ * @param arg Pointer to an int holding the file descriptor.
+ * @param buffer Buffer where text is written.
+ * @param len Buffer size.
+ * @return See ticker_read_fn. Read errors are reported as the end of the source.
+ */
+int ticker_read_fd(void *arg, char *buffer, size_t len);
+
+/**
+ * @brief Create a ticker: a horizontal band where text from a source scrolls from right to left. Glyphs are copied
+ *        from the renderer atlas just before they enter the screen into a ring of 8-bit coverage columns slightly
+ *        wider than the screen, so memory is constant whatever the amount of text.
+ * @param t Pointer where the ticker handle will be written.
+ * @param driver Initialised display driver.
+ * @param tr Text renderer used for glyph lookup.
+ * @param font Font identifier in tr.
+ * @param size Pixel size.
+ * @param y Top of the band. The band height is the line height of the font and is clipped to the screen.
+ * @param fg Text colour (RGB565).
+ * @param bg Background colour (RGB565).
+ * @param read Text source.
+ * @param readArg Argument passed to read.
+ * @return One of the following error codes:
+ *         TICKER_OK: No errors occurred.
+ *         TICKER_INVALID_ARGS: Invalid font or size.
+ *         TICKER_NO_MEMORY: Out of memory.
+ */
+int ticker_create(ticker **t, display_driver *driver, textrender *tr, int font, unsigned int size, int y,
+		unsigned short fg, unsigned short bg, ticker_read_fn read, void *readArg);
+
+/**
+ * @brief Scroll and redraw the band.
+ * @param t Ticker handle.
+ * @param pixels Amount of columns to scroll.
+ * @return One of the following error codes:
+ *         TICKER_OK: No errors occurred.
+ *         TICKER_END: Source is exhausted and all its text has left the screen.
+ *         TICKER_READ_ERROR: Glyph lookup failed.
+ */
+int ticker_step(ticker *t, unsigned int pixels);
+
+/**
+ * @brief Free ticker. The renderer is not freed.
+ * @param t Ticker handle.
+ */
+void ticker_destroy(ticker *t);
+
+#endif
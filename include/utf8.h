@@ -0,0 +1,68 @@
+/* ********************************************************************************************* */
+/* * UTF-8 decoding helper                                                                     * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+/**
+ * @brief Decode next code point of a UTF-8 string. Malformed sequences give U+FFFD.
+ * @param str Pointer to string position, advanced past the code point. Must not point to the terminator.
+ * @return Code point.
+ */
+static inline unsigned long utf8_next(const char **str) {
+	const unsigned char *s = (const unsigned char *) *str;
+	unsigned long code;
+	int extra, i;
+
+	if(s[0] < 0x80) {
+		*str += 1;
+		return s[0];
+	}
+
+	if(0xC0 == (s[0] & 0xE0)) {
+		code = s[0] & 0x1F;
+		extra = 1;
+	}
+	else if(0xE0 == (s[0] & 0xF0)) {
+		code = s[0] & 0x0F;
+		extra = 2;
+	}
+	else if(0xF0 == (s[0] & 0xF8)) {
+		code = s[0] & 0x07;
+		extra = 3;
+	}
+	else {
+		*str += 1;
+		return 0xFFFD;
+	}
+
+	for(i = 1; i <= extra; i++) {
+		if((s[i] & 0xC0) != 0x80) {
+			*str += i;
+			return 0xFFFD;
+		}
+		code = (code << 6) | (s[i] & 0x3F);
+	}
+
+	*str += extra + 1;
+	return code;
+}
+
+#endif
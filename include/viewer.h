@@ -0,0 +1,114 @@
+/* ********************************************************************************************* */
+/* * Viewer Header for pan/zoom of large images                                                * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#ifndef VIEWER_H
+#define VIEWER_H
+
+#include "display.h"
+
+/* Return codes */
+#define VIEWER_OK 0x0
+#define VIEWER_INVALID_ARGS 0x100
+#define VIEWER_NO_MEMORY 0x200
+#define VIEWER_FILE_ERROR 0x300
+#define VIEWER_DECODE_ERROR 0x400
+
+/* Tile side in pixels */
+#define VIEWER_TILE_SIZE 64
+
+/**
+ * @brief Opaque viewer handle.
+ */
+typedef struct viewer_s viewer;
+
+/**
+ * @brief Open a large image for viewing. The image is seen through a tiled pyramid: level 0 is full resolution and
+ *        each level halves the previous one, up to the first level that fits the screen. Tiles (RGB565) are built
+ *        lazily from the needed regions of the image only, kept in a bounded memory cache and stored on disk.
+ * @param v Pointer where the viewer handle will be written.
+ * @param driver Initialised display driver.
+ * @param path Path to image file (PNG or JPEG).
+ * @param cacheDir Directory for the disk tile cache. A subdirectory is created per image. May be NULL for no disk cache.
+ * @param memTiles Amount of tiles kept in memory. Raised to the amount of tiles that may be visible at once.
+ * @return One of the following error codes:
+ *         VIEWER_OK: No errors occurred.
+ *         VIEWER_NO_MEMORY: Out of memory.
+ *         VIEWER_FILE_ERROR: Image or cache directory could not be accessed.
+ *         VIEWER_DECODE_ERROR: Image header could not be decoded.
+ */
+int viewer_open(viewer **v, display_driver *driver, const char *path, const char *cacheDir, unsigned int memTiles);
+
+/**
+ * @brief Get image information.
+ * @param v Viewer handle.
+ * @param width Pointer where full resolution width will be written.
+ * @param height Pointer where full resolution height will be written.
+ * @param levels Pointer where the amount of pyramid levels will be written.
+ */
+void viewer_get_info(viewer *v, unsigned int *width, unsigned int *height, unsigned int *levels);
+
+/**
+ * @brief Get current view.
+ * @param v Viewer handle.
+ * @param level Pointer where the pyramid level will be written.
+ * @param x Pointer where the leftmost visible column (in level coordinates) will be written.
+ * @param y Pointer where the topmost visible row (in level coordinates) will be written.
+ */
+void viewer_get_view(viewer *v, unsigned int *level, long *x, long *y);
+
+/**
+ * @brief Set view and redraw the whole screen. Coordinates are clamped so that the view stays inside the image.
+ * @param v Viewer handle.
+ * @param level Pyramid level.
+ * @param x Leftmost visible column, in level coordinates.
+ * @param y Topmost visible row, in level coordinates.
+ * @return One of the following error codes:
+ *         VIEWER_OK: No errors occurred.
+ *         VIEWER_INVALID_ARGS: Invalid level.
+ *         VIEWER_NO_MEMORY: Out of memory.
+ *         VIEWER_DECODE_ERROR: Image data could not be decoded.
+ */
+int viewer_set_view(viewer *v, unsigned int level, long x, long y);
+
+/**
+ * @brief Move the view. Horizontal moves use the controller scroll register and only draw the exposed columns, unless
+ *        the driver cannot scroll (e.g. a canvas spanning several panels), in which case the view is redrawn.
+ * @param v Viewer handle.
+ * @param dx Columns to move right (negative moves left).
+ * @param dy Rows to move down (negative moves up).
+ * @return Same codes as viewer_set_view().
+ */
+int viewer_pan(viewer *v, long dx, long dy);
+
+/**
+ * @brief Zoom around the centre of the screen.
+ * @param v Viewer handle.
+ * @param steps Levels to zoom in (negative zooms out). Clamped to the available levels.
+ * @return Same codes as viewer_set_view().
+ */
+int viewer_zoom(viewer *v, int steps);
+
+/**
+ * @brief Close viewer. Hardware scroll is reset, so the screen may need a redraw by the caller.
+ * @param v Viewer handle.
+ */
+void viewer_close(viewer *v);
+
+#endif
@@ -0,0 +1,242 @@
+/* ********************************************************************************************* */
+/* * Animation Library for playback of delta-encoded animations                                * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "animation.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+
+struct animation_s {
+	const unsigned char *map;
+	size_t size;
+	const animation_header *header;
+	const animation_frame *frames;
+};
+
+/**
+ * @brief Check that a frame is well formed: rectangles inside the animation and RLE tokens covering them exactly.
+ * @return Non-zero if valid.
+ */
+static int _validate_frame(animation *anim, const animation_frame *frame) {
+	const uint16_t *data;
+	const uint16_t *end;
+	const animation_rect *rect;
+	unsigned int nRects, i;
+	unsigned int remaining, count;
+
+	if((frame->offset & 1) || (frame->size & 1) || frame->offset > anim->size || frame->size > anim->size - frame->offset)
+		return 0;
+
+	data = (const uint16_t *) (anim->map + frame->offset);
+	end = data + frame->size / 2;
+	if(end - data < 2)
+		return 0;
+
+	nRects = data[0];
+	data += 2;
+
+	for(i = 0; i < nRects; i++) {
+		if((size_t) (end - data) < sizeof(animation_rect) / 2)
+			return 0;
+		rect = (const animation_rect *) data;
+		data += sizeof(animation_rect) / 2;
+
+		if(!rect->w || !rect->h || rect->x + rect->w > anim->header->width || rect->y + rect->h > anim->header->height)
+			return 0;
+
+		for(remaining = rect->w * rect->h; remaining; remaining -= count) {
+			if(data >= end)
+				return 0;
+			count = *data & ANIMATION_RLE_MAX;
+			if(!count || count > remaining)
+				return 0;
+			data += (*data & ANIMATION_RLE_RUN)? 2 : count + 1;
+			if(data > end)
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Map an animation file and validate it.
+ */
+int animation_open(animation **anim, const char *path) {
+	int rv = ANIMATION_OK;
+	animation *newAnim = NULL;
+	int fd = -1;
+	struct stat st;
+	void *map;
+	unsigned int i;
+
+	newAnim = calloc(1, sizeof(animation));
+	ASSERT(newAnim, rv = ANIMATION_NO_MEMORY);
+
+	fd = open(path, O_RDONLY);
+	ASSERT(fd != -1, rv = ANIMATION_FILE_ERROR);
+	ASSERT(0 == fstat(fd, &st), rv = ANIMATION_FILE_ERROR);
+	ASSERT(st.st_size >= (off_t) sizeof(animation_header), rv = ANIMATION_INVALID_FORMAT);
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	ASSERT(map != MAP_FAILED, rv = ANIMATION_FILE_ERROR);
+	newAnim->map = map;
+	newAnim->size = st.st_size;
+
+	newAnim->header = (const animation_header *) newAnim->map;
+	ASSERT(!memcmp(newAnim->header->magic, ANIMATION_MAGIC, 4), rv = ANIMATION_INVALID_FORMAT);
+	ASSERT(ANIMATION_VERSION == newAnim->header->version, rv = ANIMATION_INVALID_FORMAT);
+	ASSERT(newAnim->header->frameCount && newAnim->header->width && newAnim->header->height,
+		rv = ANIMATION_INVALID_FORMAT);
+	ASSERT(!(newAnim->header->frameTableOffset & 3), rv = ANIMATION_INVALID_FORMAT);
+	ASSERT(newAnim->header->frameTableOffset <= newAnim->size, rv = ANIMATION_INVALID_FORMAT);
+	ASSERT((newAnim->size - newAnim->header->frameTableOffset) / sizeof(animation_frame) >
+		newAnim->header->frameCount, rv = ANIMATION_INVALID_FORMAT);
+
+	newAnim->frames = (const animation_frame *) (newAnim->map + newAnim->header->frameTableOffset);
+	for(i = 0; i <= newAnim->header->frameCount; i++)
+		ASSERT(_validate_frame(newAnim, &(newAnim->frames[i])), rv = ANIMATION_INVALID_FORMAT);
+
+	*anim = newAnim;
+	newAnim = NULL;
+
+_err:
+
+	if(fd != -1)
+		close(fd);
+
+	if(newAnim)
+		animation_close(newAnim);
+
+	return rv;
+}
+
+/**
+ * @brief Get animation information.
+ */
+void animation_get_info(animation *anim, unsigned int *width, unsigned int *height, unsigned int *frames) {
+	*width = anim->header->width;
+	*height = anim->header->height;
+	*frames = anim->header->frameCount;
+}
+
+/**
+ * @brief Draw the dirty rectangles of a frame.
+ */
+int animation_draw_frame(animation *anim, display_driver *driver, int x, int y, unsigned int frame) {
+	int rv = ANIMATION_OK;
+	int xres, yres;
+	const uint16_t *data;
+	const animation_rect *rect;
+	unsigned int nRects, i;
+	unsigned int remaining, count;
+
+	driver->get_resolution(&xres, &yres);
+	ASSERT(frame <= anim->header->frameCount, rv = ANIMATION_INVALID_ARGS);
+	ASSERT(x >= 0 && y >= 0 && x + anim->header->width <= xres && y + anim->header->height <= yres,
+		rv = ANIMATION_INVALID_ARGS);
+
+	data = (const uint16_t *) (anim->map + anim->frames[frame].offset);
+	nRects = data[0];
+	data += 2;
+
+	for(i = 0; i < nRects; i++) {
+		rect = (const animation_rect *) data;
+		data += sizeof(animation_rect) / 2;
+
+		driver->set_window(x + rect->x, y + rect->y, x + rect->x + rect->w - 1, y + rect->y + rect->h - 1);
+
+		/* Literals are streamed straight from the mapped file */
+		for(remaining = rect->w * rect->h; remaining; remaining -= count) {
+			count = *data & ANIMATION_RLE_MAX;
+			if(*data & ANIMATION_RLE_RUN) {
+				driver->fill_rgb565(data[1], count);
+				data += 2;
+			}
+			else {
+				driver->write_rgb565(data + 1, count);
+				data += count + 1;
+			}
+		}
+	}
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Play an animation.
+ */
+int animation_play(animation *anim, display_driver *driver, int x, int y, unsigned int loops, volatile int *stop) {
+	int rv = ANIMATION_OK;
+	struct timespec deadline;
+	unsigned int loop, i, frame;
+	uint32_t delay;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	for(loop = 0; !loops || loop < loops; loop++) {
+		for(i = 0; i < anim->header->frameCount; i++) {
+			if(stop && *stop)
+				return ANIMATION_OK;
+
+			/* First frame of a repetition is the loop frame, which updates the last frame in place */
+			frame = (loop && !i)? anim->header->frameCount : i;
+
+			/* With driver synchronisation, each frame goes out right behind the panel scan (no-op otherwise) */
+			driver->wait_vsync(x, y, x + anim->header->width - 1, y + anim->header->height - 1, NULL);
+			rv = animation_draw_frame(anim, driver, x, y, frame);
+			ASSERT(ANIMATION_OK == rv, );
+
+			delay = anim->frames[frame].delay;
+			deadline.tv_sec += delay / 1000000;
+			deadline.tv_nsec += (delay % 1000000) * 1000;
+			if(deadline.tv_nsec >= 1000000000) {
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000;
+			}
+
+			while(EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL));
+		}
+	}
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Unmap animation.
+ */
+void animation_close(animation *anim) {
+	if(anim->map)
+		munmap((void *) anim->map, anim->size);
+
+	free(anim);
+}
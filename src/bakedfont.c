@@ -0,0 +1,348 @@
+/* ********************************************************************************************* */
+/* * Baked Font Library for FreeType-free text                                                 * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "bakedfont.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "rgb565.h"
+#include "utf8.h"
+
+/* Width of the strips the text box is drawn in */
+#define STRIP 64
+
+/* Maximum amount of glyphs with ink crossing a strip. Extra glyphs are not drawn */
+#define STRIP_GLYPHS 128
+
+/**
+ * @brief Glyph walker state, laying out a string one glyph at a time.
+ */
+typedef struct {
+	const bakedfont_glyph *glyphs;
+	const bakedfont_kern *kerns;
+	unsigned int glyphCount;
+	unsigned int kernCount;
+	const char *str;
+	long pen;
+	long right;
+	long prev;
+} walker;
+
+/**
+ * @brief Glyph with ink crossing the strip being drawn.
+ */
+typedef struct {
+	const bakedfont_glyph *glyph;
+	long x;
+} strip_glyph;
+
+/**
+ * @brief Find a baked size.
+ * @return Size table entry or NULL.
+ */
+static const bakedfont_size *_find_size(const bakedfont *font, unsigned int size) {
+	const bakedfont_header *header = (const bakedfont_header *) font->data;
+	const bakedfont_size *sizes = (const bakedfont_size *) &(font->data[header->sizeTableOffset]);
+	unsigned int i;
+
+	for(i = 0; i < header->sizeCount; i++) {
+		if(sizes[i].size == size)
+			return &(sizes[i]);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Start walking a string.
+ */
+static void _walk_start(walker *w, const bakedfont *font, const bakedfont_size *sz, const char *str) {
+	w->glyphs = (const bakedfont_glyph *) &(font->data[sz->glyphOffset]);
+	w->kerns = (const bakedfont_kern *) &(font->data[sz->kernOffset]);
+	w->glyphCount = sz->glyphCount;
+	w->kernCount = sz->kernCount;
+	w->str = str;
+	w->pen = 0;
+	w->right = 0;
+	w->prev = -1;
+}
+
+/**
+ * @brief Place next glyph of the string. Characters not in the font are skipped.
+ * @param w Walker.
+ * @param x Pointer where the leftmost ink column of the glyph will be written.
+ * @return Glyph, or NULL at the end of the string.
+ */
+static const bakedfont_glyph *_walk_next(walker *w, long *x) {
+	const bakedfont_glyph *glyph;
+	unsigned long code;
+	unsigned int lo, hi, mid, index;
+	uint32_t pair;
+
+	while(*(w->str)) {
+		code = utf8_next(&(w->str));
+
+		/* Glyph table is sorted by code point */
+		for(lo = 0, hi = w->glyphCount; lo < hi; ) {
+			mid = (lo + hi) / 2;
+			if(w->glyphs[mid].code < code)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if(lo == w->glyphCount || w->glyphs[lo].code != code)
+			continue;
+		index = lo;
+		glyph = &(w->glyphs[index]);
+
+		/* Kerning table is sorted by (left, right) */
+		if(w->prev >= 0) {
+			pair = ((uint32_t) w->prev << 16) | index;
+			for(lo = 0, hi = w->kernCount; lo < hi; ) {
+				mid = (lo + hi) / 2;
+				if((((uint32_t) w->kerns[mid].left << 16) | w->kerns[mid].right) < pair)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			if(lo < w->kernCount && w->kerns[lo].left == w->prev && w->kerns[lo].right == index)
+				w->pen += w->kerns[lo].kerning;
+		}
+		w->prev = index;
+
+		*x = ((w->pen + 32) >> 6) + glyph->left;
+		w->pen += glyph->advance;
+		if(*x + glyph->width > w->right)
+			w->right = *x + glyph->width;
+
+		return glyph;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Width of a walked string.
+ */
+static unsigned int _walk_width(walker *w) {
+	long end = (w->pen + 63) >> 6;
+
+	return (end > w->right)? end : w->right;
+}
+
+/**
+ * @brief Map and validate a font file.
+ */
+int bakedfont_open(bakedfont *font, const char *path) {
+	int rv = BAKEDFONT_OK;
+	int fd = -1;
+	struct stat st;
+	void *map = MAP_FAILED;
+	const bakedfont_header *header;
+	const bakedfont_size *sizes;
+	const bakedfont_glyph *glyphs;
+	const bakedfont_kern *kerns;
+	uint64_t size;
+	unsigned int i, j;
+
+	fd = open(path, O_RDONLY);
+	ASSERT(fd != -1, rv = BAKEDFONT_FILE_ERROR);
+	ASSERT(0 == fstat(fd, &st), rv = BAKEDFONT_FILE_ERROR);
+	ASSERT(st.st_size >= (off_t) sizeof(bakedfont_header), rv = BAKEDFONT_INVALID_FORMAT);
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	ASSERT(map != MAP_FAILED, rv = BAKEDFONT_FILE_ERROR);
+	size = st.st_size;
+
+	/* Validate everything once, so that drawing needs no checks */
+	header = map;
+	ASSERT(!memcmp(header->magic, BAKEDFONT_MAGIC, 4), rv = BAKEDFONT_INVALID_FORMAT);
+	ASSERT(BAKEDFONT_VERSION == header->version, rv = BAKEDFONT_INVALID_FORMAT);
+	ASSERT(!(header->sizeTableOffset & 3), rv = BAKEDFONT_INVALID_FORMAT);
+	ASSERT(header->sizeTableOffset + (uint64_t) header->sizeCount * sizeof(bakedfont_size) <= size,
+			rv = BAKEDFONT_INVALID_FORMAT);
+	sizes = (const bakedfont_size *) ((const unsigned char *) map + header->sizeTableOffset);
+
+	for(i = 0; i < header->sizeCount; i++) {
+		ASSERT(!(sizes[i].glyphOffset & 3) && !(sizes[i].kernOffset & 3), rv = BAKEDFONT_INVALID_FORMAT);
+		ASSERT(sizes[i].glyphOffset + (uint64_t) sizes[i].glyphCount * sizeof(bakedfont_glyph) <= size,
+				rv = BAKEDFONT_INVALID_FORMAT);
+		ASSERT(sizes[i].kernOffset + (uint64_t) sizes[i].kernCount * sizeof(bakedfont_kern) <= size,
+				rv = BAKEDFONT_INVALID_FORMAT);
+		ASSERT(sizes[i].glyphCount <= 0x10000, rv = BAKEDFONT_INVALID_FORMAT);
+		glyphs = (const bakedfont_glyph *) ((const unsigned char *) map + sizes[i].glyphOffset);
+		kerns = (const bakedfont_kern *) ((const unsigned char *) map + sizes[i].kernOffset);
+
+		for(j = 0; j < sizes[i].glyphCount; j++) {
+			ASSERT(!j || glyphs[j].code > glyphs[j - 1].code, rv = BAKEDFONT_INVALID_FORMAT);
+			ASSERT(glyphs[j].bitmapOffset + (uint64_t) glyphs[j].width * glyphs[j].height <= size,
+					rv = BAKEDFONT_INVALID_FORMAT);
+		}
+
+		for(j = 0; j < sizes[i].kernCount; j++)
+			ASSERT(kerns[j].left < sizes[i].glyphCount && kerns[j].right < sizes[i].glyphCount,
+					rv = BAKEDFONT_INVALID_FORMAT);
+	}
+
+	font->data = map;
+	font->size = size;
+
+_err:
+	if(fd != -1)
+		close(fd);
+
+	if(rv != BAKEDFONT_OK && map != MAP_FAILED)
+		munmap(map, st.st_size);
+
+	return rv;
+}
+
+/**
+ * @brief Get vertical metrics of a baked size.
+ */
+int bakedfont_get_metrics(const bakedfont *font, unsigned int size, int *ascent, int *descent) {
+	const bakedfont_size *sz = _find_size(font, size);
+
+	if(!sz)
+		return BAKEDFONT_INVALID_ARGS;
+
+	*ascent = sz->ascent;
+	*descent = sz->descent;
+
+	return BAKEDFONT_OK;
+}
+
+/**
+ * @brief Measure a UTF-8 string.
+ */
+int bakedfont_measure(const bakedfont *font, unsigned int size, const char *str, unsigned int *width,
+		unsigned int *height) {
+	const bakedfont_size *sz = _find_size(font, size);
+	walker w;
+	long x;
+
+	if(!sz)
+		return BAKEDFONT_INVALID_ARGS;
+
+	_walk_start(&w, font, sz, str);
+	while(_walk_next(&w, &x));
+
+	*width = _walk_width(&w);
+	*height = sz->ascent + sz->descent;
+
+	return BAKEDFONT_OK;
+}
+
+/**
+ * @brief Draw a UTF-8 string on an opaque box.
+ */
+int bakedfont_draw(const bakedfont *font, display_driver *driver, unsigned int size, int x, int y,
+		unsigned int minWidth, const char *str, unsigned short fg, unsigned short bg, unsigned int *width) {
+	const bakedfont_size *sz = _find_size(font, size);
+	const bakedfont_glyph *glyph;
+	walker w;
+	strip_glyph refs[STRIP_GLYPHS];
+	unsigned char cov[STRIP];
+	uint16_t pix[STRIP];
+	uint16_t lut[256];
+	unsigned int boxW, boxH, nRefs, i;
+	int xres, yres, cx0, cy0, cx1, cy1, sx, sw, row, col;
+	long gx;
+
+	if(!sz)
+		return BAKEDFONT_INVALID_ARGS;
+
+	_walk_start(&w, font, sz, str);
+	while(_walk_next(&w, &gx));
+	boxW = _walk_width(&w);
+	boxW = (boxW > minWidth)? boxW : minWidth;
+	boxH = sz->ascent + sz->descent;
+	if(width)
+		*width = boxW;
+
+	driver->get_resolution(&xres, &yres);
+	cx0 = (x > 0)? x : 0;
+	cy0 = (y > 0)? y : 0;
+	cx1 = (x + (int) boxW < xres)? x + (int) boxW : xres;
+	cy1 = (y + (int) boxH < yres)? y + (int) boxH : yres;
+	if(cx1 <= cx0 || cy1 <= cy0)
+		return BAKEDFONT_OK;
+
+	rgb565_blend_lut(fg, bg, lut);
+
+	for(sx = cx0; sx < cx1; sx += sw) {
+		long bx0 = sx - x;
+
+		sw = (cx1 - sx < STRIP)? cx1 - sx : STRIP;
+
+		/* Glyphs with ink in this strip */
+		nRefs = 0;
+		_walk_start(&w, font, sz, str);
+		while((glyph = _walk_next(&w, &gx)) && nRefs < STRIP_GLYPHS) {
+			if(glyph->width && glyph->height && gx < bx0 + sw && gx + glyph->width > bx0) {
+				refs[nRefs].glyph = glyph;
+				refs[nRefs].x = gx;
+				nRefs++;
+			}
+		}
+
+		driver->set_window(sx, cy0, sx + sw - 1, cy1 - 1);
+		for(row = cy0 - y; row < cy1 - y; row++) {
+			memset(cov, 0, sw);
+			for(i = 0; i < nRefs; i++) {
+				const bakedfont_glyph *g = refs[i].glyph;
+				int gy = row - (sz->ascent - g->top);
+				const unsigned char *src;
+
+				if(gy < 0 || gy >= g->height)
+					continue;
+
+				src = &(font->data[g->bitmapOffset + gy * g->width]);
+				for(col = 0; col < sw; col++) {
+					long c = bx0 + col - refs[i].x;
+
+					if(c >= 0 && c < g->width && src[c] > cov[col])
+						cov[col] = src[c];
+				}
+			}
+
+			for(col = 0; col < sw; col++)
+				pix[col] = lut[cov[col]];
+			driver->write_rgb565(pix, sw);
+		}
+	}
+
+	return BAKEDFONT_OK;
+}
+
+/**
+ * @brief Unmap font file.
+ */
+void bakedfont_close(bakedfont *font) {
+	munmap((void *) font->data, font->size);
+	font->data = NULL;
+	font->size = 0;
+}
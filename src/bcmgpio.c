@@ -21,12 +21,17 @@
 #include "bcmgpio.h"
 
 #include <fcntl.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "common.h"
+#include "displaystats.h"
 
 /* Peripheral base address for Raspberry Pi 3 Model B */
 #define PERI_BASE 0x3F000000
@@ -37,12 +42,57 @@
 #define BLOCK_SIZE (4 * 1024)
 
 /* Offsets for managing GPIOs */
-#define GPIO_SET_OFFSET 0x7
-#define GPIO_CLEAR_OFFSET 0xA
 #define GPIO_READ_OFFSET 0xD
 
+_Static_assert(BCMGPIO_SET_OFFSET + 3 * BCMGPIO_OP_CLEAR == BCMGPIO_CLEAR_OFFSET, "Operations must select registers");
+_Static_assert(8 == BCMGPIO_BURST, "bcmgpio_exec_burst() is unrolled for 8 operations");
+
 /* Global GPIO handler */
-static volatile unsigned *gpio = NULL;
+volatile unsigned *bcmgpio_base = NULL;
+
+/* Trace ring (NULL unless capturing), next record, records written and time of the last one */
+bcmgpio_trace_record *bcmgpio_traceRing = NULL;
+static unsigned int traceSize = 0;
+static unsigned int traceNext = 0;
+static unsigned long long traceCount = 0;
+static uint64_t traceLast = 0;
+
+/**
+ * @brief Read the trace clock.
+ * @return Time in nanoseconds.
+ */
+static inline uint64_t _trace_now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Append a store to the trace ring.
+ */
+void bcmgpio_trace_store(unsigned int value, unsigned int clear) {
+	uint64_t now = _trace_now();
+	uint64_t delta = (now - traceLast > 0x7FFFFFFF)? 0x7FFFFFFF : now - traceLast;
+
+	bcmgpio_traceRing[traceNext].value = value;
+	bcmgpio_traceRing[traceNext].meta = (delta << 1) | clear;
+	traceLast = now;
+	traceNext = (traceNext + 1 == traceSize)? 0 : traceNext + 1;
+	traceCount++;
+}
+
+/**
+ * @brief Count GPIO stores of the checked functions. Unchecked ones are left to their callers, which can count them
+ *        in bulk instead of on every store.
+ */
+static inline void _count_stores(unsigned int n) {
+	display_stats *stats = displaystats_get();
+
+	if(stats)
+		DISPLAYSTATS_ADD(stats, gpioStores, n);
+}
 
 /**
  * @brief Initialise library.
@@ -52,7 +102,7 @@ int bcmgpio_init(void) {
 	int memFd = -1;
 	void *gpioMap = NULL;
 
-	ASSERT(gpio == NULL, rv = BCMGPIO_ALREADY_INIT);
+	ASSERT(bcmgpio_base == NULL, rv = BCMGPIO_ALREADY_INIT);
 
 	memFd = open("/dev/mem", O_RDWR | O_SYNC);
 	ASSERT(memFd > 0, rv = BCMGPIO_DEV_INACCESSIBLE);
@@ -60,7 +110,7 @@ int bcmgpio_init(void) {
 	gpioMap = mmap(NULL, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, GPIO_BASE);
 	ASSERT(gpioMap != MAP_FAILED, rv = (BCMGPIO_MMAP_ERROR | (int) gpioMap));
 
-	gpio = (volatile unsigned *) gpioMap;
+	bcmgpio_base = (volatile unsigned *) gpioMap;
 
 _err:
 	if(memFd != -1)
@@ -76,12 +126,14 @@ int bcmgpio_set_direction(unsigned int pin, unsigned int direction) {
 	int rv = BCMGPIO_OK;
 
 	ASSERT((BCMGPIO_DIR_IN == direction) || (BCMGPIO_DIR_OUT == direction), rv = BCMGPIO_INVALID_ARGS);
-	ASSERT(gpio != NULL, rv = BCMGPIO_NOT_INIT);
+	ASSERT(bcmgpio_base != NULL, rv = BCMGPIO_NOT_INIT);
 
-	*(gpio + (pin / 10)) &= ~(7 << ((pin % 10) * 3));
+	*(bcmgpio_base + (pin / 10)) &= ~(7 << ((pin % 10) * 3));
 
 	if(BCMGPIO_DIR_OUT == direction)
-		*(gpio + (pin / 10)) |=  (1 << ((pin % 10) * 3));
+		*(bcmgpio_base + (pin / 10)) |=  (1 << ((pin % 10) * 3));
+
+	_count_stores((BCMGPIO_DIR_OUT == direction)? 2 : 1);
 
 _err:
 
@@ -94,12 +146,16 @@ _err:
 int bcmgpio_write(unsigned int pin, unsigned char value) {
 	int rv = BCMGPIO_OK;
 
-	ASSERT(gpio != NULL, rv = BCMGPIO_NOT_INIT);
+	ASSERT(bcmgpio_base != NULL, rv = BCMGPIO_NOT_INIT);
 
 	if(value)
-		*(gpio + GPIO_SET_OFFSET) = 1 << pin;
+		*(bcmgpio_base + BCMGPIO_SET_OFFSET) = 1 << pin;
 	else
-		*(gpio + GPIO_CLEAR_OFFSET) = 1 << pin;
+		*(bcmgpio_base + BCMGPIO_CLEAR_OFFSET) = 1 << pin;
+
+	if(bcmgpio_traceRing)
+		bcmgpio_trace_store(1 << pin, value? 0 : BCMGPIO_TRACE_CLEAR);
+	_count_stores(1);
 
 _err:
 
@@ -124,10 +180,16 @@ _err:
 int bcmgpio_write_mask(unsigned int pinMask, unsigned int value) {
 	int rv = BCMGPIO_OK;
 
-	ASSERT(gpio != NULL, rv = BCMGPIO_NOT_INIT);
+	ASSERT(bcmgpio_base != NULL, rv = BCMGPIO_NOT_INIT);
+
+	*(bcmgpio_base + BCMGPIO_SET_OFFSET) = pinMask & value;
+	*(bcmgpio_base + BCMGPIO_CLEAR_OFFSET) = pinMask & ~value;
 
-	*(gpio + GPIO_SET_OFFSET) = pinMask & value;
-	*(gpio + GPIO_CLEAR_OFFSET) = pinMask & ~value;
+	if(bcmgpio_traceRing) {
+		bcmgpio_trace_store(pinMask & value, 0);
+		bcmgpio_trace_store(pinMask & ~value, BCMGPIO_TRACE_CLEAR);
+	}
+	_count_stores(2);
 
 _err:
 
@@ -135,36 +197,259 @@ _err:
 }
 
 /**
- * @brief Write bit to a pin. Its behaviour is similar to bcmgpio_write(), but there are no error checks.
- *
- * @note Since there are no error checks, make sure bcmgpio_init() was executed before with success!
+ * @brief Run a sequence of stores and delays.
  */
-inline void bcmgpio_write_uns(unsigned int pin, unsigned char value) {
-	*(gpio + (value? GPIO_SET_OFFSET : GPIO_CLEAR_OFFSET)) = 1 << pin;
+int bcmgpio_exec(const bcmgpio_op *ops, size_t n) {
+	int rv = BCMGPIO_OK;
+	volatile unsigned *set, *clear;
+	unsigned int stores = 0;
+	uint64_t mark;
+	size_t i;
+
+	ASSERT(bcmgpio_base != NULL, rv = BCMGPIO_NOT_INIT);
+
+	/* Checked before the first store, so that a sequence is never run halfway */
+	for(i = 0; i < n; i++)
+		ASSERT(ops[i].op <= BCMGPIO_OP_DELAY, rv = BCMGPIO_INVALID_ARGS);
+
+	set = bcmgpio_base + BCMGPIO_SET_OFFSET;
+	clear = bcmgpio_base + BCMGPIO_CLEAR_OFFSET;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	mark = _trace_now();
+
+	for(i = 0; i < n; i++) {
+		switch(ops[i].op) {
+			case BCMGPIO_OP_SET:
+				*set = ops[i].value;
+				stores++;
+				break;
+			case BCMGPIO_OP_CLEAR:
+				*clear = ops[i].value;
+				stores++;
+				break;
+			case BCMGPIO_OP_DELAY:
+				/* Stores before the delay must not be held back past it */
+				__atomic_thread_fence(__ATOMIC_SEQ_CST);
+				mark += ops[i].value;
+				while(_trace_now() < mark)
+					;
+				continue;
+		}
+
+		if(bcmgpio_traceRing)
+			bcmgpio_trace_store(ops[i].value, ops[i].op);
+	}
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	_count_stores(stores);
+
+_err:
+
+	return rv;
 }
 
 /**
- * @brief Write bits to the first 32 pins. Its behaviour is similar to bcmgpio_write_mask(), but there are no error checks.
- *
- * @note Since there are no error checks, make sure bcmgpio_init() was executed before with success!
+ * @brief Run a sequence of stores unrolled in blocks of BCMGPIO_BURST.
  */
-inline void bcmgpio_write_mask_uns(unsigned int pinMask, unsigned int value) {
-	*(gpio + GPIO_SET_OFFSET) = pinMask & value;
-	*(gpio + GPIO_CLEAR_OFFSET) = pinMask & ~value;
+int bcmgpio_exec_burst(const bcmgpio_op *ops, size_t n) {
+	int rv = BCMGPIO_OK;
+	volatile unsigned *set;
+	size_t i;
+
+	ASSERT(!(n % BCMGPIO_BURST), rv = BCMGPIO_INVALID_ARGS);
+	ASSERT(bcmgpio_base != NULL, rv = BCMGPIO_NOT_INIT);
+
+	/* The operation indexes the registers below, anything but a store would write elsewhere */
+	for(i = 0; i < n; i++)
+		ASSERT(ops[i].op <= BCMGPIO_OP_CLEAR, rv = BCMGPIO_INVALID_ARGS);
+
+	if(bcmgpio_traceRing) {
+		rv = bcmgpio_exec(ops, n);
+		goto _err;
+	}
+
+	/* The clear register is 3 words after the set register, so the operation itself selects the register */
+	set = bcmgpio_base + BCMGPIO_SET_OFFSET;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	for(i = 0; i < n; i += BCMGPIO_BURST) {
+		*(set + 3 * ops[i].op) = ops[i].value;
+		*(set + 3 * ops[i + 1].op) = ops[i + 1].value;
+		*(set + 3 * ops[i + 2].op) = ops[i + 2].value;
+		*(set + 3 * ops[i + 3].op) = ops[i + 3].value;
+		*(set + 3 * ops[i + 4].op) = ops[i + 4].value;
+		*(set + 3 * ops[i + 5].op) = ops[i + 5].value;
+		*(set + 3 * ops[i + 6].op) = ops[i + 6].value;
+		*(set + 3 * ops[i + 7].op) = ops[i + 7].value;
+	}
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	_count_stores(n);
+
+_err:
+
+	return rv;
 }
 
 /**
  * @brief Read bit from a pin.
  */
 unsigned char bcmgpio_read(unsigned int pin) {
-	return *(gpio + GPIO_READ_OFFSET) & (1 << pin);
+	return (*(bcmgpio_base + GPIO_READ_OFFSET) >> pin) & 1;
 }
 
 /**
  * @brief Read bits from the first 32 pins where pinMask is enabled.
  */
 unsigned int bcmgpio_read_mask(unsigned int pinMask) {
-	return *(gpio + GPIO_READ_OFFSET) & pinMask;
+	return *(bcmgpio_base + GPIO_READ_OFFSET) & pinMask;
+}
+
+/**
+ * @brief Start capturing every store to the set and clear registers.
+ */
+int bcmgpio_trace_start(unsigned int records) {
+	int rv = BCMGPIO_OK;
+
+	ASSERT(records && !bcmgpio_traceRing, rv = BCMGPIO_INVALID_ARGS);
+
+	bcmgpio_traceRing = malloc(records * sizeof(bcmgpio_trace_record));
+	ASSERT(bcmgpio_traceRing, rv = BCMGPIO_NO_MEMORY);
+
+	traceSize = records;
+	traceNext = 0;
+	traceCount = 0;
+	traceLast = _trace_now();
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Stop capturing and write the captured stores to a trace file.
+ */
+int bcmgpio_trace_stop(const char *path) {
+	int rv = BCMGPIO_OK;
+	bcmgpio_trace_record *ring = bcmgpio_traceRing;
+	bcmgpio_trace_header header;
+	unsigned int first;
+	FILE *file = NULL;
+
+	/* Stop capturing before anything else, so that nothing below is captured */
+	bcmgpio_traceRing = NULL;
+	if(!ring || !path)
+		goto _err;
+
+	memcpy(header.magic, BCMGPIO_TRACE_MAGIC, 4);
+	header.version = BCMGPIO_TRACE_VERSION;
+	header.count = (traceCount < traceSize)? traceCount : traceSize;
+	header.dropped = (traceCount - header.count > UINT32_MAX)? UINT32_MAX : traceCount - header.count;
+	first = (traceCount < traceSize)? 0 : traceNext;
+
+	file = fopen(path, "wb");
+	ASSERT(file, rv = BCMGPIO_FILE_ERROR);
+	ASSERT(1 == fwrite(&header, sizeof(bcmgpio_trace_header), 1, file), rv = BCMGPIO_FILE_ERROR);
+
+	/* Oldest first: from the next slot to the end of the ring, then from its start */
+	ASSERT(header.count - first == fwrite(&ring[first], sizeof(bcmgpio_trace_record), header.count - first, file),
+		rv = BCMGPIO_FILE_ERROR);
+	ASSERT(first == fwrite(ring, sizeof(bcmgpio_trace_record), first, file), rv = BCMGPIO_FILE_ERROR);
+
+_err:
+
+	if(file && fclose(file))
+		rv = BCMGPIO_FILE_ERROR;
+
+	free(ring);
+
+	return rv;
+}
+
+/**
+ * @brief Get how many whole records a trace file holds after its header.
+ * @param file Trace file, positioned right after the header.
+ * @return Number of records, or 0 if the size is unknown.
+ */
+static size_t _trace_records_left(FILE *file) {
+	struct stat st;
+
+	if(fstat(fileno(file), &st) || st.st_size < (off_t) sizeof(bcmgpio_trace_header))
+		return 0;
+
+	return (st.st_size - sizeof(bcmgpio_trace_header)) / sizeof(bcmgpio_trace_record);
+}
+
+/**
+ * @brief Replay the stores of a trace file.
+ */
+int bcmgpio_trace_replay(const char *path, int timed) {
+	int rv = BCMGPIO_OK;
+	FILE *file = NULL;
+	bcmgpio_trace_header header;
+	bcmgpio_trace_record *records = NULL;
+	bcmgpio_op *ops = NULL;
+	unsigned int pins = 0, i;
+	size_t n;
+
+	ASSERT(bcmgpio_base != NULL, rv = BCMGPIO_NOT_INIT);
+
+	file = fopen(path, "rb");
+	ASSERT(file, rv = BCMGPIO_FILE_ERROR);
+	ASSERT(1 == fread(&header, sizeof(bcmgpio_trace_header), 1, file), rv = BCMGPIO_FILE_ERROR);
+	ASSERT(!memcmp(header.magic, BCMGPIO_TRACE_MAGIC, 4) && BCMGPIO_TRACE_VERSION == header.version,
+		rv = BCMGPIO_FILE_ERROR);
+
+	/* The count comes from the file: it must fit in it, and the operation array must fit in memory */
+	ASSERT(header.count <= _trace_records_left(file), rv = BCMGPIO_FILE_ERROR);
+	ASSERT(header.count <= SIZE_MAX / (2 * sizeof(bcmgpio_op)), rv = BCMGPIO_NO_MEMORY);
+
+	records = malloc(header.count * sizeof(bcmgpio_trace_record));
+	ASSERT(records || !header.count, rv = BCMGPIO_NO_MEMORY);
+	ASSERT(header.count == fread(records, sizeof(bcmgpio_trace_record), header.count, file), rv = BCMGPIO_FILE_ERROR);
+
+	for(i = 0; i < header.count; i++)
+		pins |= records[i].value;
+	for(i = 0; i < 32; i++) {
+		if(pins & (1u << i))
+			bcmgpio_set_direction(i, BCMGPIO_DIR_OUT);
+	}
+
+	/* Records become stores, each preceded by its delay when timed */
+	ops = malloc((timed? 2 : 1) * header.count * sizeof(bcmgpio_op));
+	ASSERT(ops || !header.count, rv = BCMGPIO_NO_MEMORY);
+
+	for(i = 0, n = 0; i < header.count; i++) {
+		/* The first delta is relative to a store that is not in the file when records were dropped, so it is skipped */
+		if(timed && (i || !header.dropped)) {
+			ops[n].op = BCMGPIO_OP_DELAY;
+			ops[n++].value = records[i].meta >> 1;
+		}
+		ops[n].op = (records[i].meta & BCMGPIO_TRACE_CLEAR)? BCMGPIO_OP_CLEAR : BCMGPIO_OP_SET;
+		ops[n++].value = records[i].value;
+	}
+
+	/* Untimed, the bulk goes in bursts */
+	if(timed) {
+		rv = bcmgpio_exec(ops, n);
+	}
+	else {
+		rv = bcmgpio_exec_burst(ops, n - n % BCMGPIO_BURST);
+		if(BCMGPIO_OK == rv)
+			rv = bcmgpio_exec(ops + n - n % BCMGPIO_BURST, n % BCMGPIO_BURST);
+	}
+
+_err:
+
+	if(file)
+		fclose(file);
+
+	free(records);
+	free(ops);
+
+	return rv;
 }
 
 /**
@@ -173,10 +458,10 @@ unsigned int bcmgpio_read_mask(unsigned int pinMask) {
 int bcmgpio_finish(void) {
 	int rv = BCMGPIO_OK;
 
-	ASSERT(gpio != NULL, rv = BCMGPIO_NOT_INIT);
+	ASSERT(bcmgpio_base != NULL, rv = BCMGPIO_NOT_INIT);
 
-	munmap((void *) gpio, BLOCK_SIZE);
-	gpio = NULL;
+	munmap((void *) bcmgpio_base, BLOCK_SIZE);
+	bcmgpio_base = NULL;
 
 _err:
 
@@ -0,0 +1,287 @@
+/* ********************************************************************************************* */
+/* * Blitter Library for sprites over a static background                                      * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "blitter.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "dirtyrect.h"
+#include "rgb565.h"
+
+/**
+ * @brief Sprite state. The shown fields describe what is currently on the display.
+ */
+typedef struct {
+	const uint16_t *pixels;
+	const uint8_t *alpha;
+	int width;
+	int height;
+	int mode;
+	uint16_t key;
+	int x;
+	int y;
+	int visible;
+	int dirty;
+	int shownX;
+	int shownY;
+	int shownVisible;
+} sprite;
+
+struct blitter_s {
+	display_driver *driver;
+	const uint16_t *background;
+	int stride;
+	int xres;
+	int yres;
+	sprite *sprites;
+	int nSprites;
+	dirtyrect_list dirty;
+	uint16_t *row;
+};
+
+/**
+ * @brief Clip a sprite box to the screen.
+ * @return Non-zero if anything is left.
+ */
+static int _clip(blitter *b, int x, int y, int w, int h, dirtyrect *r) {
+	r->x0 = (x > 0)? x : 0;
+	r->y0 = (y > 0)? y : 0;
+	r->x1 = (x + w - 1 < b->xres - 1)? x + w - 1 : b->xres - 1;
+	r->y1 = (y + h - 1 < b->yres - 1)? y + h - 1 : b->yres - 1;
+
+	return r->x0 <= r->x1 && r->y0 <= r->y1;
+}
+
+/**
+ * @brief Add a rectangle to the dirty list.
+ * @return BLITTER_OK or BLITTER_NO_MEMORY.
+ */
+static int _add_dirty(blitter *b, dirtyrect r) {
+	return (DIRTYRECT_OK == dirtyrect_add(&(b->dirty), r))? BLITTER_OK : BLITTER_NO_MEMORY;
+}
+
+/**
+ * @brief Compose one line of a rectangle into the line buffer.
+ */
+static void _compose(blitter *b, int y, int x0, int x1) {
+	uint16_t *row = b->row;
+	int i, x;
+
+	memcpy(row, &(b->background[y * b->stride + x0]), (x1 - x0 + 1) * sizeof(uint16_t));
+
+	/* Sprites bottom to top */
+	for(i = 0; i < b->nSprites; i++) {
+		sprite *s = &(b->sprites[i]);
+		int sx0, sx1, off;
+		const uint16_t *src;
+
+		if(!(s->visible) || y < s->y || y >= s->y + s->height)
+			continue;
+		sx0 = (s->x > x0)? s->x : x0;
+		sx1 = (s->x + s->width - 1 < x1)? s->x + s->width - 1 : x1;
+		if(sx0 > sx1)
+			continue;
+
+		off = (y - s->y) * s->width - s->x;
+		src = &(s->pixels[off]);
+
+		switch(s->mode) {
+			case BLITTER_COLOURKEY:
+				for(x = sx0; x <= sx1; x++) {
+					if(src[x] != s->key)
+						row[x - x0] = src[x];
+				}
+				break;
+			case BLITTER_ALPHA:
+				for(x = sx0; x <= sx1; x++) {
+					unsigned int a = s->alpha[off + x];
+
+					if(a)
+						row[x - x0] = (255 == a)? src[x] : rgb565_blend(src[x], row[x - x0], (a + 4) >> 3);
+				}
+				break;
+			default:
+				memcpy(&(row[sx0 - x0]), &(src[sx0]), (sx1 - sx0 + 1) * sizeof(uint16_t));
+				break;
+		}
+	}
+}
+
+/**
+ * @brief Create a blitter.
+ */
+int blitter_create(blitter **b, display_driver *driver, const unsigned short *background, int stride) {
+	int rv = BLITTER_OK;
+	blitter *newB = NULL;
+
+	newB = calloc(1, sizeof(blitter));
+	ASSERT(newB, rv = BLITTER_NO_MEMORY);
+	newB->driver = driver;
+	newB->background = background;
+	newB->stride = stride;
+	driver->get_resolution(&(newB->xres), &(newB->yres));
+	ASSERT(background && stride >= newB->xres, rv = BLITTER_INVALID_ARGS);
+
+	newB->row = malloc(newB->xres * sizeof(uint16_t));
+	ASSERT(newB->row, rv = BLITTER_NO_MEMORY);
+	ASSERT(DIRTYRECT_OK == dirtyrect_init(&(newB->dirty)), rv = BLITTER_NO_MEMORY);
+
+	*b = newB;
+
+_err:
+	if(rv != BLITTER_OK && newB)
+		blitter_destroy(newB);
+
+	return rv;
+}
+
+/**
+ * @brief Add a sprite on top of the existing ones.
+ */
+int blitter_add_sprite(blitter *b, const unsigned short *pixels, const unsigned char *alpha, int width, int height,
+		int mode, unsigned short key, int *id) {
+	sprite *newSprites;
+	sprite *s;
+
+	if(!pixels || width <= 0 || height <= 0 || mode < BLITTER_OPAQUE || mode > BLITTER_ALPHA ||
+			(BLITTER_ALPHA == mode && !alpha))
+		return BLITTER_INVALID_ARGS;
+
+	newSprites = realloc(b->sprites, (b->nSprites + 1) * sizeof(sprite));
+	if(!newSprites)
+		return BLITTER_NO_MEMORY;
+	b->sprites = newSprites;
+
+	s = &(b->sprites[b->nSprites]);
+	memset(s, 0, sizeof(sprite));
+	s->pixels = pixels;
+	s->alpha = alpha;
+	s->width = width;
+	s->height = height;
+	s->mode = mode;
+	s->key = key;
+	*id = (b->nSprites)++;
+
+	return BLITTER_OK;
+}
+
+/**
+ * @brief Replace the image of a sprite.
+ */
+void blitter_set_image(blitter *b, int id, const unsigned short *pixels, const unsigned char *alpha) {
+	b->sprites[id].pixels = pixels;
+	b->sprites[id].alpha = alpha;
+	b->sprites[id].dirty = 1;
+}
+
+/**
+ * @brief Move a sprite.
+ */
+void blitter_move(blitter *b, int id, int x, int y) {
+	b->sprites[id].x = x;
+	b->sprites[id].y = y;
+	b->sprites[id].dirty = 1;
+}
+
+/**
+ * @brief Show or hide a sprite.
+ */
+void blitter_show(blitter *b, int id, int visible) {
+	b->sprites[id].visible = visible;
+	b->sprites[id].dirty = 1;
+}
+
+/**
+ * @brief Mark a screen region for redraw.
+ */
+int blitter_invalidate(blitter *b, int x, int y, int w, int h) {
+	dirtyrect r;
+
+	if(!_clip(b, x, y, w, h, &r))
+		return BLITTER_OK;
+
+	return _add_dirty(b, r);
+}
+
+/**
+ * @brief Send pending changes to the display.
+ */
+int blitter_flush(blitter *b, unsigned int *pixels) {
+	int rv = BLITTER_OK;
+	unsigned int sent = 0;
+	int i, y;
+	dirtyrect r;
+
+	/* Old and new boxes of changed sprites */
+	for(i = 0; i < b->nSprites; i++) {
+		sprite *s = &(b->sprites[i]);
+
+		if(!(s->dirty))
+			continue;
+
+		if(s->shownVisible && _clip(b, s->shownX, s->shownY, s->width, s->height, &r)) {
+			rv = _add_dirty(b, r);
+			ASSERT(BLITTER_OK == rv, );
+		}
+		if(s->visible && _clip(b, s->x, s->y, s->width, s->height, &r)) {
+			rv = _add_dirty(b, r);
+			ASSERT(BLITTER_OK == rv, );
+		}
+
+		s->shownX = s->x;
+		s->shownY = s->y;
+		s->shownVisible = s->visible;
+		s->dirty = 0;
+	}
+
+	for(i = 0; i < b->dirty.n; i++) {
+		dirtyrect *d = &(b->dirty.rects[i]);
+
+		b->driver->set_window(d->x0, d->y0, d->x1, d->y1);
+		for(y = d->y0; y <= d->y1; y++) {
+			_compose(b, y, d->x0, d->x1);
+			b->driver->write_rgb565(b->row, d->x1 - d->x0 + 1);
+		}
+		sent += (d->x1 - d->x0 + 1) * (d->y1 - d->y0 + 1);
+	}
+	b->dirty.n = 0;
+
+	if(pixels)
+		*pixels = sent;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Free blitter.
+ */
+void blitter_destroy(blitter *b) {
+	if(b->sprites)
+		free(b->sprites);
+	dirtyrect_free(&(b->dirty));
+	if(b->row)
+		free(b->row);
+	free(b);
+}
@@ -0,0 +1,716 @@
+/* ********************************************************************************************* */
+/* * Bus Queue Library for multi-threaded drawing                                              * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#define _GNU_SOURCE
+
+#include "busqueue.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+
+/* Pixels carried by one slot */
+#define SLOT_PIXELS 120
+
+/* Command types */
+#define CMD_FILL 0
+#define CMD_BLIT 1
+#define CMD_VSYNC 2
+
+/* Command flags: first and last command of a submitted batch */
+#define FLAG_FIRST 0x1
+#define FLAG_LAST 0x2
+
+/**
+ * @brief Draw command. It covers count pixels of a rectangle in row-major order, starting offset pixels in. A refresh
+ *        boundary only has the rectangle, bounding what the frame after it draws.
+ */
+typedef struct {
+	int type;
+	int flags;
+	int16_t x0;
+	int16_t y0;
+	int16_t x1;
+	int16_t y1;
+	uint32_t offset;
+	uint32_t count;
+	uint16_t colour;
+	/* Submission time in nanoseconds, on the last command of a batch */
+	uint64_t submitted;
+	uint16_t pixels[SLOT_PIXELS];
+} command;
+
+/**
+ * @brief Ring slot. For ring position p, the sequence is p when the slot is free, p + 1 when it holds the command for
+ *        p, and p + ring size once that command was consumed.
+ */
+typedef struct {
+	atomic_uint seq;
+	command cmd;
+} slot;
+
+struct busqueue_s {
+	display_driver *driver;
+	int yres;
+	slot *ring;
+	unsigned int mask;
+	atomic_uint tail;
+	atomic_uint done;
+	atomic_int stop;
+	sem_t items;
+	pthread_t thread;
+	int threadCreated;
+	/* Consumer state: open window and cursor, and the fill being merged */
+	int winOpen;
+	int winX0;
+	int winX1;
+	int curRow;
+	int curCol;
+	int fillPending;
+	unsigned int fillPos;
+	int fillX0;
+	int fillX1;
+	int fillRow;
+	int fillCol;
+	uint32_t fillCount;
+	uint16_t fillColour;
+	/* Consumer timing of the batch being sent: CPU time at its start and time spent in driver calls */
+	uint64_t cpuStart;
+	uint64_t busy;
+	/* Refresh boundary of the frame being sent, 0 if none */
+	uint64_t frameStart;
+	/* Statistics, written by the consumer and read (or reset) by anyone */
+	atomic_uint batches;
+	atomic_uint latency[BUSQUEUE_HIST_BINS];
+	atomic_uint gaps[BUSQUEUE_HIST_BINS];
+	atomic_uint maxLatency;
+	atomic_uint maxGap;
+	atomic_uint frames;
+	atomic_uint present[BUSQUEUE_HIST_BINS];
+	atomic_uint maxPresent;
+};
+
+struct busqueue_batch_s {
+	busqueue *q;
+	command *cmds;
+	unsigned int count;
+	unsigned int capacity;
+	int xres;
+	int yres;
+	/* Staged refresh boundary still bounding the commands staged after it, -1 if none */
+	int vsync;
+};
+
+/**
+ * @brief Read a clock in nanoseconds.
+ */
+static inline uint64_t _now(clockid_t clock) {
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Add a duration to a histogram of power-of-two microsecond bins and update its maximum.
+ */
+static void _record(atomic_uint *hist, atomic_uint *max, uint64_t ns) {
+	unsigned int us = (ns / 1000 > UINT32_MAX)? UINT32_MAX : ns / 1000;
+	int bin = us? 32 - __builtin_clz(us) : 0;
+
+	atomic_fetch_add_explicit(&(hist[(bin < BUSQUEUE_HIST_BINS)? bin : BUSQUEUE_HIST_BINS - 1]), 1,
+		memory_order_relaxed);
+	if(us > atomic_load_explicit(max, memory_order_relaxed))
+		atomic_store_explicit(max, us, memory_order_relaxed);
+}
+
+/**
+ * @brief Send pixels, addressing only if they do not continue where the cursor is.
+ * @param q Queue handle.
+ * @param x0 Rectangle left.
+ * @param x1 Rectangle right.
+ * @param row First pixel line.
+ * @param col First pixel column.
+ * @param pixels Pixels, or NULL to fill.
+ * @param colour Fill colour.
+ * @param n Amount of pixels.
+ */
+static void _send(busqueue *q, int x0, int x1, int row, int col, const uint16_t *pixels, uint16_t colour,
+		uint32_t n) {
+	int w = x1 - x0 + 1;
+	uint32_t head, total;
+
+	if(!(q->winOpen && q->winX0 == x0 && q->winX1 == x1 && q->curRow == row && q->curCol == col)) {
+		/* Rest of a line first, when starting mid-line */
+		if(col != x0) {
+			head = (n < (uint32_t) (x1 - col + 1))? n : (uint32_t) (x1 - col + 1);
+			q->driver->set_window(col, row, x1, row);
+			if(pixels)
+				q->driver->write_rgb565(pixels, head);
+			else
+				q->driver->fill_rgb565(colour, head);
+			q->winOpen = 0;
+			n -= head;
+			if(!n)
+				return;
+			pixels = pixels? pixels + head : NULL;
+			row++;
+			col = x0;
+		}
+
+		/* Window down to the bottom of the screen, so that commands below can continue it */
+		q->driver->set_window(x0, row, x1, q->yres - 1);
+		q->winOpen = 1;
+		q->winX0 = x0;
+		q->winX1 = x1;
+	}
+
+	if(pixels)
+		q->driver->write_rgb565(pixels, n);
+	else
+		q->driver->fill_rgb565(colour, n);
+
+	total = (col - x0) + n;
+	q->curRow = row + total / w;
+	q->curCol = x0 + total % w;
+}
+
+/**
+ * @brief Send the fill being merged, if any.
+ */
+static void _flush_fill(busqueue *q) {
+	if(q->fillPending) {
+		_send(q, q->fillX0, q->fillX1, q->fillRow, q->fillCol, NULL, q->fillColour, q->fillCount);
+		q->fillPending = 0;
+	}
+}
+
+/**
+ * @brief Run a command.
+ */
+static void _execute(busqueue *q, const command *c, unsigned int pos) {
+	int w = c->x1 - c->x0 + 1;
+	int row = c->y0 + c->offset / w;
+	int col = c->x0 + c->offset % w;
+	uint32_t total;
+
+	if(CMD_FILL == c->type) {
+		/* Merge with a pending fill of the same colour that ends where this one starts */
+		if(q->fillPending && q->fillColour == c->colour && q->fillX0 == c->x0 && q->fillX1 == c->x1) {
+			total = (q->fillCol - q->fillX0) + q->fillCount;
+			if(row == q->fillRow + (int) (total / w) && col == q->fillX0 + (int) (total % w)) {
+				q->fillCount += c->count;
+				return;
+			}
+		}
+
+		_flush_fill(q);
+		q->fillPending = 1;
+		q->fillPos = pos;
+		q->fillX0 = c->x0;
+		q->fillX1 = c->x1;
+		q->fillRow = row;
+		q->fillCol = col;
+		q->fillCount = c->count;
+		q->fillColour = c->colour;
+		return;
+	}
+
+	_flush_fill(q);
+	_send(q, c->x0, c->x1, row, col, c->pixels, 0, c->count);
+}
+
+/**
+ * @brief Wait for a refresh boundary.
+ */
+static void _wait_vsync(busqueue *q, const command *c) {
+	unsigned long long boundary;
+	uint64_t cpu = _now(CLOCK_THREAD_CPUTIME_ID);
+
+	/* Without driver synchronisation frames are sent right away */
+	if(DISPLAY_OK == q->driver->wait_vsync(c->x0, c->y0, c->x1, c->y1, &boundary)) {
+		q->frameStart = boundary;
+		atomic_fetch_add_explicit(&(q->frames), 1, memory_order_relaxed);
+	}
+
+	/* Spinning at the end of the wait is neither work nor preemption */
+	q->cpuStart += _now(CLOCK_THREAD_CPUTIME_ID) - cpu;
+}
+
+/**
+ * @brief Bus thread: run commands in ring order, sleeping while the ring is empty.
+ */
+static void *_consumer(void *arg) {
+	busqueue *q = arg;
+	unsigned int pos = 0;
+
+	for(;;) {
+		slot *s = &(q->ring[pos & q->mask]);
+
+		if(atomic_load_explicit(&(s->seq), memory_order_acquire) == pos + 1) {
+			int flags = s->cmd.flags;
+			uint64_t submitted = s->cmd.submitted, start, end;
+
+			if(flags & FLAG_FIRST) {
+				q->cpuStart = _now(CLOCK_THREAD_CPUTIME_ID);
+				q->busy = 0;
+			}
+
+			/* Only time in driver calls counts as busy: waiting for the rest of the batch to be published is not */
+			start = _now(CLOCK_MONOTONIC);
+			if(CMD_VSYNC == s->cmd.type)
+				_flush_fill(q);
+			else
+				_execute(q, &(s->cmd), pos);
+			end = _now(CLOCK_MONOTONIC);
+			q->busy += end - start;
+
+			if(CMD_VSYNC == s->cmd.type) {
+				_wait_vsync(q, &(s->cmd));
+				end = _now(CLOCK_MONOTONIC);
+			}
+
+			/* Busy time the thread did not spend on a CPU is time it was preempted */
+			if(flags & FLAG_LAST) {
+				uint64_t cpu;
+
+				/* A frame is presented once all of it is sent, merged fill included */
+				if(q->frameStart) {
+					_flush_fill(q);
+					start = end;
+					end = _now(CLOCK_MONOTONIC);
+					q->busy += end - start;
+					_record(q->present, &(q->maxPresent), (end > q->frameStart)? end - q->frameStart : 0);
+					q->frameStart = 0;
+				}
+
+				cpu = _now(CLOCK_THREAD_CPUTIME_ID) - q->cpuStart;
+
+				atomic_fetch_add_explicit(&(q->batches), 1, memory_order_relaxed);
+				_record(q->latency, &(q->maxLatency), end - submitted);
+				_record(q->gaps, &(q->maxGap), (q->busy > cpu)? q->busy - cpu : 0);
+			}
+
+			atomic_store_explicit(&(s->seq), pos + q->mask + 1, memory_order_release);
+			pos++;
+
+			/* A merged fill is only done once it is sent */
+			atomic_store_explicit(&(q->done), q->fillPending? q->fillPos : pos, memory_order_release);
+			continue;
+		}
+
+		_flush_fill(q);
+		atomic_store_explicit(&(q->done), pos, memory_order_release);
+
+		if(atomic_load(&(q->stop)) && pos == atomic_load(&(q->tail)))
+			break;
+		sem_wait(&(q->items));
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Create a drawing queue and its bus thread.
+ */
+int busqueue_create(busqueue **q, display_driver *driver, unsigned int slots) {
+	int rv = BUSQUEUE_OK;
+	busqueue *newQ = NULL;
+	int xres, semInit = 0;
+	unsigned int i;
+
+	ASSERT(slots >= 2 && !(slots & (slots - 1)), rv = BUSQUEUE_INVALID_ARGS);
+
+	newQ = calloc(1, sizeof(busqueue));
+	ASSERT(newQ, rv = BUSQUEUE_NO_MEMORY);
+	newQ->driver = driver;
+	driver->get_resolution(&xres, &(newQ->yres));
+	newQ->mask = slots - 1;
+
+	newQ->ring = malloc(slots * sizeof(slot));
+	ASSERT(newQ->ring, rv = BUSQUEUE_NO_MEMORY);
+	for(i = 0; i < slots; i++)
+		atomic_init(&(newQ->ring[i].seq), i);
+	/* calloc() zeroed the statistics */
+	atomic_init(&(newQ->tail), 0);
+	atomic_init(&(newQ->done), 0);
+	atomic_init(&(newQ->stop), 0);
+
+	ASSERT(!sem_init(&(newQ->items), 0, 0), rv = BUSQUEUE_THREAD_ERROR);
+	semInit = 1;
+	ASSERT(!pthread_create(&(newQ->thread), NULL, _consumer, newQ), rv = BUSQUEUE_THREAD_ERROR);
+	newQ->threadCreated = 1;
+
+	*q = newQ;
+
+_err:
+	if(rv != BUSQUEUE_OK && newQ) {
+		if(semInit)
+			sem_destroy(&(newQ->items));
+		if(newQ->ring)
+			free(newQ->ring);
+		free(newQ);
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Create a batch.
+ */
+int busqueue_batch_create(busqueue *q, busqueue_batch **b, unsigned int slots) {
+	busqueue_batch *newB;
+
+	if(!slots || slots > (q->mask + 1) / 2)
+		return BUSQUEUE_INVALID_ARGS;
+
+	newB = calloc(1, sizeof(busqueue_batch));
+	if(!newB)
+		return BUSQUEUE_NO_MEMORY;
+	newB->cmds = malloc(slots * sizeof(command));
+	if(!(newB->cmds)) {
+		free(newB);
+		return BUSQUEUE_NO_MEMORY;
+	}
+	newB->q = q;
+	newB->capacity = slots;
+	newB->vsync = -1;
+	q->driver->get_resolution(&(newB->xres), &(newB->yres));
+	*b = newB;
+
+	return BUSQUEUE_OK;
+}
+
+/**
+ * @brief Close the open refresh boundary of a batch, if any, before submitting it. A frame submitted in parts is
+ *        synchronised for the whole screen, as the rest of it is not known yet.
+ * @param b Batch handle.
+ * @param partial Non-zero if more commands of the frame follow.
+ */
+static void _end_vsync(busqueue_batch *b, int partial) {
+	command *c;
+
+	if(b->vsync < 0)
+		return;
+
+	c = &(b->cmds[b->vsync]);
+	if(partial || c->x1 < c->x0) {
+		c->x0 = 0;
+		c->y0 = 0;
+		c->x1 = b->xres - 1;
+		c->y1 = b->yres - 1;
+	}
+	b->vsync = -1;
+}
+
+/**
+ * @brief Grow the open refresh boundary of a batch, if any, to cover a clipped rectangle.
+ */
+static void _widen_vsync(busqueue_batch *b, int x, int y, int w, int h) {
+	command *c;
+
+	if(b->vsync < 0)
+		return;
+
+	c = &(b->cmds[b->vsync]);
+	c->x0 = (x < c->x0)? x : c->x0;
+	c->y0 = (y < c->y0)? y : c->y0;
+	c->x1 = (x + w - 1 > c->x1)? x + w - 1 : c->x1;
+	c->y1 = (y + h - 1 > c->y1)? y + h - 1 : c->y1;
+}
+
+/**
+ * @brief Get the next staging command, submitting staged ones if full.
+ */
+static command *_stage(busqueue_batch *b) {
+	if(b->count == b->capacity) {
+		_end_vsync(b, 1);
+		busqueue_submit(b, 1);
+	}
+
+	b->cmds[b->count].flags = 0;
+
+	return &(b->cmds[(b->count)++]);
+}
+
+/**
+ * @brief Clip a rectangle to the screen.
+ * @return Non-zero if anything is left.
+ */
+static int _clip(busqueue_batch *b, int *x, int *y, int *w, int *h, int *skipX, int *skipY) {
+	*skipX = (*x < 0)? -*x : 0;
+	*skipY = (*y < 0)? -*y : 0;
+	*x += *skipX;
+	*y += *skipY;
+	*w -= *skipX;
+	*h -= *skipY;
+	*w = (*x + *w > b->xres)? b->xres - *x : *w;
+	*h = (*y + *h > b->yres)? b->yres - *y : *h;
+
+	return *w > 0 && *h > 0;
+}
+
+/**
+ * @brief Stage a rectangle fill.
+ */
+void busqueue_fill(busqueue_batch *b, int x, int y, int w, int h, unsigned short colour) {
+	command *c;
+	int skipX, skipY;
+
+	if(!_clip(b, &x, &y, &w, &h, &skipX, &skipY))
+		return;
+	_widen_vsync(b, x, y, w, h);
+
+	c = _stage(b);
+	c->type = CMD_FILL;
+	c->x0 = x;
+	c->y0 = y;
+	c->x1 = x + w - 1;
+	c->y1 = y + h - 1;
+	c->offset = 0;
+	c->count = w * h;
+	c->colour = colour;
+}
+
+/**
+ * @brief Stage an image blit.
+ */
+void busqueue_blit(busqueue_batch *b, int x, int y, int w, int h, const unsigned short *pixels, int stride) {
+	uint32_t offset = 0, total, n, i;
+	int skipX, skipY;
+
+	if(!_clip(b, &x, &y, &w, &h, &skipX, &skipY))
+		return;
+	_widen_vsync(b, x, y, w, h);
+	pixels += skipY * stride + skipX;
+
+	/* Split in slots, row-major through the clipped rectangle */
+	for(total = w * h; offset < total; offset += n) {
+		command *c = _stage(b);
+
+		n = (total - offset < SLOT_PIXELS)? total - offset : SLOT_PIXELS;
+		c->type = CMD_BLIT;
+		c->x0 = x;
+		c->y0 = y;
+		c->x1 = x + w - 1;
+		c->y1 = y + h - 1;
+		c->offset = offset;
+		c->count = n;
+		for(i = 0; i < n; i++)
+			c->pixels[i] = pixels[((offset + i) / w) * stride + (offset + i) % w];
+	}
+}
+
+/**
+ * @brief Stage a refresh boundary.
+ */
+void busqueue_vsync(busqueue_batch *b) {
+	command *c = _stage(b);
+
+	/* Empty until commands staged after it widen it */
+	c->type = CMD_VSYNC;
+	c->x0 = b->xres;
+	c->y0 = b->yres;
+	c->x1 = -1;
+	c->y1 = -1;
+	c->offset = 0;
+	c->count = 0;
+	b->vsync = b->count - 1;
+}
+
+/**
+ * @brief Submit staged commands.
+ */
+int busqueue_submit(busqueue_batch *b, int wait) {
+	busqueue *q = b->q;
+	unsigned int k = b->count, pos, i;
+
+	if(!k)
+		return BUSQUEUE_OK;
+
+	b->cmds[k - 1].submitted = _now(CLOCK_MONOTONIC);
+
+	/* Reserve k slots at once. They are consumed in order, so the last one being free means all are */
+	pos = atomic_load_explicit(&(q->tail), memory_order_relaxed);
+	for(;;) {
+		slot *last = &(q->ring[(pos + k - 1) & q->mask]);
+		int diff = (int) (atomic_load_explicit(&(last->seq), memory_order_acquire) - (pos + k - 1));
+
+		if(!diff) {
+			if(atomic_compare_exchange_weak(&(q->tail), &pos, pos + k))
+				break;
+		}
+		else if(diff < 0) {
+			if(!wait)
+				return BUSQUEUE_FULL;
+			sched_yield();
+			pos = atomic_load_explicit(&(q->tail), memory_order_relaxed);
+		}
+		else {
+			pos = atomic_load_explicit(&(q->tail), memory_order_relaxed);
+		}
+	}
+
+	/* Only now that it is certain to be sent, so that a frame still being staged keeps widening it otherwise */
+	_end_vsync(b, 0);
+
+	for(i = 0; i < k; i++) {
+		slot *s = &(q->ring[(pos + i) & q->mask]);
+		command *c = &(b->cmds[i]);
+		size_t size = offsetof(command, pixels) + ((CMD_BLIT == c->type)? c->count * sizeof(uint16_t) : 0);
+
+		memcpy(&(s->cmd), c, size);
+		/* Batch boundaries go on the copies, the staged commands stay reusable if the queue was full */
+		s->cmd.flags |= (i? 0 : FLAG_FIRST) | ((i == k - 1)? FLAG_LAST : 0);
+		atomic_store_explicit(&(s->seq), pos + i + 1, memory_order_release);
+	}
+	b->count = 0;
+	sem_post(&(q->items));
+
+	return BUSQUEUE_OK;
+}
+
+/**
+ * @brief Free batch.
+ */
+void busqueue_batch_destroy(busqueue_batch *b) {
+	free(b->cmds);
+	free(b);
+}
+
+/**
+ * @brief Wait until every command submitted so far has been sent.
+ */
+void busqueue_sync(busqueue *q) {
+	unsigned int target = atomic_load(&(q->tail));
+
+	/* The consumer sends merged fills before going idle, so everything is eventually done */
+	while((int) (atomic_load_explicit(&(q->done), memory_order_acquire) - target) < 0)
+		sched_yield();
+}
+
+/**
+ * @brief Pick the first core isolated from the scheduler (isolcpus=), or the last core if none is.
+ */
+static int _isolated_cpu(void) {
+	FILE *file = fopen("/sys/devices/system/cpu/isolated", "r");
+	int cpu = -1;
+
+	if(file) {
+		if(1 != fscanf(file, "%d", &cpu))
+			cpu = -1;
+		fclose(file);
+	}
+
+	return (cpu >= 0)? cpu : sysconf(_SC_NPROCESSORS_ONLN) - 1;
+}
+
+/**
+ * @brief Put the bus thread in real-time mode.
+ */
+int busqueue_set_realtime(busqueue *q, int cpu, int priority) {
+	int rv = BUSQUEUE_OK;
+	struct sched_param param;
+	cpu_set_t set;
+
+	ASSERT(cpu >= BUSQUEUE_CPU_ANY && cpu < CPU_SETSIZE, rv = BUSQUEUE_INVALID_ARGS);
+	ASSERT(0 <= priority && priority <= sched_get_priority_max(SCHED_FIFO), rv = BUSQUEUE_INVALID_ARGS);
+
+	if(cpu != BUSQUEUE_CPU_ANY) {
+		CPU_ZERO(&set);
+		CPU_SET((BUSQUEUE_CPU_ISOLATED == cpu)? _isolated_cpu() : cpu, &set);
+		ASSERT(!pthread_setaffinity_np(q->thread, sizeof(cpu_set_t), &set), rv = BUSQUEUE_RT_ERROR);
+	}
+
+	if(priority) {
+		param.sched_priority = priority;
+		ASSERT(!pthread_setschedparam(q->thread, SCHED_FIFO, &param), rv = BUSQUEUE_RT_ERROR);
+	}
+
+	/* Never give heap memory back nor take it from fresh mappings, so that locked pages stay locked and faulted in */
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+
+	/* Locking faults in every page mapped so far (ring, framebuffers, stacks, code, GPIO registers) and later ones */
+	ASSERT(!mlockall(MCL_CURRENT | MCL_FUTURE), rv = BUSQUEUE_RT_ERROR);
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Get flush statistics.
+ */
+void busqueue_get_stats(busqueue *q, busqueue_stats *stats, int reset) {
+	int i;
+
+	stats->batches = atomic_load_explicit(&(q->batches), memory_order_relaxed);
+	stats->maxLatency = atomic_load_explicit(&(q->maxLatency), memory_order_relaxed);
+	stats->maxGap = atomic_load_explicit(&(q->maxGap), memory_order_relaxed);
+	stats->frames = atomic_load_explicit(&(q->frames), memory_order_relaxed);
+	stats->maxPresent = atomic_load_explicit(&(q->maxPresent), memory_order_relaxed);
+	for(i = 0; i < BUSQUEUE_HIST_BINS; i++) {
+		stats->latency[i] = atomic_load_explicit(&(q->latency[i]), memory_order_relaxed);
+		stats->gaps[i] = atomic_load_explicit(&(q->gaps[i]), memory_order_relaxed);
+		stats->present[i] = atomic_load_explicit(&(q->present[i]), memory_order_relaxed);
+	}
+
+	/* Counts added by the consumer after being read here are subtracted rather than lost */
+	if(reset) {
+		atomic_fetch_sub_explicit(&(q->batches), stats->batches, memory_order_relaxed);
+		atomic_store_explicit(&(q->maxLatency), 0, memory_order_relaxed);
+		atomic_store_explicit(&(q->maxGap), 0, memory_order_relaxed);
+		atomic_fetch_sub_explicit(&(q->frames), stats->frames, memory_order_relaxed);
+		atomic_store_explicit(&(q->maxPresent), 0, memory_order_relaxed);
+		for(i = 0; i < BUSQUEUE_HIST_BINS; i++) {
+			atomic_fetch_sub_explicit(&(q->latency[i]), stats->latency[i], memory_order_relaxed);
+			atomic_fetch_sub_explicit(&(q->gaps[i]), stats->gaps[i], memory_order_relaxed);
+			atomic_fetch_sub_explicit(&(q->present[i]), stats->present[i], memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * @brief Send remaining commands, stop the bus thread and free the queue.
+ */
+void busqueue_destroy(busqueue *q) {
+	if(q->threadCreated) {
+		atomic_store(&(q->stop), 1);
+		sem_post(&(q->items));
+		pthread_join(q->thread, NULL);
+	}
+	sem_destroy(&(q->items));
+	free(q->ring);
+	free(q);
+}
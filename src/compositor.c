@@ -0,0 +1,349 @@
+/* ********************************************************************************************* */
+/* * Compositor Library for layered screens                                                    * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "compositor.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/* Pixels blended at a time */
+#define LANES 8
+
+/**
+ * @brief 8 x 16-bit vector. GCC lowers operations on this type to NEON on ARM and SSE2 on x86.
+ */
+typedef uint16_t v8u16 __attribute__((vector_size(16)));
+
+/**
+ * @brief Layer state.
+ */
+typedef struct {
+	int format;
+	const void *pixels;
+	int width;
+	int height;
+	int stride;
+	int x;
+	int y;
+	unsigned int opacity;
+	int visible;
+} layer;
+
+struct compositor_s {
+	display_driver *driver;
+	int xres;
+	int yres;
+	int tilesX;
+	int tilesY;
+	uint8_t *damaged;
+	layer *layers;
+	int nLayers;
+	uint16_t *line;
+};
+
+/**
+ * @brief Multiply 8-bit values, dividing by 255 with rounding.
+ */
+static inline v8u16 _mul(v8u16 a, v8u16 b) {
+	v8u16 t = a * b + 128;
+
+	return (t + (t >> 8)) >> 8;
+}
+
+/**
+ * @brief Mark the tiles under a screen rectangle as damaged.
+ */
+static void _damage(compositor *c, int x, int y, int w, int h) {
+	int tx0, ty0, tx1, ty1, tx, ty;
+
+	x = (x > 0)? x : 0;
+	y = (y > 0)? y : 0;
+	w = (x + w > c->xres)? c->xres - x : w;
+	h = (y + h > c->yres)? c->yres - y : h;
+	if(w <= 0 || h <= 0)
+		return;
+
+	tx0 = x / COMPOSITOR_TILE;
+	ty0 = y / COMPOSITOR_TILE;
+	tx1 = (x + w - 1) / COMPOSITOR_TILE;
+	ty1 = (y + h - 1) / COMPOSITOR_TILE;
+	for(ty = ty0; ty <= ty1; ty++) {
+		for(tx = tx0; tx <= tx1; tx++)
+			c->damaged[ty * c->tilesX + tx] = 1;
+	}
+}
+
+/**
+ * @brief Compose up to LANES pixels of a screen line.
+ * @param c Compositor handle.
+ * @param x First pixel.
+ * @param y Line.
+ * @param n Amount of pixels.
+ * @param out Output RGB565 pixels.
+ */
+static void _compose(compositor *c, int x, int y, int n, uint16_t *out) {
+	v8u16 r = {0}, g = {0}, b = {0}, res;
+	int first, i, j;
+
+	/* Layers under one covering these pixels opaquely are hidden */
+	for(first = c->nLayers - 1; first > 0; first--) {
+		layer *l = &(c->layers[first]);
+
+		if(l->visible && 255 == l->opacity && COMPOSITOR_RGB565 == l->format && y >= l->y && y < l->y + l->height &&
+				x >= l->x && x + n <= l->x + l->width)
+			break;
+	}
+	first = (first < 0)? 0 : first;
+
+	for(i = first; i < c->nLayers; i++) {
+		layer *l = &(c->layers[i]);
+		v8u16 sr = {0}, sg = {0}, sb = {0}, sa = {0};
+		int x0, x1;
+
+		if(!(l->visible) || !(l->opacity) || y < l->y || y >= l->y + l->height)
+			continue;
+		x0 = (x > l->x)? x : l->x;
+		x1 = (x + n < l->x + l->width)? x + n : l->x + l->width;
+		if(x0 >= x1)
+			continue;
+
+		/* Gather into planes; lanes outside the layer stay fully transparent */
+		if(COMPOSITOR_RGB565 == l->format) {
+			const uint16_t *src = (const uint16_t *) l->pixels + (y - l->y) * l->stride - l->x;
+
+			for(j = x0; j < x1; j++) {
+				uint16_t p = src[j];
+
+				sr[j - x] = ((p >> 8) & 0xF8) | (p >> 13);
+				sg[j - x] = ((p >> 3) & 0xFC) | ((p >> 9) & 0x3);
+				sb[j - x] = ((p << 3) & 0xF8) | ((p >> 2) & 0x7);
+				sa[j - x] = 255;
+			}
+		}
+		else {
+			const uint32_t *src = (const uint32_t *) l->pixels + (y - l->y) * l->stride - l->x;
+
+			for(j = x0; j < x1; j++) {
+				uint32_t p = src[j];
+
+				sa[j - x] = p >> 24;
+				sr[j - x] = (p >> 16) & 0xFF;
+				sg[j - x] = (p >> 8) & 0xFF;
+				sb[j - x] = p & 0xFF;
+			}
+		}
+
+		if(l->opacity != 255) {
+			v8u16 op = {0};
+
+			op += (uint16_t) l->opacity;
+			sa = _mul(sa, op);
+			sr = _mul(sr, op);
+			sg = _mul(sg, op);
+			sb = _mul(sb, op);
+		}
+
+		/* Premultiplied over: dst = src + dst * (1 - srcAlpha) */
+		sa = 255 - sa;
+		r = sr + _mul(r, sa);
+		g = sg + _mul(g, sa);
+		b = sb + _mul(b, sa);
+	}
+
+	res = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+	memcpy(out, &res, n * sizeof(uint16_t));
+}
+
+/**
+ * @brief Create a compositor.
+ */
+int compositor_create(compositor **c, display_driver *driver) {
+	int rv = COMPOSITOR_OK;
+	compositor *newC = NULL;
+
+	newC = calloc(1, sizeof(compositor));
+	ASSERT(newC, rv = COMPOSITOR_NO_MEMORY);
+	newC->driver = driver;
+	driver->get_resolution(&(newC->xres), &(newC->yres));
+	newC->tilesX = (newC->xres + COMPOSITOR_TILE - 1) / COMPOSITOR_TILE;
+	newC->tilesY = (newC->yres + COMPOSITOR_TILE - 1) / COMPOSITOR_TILE;
+
+	newC->damaged = calloc(newC->tilesX * newC->tilesY, sizeof(uint8_t));
+	ASSERT(newC->damaged, rv = COMPOSITOR_NO_MEMORY);
+
+	newC->line = malloc(newC->xres * sizeof(uint16_t));
+	ASSERT(newC->line, rv = COMPOSITOR_NO_MEMORY);
+
+	*c = newC;
+
+_err:
+	if(rv != COMPOSITOR_OK && newC)
+		compositor_destroy(newC);
+
+	return rv;
+}
+
+/**
+ * @brief Add a layer on top of the existing ones.
+ */
+int compositor_add_layer(compositor *c, int format, const void *pixels, int width, int height, int stride, int *id) {
+	layer *newLayers;
+	layer *l;
+
+	if((format != COMPOSITOR_RGB565 && format != COMPOSITOR_ARGB8888) || !pixels || width <= 0 || height <= 0 ||
+			stride < width)
+		return COMPOSITOR_INVALID_ARGS;
+
+	newLayers = realloc(c->layers, (c->nLayers + 1) * sizeof(layer));
+	if(!newLayers)
+		return COMPOSITOR_NO_MEMORY;
+	c->layers = newLayers;
+
+	l = &(c->layers[c->nLayers]);
+	l->format = format;
+	l->pixels = pixels;
+	l->width = width;
+	l->height = height;
+	l->stride = stride;
+	l->x = 0;
+	l->y = 0;
+	l->opacity = 255;
+	l->visible = 1;
+	_damage(c, 0, 0, width, height);
+	*id = (c->nLayers)++;
+
+	return COMPOSITOR_OK;
+}
+
+/**
+ * @brief Move a layer.
+ */
+void compositor_set_position(compositor *c, int id, int x, int y) {
+	layer *l = &(c->layers[id]);
+
+	if(l->visible) {
+		_damage(c, l->x, l->y, l->width, l->height);
+		_damage(c, x, y, l->width, l->height);
+	}
+	l->x = x;
+	l->y = y;
+}
+
+/**
+ * @brief Set the opacity a layer is blended with.
+ */
+void compositor_set_opacity(compositor *c, int id, unsigned int opacity) {
+	layer *l = &(c->layers[id]);
+
+	opacity = (opacity > 255)? 255 : opacity;
+	if(l->visible && opacity != l->opacity)
+		_damage(c, l->x, l->y, l->width, l->height);
+	l->opacity = opacity;
+}
+
+/**
+ * @brief Show or hide a layer.
+ */
+void compositor_show(compositor *c, int id, int visible) {
+	layer *l = &(c->layers[id]);
+
+	if(!(l->visible) != !visible)
+		_damage(c, l->x, l->y, l->width, l->height);
+	l->visible = visible;
+}
+
+/**
+ * @brief Report a change in a layer buffer.
+ */
+void compositor_damage(compositor *c, int id, int x, int y, int w, int h) {
+	layer *l = &(c->layers[id]);
+
+	/* Clip to the layer, then move to screen coordinates */
+	if(x < 0) {
+		w += x;
+		x = 0;
+	}
+	if(y < 0) {
+		h += y;
+		y = 0;
+	}
+	w = (x + w > l->width)? l->width - x : w;
+	h = (y + h > l->height)? l->height - y : h;
+
+	if(l->visible)
+		_damage(c, l->x + x, l->y + y, w, h);
+}
+
+/**
+ * @brief Compose damaged tiles and send them to the display.
+ */
+void compositor_flush(compositor *c, unsigned int *tiles) {
+	unsigned int sent = 0;
+	int tx, ty, t0, x0, x1, y0, y1, x, y;
+
+	for(ty = 0; ty < c->tilesY; ty++) {
+		uint8_t *row = &(c->damaged[ty * c->tilesX]);
+
+		for(tx = 0; tx < c->tilesX; ) {
+			if(!row[tx]) {
+				tx++;
+				continue;
+			}
+
+			/* Run of damaged tiles */
+			for(t0 = tx; tx < c->tilesX && row[tx]; tx++)
+				row[tx] = 0;
+			sent += tx - t0;
+
+			x0 = t0 * COMPOSITOR_TILE;
+			x1 = tx * COMPOSITOR_TILE;
+			x1 = (x1 > c->xres)? c->xres : x1;
+			y0 = ty * COMPOSITOR_TILE;
+			y1 = y0 + COMPOSITOR_TILE;
+			y1 = (y1 > c->yres)? c->yres : y1;
+
+			c->driver->set_window(x0, y0, x1 - 1, y1 - 1);
+			for(y = y0; y < y1; y++) {
+				for(x = x0; x < x1; x += LANES)
+					_compose(c, x, y, (x + LANES > x1)? x1 - x : LANES, &(c->line[x - x0]));
+				c->driver->write_rgb565(c->line, x1 - x0);
+			}
+		}
+	}
+
+	if(tiles)
+		*tiles = sent;
+}
+
+/**
+ * @brief Free compositor.
+ */
+void compositor_destroy(compositor *c) {
+	if(c->damaged)
+		free(c->damaged);
+	if(c->layers)
+		free(c->layers);
+	if(c->line)
+		free(c->line);
+	free(c);
+}
@@ -0,0 +1,621 @@
+/* ********************************************************************************************* */
+/* * Console Library for text terminal on the display                                          * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "console.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "rgb565.h"
+
+/* Glyph cache slots (direct-mapped by code point) */
+#define GLYPH_SLOTS 256
+
+/* Maximum escape sequence parameters */
+#define MAX_PARAMS 8
+
+/* Parser states */
+#define STATE_TEXT 0
+#define STATE_ESC 1
+#define STATE_CSI 2
+
+/**
+ * @brief Character cell.
+ */
+typedef struct {
+	uint32_t code;
+	uint8_t fg;
+	uint8_t bg;
+	uint8_t attr;
+	uint8_t pad;
+} cell;
+
+/**
+ * @brief Glyph cache slot, holding the coverage of a whole cell.
+ */
+typedef struct {
+	int valid;
+	uint32_t code;
+	unsigned char *coverage;
+} glyph_slot;
+
+struct console_s {
+	display_driver *driver;
+	textrender *tr;
+	int font;
+	unsigned int size;
+	int xres;
+	int yres;
+	unsigned int cellW;
+	unsigned int cellH;
+	int ascent;
+	unsigned int cols;
+	unsigned int rows;
+	cell *back;
+	unsigned int top;
+	cell *front;
+	unsigned char *rowDirty;
+	unsigned int curCol;
+	unsigned int curRow;
+	int wrapPending;
+	uint8_t fg;
+	uint8_t bg;
+	uint8_t attr;
+	int state;
+	unsigned int params[MAX_PARAMS];
+	unsigned int nParams;
+	unsigned long code;
+	int pending;
+	glyph_slot slots[GLYPH_SLOTS];
+	unsigned char *glyphData;
+	uint16_t *luts[256];
+	uint16_t *pixRow;
+};
+
+/**
+ * @brief ANSI palette in RGB565: normal colours, then bright ones.
+ */
+static const uint16_t palette[16] = {
+	DISPLAY_RGB565(0, 0, 0), DISPLAY_RGB565(170, 0, 0), DISPLAY_RGB565(0, 170, 0), DISPLAY_RGB565(170, 85, 0),
+	DISPLAY_RGB565(0, 0, 170), DISPLAY_RGB565(170, 0, 170), DISPLAY_RGB565(0, 170, 170),
+	DISPLAY_RGB565(170, 170, 170), DISPLAY_RGB565(85, 85, 85), DISPLAY_RGB565(255, 85, 85),
+	DISPLAY_RGB565(85, 255, 85), DISPLAY_RGB565(255, 255, 85), DISPLAY_RGB565(85, 85, 255),
+	DISPLAY_RGB565(255, 85, 255), DISPLAY_RGB565(85, 255, 255), DISPLAY_RGB565(255, 255, 255)
+};
+
+/**
+ * @brief Cell of the grid at a screen position. The grid is a ring of lines, so scrolling moves no cells.
+ */
+static cell *_cell(console *con, unsigned int row, unsigned int col) {
+	return &(con->back[((con->top + row) % con->rows) * con->cols + col]);
+}
+
+/**
+ * @brief Blank a range of cells of a line with the current background.
+ */
+static void _erase(console *con, unsigned int row, unsigned int from, unsigned int to) {
+	unsigned int i;
+
+	for(i = from; i < to; i++) {
+		cell *c = _cell(con, row, i);
+
+		c->code = ' ';
+		c->fg = con->fg;
+		c->bg = con->bg;
+		c->attr = 0;
+	}
+	con->rowDirty[row] = 1;
+}
+
+/**
+ * @brief Move cursor to the start of the next line, scrolling if needed.
+ */
+static void _newline(console *con) {
+	con->curCol = 0;
+	con->wrapPending = 0;
+
+	if(con->curRow + 1 < con->rows) {
+		con->curRow++;
+		return;
+	}
+
+	/* Scroll: the top line becomes the new bottom line */
+	con->top = (con->top + 1) % con->rows;
+	_erase(con, con->rows - 1, 0, con->cols);
+	memset(con->rowDirty, 1, con->rows);
+}
+
+/**
+ * @brief Put a printable character at the cursor.
+ */
+static void _put(console *con, unsigned long code) {
+	cell *c;
+
+	if(con->wrapPending)
+		_newline(con);
+
+	c = _cell(con, con->curRow, con->curCol);
+	c->code = code;
+	c->fg = con->fg;
+	c->bg = con->bg;
+	c->attr = con->attr;
+	con->rowDirty[con->curRow] = 1;
+
+	if(con->curCol + 1 < con->cols)
+		con->curCol++;
+	else
+		con->wrapPending = 1;
+}
+
+/**
+ * @brief Execute a select graphic rendition parameter.
+ */
+static void _sgr(console *con, unsigned int p) {
+	if(0 == p) {
+		con->fg = CONSOLE_WHITE;
+		con->bg = CONSOLE_BLACK;
+		con->attr = 0;
+	}
+	else if(1 == p) {
+		con->attr |= CONSOLE_ATTR_BOLD;
+	}
+	else if(4 == p) {
+		con->attr |= CONSOLE_ATTR_UNDERLINE;
+	}
+	else if(7 == p) {
+		con->attr |= CONSOLE_ATTR_REVERSE;
+	}
+	else if(22 == p) {
+		con->attr &= ~CONSOLE_ATTR_BOLD;
+	}
+	else if(24 == p) {
+		con->attr &= ~CONSOLE_ATTR_UNDERLINE;
+	}
+	else if(27 == p) {
+		con->attr &= ~CONSOLE_ATTR_REVERSE;
+	}
+	else if(p >= 30 && p <= 37) {
+		con->fg = p - 30;
+	}
+	else if(39 == p) {
+		con->fg = CONSOLE_WHITE;
+	}
+	else if(p >= 40 && p <= 47) {
+		con->bg = p - 40;
+	}
+	else if(49 == p) {
+		con->bg = CONSOLE_BLACK;
+	}
+	else if(p >= 90 && p <= 97) {
+		con->fg = p - 90 + CONSOLE_BRIGHT;
+	}
+	else if(p >= 100 && p <= 107) {
+		con->bg = p - 100 + CONSOLE_BRIGHT;
+	}
+}
+
+/**
+ * @brief Execute a control sequence.
+ */
+static void _csi(console *con, char final) {
+	unsigned int i;
+	unsigned int p0 = con->params[0];
+	unsigned int p1 = (con->nParams > 1)? con->params[1] : 0;
+
+	switch(final) {
+		case 'm':
+			for(i = 0; i < con->nParams; i++)
+				_sgr(con, con->params[i]);
+			break;
+		case 'H':
+		case 'f':
+			con->curRow = (p0 > con->rows)? con->rows - 1 : (p0? p0 - 1 : 0);
+			con->curCol = (p1 > con->cols)? con->cols - 1 : (p1? p1 - 1 : 0);
+			con->wrapPending = 0;
+			break;
+		case 'J':
+			if(2 == p0) {
+				for(i = 0; i < con->rows; i++)
+					_erase(con, i, 0, con->cols);
+			}
+			else if(0 == p0) {
+				_erase(con, con->curRow, con->curCol, con->cols);
+				for(i = con->curRow + 1; i < con->rows; i++)
+					_erase(con, i, 0, con->cols);
+			}
+			break;
+		case 'K':
+			if(0 == p0)
+				_erase(con, con->curRow, con->curCol, con->cols);
+			break;
+	}
+}
+
+/**
+ * @brief Process a decoded code point.
+ */
+static void _process(console *con, unsigned long code) {
+	if(STATE_ESC == con->state) {
+		if('[' == code) {
+			con->state = STATE_CSI;
+			con->nParams = 1;
+			con->params[0] = 0;
+		}
+		else {
+			con->state = STATE_TEXT;
+		}
+		return;
+	}
+
+	if(STATE_CSI == con->state) {
+		if(code >= '0' && code <= '9') {
+			con->params[con->nParams - 1] = con->params[con->nParams - 1] * 10 + (code - '0');
+		}
+		else if(';' == code) {
+			if(con->nParams < MAX_PARAMS)
+				con->params[(con->nParams)++] = 0;
+		}
+		else if(code >= 0x40 && code <= 0x7E) {
+			_csi(con, code);
+			con->state = STATE_TEXT;
+		}
+		return;
+	}
+
+	switch(code) {
+		case 0x1B:
+			con->state = STATE_ESC;
+			break;
+		case '\n':
+			_newline(con);
+			break;
+		case '\r':
+			con->curCol = 0;
+			con->wrapPending = 0;
+			break;
+		case '\t':
+			do {
+				_put(con, ' ');
+			} while(con->curCol % 8 && !(con->wrapPending));
+			break;
+		case '\b':
+			if(con->curCol)
+				con->curCol--;
+			con->wrapPending = 0;
+			break;
+		default:
+			if(code >= 0x20 && code != 0x7F)
+				_put(con, code);
+	}
+}
+
+/**
+ * @brief Get cell coverage of a glyph, rendering it from the atlas if not cached.
+ * @return Coverage (cellW * cellH bytes) or NULL on glyph lookup error.
+ */
+static const unsigned char *_glyph(console *con, uint32_t code) {
+	glyph_slot *slot = &(con->slots[code % GLYPH_SLOTS]);
+	textrender_glyph glyph;
+	unsigned int i, j;
+
+	if(slot->valid && slot->code == code)
+		return slot->coverage;
+
+	memset(slot->coverage, 0, con->cellW * con->cellH);
+	slot->valid = 0;
+	if(code != ' ') {
+		if(textrender_get_glyph(con->tr, con->font, con->size, code, &glyph) != TEXTRENDER_OK)
+			return NULL;
+
+		/* Anything beyond the cell is clipped */
+		for(j = 0; j < glyph.height; j++) {
+			int y = con->ascent - glyph.top + (int) j;
+
+			if(y < 0 || y >= (int) con->cellH)
+				continue;
+			for(i = 0; i < glyph.width; i++) {
+				int x = glyph.left + (int) i;
+
+				if(x >= 0 && x < (int) con->cellW)
+					slot->coverage[y * con->cellW + x] = glyph.coverage[j * glyph.stride + i];
+			}
+		}
+	}
+
+	slot->valid = 1;
+	slot->code = code;
+
+	return slot->coverage;
+}
+
+/**
+ * @brief Get blend table for a cell colour pair, building it on first use.
+ * @return Table or NULL if out of memory.
+ */
+static const uint16_t *_lut(console *con, const cell *c) {
+	unsigned int fg = c->fg | ((c->attr & CONSOLE_ATTR_BOLD)? CONSOLE_BRIGHT : 0);
+	unsigned int bg = c->bg;
+	unsigned int pair;
+
+	if(c->attr & CONSOLE_ATTR_REVERSE) {
+		pair = fg;
+		fg = bg;
+		bg = pair;
+	}
+	pair = (fg << 4) | bg;
+
+	if(!(con->luts[pair])) {
+		con->luts[pair] = malloc(256 * sizeof(uint16_t));
+		if(!(con->luts[pair]))
+			return NULL;
+
+		rgb565_blend_lut(palette[fg], palette[bg], con->luts[pair]);
+	}
+
+	return con->luts[pair];
+}
+
+/**
+ * @brief Draw consecutive cells of a line with one window blit.
+ * @param con Console handle.
+ * @param row Screen line.
+ * @param from First column.
+ * @param to Last column (exclusive).
+ * @return CONSOLE_OK, CONSOLE_NO_MEMORY or CONSOLE_FONT_ERROR.
+ */
+static int _draw_run(console *con, unsigned int row, unsigned int from, unsigned int to) {
+	unsigned int py, col, i;
+	int underline = con->ascent + 1;
+
+	con->driver->set_window(from * con->cellW, row * con->cellH, to * con->cellW - 1, (row + 1) * con->cellH - 1);
+
+	for(py = 0; py < con->cellH; py++) {
+		uint16_t *out = con->pixRow;
+
+		for(col = from; col < to; col++) {
+			const cell *c = _cell(con, row, col);
+			const uint16_t *lut = _lut(con, c);
+			const unsigned char *cov = _glyph(con, c->code);
+
+			if(!lut)
+				return CONSOLE_NO_MEMORY;
+			if(!cov)
+				return CONSOLE_FONT_ERROR;
+
+			cov += py * con->cellW;
+			if((c->attr & CONSOLE_ATTR_UNDERLINE) && (int) py == underline) {
+				for(i = 0; i < con->cellW; i++)
+					*(out++) = lut[255];
+			}
+			else {
+				for(i = 0; i < con->cellW; i++)
+					*(out++) = lut[cov[i]];
+			}
+		}
+
+		con->driver->write_rgb565(con->pixRow, (to - from) * con->cellW);
+	}
+
+	return CONSOLE_OK;
+}
+
+/**
+ * @brief Create a text console covering the screen.
+ */
+int console_create(console **con, display_driver *driver, textrender *tr, int font, unsigned int size) {
+	int rv = CONSOLE_OK;
+	console *newCon = NULL;
+	textrender_glyph glyph;
+	int descent;
+	unsigned int i, advance;
+	unsigned long code;
+
+	newCon = calloc(1, sizeof(console));
+	ASSERT(newCon, rv = CONSOLE_NO_MEMORY);
+	newCon->driver = driver;
+	newCon->tr = tr;
+	newCon->font = font;
+	newCon->size = size;
+	driver->get_resolution(&(newCon->xres), &(newCon->yres));
+
+	/* Cell size: widest printable ASCII glyph by line height */
+	ASSERT(TEXTRENDER_OK == textrender_get_metrics(tr, font, size, &(newCon->ascent), &descent),
+			rv = CONSOLE_FONT_ERROR);
+	for(code = 0x20; code < 0x7F; code++) {
+		ASSERT(TEXTRENDER_OK == textrender_get_glyph(tr, font, size, code, &glyph), rv = CONSOLE_FONT_ERROR);
+		advance = (glyph.advance + 63) >> 6;
+		if(advance > newCon->cellW)
+			newCon->cellW = advance;
+	}
+	newCon->cellH = newCon->ascent + descent;
+	ASSERT(newCon->cellW && newCon->cellH, rv = CONSOLE_FONT_ERROR);
+
+	newCon->cols = newCon->xres / newCon->cellW;
+	newCon->rows = newCon->yres / newCon->cellH;
+	ASSERT(newCon->cols && newCon->rows, rv = CONSOLE_INVALID_ARGS);
+
+	newCon->back = calloc(newCon->cols * newCon->rows, sizeof(cell));
+	ASSERT(newCon->back, rv = CONSOLE_NO_MEMORY);
+	newCon->front = calloc(newCon->cols * newCon->rows, sizeof(cell));
+	ASSERT(newCon->front, rv = CONSOLE_NO_MEMORY);
+	newCon->rowDirty = malloc(newCon->rows);
+	ASSERT(newCon->rowDirty, rv = CONSOLE_NO_MEMORY);
+	newCon->glyphData = malloc(GLYPH_SLOTS * newCon->cellW * newCon->cellH);
+	ASSERT(newCon->glyphData, rv = CONSOLE_NO_MEMORY);
+	newCon->pixRow = malloc(newCon->cols * newCon->cellW * sizeof(uint16_t));
+	ASSERT(newCon->pixRow, rv = CONSOLE_NO_MEMORY);
+
+	for(i = 0; i < GLYPH_SLOTS; i++)
+		newCon->slots[i].coverage = &(newCon->glyphData[i * newCon->cellW * newCon->cellH]);
+
+	/* Screen starts black, which is what a blank grid looks like */
+	newCon->fg = CONSOLE_WHITE;
+	newCon->bg = CONSOLE_BLACK;
+	console_clear(newCon);
+	memcpy(newCon->front, newCon->back, newCon->cols * newCon->rows * sizeof(cell));
+	memset(newCon->rowDirty, 0, newCon->rows);
+	driver->set_window(0, 0, newCon->xres - 1, newCon->yres - 1);
+	driver->fill_rgb565(palette[CONSOLE_BLACK], newCon->xres * newCon->yres);
+
+	*con = newCon;
+
+_err:
+	if(rv != CONSOLE_OK && newCon)
+		console_destroy(newCon);
+
+	return rv;
+}
+
+/**
+ * @brief Get grid size.
+ */
+void console_get_size(console *con, unsigned int *cols, unsigned int *rows) {
+	*cols = con->cols;
+	*rows = con->rows;
+}
+
+/**
+ * @brief Set attributes of the text written next.
+ */
+void console_set_attr(console *con, unsigned int fg, unsigned int bg, unsigned int attr) {
+	con->fg = fg & 0xF;
+	con->bg = bg & 0xF;
+	con->attr = attr & (CONSOLE_ATTR_UNDERLINE | CONSOLE_ATTR_REVERSE | CONSOLE_ATTR_BOLD);
+}
+
+/**
+ * @brief Write UTF-8 text at the cursor.
+ */
+void console_write(console *con, const char *text, size_t len) {
+	size_t i;
+
+	for(i = 0; i < len; i++) {
+		unsigned char b = text[i];
+
+		if(con->pending) {
+			if(0x80 == (b & 0xC0)) {
+				con->code = (con->code << 6) | (b & 0x3F);
+				if(!(--(con->pending)))
+					_process(con, con->code);
+				continue;
+			}
+
+			/* Truncated sequence */
+			con->pending = 0;
+			_process(con, 0xFFFD);
+		}
+
+		if(b < 0x80) {
+			_process(con, b);
+		}
+		else if(0xC0 == (b & 0xE0)) {
+			con->code = b & 0x1F;
+			con->pending = 1;
+		}
+		else if(0xE0 == (b & 0xF0)) {
+			con->code = b & 0x0F;
+			con->pending = 2;
+		}
+		else if(0xF0 == (b & 0xF8)) {
+			con->code = b & 0x07;
+			con->pending = 3;
+		}
+		else {
+			_process(con, 0xFFFD);
+		}
+	}
+}
+
+/**
+ * @brief Clear the grid and move the cursor home.
+ */
+void console_clear(console *con) {
+	unsigned int i;
+
+	for(i = 0; i < con->rows; i++)
+		_erase(con, i, 0, con->cols);
+	con->curRow = 0;
+	con->curCol = 0;
+	con->wrapPending = 0;
+}
+
+/**
+ * @brief Send changed cells to the display.
+ */
+int console_flush(console *con, unsigned int *cells) {
+	int rv = CONSOLE_OK;
+	unsigned int row, col, from, count = 0;
+
+	for(row = 0; row < con->rows; row++) {
+		cell *front = &(con->front[row * con->cols]);
+
+		if(!(con->rowDirty[row]))
+			continue;
+
+		for(col = 0; col < con->cols; ) {
+			/* Find next run of cells that differ from the screen */
+			while(col < con->cols && !memcmp(_cell(con, row, col), &(front[col]), sizeof(cell)))
+				col++;
+			from = col;
+			while(col < con->cols && memcmp(_cell(con, row, col), &(front[col]), sizeof(cell)))
+				col++;
+
+			if(col > from) {
+				rv = _draw_run(con, row, from, col);
+				ASSERT(CONSOLE_OK == rv, );
+				for(; from < col; from++, count++)
+					front[from] = *_cell(con, row, from);
+			}
+		}
+
+		con->rowDirty[row] = 0;
+	}
+
+_err:
+	if(cells)
+		*cells = count;
+
+	return rv;
+}
+
+/**
+ * @brief Free console.
+ */
+void console_destroy(console *con) {
+	unsigned int i;
+
+	for(i = 0; i < 256; i++) {
+		if(con->luts[i])
+			free(con->luts[i]);
+	}
+	if(con->back)
+		free(con->back);
+	if(con->front)
+		free(con->front);
+	if(con->rowDirty)
+		free(con->rowDirty);
+	if(con->glyphData)
+		free(con->glyphData);
+	if(con->pixRow)
+		free(con->pixRow);
+	free(con);
+}
@@ -0,0 +1,85 @@
+/* ********************************************************************************************* */
+/* * Dirty Rectangle List Library for PiDisplayLibs                                            * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "dirtyrect.h"
+
+#include <stdlib.h>
+
+/* Rectangles added to the list at a time when it grows */
+#define GROW 16
+
+/**
+ * @brief Initialise an empty list.
+ */
+int dirtyrect_init(dirtyrect_list *l) {
+	l->n = 0;
+	l->rects = malloc(GROW * sizeof(dirtyrect));
+	l->capacity = l->rects? GROW : 0;
+
+	return l->rects? DIRTYRECT_OK : DIRTYRECT_NO_MEMORY;
+}
+
+/**
+ * @brief Add a rectangle, merging it with every rectangle it overlaps.
+ */
+int dirtyrect_add(dirtyrect_list *l, dirtyrect r) {
+	dirtyrect *newRects;
+	int i = 0;
+
+	/* Make room first, so that a failure leaves the list untouched */
+	if(l->n == l->capacity) {
+		newRects = realloc(l->rects, (l->capacity + GROW) * sizeof(dirtyrect));
+		if(!newRects)
+			return DIRTYRECT_NO_MEMORY;
+		l->rects = newRects;
+		l->capacity += GROW;
+	}
+
+	while(i < l->n) {
+		dirtyrect *d = &(l->rects[i]);
+
+		if(d->x0 > r.x1 || r.x0 > d->x1 || d->y0 > r.y1 || r.y0 > d->y1) {
+			i++;
+			continue;
+		}
+
+		/* Absorb it and start over, as the union may now overlap earlier ones */
+		r.x0 = (d->x0 < r.x0)? d->x0 : r.x0;
+		r.y0 = (d->y0 < r.y0)? d->y0 : r.y0;
+		r.x1 = (d->x1 > r.x1)? d->x1 : r.x1;
+		r.y1 = (d->y1 > r.y1)? d->y1 : r.y1;
+		l->rects[i] = l->rects[--(l->n)];
+		i = 0;
+	}
+	l->rects[(l->n)++] = r;
+
+	return DIRTYRECT_OK;
+}
+
+/**
+ * @brief Free the rectangles of a list.
+ */
+void dirtyrect_free(dirtyrect_list *l) {
+	if(l->rects)
+		free(l->rects);
+	l->rects = NULL;
+	l->n = 0;
+	l->capacity = 0;
+}
@@ -0,0 +1,799 @@
+/* ********************************************************************************************* */
+/* * Display List Library for PiDisplayLibs                                                    * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "displaylist.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "common.h"
+
+/* Command opcodes */
+#define OP_SET_XY 1
+#define OP_WINDOW 2
+#define OP_WRITE 3
+#define OP_WORDS 4
+#define OP_FILL 5
+#define OP_SCROLL 6
+
+/* Default chunk size. Larger payloads get a chunk of their own */
+#define CHUNK_SIZE (64 * 1024)
+
+/* Saved list identification */
+#define LIST_MAGIC "PDDL"
+#define LIST_VERSION 1
+
+/* Commands start on 4-byte boundaries */
+#define ALIGN4(n) (((n) + 3) & ~((size_t) 3))
+
+/**
+ * @brief Recorded call. Pixels (OP_WRITE) or words (OP_WORDS) follow immediately, padded to 4 bytes.
+ */
+typedef struct {
+	uint8_t op;
+	uint8_t reserved;
+	uint16_t colour;
+	uint32_t n;
+	int16_t x0;
+	int16_t y0;
+	int16_t x1;
+	int16_t y1;
+} command;
+
+/**
+ * @brief Arena chunk. Commands are laid out back to back in data.
+ */
+typedef struct chunk_s {
+	struct chunk_s *next;
+	size_t size;
+	size_t used;
+	unsigned char data[];
+} chunk;
+
+/**
+ * @brief Saved list header. The commands of all chunks follow immediately.
+ */
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t xres;
+	uint32_t yres;
+	uint32_t encoded;
+	uint32_t busId;
+	uint32_t size;
+	uint32_t reserved;
+} list_header;
+
+struct displaylist_s {
+	int xres;
+	int yres;
+	chunk *head;
+	chunk *cur;
+	/* Last recorded command, always at the end of cur. NULL if it must not be merged with */
+	command *last;
+	int error;
+	int encoded;
+	unsigned int busId;
+};
+
+/* List being recorded on this thread */
+static _Thread_local displaylist *recording = NULL;
+
+/**
+ * @brief Get the size of a command with its payload.
+ */
+static inline size_t _size(const command *cmd) {
+	if(OP_WRITE == cmd->op)
+		return sizeof(command) + ALIGN4(cmd->n * sizeof(uint16_t));
+	if(OP_WORDS == cmd->op)
+		return sizeof(command) + cmd->n * sizeof(uint32_t);
+	return sizeof(command);
+}
+
+/**
+ * @brief Check that a command read from a file fits in the bytes left, without overflowing on 32-bit size_t.
+ */
+static inline int _fits(const command *cmd, size_t left) {
+	uint64_t size = sizeof(command);
+
+	if(OP_WRITE == cmd->op)
+		size += ((uint64_t) cmd->n * sizeof(uint16_t) + 3) & ~(uint64_t) 3;
+	else if(OP_WORDS == cmd->op)
+		size += (uint64_t) cmd->n * sizeof(uint32_t);
+
+	return size <= left;
+}
+
+/**
+ * @brief Zero the padding after the pixels of a write, so that saved lists do not depend on uninitialised memory.
+ */
+static inline void _pad(command *cmd) {
+	if(OP_WRITE == cmd->op && (cmd->n & 1))
+		((uint16_t *) (cmd + 1))[cmd->n] = 0;
+}
+
+/**
+ * @brief Check a start position.
+ */
+static inline int _valid_xy(displaylist *l, int x, int y) {
+	return (0 <= x) && (x < l->xres) && (0 <= y) && (y < l->yres);
+}
+
+/**
+ * @brief Check a window, with the same rules as the drivers.
+ */
+static inline int _valid_window(displaylist *l, int x0, int y0, int x1, int y1) {
+	return (0 <= x0) && (x0 <= x1) && (x1 < l->xres) && (0 <= y0) && (y0 <= y1) && (y1 < l->yres);
+}
+
+/**
+ * @brief Append a command with room for its payload, moving to the next chunk (or a new one) if it does not fit.
+ * @return The new command, or NULL if out of memory.
+ */
+static command *_append(displaylist *l, int op, size_t payload) {
+	size_t size = sizeof(command) + ALIGN4(payload);
+	chunk *c = l->cur;
+	command *cmd;
+
+	if(!c || c->used + size > c->size) {
+		/* Chunks after the current one are empty, either kept by displaylist_clear() or skipped as too small */
+		if(c && c->next && c->next->size >= size) {
+			c = c->next;
+		}
+		else {
+			chunk *newChunk = malloc(sizeof(chunk) + ((size > CHUNK_SIZE)? size : CHUNK_SIZE));
+			if(!newChunk)
+				return NULL;
+
+			newChunk->size = (size > CHUNK_SIZE)? size : CHUNK_SIZE;
+			newChunk->used = 0;
+			if(c) {
+				newChunk->next = c->next;
+				c->next = newChunk;
+			}
+			else {
+				newChunk->next = l->head;
+				l->head = newChunk;
+			}
+			c = newChunk;
+		}
+		l->cur = c;
+	}
+
+	cmd = (command *) (c->data + c->used);
+	c->used += size;
+	memset(cmd, 0, sizeof(command));
+	cmd->op = op;
+	l->last = cmd;
+
+	return cmd;
+}
+
+/**
+ * @brief Free a chain of chunks.
+ */
+static void _free_chunks(chunk *c) {
+	while(c) {
+		chunk *next = c->next;
+		free(c);
+		c = next;
+	}
+}
+
+/**
+ * @brief Record an error on the list being recorded, keeping the first one.
+ * @return DISPLAY_INVALID_ARGS, for the recorder to return.
+ */
+static int _fail(displaylist *l, int error) {
+	if(l && DISPLAYLIST_OK == l->error)
+		l->error = error;
+
+	return DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Record an addressing command. An addressing command with no pixels since the previous one replaces it.
+ */
+static int _address(displaylist *l, int op, int x0, int y0, int x1, int y1) {
+	command *cmd = l->last;
+
+	if(!cmd || (OP_SET_XY != cmd->op && OP_WINDOW != cmd->op)) {
+		cmd = _append(l, op, 0);
+		if(!cmd)
+			return _fail(l, DISPLAYLIST_NO_MEMORY);
+	}
+
+	cmd->op = op;
+	cmd->x0 = x0;
+	cmd->y0 = y0;
+	cmd->x1 = x1;
+	cmd->y1 = y1;
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Record pixels, extending the previous write if it is the last command and its chunk has room.
+ */
+static int _write(displaylist *l, const unsigned short *pixels, unsigned int n) {
+	command *cmd = l->last;
+
+	if(!n)
+		return DISPLAY_OK;
+
+	if(cmd && OP_WRITE == cmd->op) {
+		size_t grow = ALIGN4((cmd->n + n) * sizeof(uint16_t)) - ALIGN4(cmd->n * sizeof(uint16_t));
+
+		if(l->cur->used + grow <= l->cur->size) {
+			memcpy((uint16_t *) (cmd + 1) + cmd->n, pixels, n * sizeof(uint16_t));
+			cmd->n += n;
+			l->cur->used += grow;
+			_pad(cmd);
+			return DISPLAY_OK;
+		}
+	}
+
+	cmd = _append(l, OP_WRITE, n * sizeof(uint16_t));
+	if(!cmd)
+		return _fail(l, DISPLAYLIST_NO_MEMORY);
+
+	memcpy(cmd + 1, pixels, n * sizeof(uint16_t));
+	cmd->n = n;
+	_pad(cmd);
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Recorder init(). The display is initialised by whoever replays the list.
+ */
+static int _rec_init(void *args, int argc) {
+	(void) args;
+	(void) argc;
+
+	return recording? DISPLAY_OK : DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Recorder set_xy().
+ */
+static int _rec_set_xy(int x, int y) {
+	displaylist *l = recording;
+
+	if(!l || !_valid_xy(l, x, y))
+		return _fail(l, DISPLAYLIST_INVALID_ARGS);
+
+	return _address(l, OP_SET_XY, x, y, 0, 0);
+}
+
+/**
+ * @brief Recorder draw(). Pixels are packed into writes.
+ */
+static int _rec_draw(unsigned char r, unsigned char g, unsigned char b) {
+	unsigned short colour = DISPLAY_RGB565(r, g, b);
+
+	if(!recording)
+		return DISPLAY_INVALID_ARGS;
+
+	return _write(recording, &colour, 1);
+}
+
+/**
+ * @brief Recorder set_window().
+ */
+static int _rec_set_window(int x0, int y0, int x1, int y1) {
+	displaylist *l = recording;
+
+	if(!l || !_valid_window(l, x0, y0, x1, y1))
+		return _fail(l, DISPLAYLIST_INVALID_ARGS);
+
+	return _address(l, OP_WINDOW, x0, y0, x1, y1);
+}
+
+/**
+ * @brief Recorder write_rgb565().
+ */
+static int _rec_write_rgb565(const unsigned short *pixels, unsigned int n) {
+	if(!recording || (n && !pixels))
+		return _fail(recording, DISPLAYLIST_INVALID_ARGS);
+
+	return _write(recording, pixels, n);
+}
+
+/**
+ * @brief Recorder fill_rgb565(). Consecutive fills of the same colour are merged.
+ */
+static int _rec_fill_rgb565(unsigned short colour, unsigned int n) {
+	displaylist *l = recording;
+	command *cmd;
+
+	if(!l)
+		return DISPLAY_INVALID_ARGS;
+	if(!n)
+		return DISPLAY_OK;
+
+	cmd = l->last;
+	if(!cmd || OP_FILL != cmd->op || cmd->colour != colour) {
+		cmd = _append(l, OP_FILL, 0);
+		if(!cmd)
+			return _fail(l, DISPLAYLIST_NO_MEMORY);
+		cmd->colour = colour;
+	}
+	cmd->n += n;
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Recorder scroll(). The offset is normalised; consecutive scrolls keep the last one.
+ */
+static int _rec_scroll(int offset) {
+	displaylist *l = recording;
+	command *cmd;
+
+	if(!l)
+		return DISPLAY_INVALID_ARGS;
+
+	offset %= l->xres;
+	if(offset < 0)
+		offset += l->xres;
+
+	cmd = l->last;
+	if(!cmd || OP_SCROLL != cmd->op) {
+		cmd = _append(l, OP_SCROLL, 0);
+		if(!cmd)
+			return _fail(l, DISPLAYLIST_NO_MEMORY);
+	}
+	cmd->x0 = offset;
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Recorder get_resolution(). Reports the resolution of the list.
+ */
+static int _rec_get_resolution(int *xres, int *yres) {
+	if(!recording)
+		return DISPLAY_INVALID_ARGS;
+
+	*xres = recording->xres;
+	*yres = recording->yres;
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Recorder encode_words(). Not available: the bus is only known when encoding or replaying.
+ */
+static int _rec_encode_words(const unsigned short *pixels, unsigned int n, unsigned int *words) {
+	(void) pixels;
+	(void) n;
+	(void) words;
+
+	return DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Recorder write_words(). Not available, the call is reported as lost by displaylist_end().
+ */
+static int _rec_write_words(const unsigned int *words, unsigned int n) {
+	(void) words;
+	(void) n;
+
+	return _fail(recording, DISPLAYLIST_INVALID_ARGS);
+}
+
+/**
+ * @brief Recorder get_bus_id(). Not available: the bus is only known when encoding or replaying.
+ */
+static int _rec_get_bus_id(unsigned int *id) {
+	(void) id;
+
+	return DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Recorder set_stats(). Counters belong to the driver that replays the list.
+ */
+static int _rec_set_stats(unsigned int flags) {
+	(void) flags;
+
+	return DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Recorder get_stats(). Counters belong to the driver that replays the list.
+ */
+static int _rec_get_stats(display_stats *stats) {
+	(void) stats;
+
+	return DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Recorder set_vsync(). Synchronisation belongs to the driver that replays the list.
+ */
+static int _rec_set_vsync(int enable) {
+	(void) enable;
+
+	return DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Recorder wait_vsync(). Synchronisation belongs to the driver that replays the list.
+ */
+static int _rec_wait_vsync(int x0, int y0, int x1, int y1, unsigned long long *timestamp) {
+	(void) x0;
+	(void) y0;
+	(void) x1;
+	(void) y1;
+	(void) timestamp;
+
+	return DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Recorder select(). A list is recorded for one resolution; panels belong to the driver that replays it.
+ */
+static int _rec_select(int panel) {
+	(void) panel;
+
+	return DISPLAY_INVALID_ARGS;
+}
+
+/**
+ * @brief Recorder finish(). Recording stops with displaylist_end().
+ */
+static int _rec_finish(void) {
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Create an empty display list.
+ */
+int displaylist_create(displaylist **l, int xres, int yres) {
+	int rv = DISPLAYLIST_OK;
+	displaylist *newList = NULL;
+
+	/* Coordinates are stored in 16 bits */
+	ASSERT(0 < xres && xres <= INT16_MAX && 0 < yres && yres <= INT16_MAX, rv = DISPLAYLIST_INVALID_ARGS);
+
+	newList = calloc(1, sizeof(displaylist));
+	ASSERT(newList, rv = DISPLAYLIST_NO_MEMORY);
+
+	newList->xres = xres;
+	newList->yres = yres;
+
+	*l = newList;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Start recording.
+ */
+int displaylist_begin(displaylist *l, display_driver *recorder) {
+	int rv = DISPLAYLIST_OK;
+
+	ASSERT(!recording, rv = DISPLAYLIST_INVALID_ARGS);
+
+	recording = l;
+	l->error = DISPLAYLIST_OK;
+
+	recorder->init = _rec_init;
+	recorder->set_xy = _rec_set_xy;
+	recorder->draw = _rec_draw;
+	recorder->set_window = _rec_set_window;
+	recorder->write_rgb565 = _rec_write_rgb565;
+	recorder->fill_rgb565 = _rec_fill_rgb565;
+	recorder->scroll = _rec_scroll;
+	recorder->get_resolution = _rec_get_resolution;
+	recorder->encode_words = _rec_encode_words;
+	recorder->write_words = _rec_write_words;
+	recorder->get_bus_id = _rec_get_bus_id;
+	recorder->set_stats = _rec_set_stats;
+	recorder->get_stats = _rec_get_stats;
+	recorder->set_vsync = _rec_set_vsync;
+	recorder->wait_vsync = _rec_wait_vsync;
+	recorder->select = _rec_select;
+	recorder->finish = _rec_finish;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Stop recording.
+ */
+int displaylist_end(displaylist *l) {
+	if(recording == l)
+		recording = NULL;
+
+	return l->error;
+}
+
+/**
+ * @brief Convert the recorded RGB565 pixels into the GPIO words of a driver.
+ */
+int displaylist_encode(displaylist *l, display_driver *driver) {
+	int rv = DISPLAYLIST_OK;
+	displaylist tmp = {.xres = l->xres, .yres = l->yres};
+	unsigned int busId;
+	chunk *c;
+
+	driver->get_bus_id(&busId);
+	ASSERT(!l->encoded || busId == l->busId, rv = DISPLAYLIST_BUS_MISMATCH);
+
+	/* Rebuild the list in a new arena, since words take more room than pixels */
+	for(c = l->head; c; c = c->next) {
+		unsigned char *p;
+
+		for(p = c->data; p < c->data + c->used; p += _size((command *) p)) {
+			command *src = (command *) p;
+			command *dst;
+
+			if(OP_WRITE == src->op) {
+				/* Two words per pixel on 8-bit buses, as for imagecache */
+				dst = _append(&tmp, OP_WORDS, 2 * src->n * sizeof(uint32_t));
+				ASSERT(dst, rv = DISPLAYLIST_NO_MEMORY);
+				driver->encode_words((const unsigned short *) (src + 1), src->n, (unsigned int *) (dst + 1));
+				dst->n = 2 * src->n;
+			}
+			else {
+				dst = _append(&tmp, src->op, _size(src) - sizeof(command));
+				ASSERT(dst, rv = DISPLAYLIST_NO_MEMORY);
+				memcpy(dst, src, _size(src));
+			}
+		}
+	}
+
+	_free_chunks(l->head);
+	l->head = tmp.head;
+	l->cur = tmp.cur;
+	l->last = NULL;
+	l->encoded = 1;
+	l->busId = busId;
+	tmp.head = NULL;
+
+_err:
+
+	_free_chunks(tmp.head);
+
+	return rv;
+}
+
+/**
+ * @brief Replay a display list.
+ */
+int displaylist_replay(displaylist *l, display_driver *driver) {
+	int rv = DISPLAYLIST_OK;
+	int xres, yres;
+	unsigned int busId;
+	chunk *c;
+
+	driver->get_resolution(&xres, &yres);
+	ASSERT(xres == l->xres && yres == l->yres, rv = DISPLAYLIST_INVALID_ARGS);
+
+	if(l->encoded) {
+		driver->get_bus_id(&busId);
+		ASSERT(busId == l->busId, rv = DISPLAYLIST_BUS_MISMATCH);
+	}
+
+	for(c = l->head; c; c = c->next) {
+		unsigned char *p;
+
+		for(p = c->data; p < c->data + c->used; p += _size((command *) p)) {
+			const command *cmd = (const command *) p;
+			int drv = DISPLAY_OK;
+
+			switch(cmd->op) {
+				case OP_SET_XY:
+					drv = driver->set_xy(cmd->x0, cmd->y0);
+					break;
+				case OP_WINDOW:
+					drv = driver->set_window(cmd->x0, cmd->y0, cmd->x1, cmd->y1);
+					break;
+				case OP_WRITE:
+					drv = driver->write_rgb565((const unsigned short *) (cmd + 1), cmd->n);
+					break;
+				case OP_WORDS:
+					drv = driver->write_words((const unsigned int *) (cmd + 1), cmd->n);
+					break;
+				case OP_FILL:
+					drv = driver->fill_rgb565(cmd->colour, cmd->n);
+					break;
+				case OP_SCROLL:
+					drv = driver->scroll(cmd->x0);
+					break;
+			}
+			ASSERT(DISPLAY_OK == drv, rv = DISPLAYLIST_DRIVER_ERROR);
+		}
+	}
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Empty a display list.
+ */
+void displaylist_clear(displaylist *l) {
+	chunk *c;
+
+	for(c = l->head; c; c = c->next)
+		c->used = 0;
+
+	l->cur = l->head;
+	l->last = NULL;
+	l->encoded = 0;
+}
+
+/**
+ * @brief Save a display list to a file.
+ */
+int displaylist_save(displaylist *l, const char *path) {
+	int rv = DISPLAYLIST_OK;
+	FILE *file = NULL;
+	list_header header;
+	size_t size = displaylist_get_size(l);
+	chunk *c;
+
+	ASSERT(size <= UINT32_MAX, rv = DISPLAYLIST_FILE_ERROR);
+
+	memcpy(header.magic, LIST_MAGIC, 4);
+	header.version = LIST_VERSION;
+	header.xres = l->xres;
+	header.yres = l->yres;
+	header.encoded = l->encoded;
+	header.busId = l->busId;
+	header.size = size;
+	header.reserved = 0;
+
+	file = fopen(path, "wb");
+	ASSERT(file, rv = DISPLAYLIST_FILE_ERROR);
+	ASSERT(1 == fwrite(&header, sizeof(list_header), 1, file), rv = DISPLAYLIST_FILE_ERROR);
+
+	for(c = l->head; c; c = c->next) {
+		if(c->used)
+			ASSERT(1 == fwrite(c->data, c->used, 1, file), rv = DISPLAYLIST_FILE_ERROR);
+	}
+
+_err:
+
+	if(file && fclose(file) && DISPLAYLIST_OK == rv)
+		rv = DISPLAYLIST_FILE_ERROR;
+
+	return rv;
+}
+
+/**
+ * @brief Load a display list saved by displaylist_save().
+ */
+int displaylist_load(displaylist **l, const char *path) {
+	int rv = DISPLAYLIST_OK;
+	FILE *file = NULL;
+	list_header header;
+	displaylist *newList = NULL;
+	chunk *c = NULL;
+	unsigned char *p, *end;
+	struct stat st;
+
+	file = fopen(path, "rb");
+	ASSERT(file, rv = DISPLAYLIST_FILE_ERROR);
+	ASSERT(1 == fread(&header, sizeof(list_header), 1, file), rv = DISPLAYLIST_FILE_ERROR);
+	ASSERT(!memcmp(header.magic, LIST_MAGIC, 4) && LIST_VERSION == header.version, rv = DISPLAYLIST_FILE_ERROR);
+
+	rv = displaylist_create(&newList, header.xres, header.yres);
+	ASSERT(DISPLAYLIST_OK == rv, rv = (DISPLAYLIST_NO_MEMORY == rv)? rv : DISPLAYLIST_FILE_ERROR);
+
+	/* The size comes from the file: the stream must be in it, and fit in a chunk */
+	ASSERT(!fstat(fileno(file), &st) && st.st_size >= (off_t) sizeof(list_header), rv = DISPLAYLIST_FILE_ERROR);
+	ASSERT(header.size <= (uint64_t) (st.st_size - sizeof(list_header)), rv = DISPLAYLIST_FILE_ERROR);
+	ASSERT(header.size <= SIZE_MAX - sizeof(chunk), rv = DISPLAYLIST_NO_MEMORY);
+
+	/* The whole stream goes to a single chunk */
+	c = malloc(sizeof(chunk) + header.size);
+	ASSERT(c, rv = DISPLAYLIST_NO_MEMORY);
+	c->next = NULL;
+	c->size = header.size;
+	c->used = header.size;
+	ASSERT(!header.size || 1 == fread(c->data, header.size, 1, file), rv = DISPLAYLIST_FILE_ERROR);
+
+	/* Validate every command now, so that replaying does not have to */
+	end = c->data + c->used;
+	for(p = c->data; p < end; p += _size((command *) p)) {
+		command *cmd = (command *) p;
+
+		ASSERT((size_t) (end - p) >= sizeof(command), rv = DISPLAYLIST_FILE_ERROR);
+		ASSERT(_fits(cmd, end - p), rv = DISPLAYLIST_FILE_ERROR);
+		switch(cmd->op) {
+			case OP_SET_XY:
+				ASSERT(_valid_xy(newList, cmd->x0, cmd->y0), rv = DISPLAYLIST_FILE_ERROR);
+				break;
+			case OP_WINDOW:
+				ASSERT(_valid_window(newList, cmd->x0, cmd->y0, cmd->x1, cmd->y1), rv = DISPLAYLIST_FILE_ERROR);
+				break;
+			case OP_WORDS:
+				ASSERT(header.encoded, rv = DISPLAYLIST_FILE_ERROR);
+				break;
+			case OP_SCROLL:
+				ASSERT(0 <= cmd->x0 && cmd->x0 < newList->xres, rv = DISPLAYLIST_FILE_ERROR);
+				break;
+			case OP_WRITE:
+			case OP_FILL:
+				break;
+			default:
+				ASSERT(0, rv = DISPLAYLIST_FILE_ERROR);
+		}
+	}
+
+	newList->head = c;
+	newList->cur = c;
+	newList->encoded = header.encoded;
+	newList->busId = header.busId;
+	c = NULL;
+
+	*l = newList;
+	newList = NULL;
+
+_err:
+
+	if(c)
+		free(c);
+
+	if(newList)
+		displaylist_destroy(newList);
+
+	if(file)
+		fclose(file);
+
+	return rv;
+}
+
+/**
+ * @brief Get the memory taken by recorded calls.
+ */
+size_t displaylist_get_size(displaylist *l) {
+	size_t size = 0;
+	chunk *c;
+
+	for(c = l->head; c; c = c->next)
+		size += c->used;
+
+	return size;
+}
+
+/**
+ * @brief Free display list and its chunks.
+ */
+void displaylist_destroy(displaylist *l) {
+	if(recording == l)
+		recording = NULL;
+
+	_free_chunks(l->head);
+	free(l);
+}
@@ -0,0 +1,161 @@
+/* ********************************************************************************************* */
+/* * Display Statistics Library for PiDisplayLibs                                              * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "displaystats.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+
+_Static_assert(!(offsetof(displaystats_page, threads) % DISPLAYSTATS_LINE), "Blocks must start on a cache line");
+_Static_assert(!(sizeof(displaystats_block) % DISPLAYSTATS_LINE), "Blocks must be padded to whole cache lines");
+
+/* Page used until (and unless) the shared one is created */
+static displaystats_page privatePage = {.magic = DISPLAYSTATS_MAGIC, .version = DISPLAYSTATS_VERSION};
+
+/* Shared page and its name */
+static displaystats_page *sharedPage = NULL;
+static char sharedName[32];
+
+displaystats_page *displaystats_current = &privatePage;
+_Thread_local int displaystats_slot __attribute__((tls_model("initial-exec"))) = -1;
+
+/**
+ * @brief Assign a block to the calling thread.
+ */
+int displaystats_claim(void) {
+	int slot = __atomic_fetch_add(&(displaystats_current->nThreads), 1, __ATOMIC_RELAXED);
+
+	displaystats_slot = (slot < DISPLAYSTATS_THREADS)? slot : DISPLAYSTATS_THREADS;
+
+	return displaystats_slot;
+}
+
+/**
+ * @brief Account a pixel transfer.
+ */
+void displaystats_transfer(display_stats *stats, unsigned int pixels, uint64_t start) {
+	uint64_t ns = displaystats_now() - start;
+	uint64_t us = ns / 1000;
+	int bin = us? 64 - __builtin_clzll(us) : 0;
+
+	bin = (bin < DISPLAY_STATS_BINS)? bin : DISPLAY_STATS_BINS - 1;
+	DISPLAYSTATS_ADD(stats, pixels, pixels);
+	DISPLAYSTATS_ADD(stats, transfers, 1);
+	DISPLAYSTATS_ADD(stats, transferNs, ns);
+	DISPLAYSTATS_ADD(stats, transferTime[bin], 1);
+}
+
+/**
+ * @brief Apply the PIDISPLAY_STATS environment variable, if set.
+ */
+int displaystats_init(void) {
+	const char *env = getenv("PIDISPLAY_STATS");
+
+	if(!env || !strcmp(env, "") || !strcmp(env, "0"))
+		return DISPLAY_OK;
+
+	return displaystats_set(DISPLAY_STATS_ENABLE | (strcmp(env, "shared")? 0 : DISPLAY_STATS_SHARED));
+}
+
+/**
+ * @brief Turn counters on or off, optionally moving them to the shared page.
+ */
+int displaystats_set(unsigned int flags) {
+	int rv = DISPLAY_OK;
+	int fd = -1;
+	void *map;
+
+	if((flags & DISPLAY_STATS_SHARED) && !sharedName[0]) {
+		snprintf(sharedName, sizeof(sharedName), DISPLAYSTATS_SHM_NAME, (int) getpid());
+		fd = shm_open(sharedName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		ASSERT(fd != -1, rv = DISPLAY_SHM_ERROR);
+
+		/* Counts so far and thread blocks move along, so threads keep their block index */
+		ASSERT((ssize_t) sizeof(displaystats_page) == pwrite(fd, displaystats_current, sizeof(displaystats_page), 0),
+			rv = DISPLAY_SHM_ERROR);
+
+		/* A page left by displaystats_finish() is replaced in place, as threads may still point into it */
+		map = mmap(sharedPage, sizeof(displaystats_page), PROT_READ | PROT_WRITE,
+			MAP_SHARED | (sharedPage? MAP_FIXED : 0), fd, 0);
+		ASSERT(map != MAP_FAILED, rv = DISPLAY_SHM_ERROR);
+
+		sharedPage = map;
+		displaystats_current = sharedPage;
+	}
+
+	displaystats_current->enabled = (flags & DISPLAY_STATS_ENABLE)? 1 : 0;
+
+_err:
+
+	if(fd != -1)
+		close(fd);
+
+	if(rv != DISPLAY_OK && sharedName[0]) {
+		shm_unlink(sharedName);
+		sharedName[0] = '\0';
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Sum the counters of every thread.
+ */
+void displaystats_sum(const displaystats_page *page, display_stats *stats) {
+	unsigned int n = (page->nThreads <= DISPLAYSTATS_THREADS)? page->nThreads : DISPLAYSTATS_THREADS + 1;
+	unsigned int i, j;
+
+	memset(stats, 0, sizeof(display_stats));
+
+	for(i = 0; i < n; i++) {
+		const display_stats *t = &(page->threads[i].stats);
+
+		stats->commands += t->commands;
+		stats->registers += t->registers;
+		stats->readdresses += t->readdresses;
+		stats->pixels += t->pixels;
+		stats->strobes += t->strobes;
+		stats->gpioStores += t->gpioStores;
+		stats->transfers += t->transfers;
+		stats->transferNs += t->transferNs;
+		for(j = 0; j < DISPLAY_STATS_BINS; j++)
+			stats->transferTime[j] += t->transferTime[j];
+	}
+}
+
+/**
+ * @brief Remove the name of the shared page, if any.
+ */
+void displaystats_finish(void) {
+	if(!sharedName[0])
+		return;
+
+	/* The page itself stays mapped, as other threads may still hold pointers into it */
+	shm_unlink(sharedName);
+	sharedName[0] = '\0';
+}
@@ -0,0 +1,90 @@
+/* ********************************************************************************************* */
+/* * Driver Loader for loading display drivers at runtime                                      * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "driverloader.h"
+
+#include <dlfcn.h>
+#include <stddef.h>
+
+#include "common.h"
+
+/**
+ * @brief Load a display driver library and retrieve its functions.
+ */
+int driverloader_open(const char *path, display_driver *driver, void **handle) {
+	int rv = DRIVERLOADER_OK;
+	void *library = NULL;
+
+	library = dlopen(path, RTLD_LAZY);
+	ASSERT(library != NULL, rv = DRIVERLOADER_DLOPEN_ERROR);
+
+	driver->init = dlsym(library, "display_init");
+	ASSERT(driver->init != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->set_xy = dlsym(library, "display_set_xy");
+	ASSERT(driver->set_xy != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->draw = dlsym(library, "display_draw");
+	ASSERT(driver->draw != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->set_window = dlsym(library, "display_set_window");
+	ASSERT(driver->set_window != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->write_rgb565 = dlsym(library, "display_write_rgb565");
+	ASSERT(driver->write_rgb565 != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->fill_rgb565 = dlsym(library, "display_fill_rgb565");
+	ASSERT(driver->fill_rgb565 != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->scroll = dlsym(library, "display_scroll");
+	ASSERT(driver->scroll != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->get_resolution = dlsym(library, "display_get_resolution");
+	ASSERT(driver->get_resolution != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->encode_words = dlsym(library, "display_encode_words");
+	ASSERT(driver->encode_words != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->write_words = dlsym(library, "display_write_words");
+	ASSERT(driver->write_words != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->get_bus_id = dlsym(library, "display_get_bus_id");
+	ASSERT(driver->get_bus_id != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->set_stats = dlsym(library, "display_set_stats");
+	ASSERT(driver->set_stats != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->get_stats = dlsym(library, "display_get_stats");
+	ASSERT(driver->get_stats != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->set_vsync = dlsym(library, "display_set_vsync");
+	ASSERT(driver->set_vsync != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->wait_vsync = dlsym(library, "display_wait_vsync");
+	ASSERT(driver->wait_vsync != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->select = dlsym(library, "display_select");
+	ASSERT(driver->select != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+	driver->finish = dlsym(library, "display_finish");
+	ASSERT(driver->finish != NULL, rv = DRIVERLOADER_DLSYM_ERROR);
+
+	*handle = library;
+	library = NULL;
+
+_err:
+
+	if(library)
+		dlclose(library);
+
+	return rv;
+}
+
+/**
+ * @brief Close a driver library opened by driverloader_open().
+ */
+void driverloader_close(void *handle) {
+	if(handle)
+		dlclose(handle);
+}
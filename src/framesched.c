@@ -0,0 +1,256 @@
+/* ********************************************************************************************* */
+/* * Frame Scheduler Library for PiDisplayLibs                                                 * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "framesched.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <time.h>
+
+#include "common.h"
+
+/* Misses among the last 8 frames that lower quality, and frames under half the period that raise it */
+#define MISS_LIMIT 2
+#define CALM_FRAMES 32
+
+/* Times the rate of a client may be halved */
+#define MAX_HALVINGS 3
+
+/**
+ * @brief Scheduled client.
+ */
+typedef struct {
+	framesched_fn render;
+	framesched_fn flush;
+	void *arg;
+	int ended;
+	/* Target and current period, time the next frame is due and time the last one started */
+	uint64_t basePeriod;
+	uint64_t period;
+	uint64_t due;
+	uint64_t last;
+	unsigned long long frame;
+	int levels;
+	int level;
+	/* Last frames, one bit each (set if missed), and frames in a row under half the period */
+	unsigned int history;
+	unsigned int calm;
+	framesched_stats stats;
+} client;
+
+struct framesched_s {
+	client *clients;
+	int n;
+	int capacity;
+};
+
+/**
+ * @brief Read the monotonic clock in nanoseconds.
+ */
+static uint64_t _now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Adapt quality and rate of a client to how long its last frame took.
+ * @param c Client.
+ * @param used Render plus flush time.
+ * @param missed Non-zero if the frame was done after its deadline.
+ */
+static void _adapt(client *c, uint64_t used, int missed) {
+	/* Calm against the period the client would go back to, so that restoring the rate does not make it miss again */
+	uint64_t next = (c->period > c->basePeriod)? c->period / 2 : c->period;
+
+	c->history = ((c->history << 1) | (missed? 1 : 0)) & 0xFF;
+	c->calm = (used < next / 2)? c->calm + 1 : 0;
+
+	/* Detail goes first, then rate; they come back in reverse order */
+	if(__builtin_popcount(c->history) >= MISS_LIMIT) {
+		if(c->level < c->levels - 1)
+			c->level++;
+		else if(c->period < (c->basePeriod << MAX_HALVINGS))
+			c->period *= 2;
+		c->history = 0;
+		c->calm = 0;
+	}
+	else if(c->calm >= CALM_FRAMES) {
+		if(c->period > c->basePeriod)
+			c->period /= 2;
+		else if(c->level)
+			c->level--;
+		c->calm = 0;
+	}
+}
+
+/**
+ * @brief Add a duration to an average over the last frames and to a maximum.
+ */
+static void _account(unsigned int *avg, unsigned int *max, uint64_t ns) {
+	unsigned int v = (ns > UINT32_MAX)? UINT32_MAX : ns;
+
+	*avg = *avg? *avg - *avg / 8 + v / 8 : v;
+	*max = (v > *max)? v : *max;
+}
+
+/**
+ * @brief Create a frame scheduler.
+ */
+int framesched_create(framesched **s) {
+	*s = calloc(1, sizeof(framesched));
+
+	return *s? FRAMESCHED_OK : FRAMESCHED_NO_MEMORY;
+}
+
+/**
+ * @brief Add a client.
+ */
+int framesched_add(framesched *s, framesched_fn render, framesched_fn flush, void *arg, unsigned int rate,
+		int levels, int *id) {
+	int rv = FRAMESCHED_OK;
+	client *clients, *c;
+
+	ASSERT(render && rate >= 1 && rate <= 1000 && levels >= 1, rv = FRAMESCHED_INVALID_ARGS);
+
+	if(s->n == s->capacity) {
+		clients = realloc(s->clients, (s->capacity? 2 * s->capacity : 4) * sizeof(client));
+		ASSERT(clients, rv = FRAMESCHED_NO_MEMORY);
+		s->clients = clients;
+		s->capacity = s->capacity? 2 * s->capacity : 4;
+	}
+
+	c = &(s->clients[s->n]);
+	c->render = render;
+	c->flush = flush;
+	c->arg = arg;
+	c->ended = 0;
+	c->basePeriod = 1000000000ULL / rate;
+	c->period = c->basePeriod;
+	c->due = 0;
+	c->last = 0;
+	c->frame = 0;
+	c->levels = levels;
+	c->level = 0;
+	c->history = 0;
+	c->calm = 0;
+	c->stats = (framesched_stats) {0};
+
+	if(id)
+		*id = s->n;
+	s->n++;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Draw frames until every client ended or stop is set.
+ */
+void framesched_run(framesched *s, volatile int *stop) {
+	framesched_frame frame;
+	struct timespec ts;
+	uint64_t start, now, rendered, flushed, late;
+	client *c;
+	int i, rv;
+
+	/* Wake up when asked rather than up to 50 us later, so that sleeping is precise without spinning */
+	prctl(PR_SET_TIMERSLACK, 1);
+
+	start = _now();
+	for(i = 0; i < s->n; i++) {
+		s->clients[i].due = start;
+		s->clients[i].last = 0;
+	}
+
+	while(!(stop && *stop)) {
+		/* Client with the earliest frame due */
+		for(c = NULL, i = 0; i < s->n; i++) {
+			if(!(s->clients[i].ended) && (!c || s->clients[i].due < c->due))
+				c = &(s->clients[i]);
+		}
+		if(!c)
+			break;
+
+		ts.tv_sec = c->due / 1000000000ULL;
+		ts.tv_nsec = c->due % 1000000000ULL;
+		while(EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL));
+
+		/* Frames whose time is over are dropped, so that a late client catches up instead of drawing a burst */
+		now = _now();
+		if(now >= c->due + c->period) {
+			late = (now - c->due) / c->period;
+			c->due += late * c->period;
+			c->frame += late;
+			c->stats.skipped += late;
+		}
+
+		frame.frame = c->frame;
+		frame.start = now;
+		frame.deadline = c->due + c->period;
+		frame.elapsed = c->last? now - c->last : 0;
+		frame.period = c->period;
+		frame.level = c->level;
+		c->last = now;
+
+		rv = c->render(c->arg, &frame);
+		rendered = _now();
+		if(FRAMESCHED_OK == rv && c->flush)
+			rv = c->flush(c->arg, &frame);
+		flushed = _now();
+
+		c->stats.frames++;
+		c->stats.missed += (flushed > frame.deadline)? 1 : 0;
+		_account(&(c->stats.renderAvg), &(c->stats.renderMax), rendered - now);
+		_account(&(c->stats.flushAvg), &(c->stats.flushMax), flushed - rendered);
+		_adapt(c, flushed - now, flushed > frame.deadline);
+
+		c->due += frame.period;
+		c->frame++;
+		c->ended = (FRAMESCHED_OK != rv);
+	}
+}
+
+/**
+ * @brief Get client statistics.
+ */
+int framesched_get_stats(framesched *s, int id, framesched_stats *stats) {
+	if(id < 0 || id >= s->n)
+		return FRAMESCHED_INVALID_ARGS;
+
+	*stats = s->clients[id].stats;
+	stats->period = s->clients[id].period;
+	stats->level = s->clients[id].level;
+
+	return FRAMESCHED_OK;
+}
+
+/**
+ * @brief Free scheduler.
+ */
+void framesched_destroy(framesched *s) {
+	free(s->clients);
+	free(s);
+}
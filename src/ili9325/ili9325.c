@@ -28,10 +28,19 @@
 
 #include "display.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "bcmgpio.h"
 #include "common.h"
+#include "displaystats.h"
 
 /* Screen resolution macros */
 #define DISPLAY_XRES 320
@@ -56,6 +65,64 @@
 #define DB_PINMASK ((1 << DB_PIN7) | (1 << DB_PIN6) | (1 << DB_PIN5) | (1 << DB_PIN4) | (1 << DB_PIN3) | (1 << DB_PIN2) | (1 << DB_PIN1) | (1 << DB_PIN0))
 #define CS_PIN 13
 #define RST_PIN 19
+/* Most panels sharing DB, RS and WR, each with its own CS and reset (see display_init()) */
+#define MAX_PANELS 4
+/* FMARK output of the controller, only needed for display_set_vsync() */
+#define FMARK_PIN 26
+
+/**
+ * Refresh timing. A refresh starts with an FMARK pulse (position 0, see register 0x000D) at the start of the back
+ * porch, then the gate lines are scanned and the front porch follows (see register 0x0008). Gate lines are screen
+ * columns; they are scanned in GRAM order, i.e. from the highest column down to column 0 (before any scrolling).
+ */
+#define FRAME_BP 7
+#define FRAME_LINES (FRAME_BP + DISPLAY_XRES + 2)
+
+/* Refreshes timed to measure the refresh period, and longest time without an FMARK edge (in ms) */
+#define FMARK_MEASURE 8
+#define FMARK_TIMEOUT 100
+
+/* Refreshes extrapolated from the last FMARK edge before waiting for a new one, when not using edge events */
+#define FMARK_RESYNC 16
+
+/* Waits end by spinning for this long, as waking up from a sleep is much coarser than a gate line (in ns) */
+#define SPIN_NS 200000
+
+/* GPIO stores for one byte on the bus (DB set and clear, WR low twice and high) and for setting RS */
+#define STORES_PER_BYTE 5
+#define STORES_RS 1
+
+/* Default size of the bus trace ring (see PIDISPLAY_TRACE), about 4 full frames */
+#define TRACE_RECORDS (4 * 1024 * 1024)
+
+/**
+ * Panels on the bus, the one being addressed (DISPLAY_CANVAS for all of them side by side) and the one whose CS is low
+ * (-1 while all of them are, during initialisation)
+ */
+static display_panel panels[MAX_PANELS] = {{CS_PIN, RST_PIN}};
+static int nPanels = 1;
+static int selected = DISPLAY_CANVAS;
+static int csPanel = -1;
+
+/* Whether each panel has a window other than full screen */
+static int windowed[MAX_PANELS];
+
+/* Current window and cursor, in canvas coordinates, and whether the window spans more than one panel */
+static int winX0 = 0, winY0 = 0, winX1 = DISPLAY_XRES - 1, winY1 = DISPLAY_YRES - 1;
+static int curX = 0, curY = 0;
+static int spanning = 0;
+
+/* Path where the bus trace is dumped by display_finish(), NULL if not capturing */
+static const char *tracePath = NULL;
+
+/* Whether vsync is on, FMARK edge event descriptor (-1 when polling FMARK), last edge and refresh period (in ns) */
+static int vsync = 0;
+static int fmarkFd = -1;
+static uint64_t fmarkLast = 0;
+static uint64_t fmarkPeriod = 0;
+
+/* Base image scroll (register 0x006A), which shifts GRAM columns against the scan */
+static int scanShift = 0;
 
 /**
  * @brief Scramble DB bits so that they can be written simultaneously using bcmgpio_write_mask.
@@ -63,7 +130,7 @@
  * @param val Unscrambled DB value.
  * @return Scrambled DB value that may be used by bcmgpio_write_mask along with the DB_PINMASK macro.
  */
-inline unsigned int scrambleDB(unsigned int val) {
+static inline unsigned int scrambleDB(unsigned int val) {
 	return
 #if DB_PIN0 != 0
 		((val & 0x1) << DB_PIN0) |
@@ -121,12 +188,31 @@ inline unsigned int scrambleDB(unsigned int val) {
 #endif
 }
 
+/**
+ * Scrambled value of every byte, generated by the preprocessor, so that pixel loops take a load per byte instead of
+ * eight masks and shifts. Each bit is moved down to bit 0 before going up to its pin, so no shift is ever negative
+ */
+#define SCRAMBLE_BIT(v, b, pin) ((((v) >> (b)) & 1) << (pin))
+#define SCRAMBLE(v) (SCRAMBLE_BIT(v, 0, DB_PIN0) | SCRAMBLE_BIT(v, 1, DB_PIN1) | SCRAMBLE_BIT(v, 2, DB_PIN2) | \
+	SCRAMBLE_BIT(v, 3, DB_PIN3) | SCRAMBLE_BIT(v, 4, DB_PIN4) | SCRAMBLE_BIT(v, 5, DB_PIN5) | \
+	SCRAMBLE_BIT(v, 6, DB_PIN6) | SCRAMBLE_BIT(v, 7, DB_PIN7))
+#define SCRAMBLE4(v) SCRAMBLE(v), SCRAMBLE((v) + 1), SCRAMBLE((v) + 2), SCRAMBLE((v) + 3)
+#define SCRAMBLE16(v) SCRAMBLE4(v), SCRAMBLE4((v) + 4), SCRAMBLE4((v) + 8), SCRAMBLE4((v) + 12)
+#define SCRAMBLE64(v) SCRAMBLE16(v), SCRAMBLE16((v) + 16), SCRAMBLE16((v) + 32), SCRAMBLE16((v) + 48)
+
+static const unsigned int scrambleTable[256] = {
+	SCRAMBLE64(0), SCRAMBLE64(64), SCRAMBLE64(128), SCRAMBLE64(192)
+};
+
+_Static_assert(SCRAMBLE(0xFF) == DB_PINMASK, "DB pins must be eight different GPIOs");
+
 /**
  * @brief Select a register for write/read.
  * @param vl Register.
  */
 void _write_com(char vl) {
 	unsigned int vlScrambled = scrambleDB((unsigned int) vl);
+	display_stats *stats = displaystats_get();
 
 	bcmgpio_write_uns(RS_PIN, 0);
 
@@ -140,6 +226,13 @@ void _write_com(char vl) {
 	bcmgpio_write_uns(RW_PIN, 0);
 	bcmgpio_write_uns(RW_PIN, 0);
 	bcmgpio_write_uns(RW_PIN, 1);
+
+	/* The MSBs skip the DB stores */
+	if(stats) {
+		DISPLAYSTATS_ADD(stats, commands, 1);
+		DISPLAYSTATS_ADD(stats, strobes, 2);
+		DISPLAYSTATS_ADD(stats, gpioStores, STORES_RS + 2 * STORES_PER_BYTE - 2);
+	}
 }
 
 /**
@@ -150,6 +243,7 @@ void _write_com(char vl) {
 void _write_data(char vh, char vl) {
 	unsigned int vhScrambled = scrambleDB((unsigned int) vh);
 	unsigned int vlScrambled = scrambleDB((unsigned int) vl);
+	display_stats *stats = displaystats_get();
 
 	bcmgpio_write_uns(RS_PIN, 1);
 
@@ -164,6 +258,100 @@ void _write_data(char vh, char vl) {
 	bcmgpio_write_uns(RW_PIN, 0);
 	bcmgpio_write_uns(RW_PIN, 0);
 	bcmgpio_write_uns(RW_PIN, 1);
+
+	if(stats) {
+		DISPLAYSTATS_ADD(stats, strobes, 2);
+		DISPLAYSTATS_ADD(stats, gpioStores, STORES_RS + 2 * STORES_PER_BYTE);
+	}
+}
+
+/**
+ * @brief Write a sequence of 16-bit data to the selected register. RS is only set once for the whole sequence.
+ * @param data Values.
+ * @param n Number of values.
+ */
+void _write_data_seq(const unsigned short *data, unsigned int n) {
+	display_stats *stats = displaystats_get();
+	unsigned int i;
+
+	bcmgpio_write_uns(RS_PIN, 1);
+
+	for(i = 0; i < n; i++) {
+		/* Write 8 MSBs */
+		bcmgpio_write_mask_uns(DB_PINMASK, scrambleTable[data[i] >> 8]);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 1);
+
+		/* Write 8 LSBs */
+		bcmgpio_write_mask_uns(DB_PINMASK, scrambleTable[data[i] & 0xFF]);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 1);
+	}
+
+	/* Counted once per call, so that the loop is left untouched */
+	if(stats) {
+		DISPLAYSTATS_ADD(stats, strobes, 2ULL * n);
+		DISPLAYSTATS_ADD(stats, gpioStores, STORES_RS + 2ULL * STORES_PER_BYTE * n);
+	}
+}
+
+/**
+ * @brief Write the same 16-bit data n times to the selected register. Value is scrambled only once.
+ * @param data Value.
+ * @param n Number of writes.
+ */
+void _write_data_rep(unsigned short data, unsigned int n) {
+	unsigned int vhScrambled = scrambleDB(data >> 8);
+	unsigned int vlScrambled = scrambleDB(data & 0xFF);
+	display_stats *stats = displaystats_get();
+	unsigned int i;
+
+	bcmgpio_write_uns(RS_PIN, 1);
+
+	for(i = 0; i < n; i++) {
+		/* Write 8 MSBs */
+		bcmgpio_write_mask_uns(DB_PINMASK, vhScrambled);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 1);
+
+		/* Write 8 LSBs */
+		bcmgpio_write_mask_uns(DB_PINMASK, vlScrambled);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 1);
+	}
+
+	if(stats) {
+		DISPLAYSTATS_ADD(stats, strobes, 2ULL * n);
+		DISPLAYSTATS_ADD(stats, gpioStores, STORES_RS + 2ULL * STORES_PER_BYTE * n);
+	}
+}
+
+/**
+ * @brief Write a sequence of pre-scrambled bytes to the selected register. RS is only set once for the whole sequence.
+ * @param words Scrambled bytes, as produced by scrambleDB(). Two consecutive words form a 16-bit value, MSBs first.
+ * @param n Number of words.
+ */
+void _write_words_seq(const unsigned int *words, unsigned int n) {
+	display_stats *stats = displaystats_get();
+	unsigned int i;
+
+	bcmgpio_write_uns(RS_PIN, 1);
+
+	for(i = 0; i < n; i++) {
+		bcmgpio_write_mask_uns(DB_PINMASK, words[i]);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 0);
+		bcmgpio_write_uns(RW_PIN, 1);
+	}
+
+	if(stats) {
+		DISPLAYSTATS_ADD(stats, strobes, n);
+		DISPLAYSTATS_ADD(stats, gpioStores, STORES_RS + (unsigned long long) STORES_PER_BYTE * n);
+	}
 }
 
 /**
@@ -172,8 +360,264 @@ void _write_data(char vh, char vl) {
  * @param data Value.
  */
 void _write_comdata(char com, int data) {
+	display_stats *stats = displaystats_get();
+
 	_write_com(com);
 	_write_data(data >> 8, data);
+
+	if(stats)
+		DISPLAYSTATS_ADD(stats, registers, 1);
+}
+
+/**
+ * @brief Request kernel edge events for FMARK, so that edges are timestamped by the kernel even while not waiting.
+ *        Polling FMARK with bcmgpio_read() is used where the GPIO character device is not available.
+ */
+static void _fmark_open(void) {
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	struct gpio_v2_line_request request;
+	int chip = open("/dev/gpiochip0", O_RDONLY);
+
+	if(chip < 0)
+		return;
+
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = FMARK_PIN;
+	request.num_lines = 1;
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING;
+	strcpy(request.consumer, "pidisplaylibs");
+	if(!ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &request)) {
+		fmarkFd = request.fd;
+		fcntl(fmarkFd, F_SETFL, O_NONBLOCK);
+	}
+
+	close(chip);
+#endif
+}
+
+/**
+ * @brief Wait for the next FMARK rising edge.
+ * @return Time of the edge in nanoseconds, or 0 if none came in FMARK_TIMEOUT ms.
+ */
+static uint64_t _fmark_wait(void) {
+	uint64_t deadline = displaystats_now() + FMARK_TIMEOUT * 1000000ULL;
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	struct gpio_v2_line_event event;
+	struct pollfd pfd = {fmarkFd, POLLIN, 0};
+
+	if(fmarkFd >= 0) {
+		if(poll(&pfd, 1, FMARK_TIMEOUT) <= 0 || sizeof(event) != read(fmarkFd, &event, sizeof(event)))
+			return 0;
+		return event.timestamp_ns;
+	}
+#endif
+
+	/* Low first, so that a pulse already going on is not taken for an edge */
+	while(bcmgpio_read(FMARK_PIN)) {
+		if(displaystats_now() > deadline)
+			return 0;
+	}
+	while(!bcmgpio_read(FMARK_PIN)) {
+		if(displaystats_now() > deadline)
+			return 0;
+	}
+
+	return displaystats_now();
+}
+
+/**
+ * @brief Take a new FMARK edge, refining the refresh period against the panel oscillator.
+ */
+static void _fmark_update(uint64_t edge) {
+	uint64_t n = (edge - fmarkLast + fmarkPeriod / 2) / fmarkPeriod;
+
+	if(n && n <= 2 * FMARK_RESYNC)
+		fmarkPeriod = (7 * fmarkPeriod + (edge - fmarkLast) / n) / 8;
+	fmarkLast = edge;
+}
+
+/**
+ * @brief Bring the last FMARK edge up to date: take the newest queued edge event, or wait for an edge once the last
+ *        one is too old to extrapolate from.
+ * @return DISPLAY_OK or DISPLAY_TIMEOUT.
+ */
+static int _fmark_sync(void) {
+	uint64_t edge;
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	struct gpio_v2_line_event event;
+
+	while(fmarkFd >= 0 && sizeof(event) == read(fmarkFd, &event, sizeof(event)))
+		_fmark_update(event.timestamp_ns);
+#endif
+
+	if(displaystats_now() - fmarkLast > FMARK_RESYNC * fmarkPeriod) {
+		edge = _fmark_wait();
+		if(!edge)
+			return DISPLAY_TIMEOUT;
+		_fmark_update(edge);
+	}
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Turn FMARK off and restore the default frame rate.
+ */
+static void _fmark_close(void) {
+	if(fmarkFd >= 0)
+		close(fmarkFd);
+	fmarkFd = -1;
+	vsync = 0;
+
+	/* FMARK function off, frame rate 91Hz */
+	_write_comdata(0x000A, 0x0000);
+	_write_comdata(0x002B, 0x000D);
+	/* Select register for memory write */
+	_write_com(0x0022);
+}
+
+/**
+ * @brief Pull the CS of a panel low, so that it alone listens to the bus.
+ * @param p Panel.
+ */
+static void _select_cs(int p) {
+	display_stats *stats;
+	int i;
+
+	if(p == csPanel)
+		return;
+
+	/* Deselect first, so that two panels never listen at once */
+	if(csPanel < 0) {
+		for(i = 0; i < nPanels; i++)
+			bcmgpio_write_uns(panels[i].cs, 1);
+	}
+	else {
+		bcmgpio_write_uns(panels[csPanel].cs, 1);
+	}
+	bcmgpio_write_uns(panels[p].cs, 0);
+	csPanel = p;
+
+	stats = displaystats_get();
+	if(stats)
+		DISPLAYSTATS_ADD(stats, gpioStores, 2);
+}
+
+/**
+ * @brief Select the panel holding the cursor again, after registers of another panel were written.
+ */
+static void _select_cursor(void) {
+	_select_cs((spanning? curX : winX0) / DISPLAY_XRES);
+}
+
+/**
+ * @brief Set the GRAM window and address of a panel and select it for memory write.
+ * @param p Panel.
+ * @param x0 Leftmost column of the panel.
+ * @param y0 Topmost row.
+ * @param x1 Rightmost column of the panel (inclusive).
+ * @param y1 Bottommost row (inclusive).
+ * @param ax Column of the next pixel.
+ * @param ay Row of the next pixel.
+ */
+static void _panel_window(int p, int x0, int y0, int x1, int y1, int ax, int ay) {
+	int full = !x0 && !y0 && ((DISPLAY_XRES - 1) == x1) && ((DISPLAY_YRES - 1) == y1);
+
+	_select_cs(p);
+
+	/* A full screen window is only written if a smaller one was set */
+	if(!full || windowed[p]) {
+		/**
+		 * GRAM is addressed in portrait: horizontal addresses are screen rows and vertical addresses are mirrored
+		 * screen columns. Since the vertical address is decremented on each write (see register 0x0003), a window row
+		 * is written from x0 to x1
+		 */
+		_write_comdata(0x0050, y0);
+		_write_comdata(0x0051, y1);
+		_write_comdata(0x0052, (DISPLAY_XRES - 1) - x1);
+		_write_comdata(0x0053, (DISPLAY_XRES - 1) - x0);
+		windowed[p] = !full;
+	}
+
+	/* Horizontal GRAM start address */
+	_write_comdata(0x0020, ay);
+	/* Vertical GRAM start address */
+	_write_comdata(0x0021, (DISPLAY_XRES - 1) - ax);
+	/* Select register for memory write */
+	_write_com(0x0022);
+}
+
+/**
+ * @brief Set a window in canvas coordinates. Each panel it covers gets its share of the window, with the address
+ *        where its next pixel goes, so that a row can be sent as consecutive runs, one per panel.
+ * @param x0 Leftmost column.
+ * @param y0 Topmost row.
+ * @param x1 Rightmost column (inclusive).
+ * @param y1 Bottommost row (inclusive).
+ * @param cx Column of the cursor.
+ * @param cy Row of the cursor.
+ */
+static void _canvas_window(int x0, int y0, int x1, int y1, int cx, int cy) {
+	int p, sx0, sx1;
+
+	for(p = x0 / DISPLAY_XRES; p <= x1 / DISPLAY_XRES; p++) {
+		sx0 = ((x0 > p * DISPLAY_XRES)? x0 : p * DISPLAY_XRES) - p * DISPLAY_XRES;
+		sx1 = ((x1 < (p + 1) * DISPLAY_XRES - 1)? x1 : (p + 1) * DISPLAY_XRES - 1) - p * DISPLAY_XRES;
+
+		/* Panels left of the cursor get their next pixel on the following row, the others on the cursor row */
+		if(cx > p * DISPLAY_XRES + sx1)
+			_panel_window(p, sx0, y0, sx1, y1, sx0, (cy == y1)? y0 : cy + 1);
+		else if(cx < p * DISPLAY_XRES + sx0)
+			_panel_window(p, sx0, y0, sx1, y1, sx0, cy);
+		else
+			_panel_window(p, sx0, y0, sx1, y1, cx - p * DISPLAY_XRES, cy);
+	}
+
+	winX0 = x0;
+	winY0 = y0;
+	winX1 = x1;
+	winY1 = y1;
+	curX = cx;
+	curY = cy;
+	spanning = (x0 / DISPLAY_XRES) != (x1 / DISPLAY_XRES);
+	_select_cursor();
+}
+
+/**
+ * @brief Select the panel holding the cursor of a spanning window and move the cursor past the pixels it takes.
+ * @param n Pixels left to write.
+ * @return Pixels to write on the selected panel, up to its edge or the end of the window row.
+ */
+static unsigned int _span_next(unsigned int n) {
+	int p = curX / DISPLAY_XRES;
+	int end = ((p + 1) * DISPLAY_XRES - 1 < winX1)? (p + 1) * DISPLAY_XRES - 1 : winX1;
+
+	if(n > (unsigned int) (end - curX + 1))
+		n = end - curX + 1;
+
+	_select_cs(p);
+
+	curX += n;
+	if(curX > winX1) {
+		curX = winX0;
+		curY = (curY == winY1)? winY0 : curY + 1;
+	}
+
+	return n;
+}
+
+/**
+ * @brief Get the canvas column of the first column being addressed.
+ */
+static inline int _offset(void) {
+	return (DISPLAY_CANVAS == selected)? 0 : selected * DISPLAY_XRES;
+}
+
+/**
+ * @brief Get the amount of columns being addressed.
+ */
+static inline int _width(void) {
+	return (DISPLAY_CANVAS == selected)? nPanels * DISPLAY_XRES : DISPLAY_XRES;
 }
 
 /**
@@ -182,19 +626,55 @@ void _write_comdata(char com, int data) {
  * @param argc Number of elements in args. See specific notes for each driver.
  * @return Return code. See specific notes for each driver.
  *
- * @note For the ili9325 driver, there are no arguments needed. Simply use as display_init(NULL, 0);
+ * @note For the ili9325 driver, display_init(NULL, 0) drives a single panel on CS_PIN and RST_PIN. Several panels
+ *       may share the DB, RS and WR lines, each with its own CS and reset pins: args is then an array of argc
+ *       display_panel (at most MAX_PANELS). Panels are reset and initialised together, and are then addressed as one
+ *       canvas, side by side from left to right in array order (see display_select()).
  *       Possible return codes:
  *           DISPLAY_OK: No errors occurred.
+ *           DISPLAY_INVALID_ARGS: Too many panels, or argc is not positive.
  *           DISPLAY_GPIO_ERROR: An error occurred while initialising bcmgpio. The specific error code is
  *                               masked on the first 2 bytes of the return value.
+ *           DISPLAY_SHM_ERROR: PIDISPLAY_STATS asked for the shared counter page, but it could not be created.
+ *           DISPLAY_TIMEOUT: PIDISPLAY_VSYNC asked for synchronisation, but FMARK is not wired (see
+ *                            display_set_vsync()). The display is usable, without synchronisation.
+ *       Setting PIDISPLAY_TRACE to a file path captures every GPIO store (see bcmgpio_trace_start()) until
+ *       display_finish() writes them to that file. PIDISPLAY_TRACE_RECORDS sets how many stores are kept.
  */
 int display_init(void *args, int argc) {
 	int rv = DISPLAY_OK;
 	int irv;
+	const char *records;
+	int i;
+
+	if(args) {
+		ASSERT((0 < argc) && (argc <= MAX_PANELS), rv = DISPLAY_INVALID_ARGS);
+		memcpy(panels, args, argc * sizeof(display_panel));
+		nPanels = argc;
+	}
+	else {
+		panels[0].cs = CS_PIN;
+		panels[0].rst = RST_PIN;
+		nPanels = 1;
+	}
+	selected = DISPLAY_CANVAS;
+	csPanel = -1;
+	memset(windowed, 0, sizeof(windowed));
+
+	/* Counters and bus capture may be turned on from the environment, so that initialisation is covered too */
+	rv = displaystats_init();
+	ASSERT(DISPLAY_OK == rv, );
+
+	tracePath = getenv("PIDISPLAY_TRACE");
+	if(tracePath) {
+		records = getenv("PIDISPLAY_TRACE_RECORDS");
+		irv = bcmgpio_trace_start(records? strtoul(records, NULL, 0) : TRACE_RECORDS);
+		ASSERT(irv == BCMGPIO_OK, rv = DISPLAY_GPIO_ERROR | irv; tracePath = NULL);
+	}
 
 	/* Initialise bcmgpio */
 	irv = bcmgpio_init();
-	ASSERT(irv == BCMGPIO_OK, rv = DISPLAY_GPIO_ERROR | irv);
+	ASSERT(irv == BCMGPIO_OK, rv = DISPLAY_GPIO_ERROR | irv; bcmgpio_trace_stop(NULL); tracePath = NULL);
 
 	/* Set outputs */
 	bcmgpio_set_direction(RS_PIN, BCMGPIO_DIR_OUT);
@@ -208,19 +688,25 @@ int display_init(void *args, int argc) {
 	bcmgpio_set_direction(DB_PIN5, BCMGPIO_DIR_OUT);
 	bcmgpio_set_direction(DB_PIN6, BCMGPIO_DIR_OUT);
 	bcmgpio_set_direction(DB_PIN7, BCMGPIO_DIR_OUT);
-	bcmgpio_set_direction(CS_PIN, BCMGPIO_DIR_OUT);
-	bcmgpio_set_direction(RST_PIN, BCMGPIO_DIR_OUT);
+	for(i = 0; i < nPanels; i++) {
+		bcmgpio_set_direction(panels[i].cs, BCMGPIO_DIR_OUT);
+		bcmgpio_set_direction(panels[i].rst, BCMGPIO_DIR_OUT);
+	}
 
-	/* Reset display */
-	bcmgpio_write_uns(RST_PIN, 1);
+	/* Reset displays */
+	for(i = 0; i < nPanels; i++)
+		bcmgpio_write_uns(panels[i].rst, 1);
 	usleep(5000);
-	bcmgpio_write_uns(RST_PIN, 0);
+	for(i = 0; i < nPanels; i++)
+		bcmgpio_write_uns(panels[i].rst, 0);
 	usleep(15000);
-	bcmgpio_write_uns(RST_PIN, 1);
+	for(i = 0; i < nPanels; i++)
+		bcmgpio_write_uns(panels[i].rst, 1);
 	usleep(15000);
 
-	/* Select device. Since PiDisplayLibs expects a non-shared bus, this device is kept as enabled */
-	bcmgpio_write_uns(CS_PIN, 0);
+	/* Select every device, so that all of them are initialised at once */
+	for(i = 0; i < nPanels; i++)
+		bcmgpio_write_uns(panels[i].cs, 0);
 
 	/* Set internal timing */
 	_write_comdata(0x00E3, 0x3008);
@@ -335,7 +821,19 @@ int display_init(void *args, int argc) {
 	/* Select register for memory write */
 	_write_com(0x0022);
 
-	//bcmgpio_write_uns(CS_PIN, 1);
+	/* From now on, only the panel being written listens */
+	winX0 = 0;
+	winY0 = 0;
+	winX1 = nPanels * DISPLAY_XRES - 1;
+	winY1 = DISPLAY_YRES - 1;
+	curX = 0;
+	curY = 0;
+	spanning = nPanels > 1;
+	_select_cs(0);
+
+	/* Synchronisation may be turned on from the environment too */
+	if(getenv("PIDISPLAY_VSYNC") && strcmp(getenv("PIDISPLAY_VSYNC"), "0"))
+		rv = display_set_vsync(1);
 
 _err:
 
@@ -348,20 +846,17 @@ _err:
  * @param y Second coordinate.
  * @return Return code. See specific notes for each driver.
  *
- * @note Possible return codes:
+ * @note The window is reset to the whole area being addressed (see display_select()).
+ *       Possible return codes:
  *           DISPLAY_OK: No error checking is performed.
  */
 int display_set_xy(int x, int y) {
-	//bcmgpio_write_uns(CS_PIN, 0);
+	display_stats *stats = displaystats_get();
 
-	/* Horizontal GRAM start address */
-	_write_comdata(0x0020, y);
-	/* Vertical GRAM start address */
-	_write_comdata(0x0021, (DISPLAY_XRES - 1) - x);
-	/* Select register for memory write */
-	_write_com(0x0022);
+	if(stats)
+		DISPLAYSTATS_ADD(stats, readdresses, 1);
 
-	//bcmgpio_write_uns(CS_PIN, 1);
+	_canvas_window(_offset(), 0, _offset() + _width() - 1, DISPLAY_YRES - 1, _offset() + x, y);
 
 	return DISPLAY_OK;
 }
@@ -383,26 +878,432 @@ int display_draw(unsigned char r, unsigned char g, unsigned char b) {
 	 * R7 | R6 | R5 | R4 | R3 | G7 | G6 | G5 | G4 | G3 | G2 | B7 | B6 | B5 | B4 | B3
 	 */
 	int colour = ((r << 8) & 0xF800) | ((g << 3) & 0x7E0) | ((b >> 3) & 0x1F);
+	display_stats *stats = displaystats_get();
 
-	//bcmgpio_write_uns(CS_PIN, 0);
+	if(spanning)
+		_span_next(1);
 
 	/* Write colour to current memory position (i.e. draw pixel) */
 	_write_data((colour >> 8), (colour & 0xFF));
 
-	//bcmgpio_write_uns(CS_PIN, 1);
+	if(stats)
+		DISPLAYSTATS_ADD(stats, pixels, 1);
 
 	return DISPLAY_OK;
 }
 
 /**
- * @brief Close handles, free memory, finish use.
+ * @brief Set a rectangular drawing window and move to its top-left corner.
+ * @param x0 Leftmost column.
+ * @param y0 Topmost row.
+ * @param x1 Rightmost column (inclusive).
+ * @param y1 Bottommost row (inclusive).
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Possible return codes:
+ *           DISPLAY_OK: No errors occurred.
+ *           DISPLAY_INVALID_ARGS: Window is empty or out of the screen.
+ */
+int display_set_window(int x0, int y0, int x1, int y1) {
+	int rv = DISPLAY_OK;
+	display_stats *stats = displaystats_get();
+
+	ASSERT((0 <= x0) && (x0 <= x1) && (x1 < _width()), rv = DISPLAY_INVALID_ARGS);
+	ASSERT((0 <= y0) && (y0 <= y1) && (y1 < DISPLAY_YRES), rv = DISPLAY_INVALID_ARGS);
+
+	if(stats)
+		DISPLAYSTATS_ADD(stats, readdresses, 1);
+
+	_canvas_window(_offset() + x0, y0, _offset() + x1, y1, _offset() + x0, y0);
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Write a sequence of pixels in RGB565 format starting on current memory position.
+ * @param pixels Pixel array. Each element is a colour in RGB565 format.
+ * @param n Number of pixels in the array.
  * @return Return code. See specific notes for each driver.
  *
  * @note Possible return codes:
  *           DISPLAY_OK: No error checking is performed.
  */
+int display_write_rgb565(const unsigned short *pixels, unsigned int n) {
+	display_stats *stats = displaystats_get();
+	uint64_t start = stats? displaystats_now() : 0;
+	unsigned int i, k;
+
+	/* A window spanning panels is sent as runs, switching panels at their edges */
+	if(spanning) {
+		for(i = 0; i < n; i += k) {
+			k = _span_next(n - i);
+			_write_data_seq(pixels + i, k);
+		}
+	}
+	else {
+		_write_data_seq(pixels, n);
+	}
+
+	if(stats)
+		displaystats_transfer(stats, n, start);
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Write the same RGB565 colour n times starting on current memory position.
+ * @param colour Colour in RGB565 format.
+ * @param n Number of pixels.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Possible return codes:
+ *           DISPLAY_OK: No error checking is performed.
+ */
+int display_fill_rgb565(unsigned short colour, unsigned int n) {
+	display_stats *stats = displaystats_get();
+	uint64_t start = stats? displaystats_now() : 0;
+	unsigned int i, k;
+
+	if(spanning) {
+		for(i = 0; i < n; i += k) {
+			k = _span_next(n - i);
+			_write_data_rep(colour, k);
+		}
+	}
+	else {
+		_write_data_rep(colour, n);
+	}
+
+	if(stats)
+		displaystats_transfer(stats, n, start);
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Scroll the screen horizontally using the controller scroll register.
+ * @param offset Scroll offset in columns. Zero disables scrolling.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Screen columns are gate lines on this panel, so the base image scroll (registers 0x0061 and 0x006A) moves the
+ *       picture horizontally. Since the vertical GRAM address is mirrored, scrolling by VL lines shows memory column
+ *       x + offset at screen column x. Each panel scrolls on its own, so a panel must be selected first when there
+ *       are several (see display_select()).
+ *       Possible return codes:
+ *           DISPLAY_OK: No errors occurred.
+ *           DISPLAY_INVALID_ARGS: The canvas spans several panels.
+ */
+int display_scroll(int offset) {
+	int rv = DISPLAY_OK;
+	int p = (DISPLAY_CANVAS == selected)? 0 : selected;
+	int shift;
+
+	ASSERT((DISPLAY_CANVAS != selected) || (1 == nPanels), rv = DISPLAY_INVALID_ARGS);
+
+	offset %= DISPLAY_XRES;
+	if(offset < 0)
+		offset += DISPLAY_XRES;
+	shift = offset? (DISPLAY_XRES - offset) : 0;
+
+	_select_cs(p);
+	/* Base image display control: REV = 1, VLE = 1 if scrolling */
+	_write_comdata(0x0061, offset? 0x0003 : 0x0001);
+	/* Vertical scroll control */
+	_write_comdata(0x006A, shift);
+	/* Select register for memory write */
+	_write_com(0x0022);
+	_select_cursor();
+
+	/* Only the first panel is synchronised */
+	if(!p)
+		scanShift = shift;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Encode RGB565 pixels into the GPIO words that the driver puts on the data bus.
+ * @param pixels Pixel array in RGB565 format.
+ * @param n Number of pixels in the array.
+ * @param words Output array with 2 * n elements.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Possible return codes:
+ *           DISPLAY_OK: No error checking is performed.
+ */
+int display_encode_words(const unsigned short *pixels, unsigned int n, unsigned int *words) {
+	unsigned int i;
+
+	for(i = 0; i < n; i++) {
+		words[2 * i] = scrambleTable[pixels[i] >> 8];
+		words[2 * i + 1] = scrambleTable[pixels[i] & 0xFF];
+	}
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Write a sequence of GPIO words produced by display_encode_words() starting on current memory position.
+ * @param words Word array.
+ * @param n Number of words in the array.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Possible return codes:
+ *           DISPLAY_OK: No error checking is performed.
+ */
+int display_write_words(const unsigned int *words, unsigned int n) {
+	display_stats *stats = displaystats_get();
+	uint64_t start = stats? displaystats_now() : 0;
+	unsigned int i, k;
+
+	/* Two words per pixel */
+	if(spanning) {
+		for(i = 0; i < n / 2; i += k) {
+			k = _span_next(n / 2 - i);
+			_write_words_seq(words + 2 * i, 2 * k);
+		}
+	}
+	else {
+		_write_words_seq(words, n);
+	}
+
+	if(stats)
+		displaystats_transfer(stats, n / 2, start);
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Get an identifier of the data bus pin map.
+ * @param id Pointer where the identifier will be written.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note The identifier is a FNV-1a hash of the scrambled value of each DB bit, so it changes whenever a DB pin does.
+ *       Possible return codes:
+ *           DISPLAY_OK: No error checking is performed.
+ */
+int display_get_bus_id(unsigned int *id) {
+	unsigned int hash = 2166136261u;
+	unsigned int i;
+
+	for(i = 0; i < 8; i++)
+		hash = (hash ^ scrambleDB(1 << i)) * 16777619u;
+
+	*id = hash;
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Get display resolution.
+ * @param xres Pointer where the amount of columns will be written.
+ * @param yres Pointer where the amount of rows will be written.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note The resolution is the one of the area being addressed: a single panel or the whole canvas.
+ *       Possible return codes:
+ *           DISPLAY_OK: No error checking is performed.
+ */
+int display_get_resolution(int *xres, int *yres) {
+	*xres = _width();
+	*yres = DISPLAY_YRES;
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Turn driver counters on or off.
+ * @param flags Zero to stop counting, DISPLAY_STATS_ENABLE to count, plus DISPLAY_STATS_SHARED for the shared page.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Register selections, register writes, pixels, WR strobes and GPIO stores are counted in bulk by the bus
+ *       functions (stores of the bcmgpio checked functions are counted by bcmgpio itself). Pixel transfers are timed.
+ *       Possible return codes:
+ *           DISPLAY_OK: No errors occurred.
+ *           DISPLAY_SHM_ERROR: Shared page could not be created.
+ */
+int display_set_stats(unsigned int flags) {
+	return displaystats_set(flags);
+}
+
+/**
+ * @brief Get driver counters, summed over every thread that used the driver.
+ * @param stats Pointer where the counters will be written.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Possible return codes:
+ *           DISPLAY_OK: No error checking is performed.
+ */
+int display_get_stats(display_stats *stats) {
+	displaystats_sum(displaystats_current, stats);
+
+	return DISPLAY_OK;
+}
+
+/**
+ * @brief Turn tear-free synchronisation on or off.
+ * @param enable Non-zero to turn synchronisation on, zero to turn it off.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note FMARK must be wired to FMARK_PIN. FMARK edges come from kernel edge events if the GPIO character device is
+ *       available, otherwise FMARK is polled while waiting. The panel is switched to its lowest frame rate, so that
+ *       the scan leaves windows alone for longer, and the refresh period is measured; it is then kept in step with
+ *       the panel oscillator from later edges. With several panels, only the first one is synchronised.
+ *       Possible return codes:
+ *           DISPLAY_OK: No errors occurred.
+ *           DISPLAY_TIMEOUT: No FMARK edge was seen (FMARK is probably not wired). Synchronisation stays off.
+ */
+int display_set_vsync(int enable) {
+	int rv = DISPLAY_OK;
+	uint64_t first, edge;
+	int i;
+
+	_select_cs(0);
+	_fmark_close();
+	if(!enable)
+		goto _err;
+
+	/* Lowest frame rate */
+	_write_comdata(0x002B, 0x0000);
+	/* FMARK on, once per frame, at the start of the back porch */
+	_write_comdata(0x000D, 0x0000);
+	_write_comdata(0x000A, 0x0008);
+	/* Select register for memory write */
+	_write_com(0x0022);
+
+	bcmgpio_set_direction(FMARK_PIN, BCMGPIO_DIR_IN);
+	_fmark_open();
+
+	/* Let the new frame rate settle, then time a few refreshes */
+	first = _fmark_wait();
+	first = first? _fmark_wait() : 0;
+	for(i = 0, edge = first; edge && i < FMARK_MEASURE; i++)
+		edge = _fmark_wait();
+	ASSERT(edge && edge > first, rv = DISPLAY_TIMEOUT; _fmark_close());
+
+	fmarkPeriod = (edge - first) / FMARK_MEASURE;
+	fmarkLast = edge;
+	vsync = 1;
+
+_err:
+	_select_cursor();
+
+	return rv;
+}
+
+/**
+ * @brief Wait until a window may be written without tearing.
+ * @param x0 Leftmost column of the window.
+ * @param y0 Topmost row of the window.
+ * @param x1 Rightmost column of the window (inclusive).
+ * @param y1 Bottommost row of the window (inclusive).
+ * @param timestamp Pointer where the time the scan left the window will be written. May be NULL.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Gate lines are screen columns, so only x0 and x1 matter: the wait ends when the scan leaves column x0 (the
+ *       last one it refreshes), or right away if it left it less than an eighth of a refresh ago. A write then has
+ *       until the scan reaches x1 again, i.e. the refresh period minus the share of gate lines the window spans.
+ *       Screen rows are written across every gate line, so windows as wide as the screen cannot avoid the scan; they
+ *       tear once at most if written within two refreshes. The scan position is extrapolated from the last FMARK
+ *       edge and the measured period. FMARK comes from the first panel: windows on other panels are not waited for.
+ *       Possible return codes:
+ *           DISPLAY_OK: No errors occurred.
+ *           DISPLAY_INVALID_ARGS: Synchronisation is off, or window is empty or out of the screen.
+ *           DISPLAY_TIMEOUT: FMARK edges stopped coming.
+ */
+int display_wait_vsync(int x0, int y0, int x1, int y1, unsigned long long *timestamp) {
+	int rv = DISPLAY_OK;
+	uint64_t target, now;
+	struct timespec ts;
+	int line;
+
+	ASSERT(vsync, rv = DISPLAY_INVALID_ARGS);
+	ASSERT((0 <= x0) && (x0 <= x1) && (x1 < _width()), rv = DISPLAY_INVALID_ARGS);
+	ASSERT((0 <= y0) && (y0 <= y1) && (y1 < DISPLAY_YRES), rv = DISPLAY_INVALID_ARGS);
+
+	/* Other panels run on their own oscillators */
+	x0 += _offset();
+	if(x0 >= DISPLAY_XRES) {
+		if(timestamp)
+			*timestamp = displaystats_now();
+		goto _err;
+	}
+
+	rv = _fmark_sync();
+	ASSERT(DISPLAY_OK == rv, );
+
+	/* Gate line showing column x0, after scrolling */
+	line = ((DISPLAY_XRES - 1) - x0 - scanShift + DISPLAY_XRES) % DISPLAY_XRES;
+	target = fmarkLast + (FRAME_BP + line + 1) * fmarkPeriod / FRAME_LINES;
+	now = displaystats_now();
+	while(target + fmarkPeriod / 8 < now)
+		target += fmarkPeriod;
+
+	/* Sleep most of the way, then spin */
+	if(target > now + SPIN_NS) {
+		ts.tv_sec = (target - SPIN_NS) / 1000000000ULL;
+		ts.tv_nsec = (target - SPIN_NS) % 1000000000ULL;
+		while(EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL));
+	}
+	while(displaystats_now() < target)
+		;
+
+	if(timestamp)
+		*timestamp = target;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Select the panel addressed by the following calls.
+ * @param panel Panel index, in display_init() order, or DISPLAY_CANVAS for all panels side by side.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note Coordinates and resolution become those of the selected panel, or of the canvas. The window is left as it was,
+ *       so a window or position should be set right after.
+ *       Possible return codes:
+ *           DISPLAY_OK: No errors occurred.
+ *           DISPLAY_INVALID_ARGS: There is no such panel.
+ */
+int display_select(int panel) {
+	int rv = DISPLAY_OK;
+
+	ASSERT((DISPLAY_CANVAS == panel) || ((0 <= panel) && (panel < nPanels)), rv = DISPLAY_INVALID_ARGS);
+
+	selected = panel;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Close handles, free memory, finish use.
+ * @return Return code. See specific notes for each driver.
+ *
+ * @note The bus trace, if any, is written. The shared counter page, if any, is removed.
+ *       Possible return codes:
+ *           DISPLAY_OK: No error checking is performed.
+ */
 int display_finish(void) {
+	if(fmarkFd >= 0)
+		close(fmarkFd);
+	fmarkFd = -1;
+	vsync = 0;
+
+	if(tracePath) {
+		bcmgpio_trace_stop(tracePath);
+		tracePath = NULL;
+	}
+
 	bcmgpio_finish();
+	displaystats_finish();
 
 	return DISPLAY_OK;
 }
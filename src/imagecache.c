@@ -0,0 +1,449 @@
+/* ********************************************************************************************* */
+/* * Image Cache Library for disk-backed panel-ready images                                    * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#define _GNU_SOURCE
+
+#include "imagecache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "imagedecode.h"
+
+/* Entry file identification */
+#define ENTRY_MAGIC "PDIC"
+#define ENTRY_VERSION 1
+#define ENTRY_SUFFIX ".pdic"
+
+/* Read size for content hashing */
+#define HASH_CHUNK (64 * 1024)
+
+/**
+ * @brief Entry file header. The payload (RGB565 pixels or GPIO words) follows immediately.
+ */
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t busId;
+	uint32_t count;
+	uint32_t reserved;
+} entry_header;
+
+/**
+ * @brief Remembered content hash of a source file, valid while its inode, size and mtime are unchanged.
+ */
+typedef struct {
+	char *path;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+	uint64_t hash;
+} hash_memo;
+
+/**
+ * @brief Entry found while scanning the cache directory for eviction.
+ */
+typedef struct {
+	char name[NAME_MAX + 1];
+	off_t size;
+	struct timespec mtime;
+} scan_entry;
+
+struct imagecache_s {
+	char *dir;
+	display_driver *driver;
+	int format;
+	unsigned long long maxSize;
+	int xres;
+	int yres;
+	unsigned int busId;
+	hash_memo *memos;
+	unsigned int nMemos;
+};
+
+/**
+ * @brief FNV-1a 64-bit hash of a file content. Memoised by path, inode, size and mtime.
+ * @param cache Cache handle.
+ * @param path File path.
+ * @param hash Pointer where the hash will be written.
+ * @return IMAGECACHE_OK, IMAGECACHE_FILE_ERROR or IMAGECACHE_NO_MEMORY.
+ */
+static int _content_hash(imagecache *cache, const char *path, uint64_t *hash) {
+	int rv = IMAGECACHE_OK;
+	struct stat st;
+	FILE *file = NULL;
+	unsigned char *chunk = NULL;
+	size_t n, i;
+	uint64_t h = 14695981039346656037ull;
+	hash_memo *memo = NULL;
+	hash_memo *newMemos;
+
+	ASSERT(0 == stat(path, &st), rv = IMAGECACHE_FILE_ERROR);
+
+	for(i = 0; i < cache->nMemos; i++) {
+		if(!strcmp(cache->memos[i].path, path)) {
+			memo = &(cache->memos[i]);
+			break;
+		}
+	}
+
+	if(memo && memo->dev == st.st_dev && memo->ino == st.st_ino && memo->size == st.st_size &&
+			memo->mtime.tv_sec == st.st_mtim.tv_sec && memo->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+		*hash = memo->hash;
+		return IMAGECACHE_OK;
+	}
+
+	file = fopen(path, "rb");
+	ASSERT(file, rv = IMAGECACHE_FILE_ERROR);
+	chunk = malloc(HASH_CHUNK);
+	ASSERT(chunk, rv = IMAGECACHE_NO_MEMORY);
+
+	while((n = fread(chunk, 1, HASH_CHUNK, file)) > 0) {
+		for(i = 0; i < n; i++)
+			h = (h ^ chunk[i]) * 1099511628211ull;
+	}
+	ASSERT(!ferror(file), rv = IMAGECACHE_FILE_ERROR);
+
+	/* Remember it. Failing to do so only costs a re-hash next time */
+	if(!memo) {
+		newMemos = realloc(cache->memos, (cache->nMemos + 1) * sizeof(hash_memo));
+		if(newMemos) {
+			cache->memos = newMemos;
+			memo = &(cache->memos[cache->nMemos]);
+			memo->path = strdup(path);
+			if(memo->path)
+				cache->nMemos++;
+			else
+				memo = NULL;
+		}
+	}
+	if(memo) {
+		memo->dev = st.st_dev;
+		memo->ino = st.st_ino;
+		memo->size = st.st_size;
+		memo->mtime = st.st_mtim;
+		memo->hash = h;
+	}
+
+	*hash = h;
+
+_err:
+
+	if(chunk)
+		free(chunk);
+
+	if(file)
+		fclose(file);
+
+	return rv;
+}
+
+/**
+ * @brief Compare scanned entries by last use, oldest first.
+ */
+static int _compare_scan(const void *a, const void *b) {
+	const scan_entry *ea = (const scan_entry *) a;
+	const scan_entry *eb = (const scan_entry *) b;
+
+	if(ea->mtime.tv_sec != eb->mtime.tv_sec)
+		return (ea->mtime.tv_sec < eb->mtime.tv_sec)? -1 : 1;
+	if(ea->mtime.tv_nsec != eb->mtime.tv_nsec)
+		return (ea->mtime.tv_nsec < eb->mtime.tv_nsec)? -1 : 1;
+	return 0;
+}
+
+/**
+ * @brief Evict least recently used entries until newSize more bytes fit in the size limit. Last use is the entry mtime,
+ *        which is refreshed on every hit.
+ * @param cache Cache handle.
+ * @param newSize Size of the entry about to be stored.
+ * @return IMAGECACHE_OK or IMAGECACHE_DIR_ERROR.
+ */
+static int _evict(imagecache *cache, unsigned long long newSize) {
+	int rv = IMAGECACHE_OK;
+	DIR *dir = NULL;
+	struct dirent *dirEntry;
+	struct stat st;
+	scan_entry *entries = NULL;
+	scan_entry *newEntries;
+	unsigned int nEntries = 0;
+	unsigned long long total = 0;
+	size_t nameLen;
+	unsigned int i;
+
+	dir = opendir(cache->dir);
+	ASSERT(dir, rv = IMAGECACHE_DIR_ERROR);
+
+	while((dirEntry = readdir(dir))) {
+		nameLen = strlen(dirEntry->d_name);
+		if(nameLen < strlen(ENTRY_SUFFIX) || strcmp(dirEntry->d_name + nameLen - strlen(ENTRY_SUFFIX), ENTRY_SUFFIX))
+			continue;
+		if(fstatat(dirfd(dir), dirEntry->d_name, &st, 0))
+			continue;
+
+		newEntries = realloc(entries, (nEntries + 1) * sizeof(scan_entry));
+		ASSERT(newEntries, rv = IMAGECACHE_NO_MEMORY);
+		entries = newEntries;
+		strcpy(entries[nEntries].name, dirEntry->d_name);
+		entries[nEntries].size = st.st_size;
+		entries[nEntries].mtime = st.st_mtim;
+		total += st.st_size;
+		nEntries++;
+	}
+
+	qsort(entries, nEntries, sizeof(scan_entry), _compare_scan);
+
+	for(i = 0; i < nEntries && total + newSize > cache->maxSize; i++) {
+		if(!unlinkat(dirfd(dir), entries[i].name, 0))
+			total -= entries[i].size;
+	}
+
+_err:
+
+	if(entries)
+		free(entries);
+
+	if(dir)
+		closedir(dir);
+
+	return rv;
+}
+
+/**
+ * @brief Write a new entry. It is written to a temporary file and renamed, so readers never see partial entries.
+ * @param cache Cache handle.
+ * @param entryPath Final entry path.
+ * @param header Entry header.
+ * @param payload Entry payload.
+ * @param payloadSize Payload size in bytes.
+ */
+static void _store(imagecache *cache, const char *entryPath, entry_header *header, const void *payload,
+		size_t payloadSize) {
+	char tmpPath[PATH_MAX];
+	FILE *file = NULL;
+	int ok;
+
+	if(sizeof(entry_header) + payloadSize > cache->maxSize)
+		return;
+	if(IMAGECACHE_OK != _evict(cache, sizeof(entry_header) + payloadSize))
+		return;
+
+	snprintf(tmpPath, PATH_MAX, "%s.tmp%d", entryPath, (int) getpid());
+	file = fopen(tmpPath, "wb");
+	if(!file)
+		return;
+
+	ok = (1 == fwrite(header, sizeof(entry_header), 1, file)) && (1 == fwrite(payload, payloadSize, 1, file));
+	ok = !fclose(file) && ok;
+
+	if(!ok || rename(tmpPath, entryPath))
+		unlink(tmpPath);
+}
+
+/**
+ * @brief Stream an entry payload to the display.
+ */
+static void _transfer(imagecache *cache, int format, const void *payload, unsigned int count) {
+	cache->driver->set_window(0, 0, cache->xres - 1, cache->yres - 1);
+
+	if(IMAGECACHE_FMT_WORDS == format)
+		cache->driver->write_words((const unsigned int *) payload, count);
+	else
+		cache->driver->write_rgb565((const unsigned short *) payload, count);
+}
+
+/**
+ * @brief Show an entry if it exists and is valid.
+ * @return Non-zero on hit.
+ */
+static int _show_entry(imagecache *cache, const char *entryPath) {
+	int fd;
+	struct stat st;
+	void *map = MAP_FAILED;
+	entry_header *header;
+	size_t elemSize = (IMAGECACHE_FMT_WORDS == cache->format)? sizeof(unsigned int) : sizeof(unsigned short);
+	/* Encoded entries hold two bus words per pixel */
+	unsigned int count = cache->xres * cache->yres * ((IMAGECACHE_FMT_WORDS == cache->format)? 2 : 1);
+	int hit = 0;
+
+	fd = open(entryPath, O_RDONLY);
+	if(-1 == fd)
+		return 0;
+
+	ASSERT(0 == fstat(fd, &st) && st.st_size >= (off_t) sizeof(entry_header), );
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	ASSERT(map != MAP_FAILED, );
+
+	header = (entry_header *) map;
+	ASSERT(!memcmp(header->magic, ENTRY_MAGIC, 4) && ENTRY_VERSION == header->version, );
+	ASSERT(header->format == (uint32_t) cache->format, );
+	ASSERT(header->width == (uint32_t) cache->xres && header->height == (uint32_t) cache->yres, );
+	ASSERT(header->count == count, );
+	ASSERT((off_t) (sizeof(entry_header) + count * elemSize) <= st.st_size, );
+
+	_transfer(cache, cache->format, (const char *) map + sizeof(entry_header), count);
+	hit = 1;
+
+	/* Mark as recently used */
+	futimens(fd, NULL);
+
+_err:
+
+	if(map != MAP_FAILED)
+		munmap(map, st.st_size);
+
+	close(fd);
+
+	return hit;
+}
+
+/**
+ * @brief Open an image cache.
+ */
+int imagecache_open(imagecache **cache, const char *dir, display_driver *driver, int format,
+		unsigned long long maxSize) {
+	int rv = IMAGECACHE_OK;
+	imagecache *newCache = NULL;
+
+	ASSERT(IMAGECACHE_FMT_RGB565 == format || IMAGECACHE_FMT_WORDS == format, rv = IMAGECACHE_INVALID_ARGS);
+	ASSERT(0 == mkdir(dir, 0755) || EEXIST == errno, rv = IMAGECACHE_DIR_ERROR);
+
+	newCache = calloc(1, sizeof(imagecache));
+	ASSERT(newCache, rv = IMAGECACHE_NO_MEMORY);
+
+	newCache->dir = strdup(dir);
+	ASSERT(newCache->dir, rv = IMAGECACHE_NO_MEMORY);
+	newCache->driver = driver;
+	newCache->format = format;
+	newCache->maxSize = maxSize;
+	driver->get_resolution(&(newCache->xres), &(newCache->yres));
+
+	/* RGB565 entries do not depend on the pin map */
+	if(IMAGECACHE_FMT_WORDS == format)
+		driver->get_bus_id(&(newCache->busId));
+
+	*cache = newCache;
+	newCache = NULL;
+
+_err:
+
+	if(newCache)
+		imagecache_close(newCache);
+
+	return rv;
+}
+
+/**
+ * @brief Show an image, from the cache if present.
+ */
+int imagecache_show(imagecache *cache, const char *path, int orientation, int mode, int *hit) {
+	int rv = IMAGECACHE_OK;
+	uint64_t hash;
+	char entryPath[PATH_MAX];
+	unsigned int nPixels = cache->xres * cache->yres;
+	unsigned short *pixels = NULL;
+	unsigned int *words = NULL;
+	entry_header header;
+	int irv;
+
+	if(hit)
+		*hit = 0;
+
+	rv = _content_hash(cache, path, &hash);
+	ASSERT(IMAGECACHE_OK == rv, );
+
+	snprintf(entryPath, PATH_MAX, "%s/%016llx-%d%d-%d-%08x" ENTRY_SUFFIX, cache->dir, (unsigned long long) hash,
+		orientation, mode, cache->format, cache->busId);
+
+	if(_show_entry(cache, entryPath)) {
+		if(hit)
+			*hit = 1;
+		return IMAGECACHE_OK;
+	}
+
+	/* Miss: decode, show from memory and store */
+	pixels = malloc(nPixels * sizeof(unsigned short));
+	ASSERT(pixels, rv = IMAGECACHE_NO_MEMORY);
+
+	irv = imagedecode_to_rgb565(path, orientation, mode, pixels, cache->xres, cache->yres, NULL, NULL);
+	ASSERT(IMAGEDECODE_OK == irv, rv = (IMAGEDECODE_FILE_ERROR == irv)? IMAGECACHE_FILE_ERROR :
+		(IMAGEDECODE_NO_MEMORY == irv)? IMAGECACHE_NO_MEMORY : IMAGECACHE_DECODE_ERROR);
+
+	memcpy(header.magic, ENTRY_MAGIC, 4);
+	header.version = ENTRY_VERSION;
+	header.format = cache->format;
+	header.width = cache->xres;
+	header.height = cache->yres;
+	header.busId = cache->busId;
+	header.reserved = 0;
+
+	if(IMAGECACHE_FMT_WORDS == cache->format) {
+		words = malloc(2 * nPixels * sizeof(unsigned int));
+		ASSERT(words, rv = IMAGECACHE_NO_MEMORY);
+		cache->driver->encode_words(pixels, nPixels, words);
+		header.count = 2 * nPixels;
+		_transfer(cache, cache->format, words, header.count);
+		_store(cache, entryPath, &header, words, header.count * sizeof(unsigned int));
+	}
+	else {
+		header.count = nPixels;
+		_transfer(cache, cache->format, pixels, header.count);
+		_store(cache, entryPath, &header, pixels, header.count * sizeof(unsigned short));
+	}
+
+_err:
+
+	if(words)
+		free(words);
+
+	if(pixels)
+		free(pixels);
+
+	return rv;
+}
+
+/**
+ * @brief Close cache.
+ */
+void imagecache_close(imagecache *cache) {
+	unsigned int i;
+
+	for(i = 0; i < cache->nMemos; i++)
+		free(cache->memos[i].path);
+
+	free(cache->memos);
+	free(cache->dir);
+	free(cache);
+}
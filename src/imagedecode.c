@@ -0,0 +1,471 @@
+/* ********************************************************************************************* */
+/* * Image Decode Library for streaming PNG/JPEG decoding                                      * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "imagedecode.h"
+
+#include <png.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* jpeglib.h must come after stdio.h */
+#include <jpeglib.h>
+
+#include "common.h"
+#include "display.h"
+#include "scaler.h"
+
+/* Image types */
+#define TYPE_PNG 0
+#define TYPE_JPEG 1
+
+typedef struct {
+	struct jpeg_error_mgr stdErrorMgr;
+	jmp_buf jmpBuffer;
+} silent_error_mgr;
+
+/**
+ * @brief Destination of scaled rows.
+ */
+typedef struct {
+	unsigned short *out;
+	int xres;
+	int orientation;
+	unsigned int width;
+	unsigned int height;
+} place_arg;
+
+struct imagedecode_s {
+	int type;
+	FILE *file;
+	/* Size of the image, or of the region once set */
+	unsigned int width;
+	unsigned int height;
+	unsigned int row;
+	/* Region state. Decoded rows are rowWidth pixels wide and the region starts at column cropX */
+	bool cropping;
+	unsigned int cropX;
+	unsigned int rowWidth;
+	unsigned int regionY;
+	unsigned char *rowBuffer;
+	/* PNG state */
+	png_structp pngStruct;
+	png_infop pngInfo;
+	unsigned char *pngImage;
+	/* JPEG state */
+	struct jpeg_decompress_struct jpegInfo;
+	silent_error_mgr errorMgr;
+	bool jpegInfoCreated;
+	bool jpegStarted;
+};
+
+METHODDEF(void) silent_error_jump(j_common_ptr jpegInfo) {
+	silent_error_mgr *errorMgr = (silent_error_mgr *) jpegInfo->err;
+	longjmp(errorMgr->jmpBuffer, 1);
+}
+
+/**
+ * @brief Set up libpng for reading dec->file as 8-bit RGB.
+ * @param dec Decoder handle.
+ * @return IMAGEDECODE_OK or IMAGEDECODE_DECODE_ERROR.
+ */
+static int _png_open(imagedecode *dec) {
+	int rv = IMAGEDECODE_OK;
+	int pngDepth, pngColorType;
+	int passes;
+	unsigned int i;
+	png_bytep * volatile rowPointers = NULL;
+
+	dec->pngStruct = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	ASSERT(dec->pngStruct, rv = IMAGEDECODE_NO_MEMORY);
+
+	dec->pngInfo = png_create_info_struct(dec->pngStruct);
+	ASSERT(dec->pngInfo, rv = IMAGEDECODE_NO_MEMORY);
+
+	if(setjmp(png_jmpbuf(dec->pngStruct)))
+		ASSERT(0, rv = IMAGEDECODE_DECODE_ERROR);
+
+	png_init_io(dec->pngStruct, dec->file);
+	png_set_sig_bytes(dec->pngStruct, 8);
+	png_read_info(dec->pngStruct, dec->pngInfo);
+	png_get_IHDR(dec->pngStruct, dec->pngInfo, &(dec->width), &(dec->height), &pngDepth, &pngColorType, NULL, NULL, NULL);
+
+	if(PNG_COLOR_TYPE_PALETTE == pngColorType)
+		png_set_expand(dec->pngStruct);
+	if(PNG_COLOR_TYPE_GRAY == pngColorType && pngDepth < 8)
+		png_set_expand(dec->pngStruct);
+	if(png_get_valid(dec->pngStruct, dec->pngInfo, PNG_INFO_tRNS))
+		png_set_expand(dec->pngStruct);
+
+	if(16 == pngDepth)
+		png_set_strip_16(dec->pngStruct);
+	if(PNG_COLOR_TYPE_GRAY == pngColorType || PNG_COLOR_TYPE_GRAY_ALPHA == pngColorType)
+		png_set_gray_to_rgb(dec->pngStruct);
+	png_set_strip_alpha(dec->pngStruct);
+
+	passes = png_set_interlace_handling(dec->pngStruct);
+	png_read_update_info(dec->pngStruct, dec->pngInfo);
+
+	/* Interlaced images cannot be streamed, so they are decoded as a whole here */
+	if(passes > 1) {
+		dec->pngImage = malloc(dec->width * dec->height * 3);
+		ASSERT(dec->pngImage, rv = IMAGEDECODE_NO_MEMORY);
+		rowPointers = malloc(dec->height * sizeof(png_bytep));
+		ASSERT(rowPointers, rv = IMAGEDECODE_NO_MEMORY);
+		for(i = 0; i < dec->height; i++)
+			rowPointers[i] = dec->pngImage + i * dec->width * 3;
+		png_read_image(dec->pngStruct, rowPointers);
+	}
+
+_err:
+
+	if(rowPointers)
+		free(rowPointers);
+
+	return rv;
+}
+
+/**
+ * @brief Set up libjpeg for reading dec->file as RGB. Only the header is read.
+ * @param dec Decoder handle.
+ * @return IMAGEDECODE_OK or IMAGEDECODE_DECODE_ERROR.
+ */
+static int _jpeg_open(imagedecode *dec) {
+	int rv = IMAGEDECODE_OK;
+
+	dec->jpegInfo.err = jpeg_std_error(&(dec->errorMgr.stdErrorMgr));
+	dec->errorMgr.stdErrorMgr.error_exit = silent_error_jump;
+	if(setjmp(dec->errorMgr.jmpBuffer))
+		ASSERT(0, rv = IMAGEDECODE_DECODE_ERROR);
+
+	jpeg_create_decompress(&(dec->jpegInfo));
+	dec->jpegInfoCreated = true;
+	jpeg_stdio_src(&(dec->jpegInfo), dec->file);
+
+	jpeg_read_header(&(dec->jpegInfo), true);
+	dec->jpegInfo.out_color_space = JCS_RGB;
+
+	/* Decompression is started on the first row, so that a region can still be set */
+	dec->width = dec->jpegInfo.image_width;
+	dec->height = dec->jpegInfo.image_height;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Open an image file for row-by-row decoding.
+ */
+int imagedecode_open(const char *path, imagedecode **dec) {
+	int rv = IMAGEDECODE_OK;
+	imagedecode *newDec = NULL;
+	unsigned char signature[8];
+
+	newDec = calloc(1, sizeof(imagedecode));
+	ASSERT(newDec, rv = IMAGEDECODE_NO_MEMORY);
+
+	newDec->file = fopen(path, "rb");
+	ASSERT(newDec->file, rv = IMAGEDECODE_FILE_ERROR);
+
+	ASSERT(8 == fread(signature, 1, 8, newDec->file), rv = IMAGEDECODE_INVALID_FORMAT);
+
+	if(png_check_sig(signature, 8)) {
+		newDec->type = TYPE_PNG;
+		rv = _png_open(newDec);
+	}
+	else if(0xFF == signature[0] && 0xD8 == signature[1]) {
+		newDec->type = TYPE_JPEG;
+		rewind(newDec->file);
+		rv = _jpeg_open(newDec);
+	}
+	else {
+		rv = IMAGEDECODE_INVALID_FORMAT;
+	}
+	ASSERT(IMAGEDECODE_OK == rv, );
+	newDec->rowWidth = newDec->width;
+
+	*dec = newDec;
+	newDec = NULL;
+
+_err:
+
+	if(newDec)
+		imagedecode_close(newDec);
+
+	return rv;
+}
+
+/**
+ * @brief Get image dimensions.
+ */
+void imagedecode_get_size(imagedecode *dec, unsigned int *width, unsigned int *height) {
+	*width = dec->width;
+	*height = dec->height;
+}
+
+/**
+ * @brief Restrict decoding to a region of the image.
+ */
+int imagedecode_set_region(imagedecode *dec, unsigned int shrink, unsigned int x, unsigned int y, unsigned int w,
+		unsigned int h, unsigned int *applied) {
+	int rv = IMAGEDECODE_OK;
+	unsigned int scale = 1;
+	unsigned int x1, y1;
+#ifdef LIBJPEG_TURBO_VERSION_NUMBER
+	JDIMENSION xOffset, cropWidth;
+#else
+	JSAMPROW jpegRow;
+#endif
+
+	ASSERT(0 == dec->row && !dec->cropping && !dec->jpegStarted, rv = IMAGEDECODE_INVALID_ARGS);
+	ASSERT(w && h && x < dec->width && y < dec->height, rv = IMAGEDECODE_INVALID_ARGS);
+	x1 = (x + w < dec->width)? x + w : dec->width;
+	y1 = (y + h < dec->height)? y + h : dec->height;
+
+	if(TYPE_PNG == dec->type) {
+		dec->rowBuffer = malloc(dec->width * 3);
+		ASSERT(dec->rowBuffer, rv = IMAGEDECODE_NO_MEMORY);
+
+		/* Rows above the region still have to be decoded, unless the image was already decoded as a whole */
+		if(!dec->pngImage) {
+			if(setjmp(png_jmpbuf(dec->pngStruct)))
+				ASSERT(0, rv = IMAGEDECODE_DECODE_ERROR);
+
+			for(dec->regionY = 0; dec->regionY < y; dec->regionY++)
+				png_read_row(dec->pngStruct, dec->rowBuffer, NULL);
+		}
+
+		dec->regionY = y;
+		dec->cropX = x;
+		dec->rowWidth = dec->width;
+	}
+	else {
+		/* Let the DCT reduce by up to 8 */
+		while(scale < 8 && 2 * scale <= shrink)
+			scale *= 2;
+
+		if(setjmp(dec->errorMgr.jmpBuffer))
+			ASSERT(0, rv = IMAGEDECODE_DECODE_ERROR);
+
+		dec->jpegInfo.scale_num = 1;
+		dec->jpegInfo.scale_denom = scale;
+		jpeg_start_decompress(&(dec->jpegInfo));
+		dec->jpegStarted = true;
+
+		/* From now on, coordinates are in the scaled image */
+		x1 = (x1 + scale - 1) / scale;
+		y1 = (y1 + scale - 1) / scale;
+		x1 = (x1 < dec->jpegInfo.output_width)? x1 : dec->jpegInfo.output_width;
+		y1 = (y1 < dec->jpegInfo.output_height)? y1 : dec->jpegInfo.output_height;
+
+#ifdef LIBJPEG_TURBO_VERSION_NUMBER
+		/* libjpeg-turbo decodes only the iMCU columns covering the region and skips rows above it */
+		xOffset = x / scale;
+		cropWidth = x1 - x / scale;
+		jpeg_crop_scanline(&(dec->jpegInfo), &xOffset, &cropWidth);
+		dec->cropX = x / scale - xOffset;
+		dec->rowWidth = dec->jpegInfo.output_width;
+
+		dec->rowBuffer = malloc(dec->rowWidth * 3);
+		ASSERT(dec->rowBuffer, rv = IMAGEDECODE_NO_MEMORY);
+
+		if(y / scale)
+			jpeg_skip_scanlines(&(dec->jpegInfo), y / scale);
+#else
+		dec->cropX = x / scale;
+		dec->rowWidth = dec->jpegInfo.output_width;
+
+		dec->rowBuffer = malloc(dec->rowWidth * 3);
+		ASSERT(dec->rowBuffer, rv = IMAGEDECODE_NO_MEMORY);
+
+		jpegRow = dec->rowBuffer;
+		while(dec->jpegInfo.output_scanline < y / scale)
+			jpeg_read_scanlines(&(dec->jpegInfo), &jpegRow, 1);
+#endif
+	}
+
+	dec->cropping = true;
+	dec->width = x1 - x / scale;
+	dec->height = y1 - y / scale;
+
+	if(applied)
+		*applied = scale;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Decode next row of the image.
+ */
+int imagedecode_read_row(imagedecode *dec, unsigned char *row) {
+	int rv = IMAGEDECODE_OK;
+	unsigned char *dst = dec->cropping? dec->rowBuffer : row;
+	JSAMPROW jpegRow = dst;
+
+	ASSERT(dec->row < dec->height, rv = IMAGEDECODE_DECODE_ERROR);
+
+	if(TYPE_PNG == dec->type) {
+		if(dec->pngImage) {
+			memcpy(dst, dec->pngImage + (dec->regionY + dec->row) * dec->rowWidth * 3, dec->rowWidth * 3);
+		}
+		else {
+			if(setjmp(png_jmpbuf(dec->pngStruct)))
+				ASSERT(0, rv = IMAGEDECODE_DECODE_ERROR);
+
+			png_read_row(dec->pngStruct, dst, NULL);
+		}
+	}
+	else {
+		if(setjmp(dec->errorMgr.jmpBuffer))
+			ASSERT(0, rv = IMAGEDECODE_DECODE_ERROR);
+
+		if(!dec->jpegStarted) {
+			jpeg_start_decompress(&(dec->jpegInfo));
+			dec->jpegStarted = true;
+		}
+
+		jpeg_read_scanlines(&(dec->jpegInfo), &jpegRow, 1);
+	}
+
+	if(dec->cropping)
+		memcpy(row, dec->rowBuffer + 3 * dec->cropX, 3 * dec->width);
+
+	dec->row++;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Close decoder and free its resources.
+ */
+void imagedecode_close(imagedecode *dec) {
+	if(dec->pngStruct || dec->pngInfo)
+		png_destroy_read_struct(&(dec->pngStruct), &(dec->pngInfo), NULL);
+
+	if(dec->pngImage)
+		free(dec->pngImage);
+
+	if(dec->rowBuffer)
+		free(dec->rowBuffer);
+
+	/* Decompression is aborted rather than finished, since not all rows may have been read */
+	if(dec->jpegInfoCreated)
+		jpeg_destroy_decompress(&(dec->jpegInfo));
+
+	if(dec->file)
+		fclose(dec->file);
+
+	free(dec);
+}
+
+/**
+ * @brief Scaler output callback: place a row of the upright image on the panel according to orientation.
+ */
+static void _place_row(void *arg, unsigned int y, const unsigned char *row) {
+	place_arg *place = (place_arg *) arg;
+	unsigned int j;
+	int px, py;
+
+	for(j = 0; j < place->width; j++) {
+		switch(place->orientation) {
+			case 1:
+				px = place->height - y - 1;
+				py = j;
+				break;
+			case 2:
+				px = place->width - j - 1;
+				py = place->height - y - 1;
+				break;
+			case 3:
+				px = y;
+				py = place->width - j - 1;
+				break;
+			default:
+				px = j;
+				py = y;
+				break;
+		}
+
+		place->out[py * place->xres + px] = DISPLAY_RGB565(row[3 * j], row[3 * j + 1], row[3 * j + 2]);
+	}
+}
+
+/**
+ * @brief Decode an image straight into a panel-ready RGB565 buffer.
+ */
+int imagedecode_to_rgb565(const char *path, int orientation, int mode, unsigned short *out, int xres, int yres,
+		imagedecode_cancel_fn cancel, void *cancelArg) {
+	int rv = IMAGEDECODE_OK;
+	imagedecode *dec = NULL;
+	scaler *sc = NULL;
+	unsigned char *row = NULL;
+	unsigned int width, height;
+	place_arg place;
+	int filter;
+	unsigned int i;
+
+	rv = imagedecode_open(path, &dec);
+	ASSERT(IMAGEDECODE_OK == rv, );
+	imagedecode_get_size(dec, &width, &height);
+
+	row = malloc(width * 3);
+	ASSERT(row, rv = IMAGEDECODE_NO_MEMORY);
+
+	/* The image is scaled upright, so the target is transposed for orientations 1 and 3 */
+	place.out = out;
+	place.xres = xres;
+	place.orientation = orientation;
+	place.width = (orientation & 1)? yres : xres;
+	place.height = (orientation & 1)? xres : yres;
+
+	/* Box filtering gives better quality when reducing at least by half */
+	filter = (width >= 2 * place.width && height >= 2 * place.height)? SCALER_FILTER_BOX : SCALER_FILTER_BILINEAR;
+	ASSERT(SCALER_OK == scaler_create(&sc, width, height, place.width, place.height, mode, filter, _place_row, &place),
+		rv = IMAGEDECODE_NO_MEMORY);
+
+	for(i = 0; i < height && !scaler_done(sc); i++) {
+		ASSERT(!cancel || !cancel(cancelArg), rv = IMAGEDECODE_CANCELLED);
+
+		rv = imagedecode_read_row(dec, row);
+		ASSERT(IMAGEDECODE_OK == rv, );
+
+		scaler_push_row(sc, row);
+	}
+
+_err:
+
+	if(sc)
+		scaler_destroy(sc);
+
+	if(row)
+		free(row);
+
+	if(dec)
+		imagedecode_close(dec);
+
+	return rv;
+}
@@ -0,0 +1,381 @@
+/* ********************************************************************************************* */
+/* * Page Store Library for compressed screens                                                 * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "pagestore.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/* Token opcodes (top bits) and count (bottom bits). A literal is followed by its pixels, a run by its colour */
+#define OP_LITERAL 0x0000
+#define OP_RUN 0x4000
+#define OP_COPY 0x8000
+#define OP_MASK 0xC000
+#define COUNT_MASK 0x3FFF
+
+/* Addressing cost of one window, in pixel times (window registers plus the memory write command) */
+#define WINDOW_COST 16
+
+/**
+ * @brief Compressed page.
+ */
+typedef struct {
+	uint16_t *data;
+	size_t words;
+} page;
+
+/**
+ * @brief Streaming decoder state.
+ */
+typedef struct {
+	const uint16_t *p;
+	unsigned int op;
+	unsigned int left;
+	uint16_t colour;
+} decoder;
+
+struct pagestore_s {
+	display_driver *driver;
+	int xres;
+	int yres;
+	page *pages;
+	int nPages;
+	/* Compressed contents of the screen, and the old contents of a replaced page if they are still shown */
+	const uint16_t *screen;
+	uint16_t *orphan;
+	uint16_t *newLine;
+	uint16_t *oldLine;
+	int16_t *spanX0;
+	int16_t *spanX1;
+};
+
+/**
+ * @brief Compress a screen-sized image.
+ * @return PAGESTORE_OK or PAGESTORE_NO_MEMORY.
+ */
+static int _encode(pagestore *ps, const uint16_t *pixels, int stride, page *pg) {
+	int w = ps->xres;
+	int n = ps->xres * ps->yres;
+	int p = 0, lit = -1, r, u;
+	size_t out = 0;
+	uint16_t *buf;
+
+#define AT(i) (pixels[((i) / w) * stride + (i) % w])
+
+	/* Worst case is all literals */
+	buf = malloc((n + n / COUNT_MASK + 1) * sizeof(uint16_t));
+	if(!buf)
+		return PAGESTORE_NO_MEMORY;
+
+	while(p < n) {
+		uint16_t c = AT(p);
+
+		for(r = 1; p + r < n && r < COUNT_MASK && AT(p + r) == c; r++)
+			;
+		for(u = 0; p >= w && p + u < n && u < COUNT_MASK && AT(p + u) == AT(p + u - w); u++)
+			;
+
+		/* Copies take one word, runs two, literals one per pixel */
+		if(u >= 2 && u >= r) {
+			buf[out++] = OP_COPY | u;
+			p += u;
+			lit = -1;
+		}
+		else if(r >= 3) {
+			buf[out++] = OP_RUN | r;
+			buf[out++] = c;
+			p += r;
+			lit = -1;
+		}
+		else {
+			if(lit < 0 || (buf[lit] & COUNT_MASK) == COUNT_MASK) {
+				lit = out;
+				buf[out++] = OP_LITERAL;
+			}
+			buf[lit]++;
+			buf[out++] = c;
+			p++;
+		}
+	}
+
+#undef AT
+
+	pg->data = realloc(buf, out * sizeof(uint16_t));
+	pg->data = pg->data? pg->data : buf;
+	pg->words = out;
+
+	return PAGESTORE_OK;
+}
+
+/**
+ * @brief Decode the next line of a page. The line buffer must hold the previous line of the same page.
+ */
+static void _decode_line(decoder *d, uint16_t *line, int width) {
+	int x = 0;
+	unsigned int i, n;
+
+	while(x < width) {
+		if(!(d->left)) {
+			uint16_t token = *(d->p++);
+
+			d->op = token & OP_MASK;
+			d->left = token & COUNT_MASK;
+			if(OP_RUN == d->op)
+				d->colour = *(d->p++);
+		}
+
+		n = ((unsigned int) (width - x) < d->left)? (unsigned int) (width - x) : d->left;
+		switch(d->op) {
+			case OP_RUN:
+				for(i = 0; i < n; i++)
+					line[x + i] = d->colour;
+				break;
+			case OP_LITERAL:
+				memcpy(&(line[x]), d->p, n * sizeof(uint16_t));
+				d->p += n;
+				break;
+			default:
+				/* Pixels from the line above are already in place */
+				break;
+		}
+		x += n;
+		d->left -= n;
+	}
+}
+
+/**
+ * @brief Change the screen contents, freeing the old contents of a replaced page once they are gone.
+ */
+static void _set_screen(pagestore *ps, const uint16_t *data) {
+	if(ps->orphan && ps->orphan != data) {
+		free(ps->orphan);
+		ps->orphan = NULL;
+	}
+	ps->screen = data;
+}
+
+/**
+ * @brief Create a page store.
+ */
+int pagestore_create(pagestore **ps, display_driver *driver) {
+	int rv = PAGESTORE_OK;
+	pagestore *newPs = NULL;
+
+	newPs = calloc(1, sizeof(pagestore));
+	ASSERT(newPs, rv = PAGESTORE_NO_MEMORY);
+	newPs->driver = driver;
+	driver->get_resolution(&(newPs->xres), &(newPs->yres));
+
+	newPs->newLine = malloc(newPs->xres * sizeof(uint16_t));
+	ASSERT(newPs->newLine, rv = PAGESTORE_NO_MEMORY);
+	newPs->oldLine = malloc(newPs->xres * sizeof(uint16_t));
+	ASSERT(newPs->oldLine, rv = PAGESTORE_NO_MEMORY);
+	newPs->spanX0 = malloc(newPs->yres * sizeof(int16_t));
+	ASSERT(newPs->spanX0, rv = PAGESTORE_NO_MEMORY);
+	newPs->spanX1 = malloc(newPs->yres * sizeof(int16_t));
+	ASSERT(newPs->spanX1, rv = PAGESTORE_NO_MEMORY);
+
+	*ps = newPs;
+
+_err:
+	if(rv != PAGESTORE_OK && newPs)
+		pagestore_destroy(newPs);
+
+	return rv;
+}
+
+/**
+ * @brief Compress and add a page.
+ */
+int pagestore_add(pagestore *ps, const unsigned short *pixels, int stride, int *id) {
+	int rv = PAGESTORE_OK;
+	page *newPages;
+	page pg;
+
+	if(!pixels || stride < ps->xres)
+		return PAGESTORE_INVALID_ARGS;
+
+	rv = _encode(ps, pixels, stride, &pg);
+	if(rv != PAGESTORE_OK)
+		return rv;
+
+	newPages = realloc(ps->pages, (ps->nPages + 1) * sizeof(page));
+	if(!newPages) {
+		free(pg.data);
+		return PAGESTORE_NO_MEMORY;
+	}
+	ps->pages = newPages;
+	ps->pages[ps->nPages] = pg;
+	*id = (ps->nPages)++;
+
+	return PAGESTORE_OK;
+}
+
+/**
+ * @brief Replace the contents of a page.
+ */
+int pagestore_replace(pagestore *ps, int id, const unsigned short *pixels, int stride) {
+	int rv = PAGESTORE_OK;
+	page *pg;
+	page newPg;
+
+	if(id < 0 || id >= ps->nPages || !pixels || stride < ps->xres)
+		return PAGESTORE_INVALID_ARGS;
+	pg = &(ps->pages[id]);
+
+	rv = _encode(ps, pixels, stride, &newPg);
+	if(rv != PAGESTORE_OK)
+		return rv;
+
+	/* Old contents stay alive while shown, to diff against */
+	if(ps->screen == pg->data)
+		ps->orphan = pg->data;
+	else
+		free(pg->data);
+	*pg = newPg;
+
+	return PAGESTORE_OK;
+}
+
+/**
+ * @brief Show a page.
+ */
+int pagestore_show(pagestore *ps, int id, unsigned int *pixels) {
+	unsigned int sent = 0, cost = 0, full = ps->xres * ps->yres;
+	int diff = 0, open = 0, x0, x1, y;
+	decoder newD, oldD;
+	page *pg;
+
+	if(pixels)
+		*pixels = 0;
+	if(id < 0 || id >= ps->nPages)
+		return PAGESTORE_INVALID_ARGS;
+	pg = &(ps->pages[id]);
+	if(ps->screen == pg->data)
+		return PAGESTORE_OK;
+
+	/* Changed span of each line, and what sending only them would cost */
+	if(ps->screen) {
+		memset(&newD, 0, sizeof(decoder));
+		memset(&oldD, 0, sizeof(decoder));
+		newD.p = pg->data;
+		oldD.p = ps->screen;
+
+		for(y = 0; y < ps->yres && cost < full; y++) {
+			_decode_line(&newD, ps->newLine, ps->xres);
+			_decode_line(&oldD, ps->oldLine, ps->xres);
+
+			for(x0 = 0; x0 < ps->xres && ps->newLine[x0] == ps->oldLine[x0]; x0++)
+				;
+			for(x1 = ps->xres - 1; x1 > x0 && ps->newLine[x1] == ps->oldLine[x1]; x1--)
+				;
+			ps->spanX0[y] = x0;
+			ps->spanX1[y] = x1;
+			if(x0 < ps->xres) {
+				cost += x1 - x0 + 1;
+				if(!y || ps->spanX0[y - 1] != x0 || ps->spanX1[y - 1] != x1)
+					cost += WINDOW_COST;
+			}
+		}
+		diff = cost < full;
+	}
+
+	memset(&newD, 0, sizeof(decoder));
+	newD.p = pg->data;
+
+	if(diff) {
+		/* Changed spans only; consecutive lines with the same span continue the open window */
+		for(y = 0; y < ps->yres; y++) {
+			_decode_line(&newD, ps->newLine, ps->xres);
+			x0 = ps->spanX0[y];
+			x1 = ps->spanX1[y];
+			if(x0 >= ps->xres) {
+				open = 0;
+				continue;
+			}
+
+			if(!open || ps->spanX0[y - 1] != x0 || ps->spanX1[y - 1] != x1)
+				ps->driver->set_window(x0, y, x1, ps->yres - 1);
+			open = 1;
+			ps->driver->write_rgb565(&(ps->newLine[x0]), x1 - x0 + 1);
+			sent += x1 - x0 + 1;
+		}
+	}
+	else {
+		ps->driver->set_window(0, 0, ps->xres - 1, ps->yres - 1);
+		for(y = 0; y < ps->yres; y++) {
+			_decode_line(&newD, ps->newLine, ps->xres);
+			ps->driver->write_rgb565(ps->newLine, ps->xres);
+		}
+		sent = full;
+	}
+
+	_set_screen(ps, pg->data);
+	if(pixels)
+		*pixels = sent;
+
+	return PAGESTORE_OK;
+}
+
+/**
+ * @brief Forget what is on screen.
+ */
+void pagestore_invalidate(pagestore *ps) {
+	_set_screen(ps, NULL);
+}
+
+/**
+ * @brief Get the memory taken by compressed pages.
+ */
+size_t pagestore_get_size(pagestore *ps) {
+	size_t size = 0;
+	int i;
+
+	for(i = 0; i < ps->nPages; i++)
+		size += ps->pages[i].words * sizeof(uint16_t);
+
+	return size;
+}
+
+/**
+ * @brief Free page store and its pages.
+ */
+void pagestore_destroy(pagestore *ps) {
+	int i;
+
+	for(i = 0; i < ps->nPages; i++)
+		free(ps->pages[i].data);
+	if(ps->pages)
+		free(ps->pages);
+	if(ps->orphan)
+		free(ps->orphan);
+	if(ps->newLine)
+		free(ps->newLine);
+	if(ps->oldLine)
+		free(ps->oldLine);
+	if(ps->spanX0)
+		free(ps->spanX0);
+	if(ps->spanX1)
+		free(ps->spanX1);
+	free(ps);
+}
@@ -0,0 +1,826 @@
+/* ********************************************************************************************* */
+/* * Raster Library for 2D primitives                                                          * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "raster.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "rgb565.h"
+
+/* Sub-pixel precision of coordinates (24.8 fixed-point) */
+#define FRAC 8
+#define ONE (1 << FRAC)
+
+/* Sub-lines sampled per line when anti-aliasing */
+#define SUB 4
+
+/* Paint kinds */
+#define PAINT_SOLID 0
+#define PAINT_LINEAR 1
+#define PAINT_RADIAL 2
+
+/**
+ * @brief First quarter of a sine wave in 16.16, 257 entries.
+ */
+static const int32_t sineTable[257] = {
+	0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+	3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+	6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+	9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+	12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+	15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+	19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+	22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+	25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+	28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+	30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+	33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+	36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+	39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+	41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+	44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+	46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+	48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+	50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+	52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+	54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+	56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+	57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+	59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+	60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+	61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+	62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+	63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+	64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+	64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+	65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+	65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+	65536,
+};
+
+/**
+ * @brief Path edge, oriented downwards. Dir is +1 if the original edge went down, -1 otherwise.
+ */
+typedef struct {
+	int32_t x0;
+	int32_t y0;
+	int32_t x1;
+	int32_t y1;
+	int dir;
+} edge;
+
+/**
+ * @brief Edge crossing of a sampled line.
+ */
+typedef struct {
+	int32_t x;
+	int dir;
+} crossing;
+
+struct raster_s {
+	display_driver *driver;
+	uint16_t *pixels;
+	int width;
+	int height;
+	int stride;
+	int clipX0;
+	int clipY0;
+	int clipX1;
+	int clipY1;
+	int antialias;
+	uint16_t background;
+	int paint;
+	uint16_t colour;
+	int gx;
+	int gy;
+	int gdx;
+	int gdy;
+	uint64_t gScale;
+	uint16_t ramp[256];
+	int32_t *points;
+	unsigned int nPoints;
+	unsigned int capPoints;
+	unsigned int *contours;
+	unsigned int nContours;
+	unsigned int capContours;
+	edge *edges;
+	unsigned int capEdges;
+	crossing *crossings;
+	uint16_t *cov;
+	uint16_t *row;
+	int winOpen;
+	int winX0;
+	int winX1;
+	int winNextY;
+};
+
+/**
+ * @brief Quarter sine lookup with linear interpolation.
+ * @param u Angle in 1/65536 turns, from 0 to 16384.
+ * @return Sine in 16.16.
+ */
+static int32_t _quarter(unsigned int u) {
+	unsigned int i = u >> 6;
+	int32_t f = u & 63;
+
+	if(i >= 256)
+		return sineTable[256];
+
+	return sineTable[i] + (((sineTable[i + 1] - sineTable[i]) * f) >> 6);
+}
+
+/**
+ * @brief Sine in 16.16 of an angle in 1/65536 turns.
+ */
+static int32_t _sin(unsigned int a) {
+	unsigned int u = a & 0x3FFF;
+
+	switch((a >> 14) & 3) {
+		case 0:
+			return _quarter(u);
+		case 1:
+			return _quarter(16384 - u);
+		case 2:
+			return -_quarter(u);
+		default:
+			return -_quarter(16384 - u);
+	}
+}
+
+/**
+ * @brief Cosine in 16.16 of an angle in 1/65536 turns.
+ */
+static int32_t _cos(unsigned int a) {
+	return _sin(a + 16384);
+}
+
+/**
+ * @brief Integer square root.
+ */
+static uint32_t _isqrt(uint64_t v) {
+	uint64_t res = 0;
+	uint64_t bit = 1ull << 62;
+
+	while(bit > v)
+		bit >>= 2;
+
+	while(bit) {
+		if(v >= res + bit) {
+			v -= res + bit;
+			res = (res >> 1) + bit;
+		}
+		else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return res;
+}
+
+/**
+ * @brief Paint colour at a pixel.
+ */
+static uint16_t _paint(raster *r, int x, int y) {
+	int64_t num;
+	int dx, dy;
+	uint32_t t;
+
+	switch(r->paint) {
+		case PAINT_LINEAR:
+			num = (int64_t) (x - r->gx) * r->gdx + (int64_t) (y - r->gy) * r->gdy;
+			if(num <= 0)
+				return r->ramp[0];
+			t = ((uint64_t) num * r->gScale) >> 32;
+			return r->ramp[(t > 255)? 255 : t];
+		case PAINT_RADIAL:
+			dx = x - r->gx;
+			dy = y - r->gy;
+			t = ((uint64_t) _isqrt(((uint64_t) (dx * dx + dy * dy)) << 8) * r->gScale) >> 32;
+			return r->ramp[(t > 255)? 255 : t];
+		default:
+			return r->colour;
+	}
+}
+
+/**
+ * @brief Build gradient ramp between two colours.
+ */
+static void _ramp(raster *r, uint16_t c0, uint16_t c1) {
+	unsigned int i;
+
+	for(i = 0; i < 256; i++)
+		r->ramp[i] = rgb565_blend(c1, c0, ((i * 256 + 127) / 255) >> 3);
+}
+
+/**
+ * @brief Send a span to the target.
+ * @param r Rasteriser handle.
+ * @param y Line.
+ * @param x0 First pixel.
+ * @param x1 Last pixel (inclusive).
+ * @param px Pixels, or NULL for a span of the solid colour.
+ */
+static void _emit(raster *r, int y, int x0, int x1, const uint16_t *px) {
+	int i;
+
+	if(r->pixels) {
+		uint16_t *dst = &(r->pixels[y * r->stride + x0]);
+
+		if(px)
+			memcpy(dst, px, (x1 - x0 + 1) * sizeof(uint16_t));
+		else
+			for(i = 0; i <= x1 - x0; i++)
+				dst[i] = r->colour;
+		return;
+	}
+
+	/* Spans continuing the open window need no addressing */
+	if(!(r->winOpen && r->winX0 == x0 && r->winX1 == x1 && r->winNextY == y)) {
+		r->driver->set_window(x0, y, x1, r->clipY1);
+		r->winOpen = 1;
+		r->winX0 = x0;
+		r->winX1 = x1;
+	}
+	r->winNextY = y + 1;
+
+	if(px)
+		r->driver->write_rgb565(px, x1 - x0 + 1);
+	else
+		r->driver->fill_rgb565(r->colour, x1 - x0 + 1);
+}
+
+/**
+ * @brief Start a new path.
+ */
+static void _path_begin(raster *r) {
+	r->nPoints = 0;
+	r->nContours = 0;
+}
+
+/**
+ * @brief Add a point to the path, starting a new contour if requested. Coordinates are 24.8 fixed-point.
+ * @return RASTER_OK or RASTER_NO_MEMORY.
+ */
+static int _path_add(raster *r, int32_t x, int32_t y, int newContour) {
+	void *newData;
+
+	if(newContour) {
+		if(r->nContours == r->capContours) {
+			newData = realloc(r->contours, (r->capContours + 8) * sizeof(unsigned int));
+			if(!newData)
+				return RASTER_NO_MEMORY;
+			r->contours = newData;
+			r->capContours += 8;
+		}
+		r->contours[(r->nContours)++] = r->nPoints;
+	}
+
+	if(r->nPoints == r->capPoints) {
+		newData = realloc(r->points, 2 * (r->capPoints + 64) * sizeof(int32_t));
+		if(!newData)
+			return RASTER_NO_MEMORY;
+		r->points = newData;
+		r->capPoints += 64;
+	}
+	r->points[2 * r->nPoints] = x;
+	r->points[2 * r->nPoints + 1] = y;
+	r->nPoints++;
+
+	return RASTER_OK;
+}
+
+/**
+ * @brief Add a circular arc to the path.
+ * @param r Rasteriser handle.
+ * @param cx Centre X (24.8).
+ * @param cy Centre Y (24.8).
+ * @param radius Radius (24.8).
+ * @param start Start angle in 1/65536 turns.
+ * @param sweep Sweep in 1/65536 turns (negative for counter-clockwise).
+ * @param newContour Non-zero to start a new contour with the first point.
+ * @return RASTER_OK or RASTER_NO_MEMORY.
+ */
+static int _path_arc(raster *r, int32_t cx, int32_t cy, int32_t radius, int32_t start, int32_t sweep,
+		int newContour) {
+	int rv = RASTER_OK;
+	int n, i;
+
+	/* Segments for a full turn grow with the square root of the radius, keeping chord error under 1/4 pixel */
+	n = 8 * (_isqrt(radius >> FRAC) + 1);
+	n = (n * (sweep < 0? -sweep : sweep)) >> 16;
+	if(n < 2)
+		n = 2;
+
+	for(i = 0; i <= n && RASTER_OK == rv; i++) {
+		uint32_t a = start + (int32_t) (((int64_t) sweep * i) / n);
+
+		rv = _path_add(r, cx + (int32_t) (((int64_t) radius * _cos(a)) >> 16),
+				cy + (int32_t) (((int64_t) radius * _sin(a)) >> 16), newContour && !i);
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Accumulate a sampled span into the coverage line.
+ * @param r Rasteriser handle.
+ * @param xa Span start (24.8).
+ * @param xb Span end (24.8).
+ * @param minX Pointer to the leftmost covered pixel, updated.
+ * @param maxX Pointer to the rightmost covered pixel, updated.
+ */
+static void _accumulate(raster *r, int32_t xa, int32_t xb, int *minX, int *maxX) {
+	int32_t lo = r->clipX0 * ONE;
+	int32_t hi = (r->clipX1 + 1) * ONE;
+	int pa, pb, i;
+
+	if(r->antialias) {
+		xa = (xa < lo)? lo : xa;
+		xb = (xb > hi)? hi : xb;
+		if(xb <= xa)
+			return;
+
+		/* Exact horizontal coverage, each sub-line weighs 1/SUB */
+		pa = xa >> FRAC;
+		pb = (xb - 1) >> FRAC;
+		if(pa == pb) {
+			r->cov[pa] += (xb - xa) / SUB;
+		}
+		else {
+			r->cov[pa] += (((pa + 1) * ONE) - xa) / SUB;
+			for(i = pa + 1; i < pb; i++)
+				r->cov[i] += ONE / SUB;
+			r->cov[pb] += (xb - (pb * ONE)) / SUB;
+		}
+	}
+	else {
+		/* Pixels whose centre is inside */
+		pa = (xa + ONE / 2 - 1) >> FRAC;
+		pb = ((xb + ONE / 2 - 1) >> FRAC) - 1;
+		pa = (pa < r->clipX0)? r->clipX0 : pa;
+		pb = (pb > r->clipX1)? r->clipX1 : pb;
+		if(pb < pa)
+			return;
+
+		for(i = pa; i <= pb; i++)
+			r->cov[i] = ONE;
+	}
+
+	*minX = (pa < *minX)? pa : *minX;
+	*maxX = (pb > *maxX)? pb : *maxX;
+}
+
+/**
+ * @brief Fill the current path with the non-zero rule and send its spans.
+ * @return RASTER_OK or RASTER_NO_MEMORY.
+ */
+static int _fill_path(raster *r) {
+	unsigned int nEdges = 0, c, i, j, nCross;
+	int32_t minY = INT32_MAX, maxY = INT32_MIN;
+	int y, y0, y1, s, samples, x, minX, maxX, winding;
+	edge *newEdges;
+	crossing *newCrossings;
+
+	if(!(r->nPoints))
+		return RASTER_OK;
+
+	if(r->nPoints > r->capEdges) {
+		newEdges = realloc(r->edges, r->nPoints * sizeof(edge));
+		if(!newEdges)
+			return RASTER_NO_MEMORY;
+		r->edges = newEdges;
+		newCrossings = realloc(r->crossings, r->nPoints * sizeof(crossing));
+		if(!newCrossings)
+			return RASTER_NO_MEMORY;
+		r->crossings = newCrossings;
+		r->capEdges = r->nPoints;
+	}
+
+	/* Edges of every contour, closing each one */
+	for(c = 0; c < r->nContours; c++) {
+		unsigned int first = r->contours[c];
+		unsigned int last = (c + 1 < r->nContours)? r->contours[c + 1] : r->nPoints;
+
+		for(i = first; i < last; i++) {
+			unsigned int k = (i + 1 < last)? i + 1 : first;
+			int32_t ax = r->points[2 * i], ay = r->points[2 * i + 1];
+			int32_t bx = r->points[2 * k], by = r->points[2 * k + 1];
+			edge *e = &(r->edges[nEdges]);
+
+			if(ay == by)
+				continue;
+
+			e->dir = (ay < by)? 1 : -1;
+			e->x0 = (ay < by)? ax : bx;
+			e->y0 = (ay < by)? ay : by;
+			e->x1 = (ay < by)? bx : ax;
+			e->y1 = (ay < by)? by : ay;
+			minY = (e->y0 < minY)? e->y0 : minY;
+			maxY = (e->y1 > maxY)? e->y1 : maxY;
+			nEdges++;
+		}
+	}
+	if(!nEdges)
+		return RASTER_OK;
+
+	y0 = minY >> FRAC;
+	y1 = (maxY - 1) >> FRAC;
+	y0 = (y0 < r->clipY0)? r->clipY0 : y0;
+	y1 = (y1 > r->clipY1)? r->clipY1 : y1;
+	samples = r->antialias? SUB : 1;
+	r->winOpen = 0;
+
+	for(y = y0; y <= y1; y++) {
+		minX = INT32_MAX;
+		maxX = INT32_MIN;
+
+		for(s = 0; s < samples; s++) {
+			int32_t sy = y * ONE + ((2 * s + 1) * ONE) / (2 * samples);
+
+			/* Crossings of this sub-line, sorted by X */
+			nCross = 0;
+			for(i = 0; i < nEdges; i++) {
+				edge *e = &(r->edges[i]);
+				int32_t cx;
+
+				if(sy < e->y0 || sy >= e->y1)
+					continue;
+
+				cx = e->x0 + (int32_t) (((int64_t) (sy - e->y0) * (e->x1 - e->x0)) / (e->y1 - e->y0));
+				for(j = nCross; j > 0 && r->crossings[j - 1].x > cx; j--)
+					r->crossings[j] = r->crossings[j - 1];
+				r->crossings[j].x = cx;
+				r->crossings[j].dir = e->dir;
+				nCross++;
+			}
+
+			/* Non-zero winding spans, covered from a crossing to the next one */
+			for(i = 0, winding = 0; i + 1 < nCross; i++) {
+				winding += r->crossings[i].dir;
+				if(winding)
+					_accumulate(r, r->crossings[i].x, r->crossings[i + 1].x, &minX, &maxX);
+			}
+		}
+
+		if(minX > maxX)
+			continue;
+
+		/* Send covered runs, blending partial pixels */
+		for(x = minX; x <= maxX; ) {
+			int start, solid = (PAINT_SOLID == r->paint);
+
+			while(x <= maxX && !(r->cov[x]))
+				x++;
+			start = x;
+			while(x <= maxX && r->cov[x]) {
+				unsigned int cov = (r->cov[x] > ONE)? ONE : r->cov[x];
+				uint16_t colour = _paint(r, x, y);
+
+				if(cov < ONE) {
+					uint16_t dst = r->pixels? r->pixels[y * r->stride + x] : r->background;
+
+					colour = rgb565_blend(colour, dst, cov >> 3);
+					solid = 0;
+				}
+				r->row[x] = colour;
+				r->cov[x] = 0;
+				x++;
+			}
+
+			if(x > start)
+				_emit(r, y, start, x - 1, solid? NULL : &(r->row[start]));
+		}
+	}
+
+	return RASTER_OK;
+}
+
+/**
+ * @brief Common initialisation.
+ */
+static int _create(raster **r, display_driver *driver, unsigned short *pixels, int width, int height, int stride) {
+	int rv = RASTER_OK;
+	raster *newR = NULL;
+
+	newR = calloc(1, sizeof(raster));
+	ASSERT(newR, rv = RASTER_NO_MEMORY);
+	newR->driver = driver;
+	newR->pixels = pixels;
+	newR->width = width;
+	newR->height = height;
+	newR->stride = stride;
+	newR->clipX1 = width - 1;
+	newR->clipY1 = height - 1;
+	newR->antialias = 1;
+	newR->colour = 0xFFFF;
+
+	/* Coverage has a spare entry, as partial pixels may end one past the clip */
+	newR->cov = calloc(width + 1, sizeof(uint16_t));
+	ASSERT(newR->cov, rv = RASTER_NO_MEMORY);
+	newR->row = malloc(width * sizeof(uint16_t));
+	ASSERT(newR->row, rv = RASTER_NO_MEMORY);
+
+	*r = newR;
+
+_err:
+	if(rv != RASTER_OK && newR)
+		raster_destroy(newR);
+
+	return rv;
+}
+
+/**
+ * @brief Create a rasteriser drawing on the display.
+ */
+int raster_create(raster **r, display_driver *driver) {
+	int xres, yres;
+
+	driver->get_resolution(&xres, &yres);
+
+	return _create(r, driver, NULL, xres, yres, xres);
+}
+
+/**
+ * @brief Create a rasteriser drawing on an RGB565 buffer.
+ */
+int raster_create_buffer(raster **r, unsigned short *pixels, int width, int height, int stride) {
+	if(!pixels || width <= 0 || height <= 0 || stride < width)
+		return RASTER_INVALID_ARGS;
+
+	return _create(r, NULL, pixels, width, height, stride);
+}
+
+/**
+ * @brief Restrict drawing to a rectangle.
+ */
+void raster_set_clip(raster *r, int x0, int y0, int x1, int y1) {
+	r->clipX0 = (x0 > 0)? x0 : 0;
+	r->clipY0 = (y0 > 0)? y0 : 0;
+	r->clipX1 = (x1 < r->width - 1)? x1 : r->width - 1;
+	r->clipY1 = (y1 < r->height - 1)? y1 : r->height - 1;
+}
+
+/**
+ * @brief Enable or disable anti-aliasing.
+ */
+void raster_set_antialias(raster *r, int enable) {
+	r->antialias = enable;
+}
+
+/**
+ * @brief Set the colour anti-aliased edges are blended against.
+ */
+void raster_set_background(raster *r, unsigned short colour) {
+	r->background = colour;
+}
+
+/**
+ * @brief Paint following shapes with a solid colour.
+ */
+void raster_set_solid(raster *r, unsigned short colour) {
+	r->paint = PAINT_SOLID;
+	r->colour = colour;
+}
+
+/**
+ * @brief Paint following shapes with a linear gradient.
+ */
+void raster_set_linear(raster *r, int x0, int y0, int x1, int y1, unsigned short c0, unsigned short c1) {
+	uint64_t len2 = (int64_t) (x1 - x0) * (x1 - x0) + (int64_t) (y1 - y0) * (y1 - y0);
+
+	r->paint = PAINT_LINEAR;
+	r->gx = x0;
+	r->gy = y0;
+	r->gdx = x1 - x0;
+	r->gdy = y1 - y0;
+	r->gScale = len2? (255ull << 32) / len2 + 1 : 0;
+	_ramp(r, c0, c1);
+}
+
+/**
+ * @brief Paint following shapes with a radial gradient.
+ */
+void raster_set_radial(raster *r, int cx, int cy, int radius, unsigned short c0, unsigned short c1) {
+	r->paint = PAINT_RADIAL;
+	r->gx = cx;
+	r->gy = cy;
+
+	/* Distances come in 1/16 pixels */
+	r->gScale = (radius > 0)? (255ull << 32) / (16 * (uint64_t) radius) + 1 : 0;
+	_ramp(r, c0, c1);
+}
+
+/**
+ * @brief Fill a rectangle.
+ */
+int raster_fill_rect(raster *r, int x, int y, int w, int h) {
+	int x0 = (x > r->clipX0)? x : r->clipX0;
+	int y0 = (y > r->clipY0)? y : r->clipY0;
+	int x1 = (x + w - 1 < r->clipX1)? x + w - 1 : r->clipX1;
+	int y1 = (y + h - 1 < r->clipY1)? y + h - 1 : r->clipY1;
+	int i;
+
+	if(x1 < x0 || y1 < y0)
+		return RASTER_OK;
+
+	/* Solid rectangles are a single window fill */
+	if(PAINT_SOLID == r->paint) {
+		if(r->pixels) {
+			for(i = y0; i <= y1; i++)
+				_emit(r, i, x0, x1, NULL);
+		}
+		else {
+			r->driver->set_window(x0, y0, x1, y1);
+			r->driver->fill_rgb565(r->colour, (x1 - x0 + 1) * (y1 - y0 + 1));
+			r->winOpen = 0;
+		}
+		return RASTER_OK;
+	}
+
+	_path_begin(r);
+	if(_path_add(r, x * ONE, y * ONE, 1) || _path_add(r, (x + w) * ONE, y * ONE, 0) ||
+			_path_add(r, (x + w) * ONE, (y + h) * ONE, 0) || _path_add(r, x * ONE, (y + h) * ONE, 0))
+		return RASTER_NO_MEMORY;
+
+	return _fill_path(r);
+}
+
+/**
+ * @brief Fill a rectangle with rounded corners.
+ */
+int raster_fill_round_rect(raster *r, int x, int y, int w, int h, int radius) {
+	int32_t rad, x0, y0, x1, y1;
+
+	if(w <= 0 || h <= 0)
+		return RASTER_OK;
+
+	radius = (radius > w / 2)? w / 2 : radius;
+	radius = (radius > h / 2)? h / 2 : radius;
+	if(radius <= 0)
+		return raster_fill_rect(r, x, y, w, h);
+
+	rad = radius * ONE;
+	x0 = x * ONE + rad;
+	y0 = y * ONE + rad;
+	x1 = ((x + w) * ONE) - rad;
+	y1 = ((y + h) * ONE) - rad;
+
+	/* Corners clockwise from the top-left one, angles clockwise from +X */
+	_path_begin(r);
+	if(_path_arc(r, x0, y0, rad, 32768, 16384, 1) || _path_arc(r, x1, y0, rad, 49152, 16384, 0) ||
+			_path_arc(r, x1, y1, rad, 0, 16384, 0) || _path_arc(r, x0, y1, rad, 16384, 16384, 0))
+		return RASTER_NO_MEMORY;
+
+	return _fill_path(r);
+}
+
+/**
+ * @brief Fill a circle centred on a pixel.
+ */
+int raster_fill_circle(raster *r, int cx, int cy, int radius) {
+	if(radius <= 0)
+		return RASTER_OK;
+
+	_path_begin(r);
+	if(_path_arc(r, cx * ONE + ONE / 2, cy * ONE + ONE / 2, radius * ONE, 0, 65536, 1))
+		return RASTER_NO_MEMORY;
+
+	return _fill_path(r);
+}
+
+/**
+ * @brief Draw an arc centred on a pixel.
+ */
+int raster_arc(raster *r, int cx, int cy, int radius, int width, int start, int sweep) {
+	int32_t x = cx * ONE + ONE / 2;
+	int32_t y = cy * ONE + ONE / 2;
+	int32_t outer = radius * ONE + width * ONE / 2;
+	int32_t inner = outer - width * ONE;
+	int32_t a0, a1;
+
+	if(width <= 0 || radius <= 0)
+		return RASTER_INVALID_ARGS;
+	if(!sweep)
+		return RASTER_OK;
+	inner = (inner > 0)? inner : 0;
+
+	_path_begin(r);
+
+	/* Ring: outer contour clockwise, inner one counter-clockwise, so the middle is not covered */
+	if(sweep >= 360 || sweep <= -360) {
+		if(_path_arc(r, x, y, outer, 0, 65536, 1) || (inner && _path_arc(r, x, y, inner, 0, -65536, 1)))
+			return RASTER_NO_MEMORY;
+		return _fill_path(r);
+	}
+
+	if(sweep < 0) {
+		start += sweep;
+		sweep = -sweep;
+	}
+	a0 = (int32_t) (((int64_t) start * 65536) / 360);
+	a1 = (int32_t) (((int64_t) sweep * 65536) / 360);
+
+	if(_path_arc(r, x, y, outer, a0, a1, 1))
+		return RASTER_NO_MEMORY;
+	if(inner) {
+		if(_path_arc(r, x, y, inner, a0 + a1, -a1, 0))
+			return RASTER_NO_MEMORY;
+	}
+	else if(_path_add(r, x, y, 0)) {
+		return RASTER_NO_MEMORY;
+	}
+
+	return _fill_path(r);
+}
+
+/**
+ * @brief Draw a line between two pixel centres.
+ */
+int raster_line(raster *r, int x0, int y0, int x1, int y1, int width) {
+	int64_t dx = (int64_t) (x1 - x0) * ONE;
+	int64_t dy = (int64_t) (y1 - y0) * ONE;
+	int32_t half = width * ONE / 2;
+	int32_t len = _isqrt(dx * dx + dy * dy);
+	int32_t ax = x0 * ONE + ONE / 2, ay = y0 * ONE + ONE / 2;
+	int32_t bx = x1 * ONE + ONE / 2, by = y1 * ONE + ONE / 2;
+	int32_t ux, uy;
+
+	if(width <= 0)
+		return RASTER_INVALID_ARGS;
+
+	/* Half-width vector along the line (a single point becomes a square) */
+	if(len) {
+		ux = (int32_t) ((dx * half) / len);
+		uy = (int32_t) ((dy * half) / len);
+	}
+	else {
+		ux = half;
+		uy = 0;
+	}
+
+	/* Square ends: extend both ends by half the width, then offset sideways */
+	_path_begin(r);
+	if(_path_add(r, ax - ux - uy, ay - uy + ux, 1) || _path_add(r, bx + ux - uy, by + uy + ux, 0) ||
+			_path_add(r, bx + ux + uy, by + uy - ux, 0) || _path_add(r, ax - ux + uy, ay - uy - ux, 0))
+		return RASTER_NO_MEMORY;
+
+	return _fill_path(r);
+}
+
+/**
+ * @brief Fill a polygon with the non-zero winding rule.
+ */
+int raster_fill_polygon(raster *r, const int *points, unsigned int n) {
+	unsigned int i;
+
+	if(n < 3)
+		return RASTER_INVALID_ARGS;
+
+	_path_begin(r);
+	for(i = 0; i < n; i++) {
+		if(_path_add(r, points[2 * i] * ONE, points[2 * i + 1] * ONE, !i))
+			return RASTER_NO_MEMORY;
+	}
+
+	return _fill_path(r);
+}
+
+/**
+ * @brief Free rasteriser.
+ */
+void raster_destroy(raster *r) {
+	if(r->points)
+		free(r->points);
+	if(r->contours)
+		free(r->contours);
+	if(r->edges)
+		free(r->edges);
+	if(r->crossings)
+		free(r->crossings);
+	if(r->cov)
+		free(r->cov);
+	if(r->row)
+		free(r->row);
+	free(r);
+}
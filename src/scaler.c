@@ -0,0 +1,418 @@
+/* ********************************************************************************************* */
+/* * Scaler Library for streaming fixed-point image scaling                                    * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "scaler.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/* Amount of destination pixels processed per block in the horizontal pass. Keeps gather buffers in L1 */
+#define BLOCK_SIZE 64
+
+/**
+ * @brief 8 x 16-bit vector. GCC lowers operations on this type to NEON on ARM and SSE2 on x86.
+ */
+typedef uint16_t v8u16 __attribute__((vector_size(16)));
+
+/**
+ * @brief Sampling tables for one axis. For bilinear sampling, destination i blends source start[i] and end[i] with
+ *        weight[i] / 256 of the latter. For box sampling, destination i averages source [start[i], end[i]) and
+ *        weight[i] is the 16.16 reciprocal of the span length.
+ */
+typedef struct {
+	int box;
+	unsigned int *start;
+	unsigned int *end;
+	uint32_t *weight;
+} axis;
+
+struct scaler_s {
+	unsigned int srcWidth;
+	unsigned int srcHeight;
+	unsigned int dstWidth;
+	unsigned int dstHeight;
+	/* Destination rectangle covered by the source */
+	unsigned int dx0;
+	unsigned int dy0;
+	unsigned int dw;
+	unsigned int dh;
+	axis xAxis;
+	axis yAxis;
+	/* Horizontally scaled rows (dw * 3 components). Two are kept for bilinear, indexed by source row parity */
+	uint16_t *hRows[2];
+	/* Vertically scaled row */
+	uint16_t *vRow;
+	/* Vertical box accumulator */
+	uint32_t *acc;
+	/* Horizontal pass gather buffers */
+	uint16_t *gatherA;
+	uint16_t *gatherB;
+	uint16_t *gatherW;
+	/* Output row (dstWidth * 3), padding included */
+	unsigned char *out;
+	unsigned int srcRow;
+	unsigned int dstRow;
+	scaler_emit_fn emit;
+	void *emitArg;
+};
+
+/**
+ * @brief Build sampling tables mapping a source span onto d destination pixels.
+ * @param ax Axis to be filled.
+ * @param srcDim Source dimension, for clamping.
+ * @param s0 Source span start, 16.16 fixed-point.
+ * @param ss Source span length, 16.16 fixed-point.
+ * @param d Destination span length.
+ * @param filter Requested filter.
+ * @return SCALER_OK or SCALER_NO_MEMORY.
+ */
+static int _setup_axis(axis *ax, unsigned int srcDim, uint64_t s0, uint64_t ss, unsigned int d, int filter) {
+	int rv = SCALER_OK;
+	uint64_t step = ss / d;
+	int64_t u;
+	unsigned int i;
+
+	ax->box = (SCALER_FILTER_BOX == filter) && (ss >= ((uint64_t) d << 16));
+	ax->start = malloc(d * sizeof(unsigned int));
+	ASSERT(ax->start, rv = SCALER_NO_MEMORY);
+	ax->end = malloc(d * sizeof(unsigned int));
+	ASSERT(ax->end, rv = SCALER_NO_MEMORY);
+	ax->weight = malloc(d * sizeof(uint32_t));
+	ASSERT(ax->weight, rv = SCALER_NO_MEMORY);
+
+	for(i = 0; i < d; i++) {
+		if(ax->box) {
+			ax->start[i] = (s0 + step * i) >> 16;
+			ax->end[i] = (s0 + step * (i + 1)) >> 16;
+			if(ax->end[i] <= ax->start[i])
+				ax->end[i] = ax->start[i] + 1;
+			if(ax->end[i] > srcDim)
+				ax->end[i] = srcDim;
+			ax->weight[i] = 65536 / (ax->end[i] - ax->start[i]);
+		}
+		else {
+			/* Sample at pixel centres */
+			u = (int64_t) (s0 + step * i + step / 2) - 32768;
+			if(u < 0)
+				u = 0;
+			if(u > ((int64_t) (srcDim - 1) << 16))
+				u = (int64_t) (srcDim - 1) << 16;
+			ax->start[i] = u >> 16;
+			ax->end[i] = (ax->start[i] + 1 < srcDim)? ax->start[i] + 1 : ax->start[i];
+			ax->weight[i] = (u >> 8) & 0xFF;
+		}
+	}
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Blend two arrays with per-element weights: out = (a * (256 - w) + b * w) / 256. All values are at most 255,
+ *        so intermediate results fit in 16 bits.
+ */
+static void _lerp_elems(const uint16_t *a, const uint16_t *b, const uint16_t *w, uint16_t *out, unsigned int n) {
+	unsigned int i = 0;
+	v8u16 va, vb, vw;
+	const v8u16 v256 = {256, 256, 256, 256, 256, 256, 256, 256};
+	const v8u16 vRound = {128, 128, 128, 128, 128, 128, 128, 128};
+
+	for(; i + 8 <= n; i += 8) {
+		memcpy(&va, a + i, sizeof(v8u16));
+		memcpy(&vb, b + i, sizeof(v8u16));
+		memcpy(&vw, w + i, sizeof(v8u16));
+		va = (va * (v256 - vw) + vb * vw + vRound) >> 8;
+		memcpy(out + i, &va, sizeof(v8u16));
+	}
+
+	for(; i < n; i++)
+		out[i] = (a[i] * (256 - w[i]) + b[i] * w[i] + 128) >> 8;
+}
+
+/**
+ * @brief Blend two arrays with a constant weight. See _lerp_elems().
+ */
+static void _lerp_rows(const uint16_t *a, const uint16_t *b, uint16_t w, uint16_t *out, unsigned int n) {
+	unsigned int i = 0;
+	v8u16 va, vb;
+	const v8u16 vw = {w, w, w, w, w, w, w, w};
+	const v8u16 viw = (v8u16) {256, 256, 256, 256, 256, 256, 256, 256} - vw;
+	const v8u16 vRound = {128, 128, 128, 128, 128, 128, 128, 128};
+
+	for(; i + 8 <= n; i += 8) {
+		memcpy(&va, a + i, sizeof(v8u16));
+		memcpy(&vb, b + i, sizeof(v8u16));
+		va = (va * viw + vb * vw + vRound) >> 8;
+		memcpy(out + i, &va, sizeof(v8u16));
+	}
+
+	for(; i < n; i++)
+		out[i] = (a[i] * (256 - w) + b[i] * w + 128) >> 8;
+}
+
+/**
+ * @brief Horizontal pass: scale a source row into dw * 3 16-bit components.
+ */
+static void _scale_row(scaler *sc, const unsigned char *row, uint16_t *hRow) {
+	axis *ax = &(sc->xAxis);
+	unsigned int i, j, k, n;
+	uint32_t sum[3];
+
+	if(ax->box) {
+		for(i = 0; i < sc->dw; i++) {
+			sum[0] = sum[1] = sum[2] = 0;
+			for(j = ax->start[i]; j < ax->end[i]; j++) {
+				sum[0] += row[3 * j];
+				sum[1] += row[3 * j + 1];
+				sum[2] += row[3 * j + 2];
+			}
+			hRow[3 * i] = (sum[0] * ax->weight[i] + 32768) >> 16;
+			hRow[3 * i + 1] = (sum[1] * ax->weight[i] + 32768) >> 16;
+			hRow[3 * i + 2] = (sum[2] * ax->weight[i] + 32768) >> 16;
+		}
+	}
+	else {
+		/* Gather samples for a block of destination pixels, then blend them with vector operations */
+		for(i = 0; i < sc->dw; i += BLOCK_SIZE) {
+			n = (sc->dw - i < BLOCK_SIZE)? sc->dw - i : BLOCK_SIZE;
+
+			for(j = 0; j < n; j++) {
+				for(k = 0; k < 3; k++) {
+					sc->gatherA[3 * j + k] = row[3 * ax->start[i + j] + k];
+					sc->gatherB[3 * j + k] = row[3 * ax->end[i + j] + k];
+					sc->gatherW[3 * j + k] = ax->weight[i + j];
+				}
+			}
+
+			_lerp_elems(sc->gatherA, sc->gatherB, sc->gatherW, hRow + 3 * i, 3 * n);
+		}
+	}
+}
+
+/**
+ * @brief Emit a destination row made of scaled components, with padding.
+ */
+static void _emit_row(scaler *sc, const uint16_t *vRow) {
+	unsigned int i;
+	unsigned char *out = sc->out + 3 * sc->dx0;
+
+	for(i = 0; i < 3 * sc->dw; i++)
+		out[i] = vRow[i];
+
+	sc->emit(sc->emitArg, sc->dy0 + sc->dstRow, sc->out);
+	sc->dstRow++;
+}
+
+/**
+ * @brief Emit black rows in the range [from, to).
+ */
+static void _emit_padding(scaler *sc, unsigned int from, unsigned int to) {
+	unsigned int i;
+
+	memset(sc->out, 0, 3 * sc->dstWidth);
+	for(i = from; i < to; i++)
+		sc->emit(sc->emitArg, i, sc->out);
+}
+
+/**
+ * @brief Create a streaming scaler.
+ */
+int scaler_create(scaler **sc, unsigned int srcWidth, unsigned int srcHeight, unsigned int dstWidth,
+		unsigned int dstHeight, int mode, int filter, scaler_emit_fn emit, void *emitArg) {
+	int rv = SCALER_OK;
+	scaler *newSc = NULL;
+	uint64_t sx0 = 0, sy0 = 0;
+	uint64_t sw = (uint64_t) srcWidth << 16, sh = (uint64_t) srcHeight << 16;
+
+	ASSERT(srcWidth && srcHeight && dstWidth && dstHeight, rv = SCALER_INVALID_ARGS);
+	ASSERT(mode >= SCALER_MODE_NONE && mode <= SCALER_MODE_STRETCH, rv = SCALER_INVALID_ARGS);
+	ASSERT(SCALER_FILTER_BILINEAR == filter || SCALER_FILTER_BOX == filter, rv = SCALER_INVALID_ARGS);
+
+	newSc = calloc(1, sizeof(scaler));
+	ASSERT(newSc, rv = SCALER_NO_MEMORY);
+
+	newSc->srcWidth = srcWidth;
+	newSc->srcHeight = srcHeight;
+	newSc->dstWidth = dstWidth;
+	newSc->dstHeight = dstHeight;
+	newSc->dw = dstWidth;
+	newSc->dh = dstHeight;
+	newSc->emit = emit;
+	newSc->emitArg = emitArg;
+
+	/* Compute destination rectangle and the source rectangle mapped onto it */
+	switch(mode) {
+		case SCALER_MODE_NONE:
+			newSc->dw = (srcWidth < dstWidth)? srcWidth : dstWidth;
+			newSc->dh = (srcHeight < dstHeight)? srcHeight : dstHeight;
+			sw = (uint64_t) newSc->dw << 16;
+			sh = (uint64_t) newSc->dh << 16;
+			break;
+		case SCALER_MODE_FIT:
+			if((uint64_t) srcWidth * dstHeight <= (uint64_t) dstWidth * srcHeight) {
+				newSc->dw = ((uint64_t) srcWidth * dstHeight) / srcHeight;
+				newSc->dw = newSc->dw? newSc->dw : 1;
+				newSc->dx0 = (dstWidth - newSc->dw) / 2;
+			}
+			else {
+				newSc->dh = ((uint64_t) srcHeight * dstWidth) / srcWidth;
+				newSc->dh = newSc->dh? newSc->dh : 1;
+				newSc->dy0 = (dstHeight - newSc->dh) / 2;
+			}
+			break;
+		case SCALER_MODE_FILL:
+			if((uint64_t) srcWidth * dstHeight > (uint64_t) dstWidth * srcHeight) {
+				sw = (((uint64_t) srcHeight << 16) * dstWidth) / dstHeight;
+				sx0 = (((uint64_t) srcWidth << 16) - sw) / 2;
+			}
+			else {
+				sh = (((uint64_t) srcWidth << 16) * dstHeight) / dstWidth;
+				sy0 = (((uint64_t) srcHeight << 16) - sh) / 2;
+			}
+			break;
+	}
+
+	rv = _setup_axis(&(newSc->xAxis), srcWidth, sx0, sw, newSc->dw, filter);
+	ASSERT(SCALER_OK == rv, );
+	rv = _setup_axis(&(newSc->yAxis), srcHeight, sy0, sh, newSc->dh, filter);
+	ASSERT(SCALER_OK == rv, );
+
+	newSc->hRows[0] = malloc(3 * newSc->dw * sizeof(uint16_t));
+	ASSERT(newSc->hRows[0], rv = SCALER_NO_MEMORY);
+	newSc->hRows[1] = malloc(3 * newSc->dw * sizeof(uint16_t));
+	ASSERT(newSc->hRows[1], rv = SCALER_NO_MEMORY);
+	newSc->vRow = malloc(3 * newSc->dw * sizeof(uint16_t));
+	ASSERT(newSc->vRow, rv = SCALER_NO_MEMORY);
+	newSc->acc = calloc(3 * newSc->dw, sizeof(uint32_t));
+	ASSERT(newSc->acc, rv = SCALER_NO_MEMORY);
+	newSc->gatherA = malloc(3 * BLOCK_SIZE * sizeof(uint16_t));
+	ASSERT(newSc->gatherA, rv = SCALER_NO_MEMORY);
+	newSc->gatherB = malloc(3 * BLOCK_SIZE * sizeof(uint16_t));
+	ASSERT(newSc->gatherB, rv = SCALER_NO_MEMORY);
+	newSc->gatherW = malloc(3 * BLOCK_SIZE * sizeof(uint16_t));
+	ASSERT(newSc->gatherW, rv = SCALER_NO_MEMORY);
+	newSc->out = calloc(3 * dstWidth, 1);
+	ASSERT(newSc->out, rv = SCALER_NO_MEMORY);
+
+	*sc = newSc;
+	newSc = NULL;
+
+_err:
+
+	if(newSc)
+		scaler_destroy(newSc);
+
+	return rv;
+}
+
+/**
+ * @brief Push next source row.
+ */
+void scaler_push_row(scaler *sc, const unsigned char *row) {
+	axis *ax = &(sc->yAxis);
+	unsigned int r = sc->srcRow++;
+	unsigned int i, j;
+	uint16_t *a, *b;
+	int needed = 0;
+
+	if(scaler_done(sc))
+		return;
+
+	/* Top padding is emitted together with the first row */
+	if(0 == r)
+		_emit_padding(sc, 0, sc->dy0);
+
+	if(ax->box) {
+		/* Rows before the first span (cropped) are skipped */
+		if(r < ax->start[sc->dstRow])
+			return;
+
+		_scale_row(sc, row, sc->hRows[0]);
+		for(i = 0; i < 3 * sc->dw; i++)
+			sc->acc[i] += sc->hRows[0][i];
+
+		if(r + 1 == ax->end[sc->dstRow]) {
+			for(i = 0; i < 3 * sc->dw; i++) {
+				sc->vRow[i] = (sc->acc[i] * ax->weight[sc->dstRow] + 32768) >> 16;
+				sc->acc[i] = 0;
+			}
+			_emit_row(sc, sc->vRow);
+		}
+	}
+	else {
+		/* Only rows sampled by a pending destination row go through the horizontal pass */
+		for(j = sc->dstRow; j < sc->dh && ax->start[j] <= r; j++) {
+			if(ax->start[j] == r || ax->end[j] == r)
+				needed = 1;
+		}
+		if(!needed)
+			return;
+
+		_scale_row(sc, row, sc->hRows[r & 1]);
+
+		/* Emit every destination row whose two source rows are available */
+		while(sc->dstRow < sc->dh && ax->end[sc->dstRow] <= r) {
+			a = sc->hRows[ax->start[sc->dstRow] & 1];
+			b = sc->hRows[ax->end[sc->dstRow] & 1];
+			if(a == b || 0 == ax->weight[sc->dstRow]) {
+				_emit_row(sc, a);
+			}
+			else {
+				_lerp_rows(a, b, ax->weight[sc->dstRow], sc->vRow, 3 * sc->dw);
+				_emit_row(sc, sc->vRow);
+			}
+		}
+	}
+
+	if(scaler_done(sc))
+		_emit_padding(sc, sc->dy0 + sc->dh, sc->dstHeight);
+}
+
+/**
+ * @brief Check whether all destination rows were emitted.
+ */
+int scaler_done(scaler *sc) {
+	return sc->dstRow >= sc->dh;
+}
+
+/**
+ * @brief Free scaler.
+ */
+void scaler_destroy(scaler *sc) {
+	free(sc->xAxis.start);
+	free(sc->xAxis.end);
+	free(sc->xAxis.weight);
+	free(sc->yAxis.start);
+	free(sc->yAxis.end);
+	free(sc->yAxis.weight);
+	free(sc->hRows[0]);
+	free(sc->hRows[1]);
+	free(sc->vRow);
+	free(sc->acc);
+	free(sc->gatherA);
+	free(sc->gatherB);
+	free(sc->gatherW);
+	free(sc->out);
+	free(sc);
+}
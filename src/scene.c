@@ -0,0 +1,655 @@
+/* ********************************************************************************************* */
+/* * Scene Library for retained widget trees                                                   * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "scene.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "dirtyrect.h"
+#include "raster.h"
+#include "rgb565.h"
+#include "utf8.h"
+
+/* Widget types */
+#define TYPE_CONTAINER 0
+#define TYPE_LABEL 1
+#define TYPE_BAR 2
+#define TYPE_GAUGE 3
+#define TYPE_IMAGE 4
+
+/**
+ * @brief Widget. Children are a linked list of identifiers; the screen rectangle is cached by the last layout.
+ */
+typedef struct {
+	int type;
+	int parent;
+	int firstChild;
+	int lastChild;
+	int next;
+	int visible;
+	int x;
+	int y;
+	int w;
+	int h;
+	dirtyrect area;
+	uint16_t fg;
+	uint16_t bg;
+	/* Container */
+	int layout;
+	int padding;
+	int spacing;
+	/* Label */
+	char *text;
+	int font;
+	unsigned int size;
+	int align;
+	unsigned int textWidth;
+	int ascent;
+	int descent;
+	/* Bar and gauge */
+	int min;
+	int max;
+	int value;
+	/* Image */
+	const uint16_t *pixels;
+	int imageWidth;
+	int imageHeight;
+} node;
+
+struct scene_s {
+	display_driver *driver;
+	textrender *tr;
+	raster *r;
+	int xres;
+	int yres;
+	uint16_t *frame;
+	node *nodes;
+	int nNodes;
+	int layoutDirty;
+	dirtyrect_list dirty;
+};
+
+/**
+ * @brief Intersect two rectangles.
+ * @return Non-zero if the intersection is not empty.
+ */
+static int _intersect(const dirtyrect *a, const dirtyrect *b, dirtyrect *out) {
+	out->x0 = (a->x0 > b->x0)? a->x0 : b->x0;
+	out->y0 = (a->y0 > b->y0)? a->y0 : b->y0;
+	out->x1 = (a->x1 < b->x1)? a->x1 : b->x1;
+	out->y1 = (a->y1 < b->y1)? a->y1 : b->y1;
+
+	return out->x0 <= out->x1 && out->y0 <= out->y1;
+}
+
+/**
+ * @brief Add a rectangle to the invalid list, merging it with every rectangle it overlaps.
+ * @return SCENE_OK or SCENE_NO_MEMORY.
+ */
+static int _invalidate(scene *s, const dirtyrect *area) {
+	dirtyrect screen = {0, 0, s->xres - 1, s->yres - 1};
+	dirtyrect r;
+
+	if(!_intersect(area, &screen, &r))
+		return SCENE_OK;
+
+	return (DIRTYRECT_OK == dirtyrect_add(&(s->dirty), r))? SCENE_OK : SCENE_NO_MEMORY;
+}
+
+/**
+ * @brief Invalidate the visible part of a widget.
+ */
+static void _invalidate_node(scene *s, int id) {
+	node *n = &(s->nodes[id]);
+
+	/* If the list cannot grow, repaint everything. The list always has room for one rectangle */
+	if(n->visible && SCENE_OK != _invalidate(s, &(n->area))) {
+		s->dirty.n = 1;
+		s->dirty.rects[0].x0 = 0;
+		s->dirty.rects[0].y0 = 0;
+		s->dirty.rects[0].x1 = s->xres - 1;
+		s->dirty.rects[0].y1 = s->yres - 1;
+	}
+}
+
+/**
+ * @brief Add a widget to a container.
+ * @return SCENE_OK, SCENE_INVALID_ARGS or SCENE_NO_MEMORY.
+ */
+static int _add(scene *s, int parent, int type, int *id) {
+	node *newNodes;
+	node *n;
+
+	if(s->nNodes && (parent < 0 || parent >= s->nNodes || s->nodes[parent].type != TYPE_CONTAINER))
+		return SCENE_INVALID_ARGS;
+
+	newNodes = realloc(s->nodes, (s->nNodes + 1) * sizeof(node));
+	if(!newNodes)
+		return SCENE_NO_MEMORY;
+	s->nodes = newNodes;
+
+	n = &(s->nodes[s->nNodes]);
+	memset(n, 0, sizeof(node));
+	n->type = type;
+	n->parent = parent;
+	n->firstChild = -1;
+	n->lastChild = -1;
+	n->next = -1;
+	n->visible = 1;
+	n->area.x1 = -1;
+	n->area.y1 = -1;
+	n->fg = 0xFFFF;
+	n->max = 100;
+
+	if(s->nNodes) {
+		if(s->nodes[parent].lastChild >= 0)
+			s->nodes[s->nodes[parent].lastChild].next = s->nNodes;
+		else
+			s->nodes[parent].firstChild = s->nNodes;
+		s->nodes[parent].lastChild = s->nNodes;
+	}
+
+	*id = (s->nNodes)++;
+	s->layoutDirty = 1;
+
+	return SCENE_OK;
+}
+
+/**
+ * @brief Place a widget and, recursively, its children. Widgets whose rectangle changed are invalidated.
+ */
+static void _layout(scene *s, int id, int x, int y, int w, int h) {
+	node *n = &(s->nodes[id]);
+	int inX, inY, inW, inH, fixed = 0, flexible = 0, count = 0, pos, share, c;
+
+	if(x != n->area.x0 || y != n->area.y0 || x + w - 1 != n->area.x1 || y + h - 1 != n->area.y1) {
+		_invalidate_node(s, id);
+		n->area.x0 = x;
+		n->area.y0 = y;
+		n->area.x1 = x + w - 1;
+		n->area.y1 = y + h - 1;
+		_invalidate_node(s, id);
+	}
+
+	if(n->type != TYPE_CONTAINER)
+		return;
+
+	inX = x + n->padding;
+	inY = y + n->padding;
+	inW = w - 2 * n->padding;
+	inH = h - 2 * n->padding;
+	inW = (inW > 0)? inW : 0;
+	inH = (inH > 0)? inH : 0;
+
+	/* Space taken by fixed-size children in stacked layouts */
+	for(c = n->firstChild; c >= 0; c = s->nodes[c].next) {
+		node *child = &(s->nodes[c]);
+		int size = (SCENE_LAYOUT_ROW == n->layout)? child->w : child->h;
+
+		if(!(child->visible))
+			continue;
+		count++;
+		fixed += size;
+		flexible += !size;
+	}
+	share = (SCENE_LAYOUT_ROW == n->layout)? inW : inH;
+	share -= fixed + ((count > 1)? (count - 1) * n->spacing : 0);
+	share = (flexible && share > 0)? share / flexible : 0;
+
+	pos = (SCENE_LAYOUT_ROW == n->layout)? inX : inY;
+	for(c = n->firstChild; c >= 0; c = s->nodes[c].next) {
+		node *child = &(s->nodes[c]);
+		int cw, ch;
+
+		if(!(child->visible))
+			continue;
+
+		switch(n->layout) {
+			case SCENE_LAYOUT_ROW:
+				cw = child->w? child->w : share;
+				_layout(s, c, pos, inY, cw, child->h? child->h : inH);
+				pos += cw + n->spacing;
+				break;
+			case SCENE_LAYOUT_COLUMN:
+				ch = child->h? child->h : share;
+				_layout(s, c, inX, pos, child->w? child->w : inW, ch);
+				pos += ch + n->spacing;
+				break;
+			default:
+				cw = child->w? child->w : inW - child->x;
+				ch = child->h? child->h : inH - child->y;
+				_layout(s, c, inX + child->x, inY + child->y, (cw > 0)? cw : 0, (ch > 0)? ch : 0);
+				break;
+		}
+	}
+}
+
+/**
+ * @brief Draw label text into the frame, clipped.
+ * @return SCENE_OK or SCENE_FONT_ERROR.
+ */
+static int _paint_text(scene *s, node *n, const dirtyrect *clip) {
+	const char *str = n->text;
+	textrender_glyph glyph;
+	unsigned int prev = 0;
+	int64_t penX;
+	int x, y, baseline, kerning, gx, gy;
+
+	if(!str || !(s->tr))
+		return SCENE_OK;
+
+	switch(n->align) {
+		case SCENE_ALIGN_CENTRE:
+			x = (n->area.x0 + n->area.x1 + 1 - (int) n->textWidth) / 2;
+			break;
+		case SCENE_ALIGN_RIGHT:
+			x = n->area.x1 + 1 - n->textWidth;
+			break;
+		default:
+			x = n->area.x0;
+			break;
+	}
+	baseline = (n->area.y0 + n->area.y1 + 1 - n->ascent - n->descent) / 2 + n->ascent;
+	penX = (int64_t) x * 64;
+
+	/* Each glyph is blended right away, as its coverage is only valid until the next lookup */
+	while(*str) {
+		if(TEXTRENDER_OK != textrender_get_glyph(s->tr, n->font, n->size, utf8_next(&str), &glyph))
+			return SCENE_FONT_ERROR;
+		if(prev && TEXTRENDER_OK == textrender_get_kerning(s->tr, n->font, n->size, prev, glyph.index, &kerning))
+			penX += kerning;
+		prev = glyph.index;
+
+		gx = (int) (penX >> 6) + glyph.left;
+		gy = baseline - glyph.top;
+		for(y = 0; y < (int) glyph.height; y++) {
+			const unsigned char *cov = glyph.coverage + y * glyph.stride;
+			uint16_t *dst;
+
+			if(gy + y < clip->y0 || gy + y > clip->y1)
+				continue;
+			dst = &(s->frame[(gy + y) * s->xres]);
+			for(x = 0; x < (int) glyph.width; x++) {
+				if(cov[x] && gx + x >= clip->x0 && gx + x <= clip->x1)
+					dst[gx + x] = rgb565_blend(n->fg, dst[gx + x], (cov[x] + 4) >> 3);
+			}
+		}
+		penX += glyph.advance;
+	}
+
+	return SCENE_OK;
+}
+
+/**
+ * @brief Repaint a widget and its children within a clip rectangle.
+ * @return SCENE_OK or SCENE_FONT_ERROR.
+ */
+static int _paint(scene *s, int id, const dirtyrect *parentClip) {
+	node *n = &(s->nodes[id]);
+	int rv = SCENE_OK;
+	int w = n->area.x1 - n->area.x0 + 1;
+	int h = n->area.y1 - n->area.y0 + 1;
+	int range = (n->max != n->min)? n->max - n->min : 1;
+	int fill, radius, thickness, x, y, c;
+	uint16_t track;
+	dirtyrect clip;
+
+	if(!(n->visible) || !_intersect(&(n->area), parentClip, &clip))
+		return SCENE_OK;
+
+	raster_set_clip(s->r, clip.x0, clip.y0, clip.x1, clip.y1);
+	track = rgb565_blend(n->fg, n->bg, 8);
+
+	/* Bars cover their whole rectangle */
+	if(n->type != TYPE_BAR) {
+		raster_set_solid(s->r, n->bg);
+		raster_fill_rect(s->r, n->area.x0, n->area.y0, w, h);
+	}
+
+	switch(n->type) {
+		case TYPE_LABEL:
+			rv = _paint_text(s, n, &clip);
+			break;
+		case TYPE_BAR:
+			raster_set_solid(s->r, track);
+			raster_fill_rect(s->r, n->area.x0, n->area.y0, w, h);
+			raster_set_solid(s->r, n->fg);
+			if(w >= h) {
+				fill = (int) ((int64_t) w * (n->value - n->min) / range);
+				raster_fill_rect(s->r, n->area.x0, n->area.y0, fill, h);
+			}
+			else {
+				fill = (int) ((int64_t) h * (n->value - n->min) / range);
+				raster_fill_rect(s->r, n->area.x0, n->area.y1 + 1 - fill, w, fill);
+			}
+			break;
+		case TYPE_GAUGE:
+			radius = ((w < h)? w : h) / 2;
+			thickness = radius / 4;
+			thickness = (thickness < 2)? 2 : thickness;
+			radius -= thickness / 2 + 1;
+			if(radius <= 0)
+				break;
+			fill = (int) ((int64_t) 270 * (n->value - n->min) / range);
+			raster_set_solid(s->r, track);
+			raster_arc(s->r, n->area.x0 + w / 2, n->area.y0 + h / 2, radius, thickness, 135 + fill, 270 - fill);
+			raster_set_solid(s->r, n->fg);
+			raster_arc(s->r, n->area.x0 + w / 2, n->area.y0 + h / 2, radius, thickness, 135, fill);
+			break;
+		case TYPE_IMAGE:
+			x = n->area.x0 + (w - n->imageWidth) / 2;
+			y = n->area.y0 + (h - n->imageHeight) / 2;
+			for(c = (clip.y0 > y)? clip.y0 : y; c <= clip.y1 && c < y + n->imageHeight; c++) {
+				int x0 = (clip.x0 > x)? clip.x0 : x;
+				int x1 = (clip.x1 < x + n->imageWidth - 1)? clip.x1 : x + n->imageWidth - 1;
+
+				if(x0 <= x1)
+					memcpy(&(s->frame[c * s->xres + x0]), &(n->pixels[(c - y) * n->imageWidth + x0 - x]),
+							(x1 - x0 + 1) * sizeof(uint16_t));
+			}
+			break;
+		default:
+			for(c = n->firstChild; c >= 0 && SCENE_OK == rv; c = s->nodes[c].next)
+				rv = _paint(s, c, &clip);
+			break;
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Create a scene.
+ */
+int scene_create(scene **s, display_driver *driver, textrender *tr) {
+	int rv = SCENE_OK;
+	scene *newS = NULL;
+	int root;
+
+	newS = calloc(1, sizeof(scene));
+	ASSERT(newS, rv = SCENE_NO_MEMORY);
+	newS->driver = driver;
+	newS->tr = tr;
+	driver->get_resolution(&(newS->xres), &(newS->yres));
+
+	newS->frame = calloc(newS->xres * newS->yres, sizeof(uint16_t));
+	ASSERT(newS->frame, rv = SCENE_NO_MEMORY);
+	rv = raster_create_buffer(&(newS->r), newS->frame, newS->xres, newS->yres, newS->xres);
+	ASSERT(RASTER_OK == rv, rv = SCENE_NO_MEMORY);
+	ASSERT(DIRTYRECT_OK == dirtyrect_init(&(newS->dirty)), rv = SCENE_NO_MEMORY);
+
+	rv = _add(newS, -1, TYPE_CONTAINER, &root);
+	ASSERT(SCENE_OK == rv, );
+	newS->nodes[root].w = newS->xres;
+	newS->nodes[root].h = newS->yres;
+
+	*s = newS;
+
+_err:
+	if(rv != SCENE_OK && newS)
+		scene_destroy(newS);
+
+	return rv;
+}
+
+/**
+ * @brief Add a container.
+ */
+int scene_add_container(scene *s, int parent, int layout, int *id) {
+	int rv;
+
+	if(layout < SCENE_LAYOUT_NONE || layout > SCENE_LAYOUT_COLUMN)
+		return SCENE_INVALID_ARGS;
+
+	rv = _add(s, parent, TYPE_CONTAINER, id);
+	if(SCENE_OK == rv)
+		s->nodes[*id].layout = layout;
+
+	return rv;
+}
+
+/**
+ * @brief Add a text label.
+ */
+int scene_add_label(scene *s, int parent, int font, unsigned int size, int *id) {
+	int rv;
+	int ascent, descent;
+
+	if(!(s->tr))
+		return SCENE_INVALID_ARGS;
+	if(TEXTRENDER_OK != textrender_get_metrics(s->tr, font, size, &ascent, &descent))
+		return SCENE_FONT_ERROR;
+
+	rv = _add(s, parent, TYPE_LABEL, id);
+	if(SCENE_OK == rv) {
+		s->nodes[*id].font = font;
+		s->nodes[*id].size = size;
+		s->nodes[*id].ascent = ascent;
+		s->nodes[*id].descent = descent;
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Add a bar.
+ */
+int scene_add_bar(scene *s, int parent, int *id) {
+	return _add(s, parent, TYPE_BAR, id);
+}
+
+/**
+ * @brief Add a gauge.
+ */
+int scene_add_gauge(scene *s, int parent, int *id) {
+	return _add(s, parent, TYPE_GAUGE, id);
+}
+
+/**
+ * @brief Add an image.
+ */
+int scene_add_image(scene *s, int parent, const unsigned short *pixels, int width, int height, int *id) {
+	int rv;
+
+	if(!pixels || width <= 0 || height <= 0)
+		return SCENE_INVALID_ARGS;
+
+	rv = _add(s, parent, TYPE_IMAGE, id);
+	if(SCENE_OK == rv) {
+		s->nodes[*id].pixels = pixels;
+		s->nodes[*id].imageWidth = width;
+		s->nodes[*id].imageHeight = height;
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Set widget geometry.
+ */
+void scene_set_geometry(scene *s, int id, int x, int y, int w, int h) {
+	node *n = &(s->nodes[id]);
+
+	n->x = x;
+	n->y = y;
+	n->w = (w > 0)? w : 0;
+	n->h = (h > 0)? h : 0;
+	s->layoutDirty = 1;
+}
+
+/**
+ * @brief Set container padding and spacing between children.
+ */
+void scene_set_padding(scene *s, int id, int padding, int spacing) {
+	s->nodes[id].padding = padding;
+	s->nodes[id].spacing = spacing;
+	s->layoutDirty = 1;
+}
+
+/**
+ * @brief Set widget colours.
+ */
+void scene_set_colours(scene *s, int id, unsigned short fg, unsigned short bg) {
+	node *n = &(s->nodes[id]);
+
+	if(fg != n->fg || bg != n->bg)
+		_invalidate_node(s, id);
+	n->fg = fg;
+	n->bg = bg;
+}
+
+/**
+ * @brief Show or hide a widget.
+ */
+void scene_set_visible(scene *s, int id, int visible) {
+	node *n = &(s->nodes[id]);
+
+	if(!(n->visible) == !visible)
+		return;
+
+	/* Hidden widgets leave their parent to repaint their area */
+	_invalidate_node(s, visible? n->parent : id);
+	n->visible = visible;
+	s->layoutDirty = 1;
+}
+
+/**
+ * @brief Set label text.
+ */
+int scene_set_text(scene *s, int id, const char *text) {
+	node *n = &(s->nodes[id]);
+	unsigned int width, height;
+	char *newText;
+
+	if(n->text && !strcmp(n->text, text))
+		return SCENE_OK;
+
+	/* Width is cached for alignment */
+	if(TEXTRENDER_OK != textrender_measure(s->tr, n->font, n->size, text, &width, &height))
+		return SCENE_FONT_ERROR;
+	newText = strdup(text);
+	if(!newText)
+		return SCENE_NO_MEMORY;
+
+	if(n->text)
+		free(n->text);
+	n->text = newText;
+	n->textWidth = width;
+	_invalidate_node(s, id);
+
+	return SCENE_OK;
+}
+
+/**
+ * @brief Set label alignment.
+ */
+void scene_set_align(scene *s, int id, int align) {
+	if(align != s->nodes[id].align)
+		_invalidate_node(s, id);
+	s->nodes[id].align = align;
+}
+
+/**
+ * @brief Set bar or gauge range.
+ */
+void scene_set_range(scene *s, int id, int min, int max) {
+	node *n = &(s->nodes[id]);
+
+	n->min = min;
+	n->max = max;
+	n->value = (n->value < min)? min : (n->value > max)? max : n->value;
+	_invalidate_node(s, id);
+}
+
+/**
+ * @brief Set bar or gauge value.
+ */
+void scene_set_value(scene *s, int id, int value) {
+	node *n = &(s->nodes[id]);
+
+	value = (value < n->min)? n->min : (value > n->max)? n->max : value;
+	if(value == n->value)
+		return;
+
+	n->value = value;
+	_invalidate_node(s, id);
+}
+
+/**
+ * @brief Lay out changed containers, repaint invalid rectangles and send them to the display.
+ */
+int scene_flush(scene *s, unsigned int *pixels) {
+	int rv = SCENE_OK;
+	unsigned int sent = 0;
+	int i, y;
+
+	if(s->layoutDirty) {
+		_layout(s, SCENE_ROOT, 0, 0, s->nodes[SCENE_ROOT].w, s->nodes[SCENE_ROOT].h);
+		s->layoutDirty = 0;
+	}
+
+	for(i = 0; i < s->dirty.n; i++) {
+		dirtyrect *d = &(s->dirty.rects[i]);
+		int w = d->x1 - d->x0 + 1;
+
+		rv = _paint(s, SCENE_ROOT, d);
+		ASSERT(SCENE_OK == rv, );
+
+		s->driver->set_window(d->x0, d->y0, d->x1, d->y1);
+		if(w == s->xres) {
+			s->driver->write_rgb565(&(s->frame[d->y0 * s->xres]), w * (d->y1 - d->y0 + 1));
+		}
+		else {
+			for(y = d->y0; y <= d->y1; y++)
+				s->driver->write_rgb565(&(s->frame[y * s->xres + d->x0]), w);
+		}
+		sent += w * (d->y1 - d->y0 + 1);
+	}
+	s->dirty.n = 0;
+
+	if(pixels)
+		*pixels = sent;
+
+_err:
+
+	return rv;
+}
+
+/**
+ * @brief Free scene and its widgets.
+ */
+void scene_destroy(scene *s) {
+	int i;
+
+	for(i = 0; i < s->nNodes; i++) {
+		if(s->nodes[i].text)
+			free(s->nodes[i].text);
+	}
+	if(s->nodes)
+		free(s->nodes);
+	dirtyrect_free(&(s->dirty));
+	if(s->r)
+		raster_destroy(s->r);
+	if(s->frame)
+		free(s->frame);
+	free(s);
+}
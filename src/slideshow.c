@@ -0,0 +1,344 @@
+/* ********************************************************************************************* */
+/* * Slideshow Library for prefetching image playback                                          * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "slideshow.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "imagedecode.h"
+
+/* Slot states */
+#define SLOT_PENDING 0
+#define SLOT_DECODING 1
+#define SLOT_READY 2
+#define SLOT_FAILED 3
+#define SLOT_SHOWING 4
+
+/**
+ * @brief A prefetch slot. Holds one panel-ready image. Slots form a ring starting at head; the i-th slot after head
+ *        holds playlist item (cursor + i).
+ */
+typedef struct {
+	int state;
+	unsigned int item;
+	unsigned int generation;
+	unsigned short *pixels;
+} slot;
+
+struct slideshow_s {
+	display_driver *driver;
+	int xres;
+	int yres;
+	pthread_mutex_t mutex;
+	pthread_cond_t workCond;
+	pthread_cond_t readyCond;
+	pthread_t *threads;
+	unsigned int nThreads;
+	slot *slots;
+	unsigned int nSlots;
+	unsigned int head;
+	unsigned int cursor;
+	char **paths;
+	unsigned int nPaths;
+	int orientation;
+	int mode;
+	/* Incremented on each playlist change. Read without lock by the cancellation callback */
+	volatile unsigned int generation;
+	volatile bool quit;
+};
+
+/**
+ * @brief Argument for the cancellation callback.
+ */
+typedef struct {
+	slideshow *show;
+	unsigned int generation;
+} cancel_arg;
+
+/**
+ * @brief Free a playlist.
+ * @param paths Array of strings.
+ * @param n Number of elements in paths.
+ */
+static void _free_paths(char **paths, unsigned int n) {
+	unsigned int i;
+
+	if(paths) {
+		for(i = 0; i < n; i++)
+			free(paths[i]);
+		free(paths);
+	}
+}
+
+/**
+ * @brief Cancellation callback for imagedecode: decoding is aborted if the playlist changed or the slideshow is ending.
+ */
+static int _cancelled(void *arg) {
+	cancel_arg *cancelArg = (cancel_arg *) arg;
+
+	return cancelArg->show->quit || (cancelArg->show->generation != cancelArg->generation);
+}
+
+/**
+ * @brief Worker thread. Decodes pending slots, nearest to head first.
+ * @param arg Slideshow handle.
+ */
+static void *_worker(void *arg) {
+	slideshow *show = (slideshow *) arg;
+	slot *s;
+	char *path;
+	int orientation;
+	int mode;
+	cancel_arg cancelArg;
+	unsigned int i;
+	int irv;
+
+	cancelArg.show = show;
+
+	pthread_mutex_lock(&(show->mutex));
+
+	while(!show->quit) {
+		/* Find a pending slot. Slots beyond the playlist length would only duplicate work */
+		s = NULL;
+		for(i = 0; i < show->nSlots && i < show->nPaths; i++) {
+			if(SLOT_PENDING == show->slots[(show->head + i) % show->nSlots].state) {
+				s = &(show->slots[(show->head + i) % show->nSlots]);
+				break;
+			}
+		}
+
+		if(!s) {
+			pthread_cond_wait(&(show->workCond), &(show->mutex));
+			continue;
+		}
+
+		s->state = SLOT_DECODING;
+		s->item = (show->cursor + i) % show->nPaths;
+		s->generation = show->generation;
+		cancelArg.generation = show->generation;
+		path = strdup(show->paths[s->item]);
+		orientation = show->orientation;
+		mode = show->mode;
+
+		/* Decode without holding the lock */
+		pthread_mutex_unlock(&(show->mutex));
+		irv = path? imagedecode_to_rgb565(path, orientation, mode, s->pixels, show->xres, show->yres, _cancelled,
+			&cancelArg) : IMAGEDECODE_NO_MEMORY;
+		free(path);
+		pthread_mutex_lock(&(show->mutex));
+
+		/* If the playlist changed meanwhile, this slot is reused for the new one */
+		if(s->generation != show->generation)
+			s->state = SLOT_PENDING;
+		else
+			s->state = (IMAGEDECODE_OK == irv)? SLOT_READY : SLOT_FAILED;
+
+		pthread_cond_broadcast(&(show->readyCond));
+	}
+
+	pthread_mutex_unlock(&(show->mutex));
+
+	return NULL;
+}
+
+/**
+ * @brief Create a slideshow engine.
+ */
+int slideshow_create(slideshow **show, display_driver *driver, unsigned int workers, unsigned int prefetch,
+		size_t memBudget) {
+	int rv = SLIDESHOW_OK;
+	slideshow *newShow = NULL;
+	size_t frameSize;
+	unsigned int i;
+
+	ASSERT(workers > 0 && prefetch > 0, rv = SLIDESHOW_INVALID_ARGS);
+
+	newShow = calloc(1, sizeof(slideshow));
+	ASSERT(newShow, rv = SLIDESHOW_NO_MEMORY);
+
+	newShow->driver = driver;
+	driver->get_resolution(&(newShow->xres), &(newShow->yres));
+	pthread_mutex_init(&(newShow->mutex), NULL);
+	pthread_cond_init(&(newShow->workCond), NULL);
+	pthread_cond_init(&(newShow->readyCond), NULL);
+
+	/* Fit prefetch depth into memory budget */
+	frameSize = newShow->xres * newShow->yres * sizeof(unsigned short);
+	newShow->nSlots = ((memBudget / frameSize) < prefetch)? (memBudget / frameSize) : prefetch;
+	if(!newShow->nSlots)
+		newShow->nSlots = 1;
+
+	newShow->slots = calloc(newShow->nSlots, sizeof(slot));
+	ASSERT(newShow->slots, rv = SLIDESHOW_NO_MEMORY);
+	for(i = 0; i < newShow->nSlots; i++) {
+		newShow->slots[i].pixels = malloc(frameSize);
+		ASSERT(newShow->slots[i].pixels, rv = SLIDESHOW_NO_MEMORY);
+	}
+
+	newShow->threads = calloc(workers, sizeof(pthread_t));
+	ASSERT(newShow->threads, rv = SLIDESHOW_NO_MEMORY);
+	for(i = 0; i < workers; i++) {
+		ASSERT(0 == pthread_create(&(newShow->threads[i]), NULL, _worker, newShow), rv = SLIDESHOW_THREAD_ERROR);
+		newShow->nThreads++;
+	}
+
+	*show = newShow;
+	newShow = NULL;
+
+_err:
+
+	if(newShow)
+		slideshow_destroy(newShow);
+
+	return rv;
+}
+
+/**
+ * @brief Replace the playlist.
+ */
+int slideshow_set_playlist(slideshow *show, char **paths, unsigned int n, int orientation, int mode) {
+	int rv = SLIDESHOW_OK;
+	char **newPaths = NULL;
+	char **oldPaths;
+	unsigned int nOldPaths;
+	unsigned int i;
+
+	/* Copy playlist before taking the lock */
+	if(n) {
+		newPaths = calloc(n, sizeof(char *));
+		ASSERT(newPaths, rv = SLIDESHOW_NO_MEMORY);
+		for(i = 0; i < n; i++) {
+			newPaths[i] = strdup(paths[i]);
+			ASSERT(newPaths[i], rv = SLIDESHOW_NO_MEMORY);
+		}
+	}
+
+	pthread_mutex_lock(&(show->mutex));
+
+	oldPaths = show->paths;
+	nOldPaths = show->nPaths;
+	show->paths = newPaths;
+	show->nPaths = n;
+	show->orientation = orientation;
+	show->mode = mode;
+	show->generation++;
+	show->head = 0;
+	show->cursor = 0;
+
+	/* Slots being decoded or shown are released by their owners */
+	for(i = 0; i < show->nSlots; i++) {
+		if(show->slots[i].state != SLOT_DECODING && show->slots[i].state != SLOT_SHOWING)
+			show->slots[i].state = SLOT_PENDING;
+	}
+
+	pthread_cond_broadcast(&(show->workCond));
+	pthread_cond_broadcast(&(show->readyCond));
+	pthread_mutex_unlock(&(show->mutex));
+
+	_free_paths(oldPaths, nOldPaths);
+	newPaths = NULL;
+
+_err:
+
+	_free_paths(newPaths, n);
+
+	return rv;
+}
+
+/**
+ * @brief Wait for the next image to be ready and transfer it to the display.
+ */
+int slideshow_next(slideshow *show, unsigned int *index) {
+	int rv = SLIDESHOW_OK;
+	slot *s;
+	unsigned int generation;
+
+	pthread_mutex_lock(&(show->mutex));
+
+	s = &(show->slots[show->head]);
+	while(show->nPaths && SLOT_READY != s->state && SLOT_FAILED != s->state) {
+		pthread_cond_wait(&(show->readyCond), &(show->mutex));
+		s = &(show->slots[show->head]);
+	}
+
+	if(!show->nPaths) {
+		pthread_mutex_unlock(&(show->mutex));
+		return SLIDESHOW_EMPTY_PLAYLIST;
+	}
+
+	if(index)
+		*index = s->item;
+	if(SLOT_FAILED == s->state)
+		rv = SLIDESHOW_DECODE_ERROR;
+	s->state = SLOT_SHOWING;
+	generation = show->generation;
+
+	/* Bus transfer is performed without holding the lock, so that workers keep decoding */
+	pthread_mutex_unlock(&(show->mutex));
+	if(SLIDESHOW_OK == rv) {
+		show->driver->set_window(0, 0, show->xres - 1, show->yres - 1);
+		show->driver->write_rgb565(s->pixels, show->xres * show->yres);
+	}
+	pthread_mutex_lock(&(show->mutex));
+
+	/* Release slot for the item that is nSlots positions ahead. If playlist changed, head was already reset */
+	s->state = SLOT_PENDING;
+	if(generation == show->generation) {
+		show->head = (show->head + 1) % show->nSlots;
+		show->cursor = (show->cursor + 1) % show->nPaths;
+	}
+
+	pthread_cond_broadcast(&(show->workCond));
+	pthread_mutex_unlock(&(show->mutex));
+
+	return rv;
+}
+
+/**
+ * @brief Stop workers and free the slideshow.
+ */
+void slideshow_destroy(slideshow *show) {
+	unsigned int i;
+
+	pthread_mutex_lock(&(show->mutex));
+	show->quit = true;
+	pthread_cond_broadcast(&(show->workCond));
+	pthread_mutex_unlock(&(show->mutex));
+
+	for(i = 0; i < show->nThreads; i++)
+		pthread_join(show->threads[i], NULL);
+
+	if(show->slots) {
+		for(i = 0; i < show->nSlots; i++)
+			free(show->slots[i].pixels);
+		free(show->slots);
+	}
+
+	free(show->threads);
+	_free_paths(show->paths, show->nPaths);
+	pthread_cond_destroy(&(show->readyCond));
+	pthread_cond_destroy(&(show->workCond));
+	pthread_mutex_destroy(&(show->mutex));
+	free(show);
+}
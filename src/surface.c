@@ -0,0 +1,340 @@
+/* ********************************************************************************************* */
+/* * Surface Library for indexed-colour buffers                                                * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "surface.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+struct surface_s {
+	int width;
+	int height;
+	int bpp;
+	/* Pixels per byte, and shift from pixel to byte index */
+	int ppb;
+	int shift;
+	unsigned int stride;
+	uint8_t *data;
+	uint16_t palette[256];
+	/* Packed byte to its pixels, rebuilt after palette changes */
+	uint16_t *lut;
+	int lutDirty;
+	uint16_t *line;
+	/* Changed region (inclusive), empty if x0 > x1 */
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+};
+
+/**
+ * @brief Grow the changed region.
+ */
+static void _touch(surface *s, int x0, int y0, int x1, int y1) {
+	s->x0 = (x0 < s->x0)? x0 : s->x0;
+	s->y0 = (y0 < s->y0)? y0 : s->y0;
+	s->x1 = (x1 > s->x1)? x1 : s->x1;
+	s->y1 = (y1 > s->y1)? y1 : s->y1;
+}
+
+/**
+ * @brief Write a pixel without clipping nor tracking.
+ */
+static inline void _put(surface *s, int x, int y, unsigned int index) {
+	uint8_t *p = &(s->data[y * s->stride + (x >> s->shift)]);
+	int bit = (s->ppb - 1 - (x & (s->ppb - 1))) * s->bpp;
+	uint8_t mask = ((1 << s->bpp) - 1) << bit;
+
+	*p = (*p & ~mask) | ((index << bit) & mask);
+}
+
+/**
+ * @brief Rebuild the byte expansion table from the palette.
+ */
+static void _build_lut(surface *s) {
+	unsigned int b;
+	int i;
+
+	if(8 == s->bpp) {
+		memcpy(s->lut, s->palette, 256 * sizeof(uint16_t));
+		return;
+	}
+
+	for(b = 0; b < 256; b++) {
+		for(i = 0; i < s->ppb; i++)
+			s->lut[b * s->ppb + i] = s->palette[(b >> ((s->ppb - 1 - i) * s->bpp)) & ((1 << s->bpp) - 1)];
+	}
+}
+
+/**
+ * @brief Create an indexed-colour surface.
+ */
+int surface_create(surface **s, int width, int height, int bpp) {
+	int rv = SURFACE_OK;
+	surface *newS = NULL;
+	unsigned int i, colours;
+
+	ASSERT(width > 0 && height > 0 && (1 == bpp || 2 == bpp || 4 == bpp || 8 == bpp), rv = SURFACE_INVALID_ARGS);
+
+	newS = calloc(1, sizeof(surface));
+	ASSERT(newS, rv = SURFACE_NO_MEMORY);
+	newS->width = width;
+	newS->height = height;
+	newS->bpp = bpp;
+	newS->ppb = 8 / bpp;
+	newS->shift = (1 == bpp)? 3 : (2 == bpp)? 2 : (4 == bpp)? 1 : 0;
+	newS->stride = (width + newS->ppb - 1) / newS->ppb;
+
+	newS->data = calloc(newS->stride * height, sizeof(uint8_t));
+	ASSERT(newS->data, rv = SURFACE_NO_MEMORY);
+	newS->lut = malloc(256 * newS->ppb * sizeof(uint16_t));
+	ASSERT(newS->lut, rv = SURFACE_NO_MEMORY);
+
+	/* Lines are expanded from whole bytes, so they may start up to a byte early */
+	newS->line = malloc((width + newS->ppb) * sizeof(uint16_t));
+	ASSERT(newS->line, rv = SURFACE_NO_MEMORY);
+
+	/* Grey ramp */
+	colours = 1 << bpp;
+	for(i = 0; i < colours; i++) {
+		unsigned int v = (i * 255) / (colours - 1);
+
+		newS->palette[i] = ((v & 0xF8) << 8) | ((v & 0xFC) << 3) | (v >> 3);
+	}
+	newS->lutDirty = 1;
+	newS->x1 = width - 1;
+	newS->y1 = height - 1;
+
+	*s = newS;
+
+_err:
+	if(rv != SURFACE_OK && newS)
+		surface_destroy(newS);
+
+	return rv;
+}
+
+/**
+ * @brief Get the packed pixel buffer.
+ */
+unsigned char *surface_get_buffer(surface *s, unsigned int *stride) {
+	if(stride)
+		*stride = s->stride;
+
+	return s->data;
+}
+
+/**
+ * @brief Set palette entries.
+ */
+void surface_set_palette(surface *s, unsigned int first, unsigned int count, const unsigned short *colours) {
+	unsigned int colourCount = 1 << s->bpp;
+
+	if(first >= colourCount)
+		return;
+	count = (first + count > colourCount)? colourCount - first : count;
+
+	memcpy(&(s->palette[first]), colours, count * sizeof(uint16_t));
+	s->lutDirty = 1;
+	_touch(s, 0, 0, s->width - 1, s->height - 1);
+}
+
+/**
+ * @brief Set a pixel.
+ */
+void surface_set_pixel(surface *s, int x, int y, unsigned int index) {
+	if(x < 0 || y < 0 || x >= s->width || y >= s->height)
+		return;
+
+	_put(s, x, y, index);
+	_touch(s, x, y, x, y);
+}
+
+/**
+ * @brief Get a pixel.
+ */
+unsigned int surface_get_pixel(surface *s, int x, int y) {
+	int bit;
+
+	if(x < 0 || y < 0 || x >= s->width || y >= s->height)
+		return 0;
+
+	bit = (s->ppb - 1 - (x & (s->ppb - 1))) * s->bpp;
+
+	return (s->data[y * s->stride + (x >> s->shift)] >> bit) & ((1 << s->bpp) - 1);
+}
+
+/**
+ * @brief Fill a rectangle.
+ */
+void surface_fill_rect(surface *s, int x, int y, int w, int h, unsigned int index) {
+	int x0 = (x > 0)? x : 0;
+	int y0 = (y > 0)? y : 0;
+	int x1 = (x + w - 1 < s->width - 1)? x + w - 1 : s->width - 1;
+	int y1 = (y + h - 1 < s->height - 1)? y + h - 1 : s->height - 1;
+	int i, j, b0, b1;
+	uint8_t fill;
+
+	if(x0 > x1 || y0 > y1)
+		return;
+
+	/* Byte with every pixel set to index */
+	fill = index & ((1 << s->bpp) - 1);
+	for(i = s->bpp; i < 8; i *= 2)
+		fill |= fill << i;
+
+	/* Whole bytes in the middle, single pixels at the ends */
+	b0 = (x0 + s->ppb - 1) >> s->shift;
+	b1 = (x1 + 1) >> s->shift;
+	for(j = y0; j <= y1; j++) {
+		if(b0 < b1) {
+			for(i = x0; i < b0 * s->ppb; i++)
+				_put(s, i, j, index);
+			memset(&(s->data[j * s->stride + b0]), fill, b1 - b0);
+			for(i = b1 * s->ppb; i <= x1; i++)
+				_put(s, i, j, index);
+		}
+		else {
+			for(i = x0; i <= x1; i++)
+				_put(s, i, j, index);
+		}
+	}
+
+	_touch(s, x0, y0, x1, y1);
+}
+
+/**
+ * @brief Draw 8-bit coverage as a ramp of palette entries.
+ */
+void surface_draw_coverage(surface *s, int x, int y, const unsigned char *coverage, int w, int h, int stride,
+		unsigned int first, unsigned int levels) {
+	int x0 = (x > 0)? x : 0;
+	int y0 = (y > 0)? y : 0;
+	int x1 = (x + w - 1 < s->width - 1)? x + w - 1 : s->width - 1;
+	int y1 = (y + h - 1 < s->height - 1)? y + h - 1 : s->height - 1;
+	int i, j;
+
+	if(x0 > x1 || y0 > y1 || !levels)
+		return;
+
+	for(j = y0; j <= y1; j++) {
+		const unsigned char *cov = &(coverage[(j - y) * stride - x]);
+
+		for(i = x0; i <= x1; i++) {
+			if(cov[i])
+				_put(s, i, j, first + ((cov[i] - 1) * levels) / 255);
+		}
+	}
+
+	_touch(s, x0, y0, x1, y1);
+}
+
+/**
+ * @brief Mark a region as changed.
+ */
+void surface_invalidate(surface *s, int x, int y, int w, int h) {
+	int x0 = (x > 0)? x : 0;
+	int y0 = (y > 0)? y : 0;
+	int x1 = (x + w - 1 < s->width - 1)? x + w - 1 : s->width - 1;
+	int y1 = (y + h - 1 < s->height - 1)? y + h - 1 : s->height - 1;
+
+	if(x0 <= x1 && y0 <= y1)
+		_touch(s, x0, y0, x1, y1);
+}
+
+/**
+ * @brief Send the changed region of the surface to the display.
+ */
+void surface_flush(surface *s, display_driver *driver, int x, int y, unsigned int *pixels) {
+	int xres, yres, x0, y0, x1, y1, b0, b1, i, j;
+
+	if(pixels)
+		*pixels = 0;
+
+	/* Changed region, clipped to the screen */
+	driver->get_resolution(&xres, &yres);
+	x0 = (x + s->x0 > 0)? s->x0 : -x;
+	y0 = (y + s->y0 > 0)? s->y0 : -y;
+	x1 = (x + s->x1 < xres - 1)? s->x1 : xres - 1 - x;
+	y1 = (y + s->y1 < yres - 1)? s->y1 : yres - 1 - y;
+
+	/* Nothing pending from now on */
+	s->x0 = s->width;
+	s->y0 = s->height;
+	s->x1 = -1;
+	s->y1 = -1;
+
+	if(x0 > x1 || y0 > y1)
+		return;
+
+	if(s->lutDirty) {
+		_build_lut(s);
+		s->lutDirty = 0;
+	}
+
+	b0 = x0 >> s->shift;
+	b1 = x1 >> s->shift;
+	driver->set_window(x + x0, y + y0, x + x1, y + y1);
+	for(j = y0; j <= y1; j++) {
+		const uint8_t *src = &(s->data[j * s->stride]);
+		uint16_t *out = s->line;
+
+		/* One table lookup per byte */
+		switch(s->ppb) {
+			case 1:
+				for(i = b0; i <= b1; i++)
+					*(out++) = s->lut[src[i]];
+				break;
+			case 2:
+				for(i = b0; i <= b1; i++, out += 2)
+					memcpy(out, &(s->lut[src[i] * 2]), 2 * sizeof(uint16_t));
+				break;
+			case 4:
+				for(i = b0; i <= b1; i++, out += 4)
+					memcpy(out, &(s->lut[src[i] * 4]), 4 * sizeof(uint16_t));
+				break;
+			default:
+				for(i = b0; i <= b1; i++, out += 8)
+					memcpy(out, &(s->lut[src[i] * 8]), 8 * sizeof(uint16_t));
+				break;
+		}
+
+		driver->write_rgb565(&(s->line[x0 - b0 * s->ppb]), x1 - x0 + 1);
+	}
+
+	if(pixels)
+		*pixels = (x1 - x0 + 1) * (y1 - y0 + 1);
+}
+
+/**
+ * @brief Free surface.
+ */
+void surface_destroy(surface *s) {
+	if(s->data)
+		free(s->data);
+	if(s->lut)
+		free(s->lut);
+	if(s->line)
+		free(s->line);
+	free(s);
+}
@@ -0,0 +1,115 @@
+/* ********************************************************************************************* */
+/* * Example 10 of PiDisplayLibs usage: Gauge and chart of values from stdin                   * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "driverloader.h"
+#include "raster.h"
+
+#define HISTORY 32
+#define BACKGROUND 0x0841
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	raster *r = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	int history[HISTORY] = {0};
+	int points[2 * (HISTORY + 2)];
+	char line[64];
+	int i, value;
+
+	/* Check arguments */
+	ASSERT(2 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE\n", argv[0]));
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = raster_create(&r, &driver);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create() failed with code %d\n", retVal));
+	raster_set_background(r, BACKGROUND);
+	raster_set_solid(r, BACKGROUND);
+	raster_fill_rect(r, 0, 0, 320, 240);
+
+	/* Static parts: chart panel and gauge track */
+	raster_set_linear(r, 0, 130, 0, 235, 0x2945, 0x10A2);
+	raster_fill_round_rect(r, 5, 130, 310, 105, 8);
+	raster_set_solid(r, 0x2945);
+	raster_arc(r, 160, 70, 55, 14, 135, 270);
+	raster_set_radial(r, 155, 65, 30, 0xFFFF, 0x001F);
+	raster_fill_circle(r, 160, 70, 30);
+
+	/* Each line of standard input is a value from 0 to 100 (e.g. a CPU load sampler) */
+	while(fgets(line, sizeof(line), stdin)) {
+		value = atoi(line);
+		value = (value < 0)? 0 : (value > 100)? 100 : value;
+		for(i = 0; i < HISTORY - 1; i++)
+			history[i] = history[i + 1];
+		history[HISTORY - 1] = value;
+
+		/* Gauge: value part in a green to red gradient, rest of the track */
+		raster_set_background(r, BACKGROUND);
+		raster_set_linear(r, 100, 0, 220, 0, 0x07E0, 0xF800);
+		raster_arc(r, 160, 70, 55, 14, 135, value * 270 / 100);
+		raster_set_solid(r, 0x2945);
+		raster_arc(r, 160, 70, 55, 14, 135 + value * 270 / 100, 270 - value * 270 / 100);
+
+		/* Chart: filled area under the history, redrawn within the panel */
+		raster_set_clip(r, 15, 140, 304, 224);
+		raster_set_solid(r, 0x18C3);
+		raster_fill_rect(r, 15, 140, 290, 85);
+		raster_set_background(r, 0x18C3);
+		for(i = 0; i < HISTORY; i++) {
+			points[2 * i] = 15 + i * 290 / (HISTORY - 1);
+			points[2 * i + 1] = 225 - history[i] * 85 / 100;
+		}
+		points[2 * HISTORY] = 305;
+		points[2 * HISTORY + 1] = 225;
+		points[2 * HISTORY + 2] = 15;
+		points[2 * HISTORY + 3] = 225;
+		raster_set_linear(r, 0, 140, 0, 225, 0x05DF, 0x0010);
+		raster_fill_polygon(r, points, HISTORY + 2);
+		raster_set_solid(r, 0xFFFF);
+		for(i = 0; i < HISTORY - 1; i++)
+			raster_line(r, points[2 * i], points[2 * i + 1], points[2 * i + 2], points[2 * i + 3], 2);
+		raster_set_clip(r, 0, 0, 319, 239);
+	}
+
+_err:
+
+	if(r)
+		raster_destroy(r);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
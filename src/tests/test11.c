@@ -0,0 +1,151 @@
+/* ********************************************************************************************* */
+/* * Example 11 of PiDisplayLibs usage: Sprites bouncing over a background                     * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "blitter.h"
+#include "common.h"
+#include "driverloader.h"
+#include "raster.h"
+
+#define MAX_BALLS 16
+#define BALL 24
+#define CROSS 15
+#define KEY 0xF81F
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	raster *r = NULL;
+	blitter *b = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	static unsigned short background[320 * 240];
+	unsigned short ball[BALL * BALL], mask[BALL * BALL], cross[CROSS * CROSS];
+	unsigned char alpha[BALL * BALL];
+	int id[MAX_BALLS], x[MAX_BALLS], y[MAX_BALLS], dx[MAX_BALLS], dy[MAX_BALLS];
+	int crossId, balls, frames, i, j;
+
+	/* Check arguments */
+	ASSERT(4 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE BALLS FRAMES\n", argv[0]));
+	balls = atoi(argv[2]);
+	balls = (balls < 1)? 1 : (balls > MAX_BALLS)? MAX_BALLS : balls;
+	frames = atoi(argv[3]);
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	/* Background: gradient with a grid */
+	retVal = raster_create_buffer(&r, background, 320, 240, 320);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create_buffer() failed with code %d\n", retVal));
+	raster_set_linear(r, 0, 0, 319, 239, 0x0010, 0x4208);
+	raster_fill_rect(r, 0, 0, 320, 240);
+	raster_set_solid(r, 0x632C);
+	for(i = 20; i < 320; i += 20)
+		raster_fill_rect(r, i, 0, 1, 240);
+	for(i = 20; i < 240; i += 20)
+		raster_fill_rect(r, 0, i, 320, 1);
+	raster_destroy(r);
+	r = NULL;
+
+	/* Ball: shaded disc, with its opacity taken from a white-on-black mask of the same disc */
+	retVal = raster_create_buffer(&r, ball, BALL, BALL, BALL);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create_buffer() failed with code %d\n", retVal));
+	raster_set_antialias(r, 0);
+	raster_set_radial(r, BALL / 3, BALL / 3, BALL, 0xFFE0, 0xC000);
+	raster_fill_rect(r, 0, 0, BALL, BALL);
+	raster_destroy(r);
+	r = NULL;
+	retVal = raster_create_buffer(&r, mask, BALL, BALL, BALL);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create_buffer() failed with code %d\n", retVal));
+	for(i = 0; i < BALL * BALL; i++)
+		mask[i] = 0x0000;
+	raster_set_solid(r, 0xFFFF);
+	raster_fill_circle(r, BALL / 2, BALL / 2, BALL / 2 - 1);
+	raster_destroy(r);
+	r = NULL;
+	for(i = 0; i < BALL * BALL; i++)
+		alpha[i] = ((mask[i] >> 5) & 0x3F) * 255 / 63;
+
+	/* Cross: colour-keyed cursor */
+	for(i = 0; i < CROSS * CROSS; i++)
+		cross[i] = (i / CROSS == CROSS / 2 || i % CROSS == CROSS / 2)? 0xFFFF : KEY;
+
+	retVal = blitter_create(&b, &driver, background, 320);
+	ASSERT(BLITTER_OK == retVal, fprintf(stderr, "Error: blitter_create() failed with code %d\n", retVal));
+	for(i = 0; i < balls; i++) {
+		retVal = blitter_add_sprite(b, ball, alpha, BALL, BALL, BLITTER_ALPHA, 0, &id[i]);
+		ASSERT(BLITTER_OK == retVal, fprintf(stderr, "Error: blitter_add_sprite() failed with code %d\n", retVal));
+		x[i] = (i * 67) % (320 - BALL);
+		y[i] = (i * 41) % (240 - BALL);
+		dx[i] = 1 + i % 3;
+		dy[i] = 2 - i % 4;
+		blitter_move(b, id[i], x[i], y[i]);
+		blitter_show(b, id[i], 1);
+	}
+	retVal = blitter_add_sprite(b, cross, NULL, CROSS, CROSS, BLITTER_COLOURKEY, KEY, &crossId);
+	ASSERT(BLITTER_OK == retVal, fprintf(stderr, "Error: blitter_add_sprite() failed with code %d\n", retVal));
+	blitter_show(b, crossId, 1);
+
+	/* First flush paints the whole background */
+	blitter_invalidate(b, 0, 0, 320, 240);
+
+	for(i = 0; i < frames; i++) {
+		for(j = 0; j < balls; j++) {
+			x[j] += dx[j];
+			y[j] += dy[j];
+			if(x[j] < 0 || x[j] > 320 - BALL)
+				dx[j] = -dx[j];
+			if(y[j] < 0 || y[j] > 240 - BALL)
+				dy[j] = -dy[j];
+			blitter_move(b, id[j], x[j], y[j]);
+		}
+
+		/* Cursor goes round the screen, partly off its edges */
+		blitter_move(b, crossId, (i * 3) % 330 - 5, 120 + (i % 60) - 30);
+
+		retVal = blitter_flush(b, NULL);
+		ASSERT(BLITTER_OK == retVal, fprintf(stderr, "Error: blitter_flush() failed with code %d\n", retVal));
+		usleep(20000);
+	}
+
+_err:
+
+	if(b)
+		blitter_destroy(b);
+
+	if(r)
+		raster_destroy(r);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,135 @@
+/* ********************************************************************************************* */
+/* * Example 12 of PiDisplayLibs usage: Layers with a fading alert over live widgets           * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "compositor.h"
+#include "driverloader.h"
+#include "raster.h"
+
+#define BARS 8
+#define ALERT_W 200
+#define ALERT_H 60
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	raster *r = NULL;
+	compositor *c = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	static unsigned short background[320 * 240], widgets[320 * 160], alertColour[ALERT_W * ALERT_H];
+	static unsigned short alertMask[ALERT_W * ALERT_H];
+	static unsigned int alert[ALERT_W * ALERT_H];
+	int bgId, widgetsId, alertId, frames, i, j, h;
+
+	/* Check arguments */
+	ASSERT(3 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE FRAMES\n", argv[0]));
+	frames = atoi(argv[2]);
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	/* Background layer, drawn once */
+	retVal = raster_create_buffer(&r, background, 320, 240, 320);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create_buffer() failed with code %d\n", retVal));
+	raster_set_radial(r, 160, 120, 200, 0x3186, 0x0000);
+	raster_fill_rect(r, 0, 0, 320, 240);
+	raster_destroy(r);
+	r = NULL;
+
+	/* Alert: rounded box, converted to premultiplied ARGB with the opacity taken from a mask of the same box */
+	retVal = raster_create_buffer(&r, alertColour, ALERT_W, ALERT_H, ALERT_W);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create_buffer() failed with code %d\n", retVal));
+	raster_set_linear(r, 0, 0, 0, ALERT_H - 1, 0xF800, 0x7800);
+	raster_fill_rect(r, 0, 0, ALERT_W, ALERT_H);
+	raster_set_solid(r, 0xFFFF);
+	raster_fill_rect(r, ALERT_W / 2 - 3, 12, 6, 24);
+	raster_fill_circle(r, ALERT_W / 2, 45, 4);
+	raster_destroy(r);
+	r = NULL;
+	retVal = raster_create_buffer(&r, alertMask, ALERT_W, ALERT_H, ALERT_W);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create_buffer() failed with code %d\n", retVal));
+	raster_set_solid(r, 0xFFFF);
+	raster_fill_round_rect(r, 0, 0, ALERT_W, ALERT_H, 12);
+	raster_destroy(r);
+	r = NULL;
+	for(i = 0; i < ALERT_W * ALERT_H; i++) {
+		unsigned int a = ((alertMask[i] >> 5) & 0x3F) * 255 / 63;
+		unsigned int p = alertColour[i];
+
+		/* At most 224 opaque, so the widgets show through */
+		a = a * 224 / 255;
+		alert[i] = (a << 24) | ((((p >> 8) & 0xF8) * a / 255) << 16) | ((((p >> 3) & 0xFC) * a / 255) << 8) |
+				(((p << 3) & 0xF8) * a / 255);
+	}
+
+	retVal = raster_create_buffer(&r, widgets, 320, 160, 320);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create_buffer() failed with code %d\n", retVal));
+	retVal = compositor_create(&c, &driver);
+	ASSERT(COMPOSITOR_OK == retVal, fprintf(stderr, "Error: compositor_create() failed with code %d\n", retVal));
+	compositor_add_layer(c, COMPOSITOR_RGB565, background, 320, 240, 320, &bgId);
+	compositor_add_layer(c, COMPOSITOR_RGB565, widgets, 320, 160, 320, &widgetsId);
+	compositor_add_layer(c, COMPOSITOR_ARGB8888, alert, ALERT_W, ALERT_H, ALERT_W, &alertId);
+	compositor_set_position(c, widgetsId, 0, 40);
+	compositor_set_opacity(c, widgetsId, 200);
+	compositor_set_position(c, alertId, 60, 90);
+
+	for(i = 0; i < frames; i++) {
+		/* Widgets: one bar changes per frame, so only its tiles are damaged */
+		j = i % BARS;
+		h = 20 + (i * 37 + j * 53) % 130;
+		raster_set_solid(r, 0x0000);
+		raster_fill_rect(r, 10 + j * 38, 0, 34, 160);
+		raster_set_linear(r, 0, 159, 0, 10, 0x07E0, 0xFFE0);
+		raster_fill_rect(r, 10 + j * 38, 160 - h, 34, h);
+		compositor_damage(c, widgetsId, 10 + j * 38, 0, 34, 160);
+
+		/* Overlay fades in and out, with nothing below it redrawn */
+		compositor_set_opacity(c, alertId, (i % 64 < 32)? (i % 32) * 8 : 255 - (i % 32) * 8);
+
+		compositor_flush(c, NULL);
+		usleep(30000);
+	}
+
+_err:
+
+	if(c)
+		compositor_destroy(c);
+
+	if(r)
+		raster_destroy(r);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+/* ********************************************************************************************* */
+/* * Example 13 of PiDisplayLibs usage: Dashboard of live values as a widget tree              * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "driverloader.h"
+#include "scene.h"
+#include "textrender.h"
+
+#define COLS 4
+#define ROWS 3
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	textrender *tr = NULL;
+	scene *s = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	int font, grid, row, cell, name, gauge, total, frames, i, j;
+	int value[COLS * ROWS], label[COLS * ROWS], bar[COLS * ROWS];
+	unsigned int sent;
+	char text[32];
+
+	/* Check arguments */
+	ASSERT(4 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE FONTFILE FRAMES\n", argv[0]));
+	frames = atoi(argv[3]);
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = textrender_create(&tr, NULL, 512, 512);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_create() failed with code %d\n", retVal));
+	retVal = textrender_load_font(tr, argv[2], &font);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_load_font() failed with code %d\n", retVal));
+	retVal = scene_create(&s, &driver, tr);
+	ASSERT(SCENE_OK == retVal, fprintf(stderr, "Error: scene_create() failed with code %d\n", retVal));
+
+	/* Layout: title row with a gauge, then a grid of cells with a name, a value and a bar each */
+	scene_add_container(s, SCENE_ROOT, SCENE_LAYOUT_COLUMN, &grid);
+	scene_set_padding(s, grid, 4, 4);
+	scene_add_container(s, grid, SCENE_LAYOUT_ROW, &row);
+	scene_set_geometry(s, row, 0, 0, 0, 48);
+	scene_add_label(s, row, font, 20, &name);
+	scene_set_text(s, name, "Total");
+	scene_add_label(s, row, font, 28, &total);
+	scene_set_align(s, total, SCENE_ALIGN_RIGHT);
+	scene_set_colours(s, total, 0xFFE0, 0x0000);
+	scene_add_gauge(s, row, &gauge);
+	scene_set_geometry(s, gauge, 0, 0, 48, 0);
+	scene_set_range(s, gauge, 0, 100 * COLS * ROWS);
+	scene_set_colours(s, gauge, 0x07FF, 0x0000);
+
+	for(i = 0; i < ROWS; i++) {
+		scene_add_container(s, grid, SCENE_LAYOUT_ROW, &row);
+		scene_set_padding(s, row, 0, 4);
+		for(j = 0; j < COLS; j++) {
+			int k = i * COLS + j;
+
+			scene_add_container(s, row, SCENE_LAYOUT_COLUMN, &cell);
+			scene_set_colours(s, cell, 0xFFFF, 0x2104);
+			scene_set_padding(s, cell, 4, 2);
+			scene_add_label(s, cell, font, 12, &name);
+			scene_set_colours(s, name, 0xAD55, 0x2104);
+			snprintf(text, sizeof(text), "Sensor %d", k + 1);
+			scene_set_text(s, name, text);
+			scene_add_label(s, cell, font, 20, &label[k]);
+			scene_set_colours(s, label[k], 0xFFFF, 0x2104);
+			scene_set_align(s, label[k], SCENE_ALIGN_CENTRE);
+			scene_add_bar(s, cell, &bar[k]);
+			scene_set_geometry(s, bar[k], 0, 0, 0, 6);
+			scene_set_colours(s, bar[k], 0x07E0, 0x2104);
+			value[k] = (k * 37) % 100;
+		}
+	}
+
+	for(i = 0; i < frames; i++) {
+		int sum = 0;
+
+		/* A few values change per frame; only their widgets are repainted */
+		for(j = 0; j < COLS * ROWS; j++) {
+			if(!((i + j) % 5))
+				value[j] = (value[j] + 7 * j + 3) % 100;
+			snprintf(text, sizeof(text), "%d %%", value[j]);
+			retVal = scene_set_text(s, label[j], text);
+			ASSERT(SCENE_OK == retVal, fprintf(stderr, "Error: scene_set_text() failed with code %d\n", retVal));
+			scene_set_value(s, bar[j], value[j]);
+			sum += value[j];
+		}
+		snprintf(text, sizeof(text), "%d", sum);
+		scene_set_text(s, total, text);
+		scene_set_value(s, gauge, sum);
+
+		retVal = scene_flush(s, &sent);
+		ASSERT(SCENE_OK == retVal, fprintf(stderr, "Error: scene_flush() failed with code %d\n", retVal));
+		printf("Frame %d: %u pixels sent\n", i, sent);
+		usleep(100000);
+	}
+
+_err:
+
+	if(s)
+		scene_destroy(s);
+
+	if(tr)
+		textrender_destroy(tr);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
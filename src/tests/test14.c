@@ -0,0 +1,141 @@
+/* ********************************************************************************************* */
+/* * Example 14 of PiDisplayLibs usage: Resident indexed-colour screens with a blinking alert  * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "driverloader.h"
+#include "surface.h"
+#include "textrender.h"
+#include "utf8.h"
+
+#define SCREENS 2
+
+/* Palette: 0 black, 1 to 7 grey ramp for text, 8 alert, 9 bars */
+#define TEXT 1
+#define TEXT_LEVELS 7
+#define ALERT 8
+#define BARS 9
+
+/**
+ * @brief Draw a string on a surface with the text ramp.
+ */
+static void draw_text(surface *s, textrender *tr, int font, unsigned int size, int x, int baseline, const char *str) {
+	textrender_glyph glyph;
+	int penX = x * 64;
+
+	while(*str) {
+		if(TEXTRENDER_OK != textrender_get_glyph(tr, font, size, utf8_next(&str), &glyph))
+			return;
+		surface_draw_coverage(s, (penX >> 6) + glyph.left, baseline - glyph.top, glyph.coverage, glyph.width,
+				glyph.height, glyph.stride, TEXT, TEXT_LEVELS);
+		penX += glyph.advance;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	textrender *tr = NULL;
+	surface *screen[SCREENS] = {NULL};
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	unsigned short palette[16];
+	int font, seconds, i, j, shown = -1;
+
+	/* Check arguments */
+	ASSERT(4 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE FONTFILE SECONDS\n", argv[0]));
+	seconds = atoi(argv[3]);
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = textrender_create(&tr, NULL, 512, 512);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_create() failed with code %d\n", retVal));
+	retVal = textrender_load_font(tr, argv[2], &font);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_load_font() failed with code %d\n", retVal));
+
+	palette[0] = 0x0000;
+	for(i = 0; i < TEXT_LEVELS; i++) {
+		unsigned int v = (i + 1) * 255 / TEXT_LEVELS;
+
+		palette[TEXT + i] = ((v & 0xF8) << 8) | ((v & 0xFC) << 3) | (v >> 3);
+	}
+	palette[ALERT] = 0xF800;
+	palette[BARS] = 0x07E0;
+
+	/* Screens at 4 bits per pixel stay resident, a quarter of their RGB565 size */
+	for(i = 0; i < SCREENS; i++) {
+		retVal = surface_create(&screen[i], 320, 240, 4);
+		ASSERT(SURFACE_OK == retVal, fprintf(stderr, "Error: surface_create() failed with code %d\n", retVal));
+		surface_set_palette(screen[i], 0, 10, palette);
+	}
+
+	draw_text(screen[0], tr, font, 28, 10, 40, "Status");
+	surface_fill_rect(screen[0], 10, 80, 300, 60, ALERT);
+	draw_text(screen[0], tr, font, 20, 10, 180, "Pressure above limit");
+	draw_text(screen[1], tr, font, 28, 10, 40, "Levels");
+	for(i = 0; i < 8; i++) {
+		j = 20 + (i * 53) % 140;
+		surface_fill_rect(screen[1], 15 + i * 38, 230 - j, 30, j, BARS);
+	}
+
+	for(i = 0; i < seconds * 4; i++) {
+		int next = (i / 8) % SCREENS;
+
+		/* Switching screens resends the whole surface */
+		if(next != shown) {
+			surface_invalidate(screen[next], 0, 0, 320, 240);
+			shown = next;
+		}
+
+		/* Blinking alert: only a palette entry changes */
+		palette[ALERT] = (i % 2)? 0x3800 : 0xF800;
+		surface_set_palette(screen[shown], ALERT, 1, &palette[ALERT]);
+
+		surface_flush(screen[shown], &driver, 0, 0, NULL);
+		usleep(250000);
+	}
+
+_err:
+
+	for(i = 0; i < SCREENS; i++) {
+		if(screen[i])
+			surface_destroy(screen[i]);
+	}
+
+	if(tr)
+		textrender_destroy(tr);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
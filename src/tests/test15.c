@@ -0,0 +1,108 @@
+/* ********************************************************************************************* */
+/* * Example 15 of PiDisplayLibs usage: Menu pages switched from a compressed page store       * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "driverloader.h"
+#include "pagestore.h"
+#include "raster.h"
+
+#define MAX_PAGES 40
+#define ITEMS 5
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	raster *r = NULL;
+	pagestore *ps = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	static unsigned short pixels[320 * 240];
+	int id[MAX_PAGES];
+	int pages, delay, loops, i, j;
+	unsigned int sent;
+
+	/* Check arguments */
+	ASSERT(5 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE PAGES DELAYMS LOOPS\n", argv[0]));
+	pages = atoi(argv[2]);
+	pages = (pages < 1)? 1 : (pages > MAX_PAGES)? MAX_PAGES : pages;
+	delay = atoi(argv[3]);
+	loops = atoi(argv[4]);
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = pagestore_create(&ps, &driver);
+	ASSERT(PAGESTORE_OK == retVal, fprintf(stderr, "Error: pagestore_create() failed with code %d\n", retVal));
+	retVal = raster_create_buffer(&r, pixels, 320, 240, 320);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create_buffer() failed with code %d\n", retVal));
+
+	/* Render every menu page once: a title bar and a list, with a different item selected on each page */
+	for(i = 0; i < pages; i++) {
+		raster_set_solid(r, 0x10A2);
+		raster_fill_rect(r, 0, 0, 320, 240);
+		raster_set_linear(r, 0, 0, 0, 35, 0x033F, 0x0010);
+		raster_fill_rect(r, 0, 0, 320, 36);
+		raster_set_solid(r, 0xFFFF);
+		raster_fill_rect(r, 10 + (i / ITEMS) * 12, 14, 8, 8);
+		for(j = 0; j < ITEMS; j++) {
+			raster_set_solid(r, (j == i % ITEMS)? 0xFD20 : 0x39E7);
+			raster_fill_round_rect(r, 16, 46 + j * 38, 288, 32, 8);
+			raster_set_solid(r, 0xFFFF);
+			raster_fill_circle(r, 36, 62 + j * 38, 6);
+		}
+
+		retVal = pagestore_add(ps, pixels, 320, &id[i]);
+		ASSERT(PAGESTORE_OK == retVal, fprintf(stderr, "Error: pagestore_add() failed with code %d\n", retVal));
+	}
+	printf("%d pages take %zu bytes (%d uncompressed)\n", pages, pagestore_get_size(ps), pages * 320 * 240 * 2);
+
+	/* Walk through the pages, as a user scrolling the menu would */
+	for(i = 0; i < loops * pages; i++) {
+		retVal = pagestore_show(ps, id[i % pages], &sent);
+		ASSERT(PAGESTORE_OK == retVal, fprintf(stderr, "Error: pagestore_show() failed with code %d\n", retVal));
+		printf("Page %d: %u pixels sent\n", i % pages, sent);
+		usleep(delay * 1000);
+	}
+
+_err:
+
+	if(r)
+		raster_destroy(r);
+
+	if(ps)
+		pagestore_destroy(ps);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
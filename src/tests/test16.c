@@ -0,0 +1,157 @@
+/* ********************************************************************************************* */
+/* * Example 16 of PiDisplayLibs usage: Widgets drawn from several threads through a bus queue * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "busqueue.h"
+#include "common.h"
+#include "driverloader.h"
+
+#define WIDGETS 8
+
+/**
+ * @brief Widget thread arguments.
+ */
+typedef struct {
+	busqueue *q;
+	int index;
+	int frames;
+} widget_args;
+
+/**
+ * @brief Widget thread: a level bar with a small icon, updated at its own rate without any lock.
+ */
+static void *widget(void *arg) {
+	widget_args *args = arg;
+	busqueue_batch *b = NULL;
+	unsigned short icon[16 * 16];
+	int x = 8 + args->index * 39, level = 0, i, j;
+
+	if(BUSQUEUE_OK != busqueue_batch_create(args->q, &b, 8))
+		return NULL;
+
+	for(i = 0; i < args->frames; i++) {
+		level = (level + 7 + args->index * 3) % 200;
+
+		/* One batch per update: background, bar and icon are reserved in the ring together, as a frame */
+		busqueue_vsync(b);
+		busqueue_fill(b, x, 20, 32, 200 - level, 0x18E3);
+		busqueue_fill(b, x, 220 - level, 32, level, (level > 150)? 0xF800 : 0x07E0);
+		for(j = 0; j < 16 * 16; j++)
+			icon[j] = ((j / 16 + j % 16 + i) & 4)? 0xFFFF : 0x001F;
+		busqueue_blit(b, x + 8, 0, 16, 16, icon, 16);
+		busqueue_submit(b, 1);
+
+		usleep(10000 + args->index * 5000);
+	}
+
+	busqueue_batch_destroy(b);
+
+	return NULL;
+}
+
+/**
+ * @brief Print a histogram of power-of-two microsecond bins, up to its last non-empty bin.
+ */
+static void print_histogram(const char *name, const unsigned int *hist, unsigned int max) {
+	int last, i;
+
+	for(last = BUSQUEUE_HIST_BINS - 1; last > 0 && !hist[last]; last--)
+		;
+
+	printf("%s (max %u us):\n", name, max);
+	for(i = 0; i <= last; i++)
+		printf("\t< %8u us: %u\n", 1u << i, hist[i]);
+}
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	busqueue *q = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	pthread_t threads[WIDGETS];
+	widget_args args[WIDGETS];
+	busqueue_stats stats;
+	int created = 0, i;
+
+	/* Check arguments */
+	ASSERT(3 == argc || 5 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE FRAMES [CPU PRIORITY]\n", argv[0]));
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = busqueue_create(&q, &driver, 256);
+	ASSERT(BUSQUEUE_OK == retVal, fprintf(stderr, "Error: busqueue_create() failed with code %d\n", retVal));
+
+	/* Optionally make the bus thread real-time */
+	if(5 == argc) {
+		retVal = busqueue_set_realtime(q, atoi(argv[3]), atoi(argv[4]));
+		ASSERT(BUSQUEUE_OK == retVal,
+			fprintf(stderr, "Error: busqueue_set_realtime() failed with code %d\n", retVal));
+	}
+
+	/* Every widget thread draws through the queue; only the bus thread touches the driver */
+	for(created = 0; created < WIDGETS; created++) {
+		args[created].q = q;
+		args[created].index = created;
+		args[created].frames = atoi(argv[2]);
+		ASSERT(!pthread_create(&threads[created], NULL, widget, &args[created]),
+				fprintf(stderr, "Error: pthread_create() failed\n"));
+	}
+
+	for(; created > 0; created--)
+		pthread_join(threads[created - 1], NULL);
+
+	/* Show how steady flushing was */
+	busqueue_sync(q);
+	busqueue_get_stats(q, &stats, 0);
+	printf("%u batches sent\n", stats.batches);
+	print_histogram("Flush latency", stats.latency, stats.maxLatency);
+	print_histogram("Preemption gaps", stats.gaps, stats.maxGap);
+	if(stats.frames) {
+		printf("%u frames sent on a refresh boundary\n", stats.frames);
+		print_histogram("Frame send time", stats.present, stats.maxPresent);
+	}
+
+_err:
+
+	for(i = 0; i < created; i++)
+		pthread_join(threads[i], NULL);
+
+	if(q)
+		busqueue_destroy(q);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+/* ********************************************************************************************* */
+/* * Example 17 of PiDisplayLibs usage: recorded display lists                                 * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "displaylist.h"
+#include "driverloader.h"
+#include "raster.h"
+
+/**
+ * @brief Get a monotonic time in microseconds.
+ */
+static long long now_us(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver, recorder;
+	raster *r = NULL;
+	displaylist *screen = NULL, *overlay = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	int xres, yres, loops, i, x, y;
+	long long t;
+	display_stats before, after;
+
+	/* Check arguments */
+	ASSERT(4 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE LISTFILE LOOPS\n", argv[0]));
+	loops = atoi(argv[3]);
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+	driver.get_resolution(&xres, &yres);
+
+	/* Record a static screen drawn by the rasteriser, as if the recorder were the display */
+	retVal = displaylist_create(&screen, xres, yres);
+	ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_create() failed with code %d\n", retVal));
+	displaylist_begin(screen, &recorder);
+	retVal = raster_create(&r, &recorder);
+	ASSERT(RASTER_OK == retVal, fprintf(stderr, "Error: raster_create() failed with code %d\n", retVal));
+	raster_set_linear(r, 0, 0, 0, yres - 1, 0x0010, 0x0000);
+	raster_fill_rect(r, 0, 0, xres, yres);
+	for(i = 0; i < 4; i++) {
+		raster_set_solid(r, 0x39E7);
+		raster_fill_round_rect(r, 12 + i * 76, 40, 68, 160, 10);
+		raster_set_solid(r, 0xFD20);
+		raster_arc(r, 46 + i * 76, 90, 26, 6, 135, 270);
+	}
+	retVal = displaylist_end(screen);
+	ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_end() failed with code %d\n", retVal));
+
+	/* Record an overlay drawn pixel by pixel: draw() calls are packed into writes */
+	retVal = displaylist_create(&overlay, xres, yres);
+	ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_create() failed with code %d\n", retVal));
+	displaylist_begin(overlay, &recorder);
+	for(y = 0; y < 24; y++) {
+		recorder.set_xy(xres / 2 - 60, yres - 32 + y);
+		for(x = 0; x < 120; x++)
+			recorder.draw(((x + y) & 8)? 255 : 40, 40, 40);
+	}
+	retVal = displaylist_end(overlay);
+	ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_end() failed with code %d\n", retVal));
+
+	/* Round trip the screen through a file, then convert both lists to bus words */
+	retVal = displaylist_save(screen, argv[2]);
+	ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_save() failed with code %d\n", retVal));
+	displaylist_destroy(screen);
+	screen = NULL;
+	retVal = displaylist_load(&screen, argv[2]);
+	ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_load() failed with code %d\n", retVal));
+	printf("Screen takes %zu bytes, overlay %zu bytes\n", displaylist_get_size(screen), displaylist_get_size(overlay));
+
+	retVal = displaylist_encode(screen, &driver);
+	ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_encode() failed with code %d\n", retVal));
+	retVal = displaylist_encode(overlay, &driver);
+	ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_encode() failed with code %d\n", retVal));
+
+	/* Blink the overlay over the screen, with driver counters on to see what each replay costs on the bus */
+	driver.set_stats(DISPLAY_STATS_ENABLE);
+	for(i = 0; i < loops; i++) {
+		driver.get_stats(&before);
+		t = now_us();
+		retVal = displaylist_replay(screen, &driver);
+		ASSERT(DISPLAYLIST_OK == retVal, fprintf(stderr, "Error: displaylist_replay() failed with code %d\n", retVal));
+		if(i & 1) {
+			retVal = displaylist_replay(overlay, &driver);
+			ASSERT(DISPLAYLIST_OK == retVal,
+				fprintf(stderr, "Error: displaylist_replay() failed with code %d\n", retVal));
+		}
+		t = now_us() - t;
+		driver.get_stats(&after);
+		printf("Loop %d: replayed in %lld us, %llu pixels, %llu strobes, %llu readdresses\n", i, t,
+			after.pixels - before.pixels, after.strobes - before.strobes, after.readdresses - before.readdresses);
+		usleep(500000);
+	}
+
+_err:
+
+	if(r)
+		raster_destroy(r);
+
+	if(overlay)
+		displaylist_destroy(overlay);
+
+	if(screen)
+		displaylist_destroy(screen);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,162 @@
+/* ********************************************************************************************* */
+/* * Example 18 of PiDisplayLibs usage: Several panels sharing one bus, drawn as one canvas    * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "busqueue.h"
+#include "common.h"
+#include "driverloader.h"
+
+#define MAX_PANELS 4
+#define BAND 24
+
+/**
+ * @brief Panel thread arguments.
+ */
+typedef struct {
+	busqueue *q;
+	int index;
+	int frames;
+	int yres;
+} panel_args;
+
+/**
+ * @brief Panel thread: renders bands of its own panel while the bus thread sends what the other panels rendered.
+ */
+static void *panel(void *arg) {
+	panel_args *args = arg;
+	busqueue_batch *b = NULL;
+	unsigned short band[320 * BAND];
+	int i, x, y, top;
+
+	if(BUSQUEUE_OK != busqueue_batch_create(args->q, &b, 64))
+		return NULL;
+
+	for(i = 0; i < args->frames; i++) {
+		top = (i * BAND) % args->yres;
+		for(y = 0; y < BAND; y++) {
+			for(x = 0; x < 320; x++)
+				band[y * 320 + x] = DISPLAY_RGB565((x + i * 4) & 0xFF, (top + y) & 0xFF, args->index * 80);
+		}
+
+		/* Canvas coordinates: panels are side by side, in display_init() order */
+		busqueue_blit(b, args->index * 320, top, 320, (top + BAND > args->yres)? args->yres - top : BAND, band, 320);
+		busqueue_submit(b, 1);
+	}
+
+	busqueue_batch_destroy(b);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	busqueue *q = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	display_panel panels[MAX_PANELS];
+	pthread_t threads[MAX_PANELS];
+	panel_args args[MAX_PANELS];
+	busqueue_stats stats;
+	struct timespec start, end;
+	int nPanels = (argc - 3) / 2, created = 0, xres, yres, i;
+	double secs;
+
+	/* Check arguments */
+	ASSERT(argc >= 5 && (argc % 2) && nPanels <= MAX_PANELS,
+		fprintf(stderr, "Usage: %s DRIVERSOFILE FRAMES CS RST [CS RST ...]\n", argv[0]));
+
+	for(i = 0; i < nPanels; i++) {
+		panels[i].cs = atoi(argv[3 + 2 * i]);
+		panels[i].rst = atoi(argv[4 + 2 * i]);
+	}
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise every panel at once */
+	retVal = driver.init(panels, nPanels);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	driver.get_resolution(&xres, &yres);
+	printf("Canvas of %dx%d\n", xres, yres);
+
+	/* A gradient across the whole canvas, as one window */
+	driver.set_window(0, 0, xres - 1, yres - 1);
+	for(i = 0; i < yres; i++)
+		driver.fill_rgb565(DISPLAY_RGB565(i, i, 255 - i), xres);
+
+	/* Each panel addressed on its own: a square per panel index, at its top-left corner */
+	for(i = 0; i < nPanels; i++) {
+		retVal = driver.select(i);
+		ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_select() failed with code %d\n", retVal));
+		driver.set_window(4, 4, 4 + 12 * (i + 1), 16);
+		driver.fill_rgb565(0xFFFF, 13 * (12 * (i + 1) + 1));
+	}
+	driver.select(DISPLAY_CANVAS);
+	sleep(1);
+
+	retVal = busqueue_create(&q, &driver, 256);
+	ASSERT(BUSQUEUE_OK == retVal, fprintf(stderr, "Error: busqueue_create() failed with code %d\n", retVal));
+
+	/* One thread per panel renders while the bus thread sends, switching panels between batches */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(created = 0; created < nPanels; created++) {
+		args[created].q = q;
+		args[created].index = created;
+		args[created].frames = atoi(argv[2]);
+		args[created].yres = yres;
+		ASSERT(!pthread_create(&threads[created], NULL, panel, &args[created]),
+				fprintf(stderr, "Error: pthread_create() failed\n"));
+	}
+
+	for(; created > 0; created--)
+		pthread_join(threads[created - 1], NULL);
+	busqueue_sync(q);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	/* The bus is shared, so this is the rate of the bus, split among panels */
+	secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	busqueue_get_stats(q, &stats, 0);
+	printf("%u batches sent in %.3f s, %.0f pixels/s over %d panels\n", stats.batches, secs,
+		(double) nPanels * atoi(argv[2]) * 320 * BAND / secs, nPanels);
+
+_err:
+
+	for(i = 0; i < created; i++)
+		pthread_join(threads[i], NULL);
+
+	if(q)
+		busqueue_destroy(q);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+/* ********************************************************************************************* */
+/* * Example 19 of PiDisplayLibs usage: Pixel rate of a driver linked into the program         * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common.h"
+#include "display.h"
+
+#define MAX_XRES 1280
+
+int main(int argc, char *argv[]) {
+	/* No driverloader: the driver is part of the program, so its pixel loops may be inlined right here */
+	display_driver driver = DISPLAY_DRIVER_STATIC;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	unsigned short line[MAX_XRES];
+	display_stats stats;
+	struct timespec start, end;
+	int frames, xres, yres, i, x, y;
+	double secs;
+
+	/* Check arguments */
+	ASSERT(2 == argc, fprintf(stderr, "Usage: %s FRAMES\n", argv[0]));
+	frames = atoi(argv[1]);
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	driver.get_resolution(&xres, &yres);
+	ASSERT(xres <= MAX_XRES, fprintf(stderr, "Error: display wider than %d columns\n", MAX_XRES));
+	driver.set_stats(DISPLAY_STATS_ENABLE);
+
+	/* Moving bars, one line at a time, as an application loop would send them */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < frames; i++) {
+		driver.set_window(0, 0, xres - 1, yres - 1);
+		for(y = 0; y < yres; y++) {
+			for(x = 0; x < xres; x++)
+				line[x] = DISPLAY_RGB565((x + i * 8) & 0xFF, y, ((x + i * 8) & 0x20)? 255 : 0);
+			driver.write_rgb565(line, xres);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	driver.get_stats(&stats);
+	printf("%d frames in %.3f s: %.1f frames/s, %.0f pixels/s, %.2f GPIO stores per pixel\n", frames, secs,
+		frames / secs, (double) frames * xres * yres / secs, stats.pixels? (double) stats.gpioStores / stats.pixels : 0.0);
+
+_err:
+
+	if(displayInit)
+		driver.finish();
+
+	return 0;
+}
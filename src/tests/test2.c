@@ -16,156 +16,157 @@
 /* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
 /* * not, see <http://www.gnu.org/licenses/>.                                                  * */
 /* ********************************************************************************************* */
-
 #include <dlfcn.h>
-#include <ft2build.h>
-#include FT_FREETYPE_H
+#include <stdbool.h>
 #include <stdio.h>
-#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "common.h"
-#include "display.h"
+#include "driverloader.h"
+#include "framesched.h"
+#include "textrender.h"
+#include "ticker.h"
+
+/* Font size, frame rate and scroll speed (pixels per second) */
+#define SIZE 200
+#define RATE 30
+#define SPEED 120
+
+/**
+ * @brief String source: repeats a string a given amount of times, followed by a space each time.
+ */
+typedef struct {
+	const char *str;
+	size_t pos;
+	unsigned int repeatAmt;
+} repeat_source;
+
+/**
+ * @brief Text source callback for repeat_source.
+ */
+int read_repeat(void *arg, char *buffer, size_t len) {
+	repeat_source *src = arg;
+	size_t n = strlen(&(src->str[src->pos]));
+
+	if(!(src->repeatAmt))
+		return -1;
+
+	if(!n) {
+		src->pos = 0;
+		src->repeatAmt--;
+		buffer[0] = ' ';
+		return 1;
+	}
 
-int min(int a, int b) {
-	return (a < b)? a : b;
+	n = (n < len)? n : len;
+	memcpy(buffer, &(src->str[src->pos]), n);
+	src->pos += n;
+
+	return n;
+}
+
+/**
+ * @brief Scroll state: ticker, distance not scrolled yet (in pixel nanoseconds) and last ticker return code.
+ */
+typedef struct {
+	ticker *tk;
+	unsigned long long residue;
+	int rv;
+} scroll_state;
+
+/**
+ * @brief Render callback: scroll by the time elapsed since the last frame, so that speed does not depend on the rate.
+ */
+int scroll(void *arg, const framesched_frame *frame) {
+	scroll_state *st = arg;
+	unsigned long long travel = SPEED * frame->elapsed + st->residue;
+
+	st->residue = travel % 1000000000ULL;
+	if(travel < 1000000000ULL)
+		return FRAMESCHED_OK;
+
+	st->rv = ticker_step(st->tk, travel / 1000000000ULL);
+
+	return (TICKER_OK == st->rv)? FRAMESCHED_OK : FRAMESCHED_END;
 }
 
 int main(int argc, char *argv[]) {
-	char *driverLibPath = NULL;
-	char *fontPath = NULL;
-	char *inputString = NULL;
-	int inputStringSz = -1;
-	unsigned int repeatAmt = 0;
 	void *driverLibrary = NULL;
-	int (* display_init)(void *, int) = NULL;
-	int (* display_set_xy)(unsigned int, unsigned int) = NULL;
-	int (* display_draw)(unsigned char, unsigned char,  unsigned char) = NULL;
-	int (* display_finish)(void) = NULL;
+	display_driver driver;
+	textrender *tr = NULL;
+	ticker *tk = NULL;
+	framesched *fs = NULL;
+	framesched_stats stats;
+	scroll_state st;
 	int retVal = DISPLAY_OK;
-	FT_Error ftRet = FT_Err_Ok;
-	FT_Library ftLibrary = NULL;
-	FT_Face ftFontFace = NULL;
-	FT_GlyphSlot slot;
-	unsigned int *text[240];
-	unsigned int textWidth = 0;
-	int i, j, k, l;
-
-	/* Initialise text matrix pointers */
-	for(i = 0; i < 240; i++)
-		text[i] = NULL;
+	bool displayInit = false;
+	int font, ascent, descent, xres, yres, y;
+	int stdinFd = 0;
+	repeat_source repeat;
 
 	/* Check if drivers .so file, font file and string was informed */
-	ASSERT(5 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE TTFFONTFILE STRING REPEATAMT\n", argv[0]));
-	driverLibPath = argv[1];
-	fontPath = argv[2];
-	inputString = argv[3];
-	inputStringSz = strnlen(inputString, 256);
-	repeatAmt = atoi(argv[4]);
+	ASSERT(5 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE TTFFONTFILE STRING|- REPEATAMT\n", argv[0]));
+	repeat.str = argv[3];
+	repeat.repeatAmt = atoi(argv[4]);
+	repeat.pos = 0;
 
 	/* Attempt to load driver library */
-	driverLibrary = dlopen(driverLibPath, RTLD_LAZY);
-	ASSERT(driverLibrary != NULL, fprintf(stderr, "Error: dlopen(): %s\n", dlerror()));
-
-	/* Retrieve display_init() */
-	display_init = dlsym(driverLibrary, "display_init");
-	ASSERT(display_init != NULL, fprintf(stderr, "Error: dlsym(\"display_init\"): %s\n", dlerror()));
-
-	/* Retrieve display_set_xy() */
-	display_set_xy = dlsym(driverLibrary, "display_set_xy");
-	ASSERT(display_set_xy != NULL, fprintf(stderr, "Error: dlsym(\"display_set_xy\"): %s\n", dlerror()));
-
-	/* Retrieve display_draw() */
-	display_draw = dlsym(driverLibrary, "display_draw");
-	ASSERT(display_draw != NULL, fprintf(stderr, "Error: dlsym(\"display_draw\"): %s\n", dlerror()));
-
-	/* Retrieve display_finish() */
-	display_finish = dlsym(driverLibrary, "display_finish");
-	ASSERT(display_finish != NULL, fprintf(stderr, "Error: dlsym(\"display_finish\"): %s\n", dlerror()));
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
 
 	/* Initialise display */
-	display_init(NULL, 0);
+	retVal = driver.init(NULL, 0);
 	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
-
-	/* Initialise freetype library */
-	ftRet = FT_Init_FreeType(&ftLibrary);
-	ASSERT(FT_Err_Ok == ftRet, fprintf(stderr, "Error: FT_Init_FreeType() failed with code %d\n", ftRet));
-
-	/* Load font */
-	ftRet = FT_New_Face(ftLibrary, fontPath, 0, &ftFontFace);
-	slot = ftFontFace->glyph;
-	ASSERT(FT_Err_Ok == ftRet, fprintf(stderr, "Error: FT_New_Face() failed with code %d\n", ftRet));
-
-	/* Set font size */
-	ftRet = FT_Set_Pixel_Sizes(ftFontFace, 0, 300);
-	ASSERT(FT_Err_Ok == ftRet, fprintf(stderr, "Error: FT_Set_Pixel_Sizes() failed with code %d\n", ftRet));
-
-	/* Allocate 320 columns on text matrix for black padding */
-	for(i = 0; i < 240; i++)
-		text[i] = calloc(320, sizeof(unsigned int));
-	textWidth = 320;
-
-	/* Renderise each character from string */
-	for(i = 0; i < inputStringSz; i++) {
-		/* Load character */
-		ftRet = FT_Load_Glyph(ftFontFace, FT_Get_Char_Index(ftFontFace, inputString[i]), FT_LOAD_DEFAULT);
-		ASSERT(FT_Err_Ok == ftRet, fprintf(stderr, "Error: FT_Load_Glyph() failed with code %d\n", ftRet));
-
-		/* Render to bitmap if needed */
-		if(ftFontFace->glyph->format != FT_GLYPH_FORMAT_BITMAP) {
-			ftRet = FT_Render_Glyph(ftFontFace->glyph, FT_RENDER_MODE_NORMAL);
-			ASSERT(FT_Err_Ok == ftRet, fprintf(stderr, "Error: FT_Render_Glyph() failed with code %d\n", ftRet));
-		}
-
-		for(j = 239, k = (slot->bitmap.rows - 1); j >= 0; j--, k--) {
-			/* Allocate columns for character */
-			text[j] = realloc(text[j], (textWidth + slot->bitmap.width + 50) * sizeof(unsigned int));
-			for(l = 0; l < slot->bitmap.width; l++) {
-				/* Draw character */
-				if(k >= 0)
-					text[j][l + textWidth] = slot->bitmap.buffer[k * slot->bitmap.width + l];
-				/* Character is done, draw black space */
-				else
-					text[j][l + textWidth] = 0;
-			}
-			/* Add padding */
-			for(l = 0; l < 50; l++)
-				text[j][l + textWidth + slot->bitmap.width] = 0;
-		}
-		textWidth += slot->bitmap.width + 50;
-	}
-
-	/* Set coordinate to (0,0) */
-	display_set_xy(0, 0);
-
-	for(i = 0; i < (repeatAmt * textWidth); i += 4) {
-		for(j = 0; j < 240; j++) {
-			for(k = 0; k < 320; k++) {
-				/* Retrieve pixel, add some fancy colouring and draw it */
-				unsigned int gsVal = text[j][(k + i) % textWidth];
-				unsigned int gsValGradient = gsVal? (gsVal / 256.0) * ((128 * k) / 320.0) + 128 : 0;
-				display_draw(gsValGradient, 0, gsValGradient);
-			}
-		}
-	}
+	displayInit = true;
+
+	retVal = textrender_create(&tr, &driver, 1024, 1024);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_create() failed with code %d\n", retVal));
+	retVal = textrender_load_font(tr, argv[2], &font);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_load_font() failed with code %d\n", retVal));
+
+	/* Centre the band. Text comes from standard input if STRING is "-" */
+	driver.get_resolution(&xres, &yres);
+	textrender_get_metrics(tr, font, SIZE, &ascent, &descent);
+	y = (yres - ascent - descent) / 2;
+	if(strcmp(argv[3], "-"))
+		retVal = ticker_create(&tk, &driver, tr, font, SIZE, y, DISPLAY_RGB565(192, 0, 192), 0, read_repeat, &repeat);
+	else
+		retVal = ticker_create(&tk, &driver, tr, font, SIZE, y, DISPLAY_RGB565(192, 0, 192), 0, ticker_read_fd,
+				&stdinFd);
+	ASSERT(TICKER_OK == retVal, fprintf(stderr, "Error: ticker_create() failed with code %d\n", retVal));
+
+	/* Scroll at a fixed rate until the text is over */
+	retVal = framesched_create(&fs);
+	ASSERT(FRAMESCHED_OK == retVal, fprintf(stderr, "Error: framesched_create() failed with code %d\n", retVal));
+	st.tk = tk;
+	st.residue = 0;
+	st.rv = TICKER_OK;
+	retVal = framesched_add(fs, scroll, NULL, &st, RATE, 1, NULL);
+	ASSERT(FRAMESCHED_OK == retVal, fprintf(stderr, "Error: framesched_add() failed with code %d\n", retVal));
+	framesched_run(fs, NULL);
+	ASSERT(TICKER_END == st.rv, fprintf(stderr, "Error: ticker_step() failed with code %d\n", st.rv));
+
+	framesched_get_stats(fs, 0, &stats);
+	printf("%llu frames (%llu late, %llu dropped), render %u us on average (max %u us), now at %u fps\n",
+		stats.frames, stats.missed, stats.skipped, stats.renderAvg / 1000, stats.renderMax / 1000,
+		1000000000u / stats.period);
 
 _err:
 
-	for(i = 0; i < 240; i++) {
-		if(text[i])
-			free(text[i]);
-	}
+	if(fs)
+		framesched_destroy(fs);
 
-	if(ftFontFace)
-		FT_Done_Face(ftFontFace);
+	if(tk)
+		ticker_destroy(tk);
 
-	if(ftLibrary)
-		FT_Done_FreeType(ftLibrary);
+	if(tr)
+		textrender_destroy(tr);
 
-	if(display_finish)
-		display_finish();
+	if(displayInit)
+		driver.finish();
 
-	if(driverLibrary)
-		dlclose(driverLibrary);
+	driverloader_close(driverLibrary);
 
 	return 0;
 }
@@ -0,0 +1,86 @@
+/* ********************************************************************************************* */
+/* * Example 20 of PiDisplayLibs usage: Show images twice through the image cache              * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common.h"
+#include "driverloader.h"
+#include "imagecache.h"
+#include "scaler.h"
+
+/* Cache size limit */
+#define CACHE_BYTES (16 * 1024 * 1024)
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	imagecache *cache = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	struct timespec start, end;
+	int format, orientation, pass, i, hit;
+
+	/* Check arguments */
+	ASSERT(argc >= 5, fprintf(stderr, "Usage: %s DRIVERSOFILE CACHEDIR FORMAT ORIENTATION IMGFILE [IMGFILE ...]\n",
+		argv[0]));
+	format = atoi(argv[3]);
+	orientation = atoi(argv[4]) % 4;
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = imagecache_open(&cache, argv[2], &driver, format, CACHE_BYTES);
+	ASSERT(IMAGECACHE_OK == retVal, fprintf(stderr, "Error: imagecache_open() failed with code %d\n", retVal));
+
+	/* The first pass decodes whatever is not cached yet, the second one is served from the cache */
+	for(pass = 0; pass < 2; pass++) {
+		for(i = 5; i < argc; i++) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			retVal = imagecache_show(cache, argv[i], orientation, SCALER_MODE_FIT, &hit);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			ASSERT(IMAGECACHE_OK == retVal,
+				fprintf(stderr, "Error: imagecache_show() failed with code %d: %s\n", retVal, argv[i]));
+
+			printf("%s: %s in %.2f ms\n", argv[i], hit? "hit" : "miss",
+				(end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+		}
+	}
+
+_err:
+
+	if(cache)
+		imagecache_close(cache);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,82 @@
+/* ********************************************************************************************* */
+/* * Example 4 of PiDisplayLibs usage: Prefetching image slideshow                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "driverloader.h"
+#include "slideshow.h"
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	slideshow *show = NULL;
+	int retVal = DISPLAY_OK;
+	unsigned int delay;
+	int orientation;
+	int mode;
+	unsigned int index;
+	bool displayInit = false;
+
+	/* Check arguments */
+	ASSERT(argc >= 6, fprintf(stderr, "Usage: %s DRIVERSOFILE DELAYMS ORIENTATION SCALEMODE IMGFILE...\n", argv[0]));
+	delay = atoi(argv[2]);
+	orientation = atoi(argv[3]) % 4;
+	mode = atoi(argv[4]) % 4;
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	/* Two workers keeping up to 4 images (at most 1 MiB) decoded ahead */
+	retVal = slideshow_create(&show, &driver, 2, 4, 1024 * 1024);
+	ASSERT(SLIDESHOW_OK == retVal, fprintf(stderr, "Error: slideshow_create() failed with code %d\n", retVal));
+
+	retVal = slideshow_set_playlist(show, &argv[5], argc - 5, orientation, mode);
+	ASSERT(SLIDESHOW_OK == retVal, fprintf(stderr, "Error: slideshow_set_playlist() failed with code %d\n", retVal));
+
+	while(1) {
+		retVal = slideshow_next(show, &index);
+		if(SLIDESHOW_DECODE_ERROR == retVal)
+			fprintf(stderr, "Warning: could not decode %s, skipping\n", argv[5 + index]);
+		else
+			usleep(delay * 1000);
+	}
+
+_err:
+
+	if(show)
+		slideshow_destroy(show);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
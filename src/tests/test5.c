@@ -0,0 +1,66 @@
+/* ********************************************************************************************* */
+/* * Example 5 of PiDisplayLibs usage: Play a delta-encoded animation                          * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "animation.h"
+#include "common.h"
+#include "driverloader.h"
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	animation *anim = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+
+	/* Check arguments */
+	ASSERT(6 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE ANIMFILE X Y LOOPS\n", argv[0]));
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Map animation */
+	retVal = animation_open(&anim, argv[2]);
+	ASSERT(ANIMATION_OK == retVal, fprintf(stderr, "Error: animation_open() failed with code %d\n", retVal));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = animation_play(anim, &driver, atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), NULL);
+	ASSERT(ANIMATION_OK == retVal, fprintf(stderr, "Error: animation_play() failed with code %d\n", retVal));
+
+_err:
+
+	if(anim)
+		animation_close(anim);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+/* ********************************************************************************************* */
+/* * Example 5 of PiDisplayLibs usage: Play a delta-encoded animation                          * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "driverloader.h"
+#include "viewer.h"
+
+/* Pan step in pixels */
+#define STEP 32
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	viewer *view = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	unsigned int width, height, levels;
+	int cmd;
+
+	/* Check arguments */
+	ASSERT(4 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE IMGFILE CACHEDIR\n", argv[0]));
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = viewer_open(&view, &driver, argv[2], argv[3], 0);
+	ASSERT(VIEWER_OK == retVal, fprintf(stderr, "Error: viewer_open() failed with code %d\n", retVal));
+	viewer_get_info(view, &width, &height, &levels);
+	printf("%ux%u, %u levels. Commands: h j k l (pan), + - (zoom), q (quit)\n", width, height, levels);
+
+	/* Start fully zoomed out */
+	retVal = viewer_set_view(view, levels - 1, 0, 0);
+
+	while(VIEWER_OK == retVal && (cmd = getchar()) != EOF && cmd != 'q') {
+		switch(cmd) {
+			case 'h':
+				retVal = viewer_pan(view, -STEP, 0);
+				break;
+			case 'l':
+				retVal = viewer_pan(view, STEP, 0);
+				break;
+			case 'k':
+				retVal = viewer_pan(view, 0, -STEP);
+				break;
+			case 'j':
+				retVal = viewer_pan(view, 0, STEP);
+				break;
+			case '+':
+				retVal = viewer_zoom(view, 1);
+				break;
+			case '-':
+				retVal = viewer_zoom(view, -1);
+				break;
+		}
+	}
+	ASSERT(VIEWER_OK == retVal, fprintf(stderr, "Error: viewer failed with code %d\n", retVal));
+
+_err:
+
+	if(view)
+		viewer_close(view);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
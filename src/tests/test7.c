@@ -0,0 +1,88 @@
+/* ********************************************************************************************* */
+/* * Example 5 of PiDisplayLibs usage: Play a delta-encoded animation                          * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common.h"
+#include "driverloader.h"
+#include "textrender.h"
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	textrender *tr = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	int font, ascent, descent;
+	unsigned int i, updates, width;
+	char buffer[64];
+	time_t now;
+
+	/* Check arguments */
+	ASSERT(4 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE FONTFILE UPDATES\n", argv[0]));
+	updates = atoi(argv[3]);
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = textrender_create(&tr, &driver, 512, 512);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_create() failed with code %d\n", retVal));
+	retVal = textrender_load_font(tr, argv[2], &font);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_load_font() failed with code %d\n", retVal));
+
+	/* Static labels */
+	driver.set_window(0, 0, 319, 239);
+	driver.fill_rgb565(0, 320 * 240);
+	textrender_draw(tr, font, 24, 8, 8, 0, "Counter", DISPLAY_RGB565(128, 128, 128), 0, NULL);
+	textrender_draw(tr, font, 24, 8, 120, 0, "Clock", DISPLAY_RGB565(128, 128, 128), 0, NULL);
+	textrender_get_metrics(tr, font, 48, &ascent, &descent);
+
+	/* Values change on every update, but glyphs are only rasterised the first time they appear */
+	for(i = 0; i < updates; i++) {
+		snprintf(buffer, sizeof(buffer), "%u", i);
+		retVal = textrender_draw(tr, font, 48, 8, 40, 300, buffer, DISPLAY_RGB565(255, 255, 0), 0, &width);
+		ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_draw() failed with code %d\n", retVal));
+
+		now = time(NULL);
+		strftime(buffer, sizeof(buffer), "%H:%M:%S", localtime(&now));
+		retVal = textrender_draw(tr, font, 48, 8, 152, 300, buffer, DISPLAY_RGB565(0, 255, 255), 0, &width);
+		ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_draw() failed with code %d\n", retVal));
+	}
+
+_err:
+
+	if(tr)
+		textrender_destroy(tr);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
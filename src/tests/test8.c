@@ -0,0 +1,74 @@
+/* ********************************************************************************************* */
+/* * Example 5 of PiDisplayLibs usage: Play a delta-encoded animation                          * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bakedfont.h"
+#include "common.h"
+#include "driverloader.h"
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	bakedfont font = {NULL, 0};
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	unsigned int size, width, height;
+	int xres, yres;
+
+	/* Check arguments */
+	ASSERT(5 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE FONTFILE SIZE STRING\n", argv[0]));
+	size = atoi(argv[3]);
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Map font */
+	retVal = bakedfont_open(&font, argv[2]);
+	ASSERT(BAKEDFONT_OK == retVal, fprintf(stderr, "Error: bakedfont_open() failed with code %d\n", retVal));
+	retVal = bakedfont_measure(&font, size, argv[4], &width, &height);
+	ASSERT(BAKEDFONT_OK == retVal, fprintf(stderr, "Error: size %u is not in the font file\n", size));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	/* Clear screen and centre the string */
+	driver.get_resolution(&xres, &yres);
+	driver.set_window(0, 0, xres - 1, yres - 1);
+	driver.fill_rgb565(0, xres * yres);
+	bakedfont_draw(&font, &driver, size, (xres - (int) width) / 2, (yres - (int) height) / 2, 0, argv[4],
+			DISPLAY_RGB565(255, 255, 255), 0, NULL);
+
+_err:
+
+	if(font.data)
+		bakedfont_close(&font);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+/* ********************************************************************************************* */
+/* * Example 5 of PiDisplayLibs usage: Play a delta-encoded animation                          * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "console.h"
+#include "driverloader.h"
+#include "textrender.h"
+
+int main(int argc, char *argv[]) {
+	void *driverLibrary = NULL;
+	display_driver driver;
+	textrender *tr = NULL;
+	console *con = NULL;
+	int retVal = DISPLAY_OK;
+	bool displayInit = false;
+	int font;
+	char buffer[4096];
+	ssize_t n;
+
+	/* Check arguments */
+	ASSERT(4 == argc, fprintf(stderr, "Usage: %s DRIVERSOFILE FONTFILE SIZE\n", argv[0]));
+
+	/* Attempt to load driver library */
+	retVal = driverloader_open(argv[1], &driver, &driverLibrary);
+	ASSERT(DRIVERLOADER_OK == retVal, fprintf(stderr, "Error: driverloader_open(): %s\n", dlerror()));
+
+	/* Initialise display */
+	retVal = driver.init(NULL, 0);
+	ASSERT(DISPLAY_OK == retVal, fprintf(stderr, "Error: display_init() failed with code %d\n", retVal));
+	displayInit = true;
+
+	retVal = textrender_create(&tr, &driver, 512, 512);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_create() failed with code %d\n", retVal));
+	retVal = textrender_load_font(tr, argv[2], &font);
+	ASSERT(TEXTRENDER_OK == retVal, fprintf(stderr, "Error: textrender_load_font() failed with code %d\n", retVal));
+	retVal = console_create(&con, &driver, tr, font, atoi(argv[3]));
+	ASSERT(CONSOLE_OK == retVal, fprintf(stderr, "Error: console_create() failed with code %d\n", retVal));
+
+	/* Show standard input as it arrives (e.g. tail -f LOGFILE | test9 ...) */
+	while((n = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+		console_write(con, buffer, n);
+		retVal = console_flush(con, NULL);
+		ASSERT(CONSOLE_OK == retVal, fprintf(stderr, "Error: console_flush() failed with code %d\n", retVal));
+	}
+
+_err:
+
+	if(con)
+		console_destroy(con);
+
+	if(tr)
+		textrender_destroy(tr);
+
+	if(displayInit)
+		driver.finish();
+
+	driverloader_close(driverLibrary);
+
+	return 0;
+}
@@ -0,0 +1,609 @@
+/* ********************************************************************************************* */
+/* * Text Rendering Library with glyph atlas                                                   * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "textrender.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "rgb565.h"
+#include "utf8.h"
+
+/* Lookup table slots (power of 2). The table is emptied together with the atlas when 3/4 full */
+#define TABLE_SIZE 2048
+
+/* Cached blend lookup tables (one per colour pair) */
+#define LUT_SLOTS 4
+
+/* Entry kinds */
+#define KIND_EMPTY 0
+#define KIND_GLYPH 1
+#define KIND_KERNING 2
+#define KIND_METRICS 3
+
+/**
+ * @brief Lookup table entry. Key is (kind, font, size, a, b): a is the code point for glyphs and the left glyph index
+ *        for kerning pairs, b is the right glyph index. Kerning is stored in advance, metrics in top (ascent) and
+ *        left (descent).
+ */
+typedef struct {
+	uint8_t kind;
+	uint16_t font;
+	uint16_t size;
+	uint32_t a;
+	uint32_t b;
+	uint16_t atlasX;
+	uint16_t atlasY;
+	uint16_t width;
+	uint16_t height;
+	int16_t left;
+	int16_t top;
+	int32_t advance;
+	uint32_t index;
+} entry;
+
+/**
+ * @brief Coverage to RGB565 table for a colour pair.
+ */
+typedef struct {
+	int valid;
+	unsigned short fg;
+	unsigned short bg;
+	unsigned long lastUse;
+	uint16_t lut[256];
+} blend_lut;
+
+/**
+ * @brief Loaded font. FreeType faces hold one size at a time.
+ */
+typedef struct {
+	FT_Face face;
+	unsigned int size;
+} font_face;
+
+/**
+ * @brief Glyph placed on a line.
+ */
+typedef struct {
+	int x;
+	textrender_glyph glyph;
+} placed_glyph;
+
+struct textrender_s {
+	display_driver *driver;
+	int xres;
+	int yres;
+	FT_Library library;
+	font_face *fonts;
+	unsigned int nFonts;
+	unsigned char *atlas;
+	unsigned int atlasWidth;
+	unsigned int atlasHeight;
+	unsigned int shelfX;
+	unsigned int shelfY;
+	unsigned int shelfHeight;
+	unsigned long generation;
+	entry *table;
+	unsigned int used;
+	blend_lut luts[LUT_SLOTS];
+	unsigned long lutClock;
+	placed_glyph *line;
+	unsigned int lineSize;
+	unsigned char *covRow;
+	uint16_t *pixRow;
+	unsigned int rowSize;
+};
+
+/**
+ * @brief Empty atlas and lookup table.
+ */
+static void _reset(textrender *tr) {
+	memset(tr->table, 0, TABLE_SIZE * sizeof(entry));
+	tr->used = 0;
+	tr->shelfX = 0;
+	tr->shelfY = 0;
+	tr->shelfHeight = 0;
+	tr->generation++;
+}
+
+/**
+ * @brief Find a table entry, or the empty slot where it belongs.
+ */
+static entry *_slot(textrender *tr, int kind, int font, unsigned int size, uint32_t a, uint32_t b) {
+	uint32_t h = 2166136261u;
+	entry *e;
+
+	h = (h ^ kind) * 16777619u;
+	h = (h ^ font) * 16777619u;
+	h = (h ^ size) * 16777619u;
+	h = (h ^ a) * 16777619u;
+	h = (h ^ b) * 16777619u;
+
+	for(h &= TABLE_SIZE - 1; ; h = (h + 1) & (TABLE_SIZE - 1)) {
+		e = &(tr->table[h]);
+		if(KIND_EMPTY == e->kind ||
+				(e->kind == kind && e->font == font && e->size == size && e->a == a && e->b == b))
+			return e;
+	}
+}
+
+/**
+ * @brief Insert a new entry with the given key, emptying the table first if it is 3/4 full (so probing always ends).
+ * @return Entry, with only its key filled.
+ */
+static entry *_insert(textrender *tr, int kind, int font, unsigned int size, uint32_t a, uint32_t b) {
+	entry *e;
+
+	if(tr->used + 1 > TABLE_SIZE * 3 / 4)
+		_reset(tr);
+
+	e = _slot(tr, kind, font, size, a, b);
+	tr->used++;
+	e->kind = kind;
+	e->font = font;
+	e->size = size;
+	e->a = a;
+	e->b = b;
+
+	return e;
+}
+
+/**
+ * @brief Select pixel size on a face, if not already selected.
+ */
+static int _set_size(textrender *tr, int font, unsigned int size) {
+	if(tr->fonts[font].size != size) {
+		if(FT_Set_Pixel_Sizes(tr->fonts[font].face, 0, size))
+			return TEXTRENDER_FONT_ERROR;
+		tr->fonts[font].size = size;
+	}
+
+	return TEXTRENDER_OK;
+}
+
+/**
+ * @brief Reserve a rectangle in the atlas (shelf packing, with one pixel gap).
+ * @return Non-zero on success.
+ */
+static int _pack(textrender *tr, unsigned int width, unsigned int height, unsigned int *x, unsigned int *y) {
+	if(tr->shelfX + width > tr->atlasWidth) {
+		tr->shelfY += tr->shelfHeight + 1;
+		tr->shelfX = 0;
+		tr->shelfHeight = 0;
+	}
+	if(width > tr->atlasWidth || tr->shelfY + height > tr->atlasHeight)
+		return 0;
+
+	*x = tr->shelfX;
+	*y = tr->shelfY;
+	tr->shelfX += width + 1;
+	if(height > tr->shelfHeight)
+		tr->shelfHeight = height;
+
+	return 1;
+}
+
+/**
+ * @brief Lay out a string on a line, filling tr->line.
+ * @param tr Renderer handle.
+ * @param font Font identifier.
+ * @param size Pixel size.
+ * @param str UTF-8 string.
+ * @param count Pointer where the amount of placed glyphs will be written.
+ * @param width Pointer where the line width will be written.
+ * @return Same codes as textrender_get_glyph(), or TEXTRENDER_NO_MEMORY.
+ */
+static int _layout(textrender *tr, int font, unsigned int size, const char *str, unsigned int *count,
+		unsigned int *width) {
+	int rv = TEXTRENDER_OK;
+	size_t len = strlen(str);
+	const char *s;
+	placed_glyph *newLine;
+	unsigned long generation;
+	unsigned int n, prev;
+	long pen, right;
+	int kerning, attempt;
+
+	/* Never more glyphs than bytes */
+	if(len > tr->lineSize) {
+		newLine = realloc(tr->line, len * sizeof(placed_glyph));
+		ASSERT(newLine, rv = TEXTRENDER_NO_MEMORY);
+		tr->line = newLine;
+		tr->lineSize = len;
+	}
+
+	/* If the atlas gets emptied while placing, earlier glyphs are stale: place everything again once */
+	for(attempt = 0; attempt < 2; attempt++) {
+		generation = tr->generation;
+		n = 0;
+		prev = 0;
+		pen = 0;
+		right = 0;
+
+		for(s = str; *s && generation == tr->generation; n++) {
+			placed_glyph *p = &(tr->line[n]);
+
+			rv = textrender_get_glyph(tr, font, size, utf8_next(&s), &(p->glyph));
+			ASSERT(TEXTRENDER_OK == rv, );
+
+			if(prev && p->glyph.index) {
+				rv = textrender_get_kerning(tr, font, size, prev, p->glyph.index, &kerning);
+				ASSERT(TEXTRENDER_OK == rv, );
+				pen += kerning;
+			}
+			prev = p->glyph.index;
+
+			p->x = ((pen + 32) >> 6) + p->glyph.left;
+			pen += p->glyph.advance;
+			if(p->x + (long) p->glyph.width > right)
+				right = p->x + p->glyph.width;
+		}
+
+		if(generation == tr->generation)
+			break;
+	}
+	ASSERT(attempt < 2, rv = TEXTRENDER_ATLAS_FULL);
+
+	*count = n;
+	*width = ((pen + 63) >> 6 > right)? (pen + 63) >> 6 : right;
+
+_err:
+	return rv;
+}
+
+/**
+ * @brief Get blend table for a colour pair, building it if not cached.
+ */
+static const uint16_t *_get_lut(textrender *tr, unsigned short fg, unsigned short bg) {
+	blend_lut *slot = &(tr->luts[0]);
+	unsigned int i;
+
+	for(i = 0; i < LUT_SLOTS; i++) {
+		if(tr->luts[i].valid && tr->luts[i].fg == fg && tr->luts[i].bg == bg) {
+			tr->luts[i].lastUse = ++(tr->lutClock);
+			return tr->luts[i].lut;
+		}
+		if(!(tr->luts[i].valid) || tr->luts[i].lastUse < slot->lastUse)
+			slot = &(tr->luts[i]);
+	}
+
+	rgb565_blend_lut(fg, bg, slot->lut);
+	slot->valid = 1;
+	slot->fg = fg;
+	slot->bg = bg;
+	slot->lastUse = ++(tr->lutClock);
+
+	return slot->lut;
+}
+
+/**
+ * @brief Create a text renderer.
+ */
+int textrender_create(textrender **tr, display_driver *driver, unsigned int atlasWidth, unsigned int atlasHeight) {
+	int rv = TEXTRENDER_OK;
+	textrender *newTr = NULL;
+
+	ASSERT(atlasWidth && atlasHeight && atlasWidth <= 0xFFFF && atlasHeight <= 0xFFFF,
+			rv = TEXTRENDER_INVALID_ARGS);
+
+	newTr = calloc(1, sizeof(textrender));
+	ASSERT(newTr, rv = TEXTRENDER_NO_MEMORY);
+	newTr->driver = driver;
+	if(driver)
+		driver->get_resolution(&(newTr->xres), &(newTr->yres));
+
+	newTr->atlasWidth = atlasWidth;
+	newTr->atlasHeight = atlasHeight;
+	newTr->atlas = malloc(atlasWidth * atlasHeight);
+	ASSERT(newTr->atlas, rv = TEXTRENDER_NO_MEMORY);
+	newTr->table = calloc(TABLE_SIZE, sizeof(entry));
+	ASSERT(newTr->table, rv = TEXTRENDER_NO_MEMORY);
+
+	ASSERT(!FT_Init_FreeType(&(newTr->library)), newTr->library = NULL; rv = TEXTRENDER_FONT_ERROR);
+
+	*tr = newTr;
+
+_err:
+	if(rv != TEXTRENDER_OK && newTr)
+		textrender_destroy(newTr);
+
+	return rv;
+}
+
+/**
+ * @brief Load a font file.
+ */
+int textrender_load_font(textrender *tr, const char *path, int *font) {
+	int rv = TEXTRENDER_OK;
+	font_face *newFonts;
+	FT_Face face = NULL;
+
+	ASSERT(tr->nFonts < 0xFFFF, rv = TEXTRENDER_NO_MEMORY);
+	ASSERT(!FT_New_Face(tr->library, path, 0, &face), face = NULL; rv = TEXTRENDER_FONT_ERROR);
+
+	newFonts = realloc(tr->fonts, (tr->nFonts + 1) * sizeof(font_face));
+	ASSERT(newFonts, rv = TEXTRENDER_NO_MEMORY);
+	tr->fonts = newFonts;
+	tr->fonts[tr->nFonts].face = face;
+	tr->fonts[tr->nFonts].size = 0;
+	*font = tr->nFonts++;
+
+	return TEXTRENDER_OK;
+
+_err:
+	if(face)
+		FT_Done_Face(face);
+
+	return rv;
+}
+
+/**
+ * @brief Get vertical metrics of a font at a given size.
+ */
+int textrender_get_metrics(textrender *tr, int font, unsigned int size, int *ascent, int *descent) {
+	int rv = TEXTRENDER_OK;
+	entry *e;
+	FT_Size_Metrics *metrics;
+
+	ASSERT(font >= 0 && (unsigned int) font < tr->nFonts && size && size <= 0xFFFF, rv = TEXTRENDER_INVALID_ARGS);
+
+	e = _slot(tr, KIND_METRICS, font, size, 0, 0);
+	if(KIND_EMPTY == e->kind) {
+		rv = _set_size(tr, font, size);
+		ASSERT(TEXTRENDER_OK == rv, );
+		metrics = &(tr->fonts[font].face->size->metrics);
+
+		e = _insert(tr, KIND_METRICS, font, size, 0, 0);
+		e->top = (metrics->ascender + 63) >> 6;
+		e->left = (-(metrics->descender) + 63) >> 6;
+	}
+
+	*ascent = e->top;
+	*descent = e->left;
+
+_err:
+	return rv;
+}
+
+/**
+ * @brief Get a glyph, rasterising it into the atlas if needed.
+ */
+int textrender_get_glyph(textrender *tr, int font, unsigned int size, unsigned long code, textrender_glyph *glyph) {
+	int rv = TEXTRENDER_OK;
+	entry *e;
+	FT_Face face;
+	FT_Bitmap *bitmap;
+	unsigned int index, x = 0, y = 0, i, j;
+
+	ASSERT(font >= 0 && (unsigned int) font < tr->nFonts && size && size <= 0xFFFF, rv = TEXTRENDER_INVALID_ARGS);
+
+	e = _slot(tr, KIND_GLYPH, font, size, code, 0);
+	if(KIND_EMPTY == e->kind) {
+		face = tr->fonts[font].face;
+		rv = _set_size(tr, font, size);
+		ASSERT(TEXTRENDER_OK == rv, );
+
+		index = FT_Get_Char_Index(face, code);
+		ASSERT(!FT_Load_Glyph(face, index, FT_LOAD_RENDER), rv = TEXTRENDER_FONT_ERROR);
+		bitmap = &(face->glyph->bitmap);
+		ASSERT(FT_PIXEL_MODE_GRAY == bitmap->pixel_mode || FT_PIXEL_MODE_MONO == bitmap->pixel_mode,
+				rv = TEXTRENDER_FONT_ERROR);
+
+		/* Make room, emptying everything if the atlas is full. The FreeType glyph slot does not depend on it */
+		e = _insert(tr, KIND_GLYPH, font, size, code, 0);
+		if(bitmap->width && bitmap->rows && !_pack(tr, bitmap->width, bitmap->rows, &x, &y)) {
+			_reset(tr);
+			e = _insert(tr, KIND_GLYPH, font, size, code, 0);
+			ASSERT(_pack(tr, bitmap->width, bitmap->rows, &x, &y), e->kind = KIND_EMPTY; tr->used--;
+					rv = TEXTRENDER_ATLAS_FULL);
+		}
+
+		for(j = 0; j < bitmap->rows; j++) {
+			unsigned char *dst = &(tr->atlas[(y + j) * tr->atlasWidth + x]);
+			const unsigned char *src = &(bitmap->buffer[j * bitmap->pitch]);
+
+			if(FT_PIXEL_MODE_GRAY == bitmap->pixel_mode) {
+				memcpy(dst, src, bitmap->width);
+			}
+			else {
+				for(i = 0; i < bitmap->width; i++)
+					dst[i] = ((src[i >> 3] >> (7 - (i & 7))) & 1)? 255 : 0;
+			}
+		}
+
+		e->atlasX = x;
+		e->atlasY = y;
+		e->width = bitmap->width;
+		e->height = bitmap->rows;
+		e->left = face->glyph->bitmap_left;
+		e->top = face->glyph->bitmap_top;
+		e->advance = face->glyph->advance.x;
+		e->index = index;
+	}
+
+	glyph->coverage = &(tr->atlas[e->atlasY * tr->atlasWidth + e->atlasX]);
+	glyph->stride = tr->atlasWidth;
+	glyph->width = e->width;
+	glyph->height = e->height;
+	glyph->left = e->left;
+	glyph->top = e->top;
+	glyph->advance = e->advance;
+	glyph->index = e->index;
+
+_err:
+	return rv;
+}
+
+/**
+ * @brief Get kerning between two glyphs.
+ */
+int textrender_get_kerning(textrender *tr, int font, unsigned int size, unsigned int left, unsigned int right,
+		int *kerning) {
+	int rv = TEXTRENDER_OK;
+	entry *e;
+	FT_Face face;
+	FT_Vector delta = {0, 0};
+
+	ASSERT(font >= 0 && (unsigned int) font < tr->nFonts && size && size <= 0xFFFF, rv = TEXTRENDER_INVALID_ARGS);
+	face = tr->fonts[font].face;
+
+	/* Nothing to remember for fonts without kerning */
+	if(!FT_HAS_KERNING(face)) {
+		*kerning = 0;
+		return TEXTRENDER_OK;
+	}
+
+	e = _slot(tr, KIND_KERNING, font, size, left, right);
+	if(KIND_EMPTY == e->kind) {
+		rv = _set_size(tr, font, size);
+		ASSERT(TEXTRENDER_OK == rv, );
+		ASSERT(!FT_Get_Kerning(face, left, right, FT_KERNING_DEFAULT, &delta), rv = TEXTRENDER_FONT_ERROR);
+
+		e = _insert(tr, KIND_KERNING, font, size, left, right);
+		e->advance = delta.x;
+	}
+
+	*kerning = e->advance;
+
+_err:
+	return rv;
+}
+
+/**
+ * @brief Measure a UTF-8 string.
+ */
+int textrender_measure(textrender *tr, int font, unsigned int size, const char *str, unsigned int *width,
+		unsigned int *height) {
+	int rv;
+	int ascent, descent;
+	unsigned int count, lineWidth;
+
+	rv = textrender_get_metrics(tr, font, size, &ascent, &descent);
+	if(TEXTRENDER_OK == rv)
+		rv = _layout(tr, font, size, str, &count, &lineWidth);
+	if(TEXTRENDER_OK == rv) {
+		*width = lineWidth;
+		*height = ascent + descent;
+	}
+
+	return rv;
+}
+
+/**
+ * @brief Draw a UTF-8 string on an opaque box.
+ */
+int textrender_draw(textrender *tr, int font, unsigned int size, int x, int y, unsigned int minWidth, const char *str,
+		unsigned short fg, unsigned short bg, unsigned int *width) {
+	int rv = TEXTRENDER_OK;
+	int ascent, descent;
+	unsigned int count, lineWidth, boxW, boxH, i;
+	int cx0, cy0, cx1, cy1, row, col;
+	const uint16_t *lut;
+	unsigned char *newCov;
+	uint16_t *newPix;
+
+	ASSERT(tr->driver, rv = TEXTRENDER_INVALID_ARGS);
+	rv = textrender_get_metrics(tr, font, size, &ascent, &descent);
+	ASSERT(TEXTRENDER_OK == rv, );
+	rv = _layout(tr, font, size, str, &count, &lineWidth);
+	ASSERT(TEXTRENDER_OK == rv, );
+
+	boxW = (lineWidth > minWidth)? lineWidth : minWidth;
+	boxH = ascent + descent;
+	if(width)
+		*width = boxW;
+
+	cx0 = (x > 0)? x : 0;
+	cy0 = (y > 0)? y : 0;
+	cx1 = (x + (int) boxW < tr->xres)? x + (int) boxW : tr->xres;
+	cy1 = (y + (int) boxH < tr->yres)? y + (int) boxH : tr->yres;
+	if(cx1 <= cx0 || cy1 <= cy0)
+		return TEXTRENDER_OK;
+
+	if(boxW > tr->rowSize) {
+		newCov = realloc(tr->covRow, boxW);
+		ASSERT(newCov, rv = TEXTRENDER_NO_MEMORY);
+		tr->covRow = newCov;
+		newPix = realloc(tr->pixRow, boxW * sizeof(uint16_t));
+		ASSERT(newPix, rv = TEXTRENDER_NO_MEMORY);
+		tr->pixRow = newPix;
+		tr->rowSize = boxW;
+	}
+
+	lut = _get_lut(tr, fg, bg);
+	tr->driver->set_window(cx0, cy0, cx1 - 1, cy1 - 1);
+
+	for(row = cy0 - y; row < cy1 - y; row++) {
+		/* Merge coverage of every glyph crossing this row (overlaps keep the strongest) */
+		memset(tr->covRow, 0, boxW);
+		for(i = 0; i < count; i++) {
+			placed_glyph *p = &(tr->line[i]);
+			int gy = row - (ascent - p->glyph.top);
+			const unsigned char *src;
+
+			if(gy < 0 || gy >= (int) p->glyph.height)
+				continue;
+
+			src = &(p->glyph.coverage[gy * p->glyph.stride]);
+			for(col = 0; col < (int) p->glyph.width; col++) {
+				int bx = p->x + col;
+
+				if(bx >= 0 && bx < (int) boxW && src[col] > tr->covRow[bx])
+					tr->covRow[bx] = src[col];
+			}
+		}
+
+		for(col = cx0 - x; col < cx1 - x; col++)
+			tr->pixRow[col] = lut[tr->covRow[col]];
+		tr->driver->write_rgb565(&(tr->pixRow[cx0 - x]), cx1 - cx0);
+	}
+
+_err:
+	return rv;
+}
+
+/**
+ * @brief Free renderer, its atlas and fonts.
+ */
+void textrender_destroy(textrender *tr) {
+	unsigned int i;
+
+	for(i = 0; i < tr->nFonts; i++)
+		FT_Done_Face(tr->fonts[i].face);
+	if(tr->library)
+		FT_Done_FreeType(tr->library);
+	if(tr->fonts)
+		free(tr->fonts);
+	if(tr->atlas)
+		free(tr->atlas);
+	if(tr->table)
+		free(tr->table);
+	if(tr->line)
+		free(tr->line);
+	if(tr->covRow)
+		free(tr->covRow);
+	if(tr->pixRow)
+		free(tr->pixRow);
+	free(tr);
+}
@@ -0,0 +1,332 @@
+/* ********************************************************************************************* */
+/* * Ticker Library for streaming scrolling text                                               * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include "ticker.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "rgb565.h"
+
+/* Bytes read from the source at a time */
+#define INPUT_SIZE 64
+
+struct ticker_s {
+	display_driver *driver;
+	textrender *tr;
+	int font;
+	unsigned int size;
+	int xres;
+	int yres;
+	int y;
+	int ascent;
+	int rowFirst;
+	int rowCount;
+	uint16_t lut[256];
+	ticker_read_fn read;
+	void *readArg;
+	char input[INPUT_SIZE];
+	int inputPos;
+	int inputLen;
+	unsigned long code;
+	int pending;
+	int ended;
+	unsigned char *ring;
+	unsigned int ringWidth;
+	unsigned long long shown;
+	unsigned long long cleared;
+	unsigned long long pen;
+	unsigned long long lastInk;
+	unsigned int prevIndex;
+	uint16_t *pixRow;
+};
+
+/**
+ * @brief Get next code point from the source, decoding UTF-8 across reads.
+ * @param t Ticker handle.
+ * @param code Pointer where the code point will be written.
+ * @return 1 if a code point was decoded, 0 if no text is available right now, -1 if the source is exhausted.
+ */
+static int _next_code(ticker *t, unsigned long *code) {
+	unsigned char b;
+	int n;
+
+	while(1) {
+		if(t->inputPos == t->inputLen) {
+			if(t->ended)
+				return -1;
+
+			n = t->read(t->readArg, t->input, INPUT_SIZE);
+			if(n < 0) {
+				t->ended = 1;
+				return -1;
+			}
+			if(!n)
+				return 0;
+
+			t->inputPos = 0;
+			t->inputLen = n;
+		}
+
+		b = t->input[(t->inputPos)++];
+
+		if(t->pending) {
+			if(0x80 == (b & 0xC0)) {
+				t->code = (t->code << 6) | (b & 0x3F);
+				if(!(--(t->pending))) {
+					*code = t->code;
+					return 1;
+				}
+				continue;
+			}
+
+			/* Truncated sequence: report it and reprocess this byte */
+			t->pending = 0;
+			(t->inputPos)--;
+			*code = 0xFFFD;
+			return 1;
+		}
+
+		if(b < 0x80) {
+			*code = b;
+			return 1;
+		}
+		else if(0xC0 == (b & 0xE0)) {
+			t->code = b & 0x1F;
+			t->pending = 1;
+		}
+		else if(0xE0 == (b & 0xF0)) {
+			t->code = b & 0x0F;
+			t->pending = 2;
+		}
+		else if(0xF0 == (b & 0xF8)) {
+			t->code = b & 0x07;
+			t->pending = 3;
+		}
+		else {
+			*code = 0xFFFD;
+			return 1;
+		}
+	}
+}
+
+/**
+ * @brief Make ring columns up to (not including) column c writable by clearing them.
+ */
+static void _clear_to(ticker *t, unsigned long long c) {
+	int r;
+
+	for(; t->cleared < c; (t->cleared)++) {
+		unsigned int slot = t->cleared % t->ringWidth;
+
+		for(r = 0; r < t->rowCount; r++)
+			t->ring[r * t->ringWidth + slot] = 0;
+	}
+}
+
+/**
+ * @brief Copy a glyph into the ring at the pen position and advance the pen.
+ * @param t Ticker handle.
+ * @param code Code point.
+ * @return TICKER_OK or TICKER_READ_ERROR.
+ */
+static int _render_glyph(ticker *t, unsigned long code) {
+	textrender_glyph glyph;
+	long long x0;
+	int kerning, r;
+	unsigned int c;
+
+	/* Lines become spaces, other control characters are dropped */
+	if('\n' == code)
+		code = ' ';
+	else if(code < 0x20)
+		return TICKER_OK;
+
+	if(textrender_get_glyph(t->tr, t->font, t->size, code, &glyph) != TEXTRENDER_OK)
+		return TICKER_READ_ERROR;
+
+	if(t->prevIndex && glyph.index) {
+		if(textrender_get_kerning(t->tr, t->font, t->size, t->prevIndex, glyph.index, &kerning) != TEXTRENDER_OK)
+			return TICKER_READ_ERROR;
+		t->pen += kerning;
+	}
+	t->prevIndex = glyph.index;
+
+	x0 = (long long) ((t->pen + 32) >> 6) + glyph.left;
+	for(c = 0; c < glyph.width; c++) {
+		long long col = x0 + c;
+
+		/* Columns already on screen cannot change, and the ring must not wrap onto them */
+		if(col < (long long) t->shown || col >= (long long) (t->shown - t->xres + t->ringWidth))
+			continue;
+
+		_clear_to(t, col + 1);
+		for(r = 0; r < t->rowCount; r++) {
+			int gy = t->rowFirst + r - (t->ascent - glyph.top);
+			unsigned char *dst = &(t->ring[r * t->ringWidth + col % t->ringWidth]);
+
+			if(gy >= 0 && gy < (int) glyph.height && glyph.coverage[gy * glyph.stride + c] > *dst)
+				*dst = glyph.coverage[gy * glyph.stride + c];
+		}
+	}
+
+	t->pen += glyph.advance;
+	if(x0 + glyph.width > (long long) t->lastInk)
+		t->lastInk = x0 + glyph.width;
+
+	return TICKER_OK;
+}
+
+/**
+ * @brief Text source reading from a file descriptor without blocking.
+ */
+int ticker_read_fd(void *arg, char *buffer, size_t len) {
+	struct pollfd pfd = {*((int *) arg), POLLIN, 0};
+	ssize_t n;
+
+	if(poll(&pfd, 1, 0) < 1)
+		return 0;
+
+	n = read(pfd.fd, buffer, len);
+	if(n < 0)
+		return (EAGAIN == errno || EINTR == errno)? 0 : -1;
+
+	return n? n : -1;
+}
+
+/**
+ * @brief Create a ticker.
+ */
+int ticker_create(ticker **t, display_driver *driver, textrender *tr, int font, unsigned int size, int y,
+		unsigned short fg, unsigned short bg, ticker_read_fn read, void *readArg) {
+	int rv = TICKER_OK;
+	ticker *newT = NULL;
+	int descent;
+
+	newT = calloc(1, sizeof(ticker));
+	ASSERT(newT, rv = TICKER_NO_MEMORY);
+	newT->driver = driver;
+	newT->tr = tr;
+	newT->font = font;
+	newT->size = size;
+	newT->y = y;
+	newT->read = read;
+	newT->readArg = readArg;
+	driver->get_resolution(&(newT->xres), &(newT->yres));
+
+	ASSERT(TEXTRENDER_OK == textrender_get_metrics(tr, font, size, &(newT->ascent), &descent),
+			rv = TICKER_INVALID_ARGS);
+
+	/* Only the rows of the band inside the screen are kept */
+	newT->rowFirst = (y < 0)? -y : 0;
+	newT->rowCount = ((y + newT->ascent + descent < newT->yres)? y + newT->ascent + descent : newT->yres) -
+		(y + newT->rowFirst);
+	if(newT->rowCount < 0)
+		newT->rowCount = 0;
+
+	/* Screen width plus room for a couple of glyphs ahead of it */
+	newT->ringWidth = newT->xres + 2 * size + 2;
+	newT->ring = calloc(newT->ringWidth, newT->rowCount? newT->rowCount : 1);
+	ASSERT(newT->ring, rv = TICKER_NO_MEMORY);
+	newT->pixRow = malloc(newT->xres * sizeof(uint16_t));
+	ASSERT(newT->pixRow, rv = TICKER_NO_MEMORY);
+
+	rgb565_blend_lut(fg, bg, newT->lut);
+
+	/* Start with a blank screen, text enters from the right */
+	newT->shown = newT->xres;
+	newT->cleared = newT->xres;
+	newT->pen = (unsigned long long) newT->xres << 6;
+	newT->lastInk = newT->xres;
+
+	*t = newT;
+
+_err:
+	if(rv != TICKER_OK && newT)
+		ticker_destroy(newT);
+
+	return rv;
+}
+
+/**
+ * @brief Scroll and redraw the band.
+ */
+int ticker_step(ticker *t, unsigned int pixels) {
+	int rv = TICKER_OK;
+	unsigned long code;
+	unsigned int i, slot, first;
+	int r, x, got;
+
+	for(i = 0; i < pixels; i++) {
+		/* Lay text out until the pen is past the column entering the screen */
+		while(((t->pen + 32) >> 6) <= t->shown) {
+			got = _next_code(t, &code);
+			if(got > 0) {
+				rv = _render_glyph(t, code);
+				ASSERT(TICKER_OK == rv, );
+			}
+			else {
+				/* Nothing to show yet (or anymore): scroll blank space */
+				t->pen += 64;
+				t->prevIndex = 0;
+			}
+		}
+
+		_clear_to(t, t->shown + 1);
+		(t->shown)++;
+	}
+
+	if(t->rowCount) {
+		slot = (t->shown - t->xres) % t->ringWidth;
+		first = (slot + t->xres > t->ringWidth)? t->ringWidth - slot : (unsigned int) t->xres;
+
+		t->driver->set_window(0, t->y + t->rowFirst, t->xres - 1, t->y + t->rowFirst + t->rowCount - 1);
+		for(r = 0; r < t->rowCount; r++) {
+			const unsigned char *src = &(t->ring[r * t->ringWidth]);
+
+			for(x = 0; x < (int) first; x++)
+				t->pixRow[x] = t->lut[src[slot + x]];
+			for(; x < t->xres; x++)
+				t->pixRow[x] = t->lut[src[x - first]];
+			t->driver->write_rgb565(t->pixRow, t->xres);
+		}
+	}
+
+	if(t->ended && t->inputPos == t->inputLen && t->shown >= t->lastInk + t->xres)
+		rv = TICKER_END;
+
+_err:
+	return rv;
+}
+
+/**
+ * @brief Free ticker.
+ */
+void ticker_destroy(ticker *t) {
+	if(t->ring)
+		free(t->ring);
+	if(t->pixRow)
+		free(t->pixRow);
+	free(t);
+}
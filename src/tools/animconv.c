@@ -0,0 +1,298 @@
+/* ********************************************************************************************* */
+/* * Animation converter: image sequence to delta-encoded animation file                       * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "animation.h"
+#include "common.h"
+#include "imagedecode.h"
+#include "scaler.h"
+
+/* Dirty detection granularity in pixels */
+#define TILE_SIZE 8
+
+/**
+ * @brief Growable array of 16-bit words.
+ */
+typedef struct {
+	uint16_t *data;
+	size_t len;
+	size_t cap;
+} word_buffer;
+
+/**
+ * @brief Rectangle in tile units, inclusive.
+ */
+typedef struct {
+	unsigned int tx0, tx1, ty0, ty1;
+	int open;
+} tile_rect;
+
+/**
+ * @brief Append a word to a buffer.
+ * @return Non-zero on success.
+ */
+static int _push(word_buffer *buf, uint16_t word) {
+	uint16_t *newData;
+
+	if(buf->len == buf->cap) {
+		buf->cap = buf->cap? 2 * buf->cap : 4096;
+		newData = realloc(buf->data, buf->cap * sizeof(uint16_t));
+		if(!newData)
+			return 0;
+		buf->data = newData;
+	}
+
+	buf->data[buf->len++] = word;
+
+	return 1;
+}
+
+/**
+ * @brief Append a rectangle and the RLE encoding of its pixels. Runs shorter than 3 are kept as literals.
+ * @return Non-zero on success.
+ */
+static int _encode_rect(word_buffer *buf, const uint16_t *frame, unsigned int width, unsigned int x, unsigned int y,
+		unsigned int w, unsigned int h) {
+	uint16_t *pixels = NULL;
+	unsigned int n = w * h;
+	unsigned int i, j, run;
+	size_t literalToken = 0;
+	int inLiteral = 0;
+	int ok = 1;
+
+	pixels = malloc(n * sizeof(uint16_t));
+	if(!pixels)
+		return 0;
+	for(j = 0; j < h; j++)
+		memcpy(pixels + j * w, frame + (y + j) * width + x, w * sizeof(uint16_t));
+
+	ok = ok && _push(buf, x) && _push(buf, y) && _push(buf, w) && _push(buf, h);
+
+	for(i = 0; ok && i < n; i += run) {
+		for(run = 1; i + run < n && run < ANIMATION_RLE_MAX && pixels[i + run] == pixels[i]; run++);
+
+		if(run >= 3) {
+			ok = _push(buf, ANIMATION_RLE_RUN | run) && _push(buf, pixels[i]);
+			inLiteral = 0;
+		}
+		else {
+			/* Extend current literal or start a new one */
+			run = 1;
+			if(!inLiteral || buf->data[literalToken] == ANIMATION_RLE_MAX) {
+				literalToken = buf->len;
+				inLiteral = 1;
+				ok = _push(buf, 0);
+			}
+			ok = ok && _push(buf, pixels[i]);
+			if(ok)
+				buf->data[literalToken]++;
+		}
+	}
+
+	free(pixels);
+
+	return ok;
+}
+
+/**
+ * @brief Encode the difference from prev to cur as dirty rectangles. Changed 8x8 tiles are merged into rectangles
+ *        (horizontal runs, then stacked when runs match), which are then shrunk to the changed pixels.
+ * @return Non-zero on success.
+ */
+static int _encode_delta(word_buffer *buf, const uint16_t *prev, const uint16_t *cur, unsigned int width,
+		unsigned int height) {
+	unsigned int tw = (width + TILE_SIZE - 1) / TILE_SIZE;
+	unsigned int th = (height + TILE_SIZE - 1) / TILE_SIZE;
+	unsigned char *dirty = NULL;
+	tile_rect *rects = NULL;
+	tile_rect *newRects;
+	unsigned int nRects = 0;
+	size_t countPos = buf->len;
+	unsigned int tx, ty, x, y, x0, x1, y0, y1, run0, i;
+	int ok = 1;
+
+	dirty = calloc(tw * th, 1);
+	ASSERT(dirty, ok = 0);
+
+	for(y = 0; y < height; y++) {
+		for(x = 0; x < width; x++) {
+			if(!prev || prev[y * width + x] != cur[y * width + x])
+				dirty[(y / TILE_SIZE) * tw + x / TILE_SIZE] = 1;
+		}
+	}
+
+	for(ty = 0; ty < th; ty++) {
+		for(tx = 0; tx < tw; tx++) {
+			if(!dirty[ty * tw + tx])
+				continue;
+			for(run0 = tx; tx + 1 < tw && dirty[ty * tw + tx + 1]; tx++);
+
+			for(i = 0; i < nRects; i++) {
+				if(rects[i].open && rects[i].tx0 == run0 && rects[i].tx1 == tx && rects[i].ty1 + 1 == ty)
+					break;
+			}
+
+			if(i < nRects) {
+				rects[i].ty1 = ty;
+			}
+			else {
+				newRects = realloc(rects, (nRects + 1) * sizeof(tile_rect));
+				ASSERT(newRects, ok = 0);
+				rects = newRects;
+				rects[nRects].tx0 = run0;
+				rects[nRects].tx1 = tx;
+				rects[nRects].ty0 = rects[nRects].ty1 = ty;
+				rects[nRects].open = 1;
+				nRects++;
+			}
+		}
+
+		for(i = 0; i < nRects; i++)
+			rects[i].open = rects[i].open && (ty == rects[i].ty1);
+	}
+
+	ASSERT(_push(buf, nRects) && _push(buf, 0), ok = 0);
+
+	for(i = 0; i < nRects; i++) {
+		/* Shrink to changed pixels */
+		x0 = width;
+		y0 = height;
+		x1 = y1 = 0;
+		for(y = rects[i].ty0 * TILE_SIZE; y < (rects[i].ty1 + 1) * TILE_SIZE && y < height; y++) {
+			for(x = rects[i].tx0 * TILE_SIZE; x < (rects[i].tx1 + 1) * TILE_SIZE && x < width; x++) {
+				if(!prev || prev[y * width + x] != cur[y * width + x]) {
+					x0 = (x < x0)? x : x0;
+					x1 = (x > x1)? x : x1;
+					y0 = (y < y0)? y : y0;
+					y1 = (y > y1)? y : y1;
+				}
+			}
+		}
+
+		ASSERT(_encode_rect(buf, cur, width, x0, y0, x1 - x0 + 1, y1 - y0 + 1), ok = 0);
+	}
+
+	buf->data[countPos] = nRects;
+
+_err:
+
+	if(rects)
+		free(rects);
+
+	if(dirty)
+		free(dirty);
+
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	int rv = 0;
+	unsigned int delay;
+	unsigned int nFrames;
+	uint16_t **frames = NULL;
+	animation_frame *table = NULL;
+	animation_header header;
+	word_buffer buf = {NULL, 0, 0};
+	imagedecode *dec = NULL;
+	unsigned int width, height, w, h;
+	FILE *outFile = NULL;
+	int irv;
+	unsigned int i;
+
+	ASSERT(argc >= 4, rv = -1; fprintf(stderr, "Usage: %s OUTFILE DELAYMS IMGFILE...\n", argv[0]));
+	delay = atoi(argv[2]);
+	nFrames = argc - 3;
+
+	/* Animation size is the size of the first image. Following images are cropped or padded to it */
+	irv = imagedecode_open(argv[3], &dec);
+	ASSERT(IMAGEDECODE_OK == irv, rv = -1; fprintf(stderr, "Error: could not open %s (code %d)\n", argv[3], irv));
+	imagedecode_get_size(dec, &width, &height);
+	imagedecode_close(dec);
+	ASSERT(width <= 0xFFFF && height <= 0xFFFF, rv = -1; fprintf(stderr, "Error: image is too large\n"));
+
+	frames = calloc(nFrames, sizeof(uint16_t *));
+	ASSERT(frames, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+	table = calloc(nFrames + 1, sizeof(animation_frame));
+	ASSERT(table, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+
+	for(i = 0; i < nFrames; i++) {
+		frames[i] = malloc(width * height * sizeof(uint16_t));
+		ASSERT(frames[i], rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+
+		irv = imagedecode_to_rgb565(argv[3 + i], 0, SCALER_MODE_NONE, frames[i], width, height, NULL, NULL);
+		ASSERT(IMAGEDECODE_OK == irv, rv = -1; fprintf(stderr, "Error: could not decode %s (code %d)\n", argv[3 + i], irv));
+	}
+
+	/* Encode first frame in full, deltas, and the loop frame (last to first) */
+	for(i = 0; i <= nFrames; i++) {
+		table[i].offset = buf.len * sizeof(uint16_t);
+		table[i].delay = delay * 1000;
+
+		if(!i)
+			irv = _encode_delta(&buf, NULL, frames[0], width, height);
+		else if(i < nFrames)
+			irv = _encode_delta(&buf, frames[i - 1], frames[i], width, height);
+		else
+			irv = _encode_delta(&buf, frames[nFrames - 1], frames[0], width, height);
+		ASSERT(irv, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+
+		table[i].size = buf.len * sizeof(uint16_t) - table[i].offset;
+	}
+
+	memcpy(header.magic, ANIMATION_MAGIC, 4);
+	header.version = ANIMATION_VERSION;
+	header.width = width;
+	header.height = height;
+	header.frameCount = nFrames;
+	header.frameTableOffset = sizeof(animation_header);
+	for(i = 0; i <= nFrames; i++)
+		table[i].offset += sizeof(animation_header) + (nFrames + 1) * sizeof(animation_frame);
+
+	outFile = fopen(argv[1], "wb");
+	ASSERT(outFile, rv = -1; fprintf(stderr, "Error: could not open %s for writing\n", argv[1]));
+	ASSERT(1 == fwrite(&header, sizeof(animation_header), 1, outFile), rv = -1; fprintf(stderr, "Error: write failed\n"));
+	ASSERT((nFrames + 1) == fwrite(table, sizeof(animation_frame), nFrames + 1, outFile),
+		rv = -1; fprintf(stderr, "Error: write failed\n"));
+	ASSERT(buf.len == fwrite(buf.data, sizeof(uint16_t), buf.len, outFile),
+		rv = -1; fprintf(stderr, "Error: write failed\n"));
+
+	w = width * height * (nFrames + 1) * sizeof(uint16_t);
+	h = buf.len * sizeof(uint16_t);
+	printf("%u frames of %ux%u, %u bytes of frame data (%.1f%% of raw)\n", nFrames, width, height, h, 100.0 * h / w);
+
+_err:
+
+	if(outFile)
+		fclose(outFile);
+
+	if(frames) {
+		for(i = 0; i < nFrames; i++)
+			free(frames[i]);
+		free(frames);
+	}
+
+	free(table);
+	free(buf.data);
+
+	return rv;
+}
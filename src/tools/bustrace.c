@@ -0,0 +1,314 @@
+/* ********************************************************************************************* */
+/* * Bus trace tool: decode, analyse and replay GPIO store traces of the ili9325 driver        * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "bcmgpio.h"
+#include "common.h"
+
+/* Bus pins of the ili9325 driver. They must match src/ili9325/ili9325.c */
+#define RS_PIN 2
+#define RW_PIN 3
+static const int dbPins[8] = {17, 27, 22, 10, 9, 11, 5, 6};
+
+/* ILI9325 registers: GRAM data, GRAM address and window */
+#define REG_GRAM 0x22
+#define IS_ADDRESS_REG(r) ((0x20 == (r)) || (0x21 == (r)) || ((0x50 <= (r)) && ((r) <= 0x53)))
+
+/* Default idle gap threshold in microseconds */
+#define GAP_US 20
+
+/* Gap histogram bins (powers of two in microseconds) */
+#define GAP_BINS 24
+
+/* Where stores went: pixel data, addressing (address and window registers, GRAM selection) or other registers */
+#define CAT_PIXEL 0
+#define CAT_ADDRESS 1
+#define CAT_REGISTER 2
+#define CATS 3
+
+/* Redundant stores, by the pins they touch */
+#define RED_RW 0
+#define RED_RS 1
+#define RED_DB 2
+#define RED_EMPTY 3
+#define RED_OTHER 4
+#define REDS 5
+
+static const char *catNames[CATS] = {"pixel data", "addressing", "other registers"};
+static const char *redNames[REDS] = {"RW (WR strobe)", "RS", "DB", "empty (no pin)", "other pins"};
+
+/**
+ * @brief Decoder state and tallies.
+ */
+typedef struct {
+	/* Pin levels and which of them are known */
+	uint32_t level;
+	uint32_t known;
+	uint32_t dbMask;
+	/* Byte pairing: a first byte is pending, with its RS level */
+	int phase;
+	int phaseRs;
+	unsigned int hi;
+	/* Selected register, -1 if unknown */
+	int index;
+	/* Time since the first store */
+	uint64_t time;
+	uint64_t gapNs;
+	int decode;
+	/* Totals */
+	unsigned long long stores;
+	unsigned long long clears;
+	unsigned long long strobes;
+	unsigned long long words;
+	unsigned long long pixels;
+	/* Stores and time of the word being transferred, then tallied by category */
+	unsigned long long pendingStores;
+	uint64_t pendingNs;
+	unsigned long long catStores[CATS];
+	uint64_t catNs[CATS];
+	unsigned long long redundant[REDS];
+	/* Idle gaps */
+	unsigned long long gaps;
+	uint64_t idleNs;
+	uint64_t maxGap;
+	unsigned long long gapHist[GAP_BINS];
+	/* Run of pixels being decoded */
+	unsigned long long runPixels;
+	uint64_t runStart;
+} decoder;
+
+/**
+ * @brief Print the run of pixels being decoded, if any.
+ */
+static void _end_run(decoder *d) {
+	if(d->decode && d->runPixels)
+		printf("%14.3f  GRAM  %llu pixels\n", d->runStart / 1000.0, d->runPixels);
+	d->runPixels = 0;
+}
+
+/**
+ * @brief Account a 16-bit word latched by two strobes.
+ */
+static void _word(decoder *d, int rs, unsigned int word) {
+	int cat;
+
+	/* Only the low byte of an index is meaningful (the driver does not set DB for the high one) */
+	if(!rs) {
+		word &= 0xFF;
+		d->index = word;
+		cat = (REG_GRAM == word || IS_ADDRESS_REG(word))? CAT_ADDRESS : CAT_REGISTER;
+	}
+	else if(REG_GRAM == d->index) {
+		cat = CAT_PIXEL;
+		if(!d->runPixels)
+			d->runStart = d->time;
+		d->runPixels++;
+		d->pixels++;
+	}
+	else {
+		cat = IS_ADDRESS_REG(d->index)? CAT_ADDRESS : CAT_REGISTER;
+		_end_run(d);
+		if(d->decode)
+			printf("%14.3f  R%04X = 0x%04X\n", d->time / 1000.0, d->index & 0xFFFF, word);
+	}
+
+	d->catStores[cat] += d->pendingStores;
+	d->catNs[cat] += d->pendingNs;
+	d->pendingStores = 0;
+	d->pendingNs = 0;
+	d->words++;
+}
+
+/**
+ * @brief Account one store.
+ */
+static void _store(decoder *d, const bcmgpio_trace_record *r, int first, uint64_t gapThreshold) {
+	uint32_t v = r->value;
+	int clear = r->meta & BCMGPIO_TRACE_CLEAR;
+	uint64_t delta = first? 0 : r->meta >> 1;
+	uint32_t rw = 1u << RW_PIN;
+	unsigned int byte = 0;
+	int i, bin;
+
+	d->time += delta;
+	d->stores++;
+	d->clears += clear? 1 : 0;
+
+	/* Idle gaps are not charged to any transfer */
+	if(delta >= gapThreshold) {
+		_end_run(d);
+		if(d->decode)
+			printf("%14.3f  idle  %.1f us\n", (d->time - delta) / 1000.0, delta / 1000.0);
+		for(bin = 0; bin < GAP_BINS - 1 && (delta / 1000) >> bin; bin++)
+			;
+		d->gapHist[bin]++;
+		d->gaps++;
+		d->idleNs += delta;
+		d->maxGap = (delta > d->maxGap)? delta : d->maxGap;
+	}
+	else {
+		d->pendingNs += delta;
+	}
+	d->pendingStores++;
+
+	/* A store is redundant if every pin it touches already has the stored level */
+	if(!v)
+		d->redundant[RED_EMPTY]++;
+	else if((v & d->known) == v && (d->level & v) == (clear? 0 : v))
+		d->redundant[(rw == v)? RED_RW : ((1u << RS_PIN) == v)? RED_RS : !(v & ~d->dbMask)? RED_DB : RED_OTHER]++;
+
+	/* WR rising edge: the panel latches DB */
+	if(!clear && (v & rw) && (d->known & rw) && !(d->level & rw)) {
+		d->level |= v;
+		d->strobes++;
+		for(i = 0; i < 8; i++)
+			byte |= ((d->level >> dbPins[i]) & 1) << i;
+
+		/* Index writes always take two bytes with RS low, so a change of RS realigns the pairing */
+		if(d->phase && d->phaseRs != (int) ((d->level >> RS_PIN) & 1))
+			d->phase = 0;
+		if(!d->phase) {
+			d->hi = byte;
+			d->phaseRs = (d->level >> RS_PIN) & 1;
+			d->phase = 1;
+		}
+		else {
+			d->phase = 0;
+			_word(d, d->phaseRs, (d->hi << 8) | byte);
+		}
+	}
+
+	d->level = clear? (d->level & ~v) : (d->level | v);
+	d->known |= v;
+}
+
+/**
+ * @brief Print the analysis of a trace.
+ */
+static void _report(decoder *d, const bcmgpio_trace_header *header, uint64_t gapThreshold) {
+	unsigned long long redundant = 0;
+	int i, first, last;
+
+	for(i = 0; i < REDS; i++)
+		redundant += d->redundant[i];
+
+	printf("Stores: %llu (%llu set, %llu clear) over %.3f ms", d->stores, d->stores - d->clears, d->clears,
+		d->time / 1e6);
+	if(header->dropped)
+		printf(", %u older ones dropped", header->dropped);
+	printf("\nStrobes: %llu, words: %llu, pixels: %llu", d->strobes, d->words, d->pixels);
+	if(d->pixels)
+		printf(" (%.2f stores per pixel)", (double) d->catStores[CAT_PIXEL] / d->pixels);
+	printf("\n\nWhere stores went:\n");
+	for(i = 0; i < CATS; i++)
+		printf("\t%-16s %12llu stores (%5.1f%%) %12.3f ms\n", catNames[i], d->catStores[i],
+			d->stores? 100.0 * d->catStores[i] / d->stores : 0.0, d->catNs[i] / 1e6);
+	printf("\t%-16s %12llu stores\n", "unfinished", d->pendingStores);
+	if(d->pixels)
+		printf("\tAddressing costs %.2f stores per pixel sent\n", (double) d->catStores[CAT_ADDRESS] / d->pixels);
+
+	printf("\nRedundant stores (pins already at the stored level): %llu (%.1f%%)\n", redundant,
+		d->stores? 100.0 * redundant / d->stores : 0.0);
+	for(i = 0; i < REDS; i++)
+		printf("\t%-16s %12llu\n", redNames[i], d->redundant[i]);
+
+	printf("\nIdle gaps of %llu us or more: %llu, %.3f ms in total, longest %.1f us\n",
+		(unsigned long long) (gapThreshold / 1000), d->gaps, d->idleNs / 1e6, d->maxGap / 1000.0);
+	for(first = 0; first < GAP_BINS - 1 && !d->gapHist[first]; first++)
+		;
+	for(last = GAP_BINS - 1; last > first && !d->gapHist[last]; last--)
+		;
+	for(i = first; d->gaps && i <= last; i++)
+		printf("\t< %8u us: %llu\n", 1u << i, d->gapHist[i]);
+}
+
+int main(int argc, char *argv[]) {
+	int rv = 0;
+	FILE *file = NULL;
+	bcmgpio_trace_header header;
+	bcmgpio_trace_record *records = NULL;
+	decoder d;
+	uint64_t gapThreshold = GAP_US * 1000ULL;
+	int irv, i;
+	unsigned int n;
+	struct stat st;
+	size_t left;
+
+	ASSERT(argc >= 3 && argc <= 4, rv = -1; fprintf(stderr, "Usage: %s report|decode TRACEFILE [GAPUS]\n"
+		"       %s replay TRACEFILE [timed]\n", argv[0], argv[0]));
+
+	/* Replaying is done by bcmgpio itself, straight on the pins */
+	if(!strcmp(argv[1], "replay")) {
+		irv = bcmgpio_init();
+		ASSERT(BCMGPIO_OK == irv, rv = -1; fprintf(stderr, "Error: bcmgpio_init() failed with code %d\n", irv));
+		irv = bcmgpio_trace_replay(argv[2], 4 == argc && !strcmp(argv[3], "timed"));
+		bcmgpio_finish();
+		ASSERT(BCMGPIO_OK == irv, rv = -1; fprintf(stderr, "Error: bcmgpio_trace_replay() failed with code %d\n", irv));
+		goto _err;
+	}
+	ASSERT(!strcmp(argv[1], "report") || !strcmp(argv[1], "decode"),
+		rv = -1; fprintf(stderr, "Error: unknown mode %s\n", argv[1]));
+	if(4 == argc)
+		gapThreshold = strtoull(argv[3], NULL, 0) * 1000ULL;
+
+	file = fopen(argv[2], "rb");
+	ASSERT(file, rv = -1; fprintf(stderr, "Error: could not open %s\n", argv[2]));
+	ASSERT(1 == fread(&header, sizeof(bcmgpio_trace_header), 1, file) &&
+		!memcmp(header.magic, BCMGPIO_TRACE_MAGIC, 4) && BCMGPIO_TRACE_VERSION == header.version,
+		rv = -1; fprintf(stderr, "Error: %s is not a bus trace\n", argv[2]));
+
+	/* Only the records actually in the file are read, whatever the header claims */
+	ASSERT(!fstat(fileno(file), &st) && st.st_size >= (off_t) sizeof(bcmgpio_trace_header),
+		rv = -1; fprintf(stderr, "Error: could not read %s\n", argv[2]));
+	left = (st.st_size - sizeof(bcmgpio_trace_header)) / sizeof(bcmgpio_trace_record);
+	n = (header.count < left)? header.count : left;
+	records = malloc(n * sizeof(bcmgpio_trace_record));
+	ASSERT(records || !n, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+	n = fread(records, sizeof(bcmgpio_trace_record), n, file);
+	if(n < header.count)
+		fprintf(stderr, "Warning: trace is truncated, %u of %u stores read\n", n, header.count);
+
+	memset(&d, 0, sizeof(decoder));
+	d.index = -1;
+	d.decode = !strcmp(argv[1], "decode");
+	for(i = 0; i < 8; i++)
+		d.dbMask |= 1u << dbPins[i];
+
+	/* The first delta is relative to a store that is not in the file when records were dropped */
+	for(i = 0; i < (int) n; i++)
+		_store(&d, &records[i], !i && header.dropped, gapThreshold);
+	_end_run(&d);
+
+	if(!d.decode)
+		_report(&d, &header, gapThreshold);
+
+_err:
+
+	if(file)
+		fclose(file);
+
+	free(records);
+
+	return rv;
+}
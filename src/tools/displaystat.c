@@ -0,0 +1,124 @@
+/* ********************************************************************************************* */
+/* * Display statistics tool: live driver counters from the shared stats page                  * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "displaystats.h"
+
+/* Lines between repeated column titles */
+#define TITLE_EVERY 20
+
+/* Set by SIGINT */
+static volatile sig_atomic_t stop = 0;
+
+/**
+ * @brief SIGINT handler: stop sampling and print the summary.
+ */
+static void _on_sigint(int sig) {
+	(void) sig;
+	stop = 1;
+}
+
+/**
+ * @brief Print the transfer time histogram, up to its last non-empty bin.
+ */
+static void _print_histogram(const display_stats *stats) {
+	int last, i;
+
+	for(last = DISPLAY_STATS_BINS - 1; last > 0 && !stats->transferTime[last]; last--)
+		;
+
+	printf("Transfer times (%llu transfers, %llu pixels):\n", stats->transfers, stats->pixels);
+	for(i = 0; i <= last; i++)
+		printf("\t< %8u us: %llu\n", 1u << i, stats->transferTime[i]);
+}
+
+int main(int argc, char *argv[]) {
+	int rv = 0;
+	char name[32];
+	int fd = -1, pid, interval = 1000, line = 0;
+	displaystats_page *page = MAP_FAILED;
+	display_stats prev, cur;
+	double secs;
+
+	ASSERT(argc >= 2 && argc <= 3, rv = -1; fprintf(stderr, "Usage: %s PID [INTERVALMS | on | off]\n", argv[0]));
+	pid = atoi(argv[1]);
+
+	snprintf(name, sizeof(name), DISPLAYSTATS_SHM_NAME, pid);
+	fd = shm_open(name, O_RDWR, 0);
+	ASSERT(fd != -1, rv = -1; fprintf(stderr, "Error: no stats page for PID %d (start it with PIDISPLAY_STATS=shared)\n",
+		pid));
+	page = mmap(NULL, sizeof(displaystats_page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	ASSERT(page != MAP_FAILED, rv = -1; fprintf(stderr, "Error: could not map %s\n", name));
+	ASSERT(!memcmp(page->magic, DISPLAYSTATS_MAGIC, 4) && DISPLAYSTATS_VERSION == page->version,
+		rv = -1; fprintf(stderr, "Error: %s is not a stats page of this version\n", name));
+
+	/* Turn counting on or off from outside */
+	if(3 == argc && (!strcmp(argv[2], "on") || !strcmp(argv[2], "off"))) {
+		page->enabled = !strcmp(argv[2], "on");
+		printf("Counting turned %s for PID %d\n", argv[2], pid);
+		goto _err;
+	}
+	if(3 == argc)
+		interval = atoi(argv[2]);
+	ASSERT(interval > 0, rv = -1; fprintf(stderr, "Error: invalid interval\n"));
+	secs = interval / 1000.0;
+
+	signal(SIGINT, _on_sigint);
+	displaystats_sum(page, &prev);
+
+	/* Rates over each interval, until interrupted or the process goes away */
+	while(!stop && !kill(pid, 0)) {
+		usleep(interval * 1000);
+		displaystats_sum(page, &cur);
+
+		if(!(line++ % TITLE_EVERY))
+			printf("%10s %10s %10s %12s %12s %10s %10s\n", "regs/s", "addr/s", "pixels/s", "strobes/s", "stores/s",
+				"xfers/s", "us/xfer");
+		printf("%10.0f %10.0f %10.0f %12.0f %12.0f %10.0f %10.1f%s\n",
+			(cur.registers - prev.registers) / secs, (cur.readdresses - prev.readdresses) / secs,
+			(cur.pixels - prev.pixels) / secs, (cur.strobes - prev.strobes) / secs,
+			(cur.gpioStores - prev.gpioStores) / secs, (cur.transfers - prev.transfers) / secs,
+			(cur.transfers > prev.transfers)?
+				(cur.transferNs - prev.transferNs) / 1000.0 / (cur.transfers - prev.transfers) : 0.0,
+			page->enabled? "" : " (off)");
+		fflush(stdout);
+		prev = cur;
+	}
+
+	_print_histogram(&prev);
+
+_err:
+
+	if(page != MAP_FAILED)
+		munmap(page, sizeof(displaystats_page));
+
+	if(fd != -1)
+		close(fd);
+
+	return rv;
+}
@@ -0,0 +1,223 @@
+/* ********************************************************************************************* */
+/* * Font baking tool: TTF to bakedfont file                                                   * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bakedfont.h"
+#include "common.h"
+
+/**
+ * @brief Code point ranges baked into the file (printable ASCII and Latin-1).
+ */
+static const unsigned long charset[][2] = {{0x20, 0x7E}, {0xA0, 0xFF}};
+
+/**
+ * @brief Growable byte buffer holding the output file.
+ */
+typedef struct {
+	unsigned char *data;
+	size_t len;
+	size_t cap;
+} byte_buffer;
+
+/**
+ * @brief Append bytes to a buffer (zeroes if data is NULL).
+ * @return Offset of the appended bytes, or -1 if out of memory.
+ */
+static long _append(byte_buffer *buf, const void *data, size_t len) {
+	unsigned char *newData;
+	size_t offset = buf->len;
+
+	if(buf->len + len > buf->cap) {
+		buf->cap = (buf->len + len > 2 * buf->cap)? buf->len + len : 2 * buf->cap;
+		newData = realloc(buf->data, buf->cap);
+		if(!newData)
+			return -1;
+		buf->data = newData;
+	}
+
+	if(data)
+		memcpy(&(buf->data[offset]), data, len);
+	else
+		memset(&(buf->data[offset]), 0, len);
+	buf->len += len;
+
+	return offset;
+}
+
+/**
+ * @brief Bake one size: glyph table, kerning table and bitmaps.
+ * @param buf Output buffer.
+ * @param face FreeType face.
+ * @param size Pixel size.
+ * @param entry Size table entry to fill (offset into buf, as buf may move).
+ * @return Zero on success.
+ */
+static int _bake_size(byte_buffer *buf, FT_Face face, unsigned int size, size_t entry) {
+	int rv = 0;
+	bakedfont_size sz;
+	bakedfont_glyph glyph;
+	bakedfont_kern kern;
+	FT_Bitmap *bitmap;
+	FT_Vector delta;
+	unsigned int *indices = NULL;
+	unsigned long code;
+	unsigned int nGlyphs = 0, maxGlyphs = 0, i, j, r;
+	long offset;
+
+	ASSERT(!FT_Set_Pixel_Sizes(face, 0, size), rv = -1; fprintf(stderr, "Error: size %u not available\n", size));
+	memset(&sz, 0, sizeof(sz));
+	sz.size = size;
+	sz.ascent = (face->size->metrics.ascender + 63) >> 6;
+	sz.descent = (-(face->size->metrics.descender) + 63) >> 6;
+
+	for(i = 0; i < sizeof(charset) / sizeof(charset[0]); i++)
+		maxGlyphs += charset[i][1] - charset[i][0] + 1;
+	indices = calloc(maxGlyphs, sizeof(unsigned int));
+	ASSERT(indices, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+
+	/* Glyph table first, bitmaps are appended later and their offsets patched in */
+	ASSERT(_append(buf, NULL, (4 - (buf->len & 3)) & 3) != -1, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+	sz.glyphOffset = buf->len;
+	for(i = 0; i < sizeof(charset) / sizeof(charset[0]); i++) {
+		for(code = charset[i][0]; code <= charset[i][1]; code++) {
+			unsigned int index = FT_Get_Char_Index(face, code);
+
+			/* Characters missing in the font are left out, except space */
+			if(!index && code != ' ')
+				continue;
+
+			ASSERT(!FT_Load_Glyph(face, index, FT_LOAD_DEFAULT), rv = -1;
+					fprintf(stderr, "Error: could not load glyph for U+%04lX\n", code));
+			memset(&glyph, 0, sizeof(glyph));
+			glyph.code = code;
+			glyph.advance = face->glyph->advance.x;
+			ASSERT(_append(buf, &glyph, sizeof(glyph)) != -1, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+			indices[nGlyphs++] = index;
+		}
+	}
+	sz.glyphCount = nGlyphs;
+
+	/* Kerning pairs, in (left, right) order */
+	sz.kernOffset = buf->len;
+	if(FT_HAS_KERNING(face)) {
+		for(i = 0; i < nGlyphs; i++) {
+			for(j = 0; j < nGlyphs; j++) {
+				if(FT_Get_Kerning(face, indices[i], indices[j], FT_KERNING_DEFAULT, &delta) || !delta.x)
+					continue;
+
+				kern.left = i;
+				kern.right = j;
+				kern.kerning = delta.x;
+				ASSERT(_append(buf, &kern, sizeof(kern)) != -1, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+				sz.kernCount++;
+			}
+		}
+	}
+
+	/* Bitmaps */
+	for(i = 0; i < nGlyphs; i++) {
+		bakedfont_glyph *g;
+
+		ASSERT(!FT_Load_Glyph(face, indices[i], FT_LOAD_RENDER), rv = -1;
+				fprintf(stderr, "Error: could not render glyph %u\n", indices[i]));
+		bitmap = &(face->glyph->bitmap);
+		ASSERT(FT_PIXEL_MODE_GRAY == bitmap->pixel_mode, rv = -1;
+				fprintf(stderr, "Error: glyph %u is not anti-aliased\n", indices[i]));
+
+		offset = buf->len;
+		for(r = 0; r < bitmap->rows; r++) {
+			ASSERT(_append(buf, &(bitmap->buffer[r * bitmap->pitch]), bitmap->width) != -1, rv = -1;
+					fprintf(stderr, "Error: Out of memory!\n"));
+		}
+
+		g = (bakedfont_glyph *) &(buf->data[sz.glyphOffset + i * sizeof(bakedfont_glyph)]);
+		g->width = bitmap->width;
+		g->height = bitmap->rows;
+		g->left = face->glyph->bitmap_left;
+		g->top = face->glyph->bitmap_top;
+		g->bitmapOffset = offset;
+	}
+
+	memcpy(&(buf->data[entry]), &sz, sizeof(sz));
+	printf("Size %u: %u glyphs, %u kerning pairs\n", size, sz.glyphCount, sz.kernCount);
+
+_err:
+	if(indices)
+		free(indices);
+
+	return rv;
+}
+
+int main(int argc, char *argv[]) {
+	int rv = 0;
+	FT_Library library = NULL;
+	FT_Face face = NULL;
+	byte_buffer buf = {NULL, 0, 0};
+	bakedfont_header header;
+	FILE *outFile = NULL;
+	unsigned int nSizes, i;
+
+	ASSERT(argc >= 4, rv = -1; fprintf(stderr, "Usage: %s OUTFILE FONTFILE SIZE...\n", argv[0]));
+	nSizes = argc - 3;
+
+	ASSERT(!FT_Init_FreeType(&library), library = NULL; rv = -1; fprintf(stderr, "Error: FT_Init_FreeType() failed\n"));
+	ASSERT(!FT_New_Face(library, argv[2], 0, &face), face = NULL; rv = -1;
+			fprintf(stderr, "Error: could not load %s\n", argv[2]));
+
+	memcpy(header.magic, BAKEDFONT_MAGIC, 4);
+	header.version = BAKEDFONT_VERSION;
+	header.sizeCount = nSizes;
+	header.sizeTableOffset = sizeof(header);
+	ASSERT(_append(&buf, &header, sizeof(header)) != -1, rv = -1; fprintf(stderr, "Error: Out of memory!\n"));
+	ASSERT(_append(&buf, NULL, nSizes * sizeof(bakedfont_size)) != -1, rv = -1;
+			fprintf(stderr, "Error: Out of memory!\n"));
+
+	for(i = 0; i < nSizes; i++) {
+		unsigned int size = atoi(argv[3 + i]);
+
+		ASSERT(size && size <= 0xFFFF, rv = -1; fprintf(stderr, "Error: invalid size %s\n", argv[3 + i]));
+		ASSERT(!_bake_size(&buf, face, size, sizeof(header) + i * sizeof(bakedfont_size)), rv = -1);
+	}
+
+	outFile = fopen(argv[1], "wb");
+	ASSERT(outFile, rv = -1; fprintf(stderr, "Error: could not open %s\n", argv[1]));
+	ASSERT(fwrite(buf.data, buf.len, 1, outFile) == 1, rv = -1; fprintf(stderr, "Error: could not write %s\n", argv[1]));
+	printf("Wrote %zu bytes\n", buf.len);
+
+_err:
+	if(outFile)
+		fclose(outFile);
+
+	if(buf.data)
+		free(buf.data);
+
+	if(face)
+		FT_Done_Face(face);
+
+	if(library)
+		FT_Done_FreeType(library);
+
+	return rv;
+}
@@ -0,0 +1,612 @@
+/* ********************************************************************************************* */
+/* * Viewer Library for pan/zoom of large images                                               * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * This file is part of PiDisplayLibs                                                        * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is free software: you can redistribute it and/or modify it under the terms  * */
+/* * of the GNU General Public License as published by the Free Software Foundation, either    * */
+/* * version 3 of the License, or (at your option) any later version.                          * */
+/* *                                                                                           * */
+/* * PiDisplayLibs is distributed in the hope that it will be useful, but WITHOUT ANY          * */
+/* * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A           * */
+/* * PARTICULAR PURPOSE.  See the GNU General Public License for more details.                 * */
+/* *                                                                                           * */
+/* * You should have received a copy of the GNU General Public License along with Foobar.  If  * */
+/* * not, see <http://www.gnu.org/licenses/>.                                                  * */
+/* ********************************************************************************************* */
+
+#define _GNU_SOURCE
+
+#include "viewer.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "imagedecode.h"
+#include "scaler.h"
+
+#define TILE VIEWER_TILE_SIZE
+#define TILE_SUFFIX ".tile"
+
+/**
+ * @brief In-memory tile. Pixels outside the level image are black.
+ */
+typedef struct {
+	int valid;
+	unsigned int level;
+	unsigned int tx;
+	unsigned int ty;
+	unsigned long lastUse;
+	uint16_t pixels[TILE * TILE];
+} tile;
+
+/**
+ * @brief Destination of a region decode, filled by the scaler callback.
+ */
+typedef struct {
+	uint16_t *pixels;
+	unsigned int width;
+} region;
+
+struct viewer_s {
+	display_driver *driver;
+	int xres;
+	int yres;
+	char *path;
+	char *tileDir;
+	unsigned int width;
+	unsigned int height;
+	unsigned int levels;
+	tile *tiles;
+	unsigned int nTiles;
+	unsigned long useClock;
+	unsigned long pinClock;
+	unsigned int level;
+	long x;
+	long y;
+	int scroll;
+	int drawn;
+};
+
+/**
+ * @brief Dimensions of a pyramid level.
+ */
+static void _level_size(viewer *v, unsigned int level, long *width, long *height) {
+	*width = (v->width + (1u << level) - 1) >> level;
+	*height = (v->height + (1u << level) - 1) >> level;
+}
+
+/**
+ * @brief Find tile in memory and mark it as used.
+ * @return Tile or NULL.
+ */
+static tile *_find(viewer *v, unsigned int level, unsigned int tx, unsigned int ty) {
+	unsigned int i;
+
+	for(i = 0; i < v->nTiles; i++) {
+		tile *t = &(v->tiles[i]);
+
+		if(t->valid && t->level == level && t->tx == tx && t->ty == ty) {
+			t->lastUse = ++(v->useClock);
+			return t;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Get the slot for a tile: the one already holding it, a free one, or the least recently used one. Tiles used
+ *        since pinClock belong to the rectangle being drawn and are never evicted.
+ * @return Tile or NULL if every slot is pinned.
+ */
+static tile *_alloc(viewer *v, unsigned int level, unsigned int tx, unsigned int ty) {
+	unsigned int i;
+	tile *victim = NULL;
+
+	for(i = 0; i < v->nTiles; i++) {
+		tile *t = &(v->tiles[i]);
+
+		if(!(t->valid) || (t->level == level && t->tx == tx && t->ty == ty)) {
+			victim = t;
+			break;
+		}
+		if(t->lastUse <= v->pinClock && (!victim || t->lastUse < victim->lastUse))
+			victim = t;
+	}
+	if(!victim)
+		return NULL;
+
+	victim->valid = 1;
+	victim->level = level;
+	victim->tx = tx;
+	victim->ty = ty;
+	victim->lastUse = ++(v->useClock);
+
+	return victim;
+}
+
+/**
+ * @brief Path of a tile in the disk cache.
+ */
+static void _tile_path(viewer *v, unsigned int level, unsigned int tx, unsigned int ty, char *path, size_t len) {
+	snprintf(path, len, "%s/%u-%u-%u" TILE_SUFFIX, v->tileDir, level, tx, ty);
+}
+
+/**
+ * @brief Load tile from the disk cache into memory.
+ * @return Tile or NULL if not cached.
+ */
+static tile *_load(viewer *v, unsigned int level, unsigned int tx, unsigned int ty) {
+	char path[PATH_MAX];
+	FILE *file;
+	tile *t;
+
+	if(!(v->tileDir))
+		return NULL;
+
+	_tile_path(v, level, tx, ty, path, sizeof(path));
+	file = fopen(path, "rb");
+	if(!file)
+		return NULL;
+
+	t = _alloc(v, level, tx, ty);
+	if(!t) {
+		fclose(file);
+		return NULL;
+	}
+	if(fread(t->pixels, sizeof(t->pixels), 1, file) != 1) {
+		/* Truncated entry: drop it, it will be regenerated */
+		t->valid = 0;
+		t = NULL;
+		unlink(path);
+	}
+	fclose(file);
+
+	return t;
+}
+
+/**
+ * @brief Store tile in the disk cache. Failures are ignored, the tile is simply regenerated next time.
+ */
+static void _store(viewer *v, tile *t) {
+	char path[PATH_MAX];
+	char tmpPath[PATH_MAX + 16];
+	FILE *file;
+	int ok;
+
+	if(!(v->tileDir))
+		return;
+
+	_tile_path(v, t->level, t->tx, t->ty, path, sizeof(path));
+	snprintf(tmpPath, sizeof(tmpPath), "%s.%d.tmp", path, (int) getpid());
+	file = fopen(tmpPath, "wb");
+	if(!file)
+		return;
+
+	ok = (fwrite(t->pixels, sizeof(t->pixels), 1, file) == 1);
+	ok = (0 == fclose(file)) && ok;
+
+	if(!ok || rename(tmpPath, path))
+		unlink(tmpPath);
+}
+
+/**
+ * @brief Scaler callback. Converts a row of the region to RGB565.
+ */
+static void _region_row(void *arg, unsigned int y, const unsigned char *row) {
+	region *reg = arg;
+	uint16_t *out = &(reg->pixels[y * reg->width]);
+	unsigned int i;
+
+	for(i = 0; i < reg->width; i++)
+		out[i] = DISPLAY_RGB565(row[3 * i], row[3 * i + 1], row[3 * i + 2]);
+}
+
+/**
+ * @brief Generate a rectangle of tiles of a level with a single region decode and put them in memory and disk caches.
+ *        Only the source rows and columns covering the rectangle are decoded.
+ * @param v Viewer handle.
+ * @param level Pyramid level.
+ * @param tx0 First tile column.
+ * @param ty0 First tile row.
+ * @param tx1 Last tile column (inclusive).
+ * @param ty1 Last tile row (inclusive).
+ * @return VIEWER_OK, VIEWER_NO_MEMORY or VIEWER_DECODE_ERROR.
+ */
+static int _generate(viewer *v, unsigned int level, unsigned int tx0, unsigned int ty0, unsigned int tx1,
+		unsigned int ty1) {
+	int rv = VIEWER_OK;
+	imagedecode *dec = NULL;
+	scaler *sc = NULL;
+	unsigned char *row = NULL;
+	region reg = {NULL, 0};
+	long levelW, levelH;
+	unsigned int lx0, ly0, lx1, ly1;
+	unsigned int sx0, sy0, sx1, sy1;
+	unsigned int decW, decH, regH;
+	unsigned int tx, ty, i, j;
+
+	_level_size(v, level, &levelW, &levelH);
+	lx0 = tx0 * TILE;
+	ly0 = ty0 * TILE;
+	lx1 = ((tx1 + 1) * TILE < levelW)? (tx1 + 1) * TILE : levelW;
+	ly1 = ((ty1 + 1) * TILE < levelH)? (ty1 + 1) * TILE : levelH;
+
+	/* Matching source rectangle at full resolution */
+	sx0 = lx0 << level;
+	sy0 = ly0 << level;
+	sx1 = ((lx1 << level) < v->width)? (lx1 << level) : v->width;
+	sy1 = ((ly1 << level) < v->height)? (ly1 << level) : v->height;
+
+	reg.width = lx1 - lx0;
+	regH = ly1 - ly0;
+	reg.pixels = malloc(reg.width * regH * sizeof(uint16_t));
+	ASSERT(reg.pixels, rv = VIEWER_NO_MEMORY);
+
+	rv = imagedecode_open(v->path, &dec);
+	ASSERT(IMAGEDECODE_OK == rv, rv = (IMAGEDECODE_NO_MEMORY == rv)? VIEWER_NO_MEMORY : VIEWER_DECODE_ERROR);
+	rv = imagedecode_set_region(dec, 1u << level, sx0, sy0, sx1 - sx0, sy1 - sy0, NULL);
+	ASSERT(IMAGEDECODE_OK == rv, rv = (IMAGEDECODE_NO_MEMORY == rv)? VIEWER_NO_MEMORY : VIEWER_DECODE_ERROR);
+	imagedecode_get_size(dec, &decW, &decH);
+
+	/* Whatever reduction the decoder did not apply is done by box filtering */
+	rv = scaler_create(&sc, decW, decH, reg.width, regH, SCALER_MODE_STRETCH, SCALER_FILTER_BOX, _region_row, &reg);
+	ASSERT(SCALER_OK == rv, rv = VIEWER_NO_MEMORY);
+	row = malloc(3 * decW);
+	ASSERT(row, rv = VIEWER_NO_MEMORY);
+
+	for(i = 0; i < decH && !scaler_done(sc); i++) {
+		ASSERT(IMAGEDECODE_OK == imagedecode_read_row(dec, row), rv = VIEWER_DECODE_ERROR);
+		scaler_push_row(sc, row);
+	}
+	ASSERT(scaler_done(sc), rv = VIEWER_DECODE_ERROR);
+
+	/* Cut region into tiles, skipping those of the rectangle that are already resident */
+	for(ty = ty0; ty <= ty1; ty++) {
+		for(tx = tx0; tx <= tx1; tx++) {
+			unsigned int ox = (tx - tx0) * TILE;
+			unsigned int oy = (ty - ty0) * TILE;
+			unsigned int w = (reg.width - ox < TILE)? reg.width - ox : TILE;
+			unsigned int h = (regH - oy < TILE)? regH - oy : TILE;
+			tile *t;
+
+			if(_find(v, level, tx, ty))
+				continue;
+			t = _alloc(v, level, tx, ty);
+			ASSERT(t, rv = VIEWER_NO_MEMORY);
+
+			if(w < TILE || h < TILE)
+				memset(t->pixels, 0, sizeof(t->pixels));
+			for(j = 0; j < h; j++)
+				memcpy(&(t->pixels[j * TILE]), &(reg.pixels[(oy + j) * reg.width + ox]), w * sizeof(uint16_t));
+
+			_store(v, t);
+		}
+	}
+
+_err:
+	if(row)
+		free(row);
+	if(sc)
+		scaler_destroy(sc);
+	if(dec)
+		imagedecode_close(dec);
+	if(reg.pixels)
+		free(reg.pixels);
+
+	return rv;
+}
+
+/**
+ * @brief Write a block of pixels to a screen rectangle, accounting for hardware scroll. The rectangle is split in two
+ *        when it wraps around the end of GRAM.
+ * @param v Viewer handle.
+ * @param x Leftmost screen column.
+ * @param y Topmost screen row.
+ * @param w Width.
+ * @param h Height.
+ * @param src Pixels, or NULL to fill with black.
+ * @param stride Distance between rows of src, in pixels.
+ */
+static void _blit(viewer *v, int x, int y, int w, int h, const uint16_t *src, unsigned int stride) {
+	int memX = (x + v->scroll) % v->xres;
+	int first = (memX + w > v->xres)? v->xres - memX : w;
+	int part, i;
+
+	for(part = 0; part < 2; part++) {
+		int pw = part? w - first : first;
+		int px = part? 0 : memX;
+
+		if(!pw)
+			break;
+
+		v->driver->set_window(px, y, px + pw - 1, y + h - 1);
+		if(src) {
+			for(i = 0; i < h; i++)
+				v->driver->write_rgb565(&(src[i * stride + (part? first : 0)]), pw);
+		}
+		else {
+			v->driver->fill_rgb565(0, pw * h);
+		}
+	}
+}
+
+/**
+ * @brief Draw a rectangle of the screen from the tile cache, generating missing tiles first.
+ * @param v Viewer handle.
+ * @param x Leftmost screen column.
+ * @param y Topmost screen row.
+ * @param w Width.
+ * @param h Height.
+ * @return VIEWER_OK, VIEWER_NO_MEMORY or VIEWER_DECODE_ERROR.
+ */
+static int _draw(viewer *v, int x, int y, int w, int h) {
+	int rv = VIEWER_OK;
+	long levelW, levelH;
+	long lx0, ly0, lx1, ly1;
+	unsigned int tx0, ty0, tx1, ty1, tx, ty;
+	unsigned int mx0 = UINT_MAX, my0 = UINT_MAX, mx1 = 0, my1 = 0;
+	int missing = 0;
+
+	_level_size(v, v->level, &levelW, &levelH);
+
+	/* Visible part of the level image, in level coordinates */
+	lx0 = v->x + x;
+	ly0 = v->y + y;
+	lx1 = (v->x + x + w < levelW)? v->x + x + w : levelW;
+	ly1 = (v->y + y + h < levelH)? v->y + y + h : levelH;
+
+	/* Areas beyond the image (when it is smaller than the screen) are black */
+	if(lx1 - v->x < x + w)
+		_blit(v, lx1 - v->x, y, x + w - (lx1 - v->x), h, NULL, 0);
+	if(ly1 - v->y < y + h && lx1 > lx0)
+		_blit(v, x, ly1 - v->y, lx1 - lx0, y + h - (ly1 - v->y), NULL, 0);
+	if(lx1 <= lx0 || ly1 <= ly0)
+		return VIEWER_OK;
+
+	tx0 = lx0 / TILE;
+	ty0 = ly0 / TILE;
+	tx1 = (lx1 - 1) / TILE;
+	ty1 = (ly1 - 1) / TILE;
+
+	/* Pin resident tiles so that loading and generation do not evict them, and bound the missing ones */
+	v->pinClock = v->useClock;
+	for(ty = ty0; ty <= ty1; ty++) {
+		for(tx = tx0; tx <= tx1; tx++) {
+			if(!_find(v, v->level, tx, ty) && !_load(v, v->level, tx, ty)) {
+				mx0 = (tx < mx0)? tx : mx0;
+				my0 = (ty < my0)? ty : my0;
+				mx1 = (tx > mx1)? tx : mx1;
+				my1 = (ty > my1)? ty : my1;
+				missing = 1;
+			}
+		}
+	}
+
+	if(missing) {
+		rv = _generate(v, v->level, mx0, my0, mx1, my1);
+		ASSERT(VIEWER_OK == rv, );
+	}
+
+	for(ty = ty0; ty <= ty1; ty++) {
+		for(tx = tx0; tx <= tx1; tx++) {
+			tile *t = _find(v, v->level, tx, ty);
+			long cx0 = ((long) tx * TILE > lx0)? (long) tx * TILE : lx0;
+			long cy0 = ((long) ty * TILE > ly0)? (long) ty * TILE : ly0;
+			long cx1 = ((long) (tx + 1) * TILE < lx1)? (long) (tx + 1) * TILE : lx1;
+			long cy1 = ((long) (ty + 1) * TILE < ly1)? (long) (ty + 1) * TILE : ly1;
+
+			ASSERT(t, rv = VIEWER_NO_MEMORY);
+			_blit(v, cx0 - v->x, cy0 - v->y, cx1 - cx0, cy1 - cy0,
+					&(t->pixels[(cy0 - ty * TILE) * TILE + (cx0 - tx * TILE)]), TILE);
+		}
+	}
+
+_err:
+	return rv;
+}
+
+/**
+ * @brief Clamp view origin so that the view stays inside the level image.
+ */
+static void _clamp(viewer *v, unsigned int level, long *x, long *y) {
+	long levelW, levelH;
+
+	_level_size(v, level, &levelW, &levelH);
+	if(*x > levelW - v->xres)
+		*x = levelW - v->xres;
+	if(*y > levelH - v->yres)
+		*y = levelH - v->yres;
+	if(*x < 0)
+		*x = 0;
+	if(*y < 0)
+		*y = 0;
+}
+
+/**
+ * @brief Open a large image for viewing.
+ */
+int viewer_open(viewer **v, display_driver *driver, const char *path, const char *cacheDir, unsigned int memTiles) {
+	int rv = VIEWER_OK;
+	viewer *newV = NULL;
+	imagedecode *dec = NULL;
+	struct stat st;
+	char key[PATH_MAX];
+	unsigned int minTiles;
+	long levelW, levelH;
+	uint64_t h = 14695981039346656037ull;
+	size_t i, len;
+
+	newV = calloc(1, sizeof(viewer));
+	ASSERT(newV, rv = VIEWER_NO_MEMORY);
+	newV->driver = driver;
+	driver->get_resolution(&(newV->xres), &(newV->yres));
+
+	newV->path = strdup(path);
+	ASSERT(newV->path, rv = VIEWER_NO_MEMORY);
+
+	rv = imagedecode_open(path, &dec);
+	ASSERT(IMAGEDECODE_OK == rv, rv = (IMAGEDECODE_FILE_ERROR == rv)? VIEWER_FILE_ERROR :
+			(IMAGEDECODE_NO_MEMORY == rv)? VIEWER_NO_MEMORY : VIEWER_DECODE_ERROR);
+	imagedecode_get_size(dec, &(newV->width), &(newV->height));
+	imagedecode_close(dec);
+	dec = NULL;
+
+	/* Level count: down to the first level that fits the screen */
+	do {
+		_level_size(newV, newV->levels++, &levelW, &levelH);
+	} while((levelW > newV->xres || levelH > newV->yres) && newV->levels < 8 * sizeof(unsigned int) - 1);
+
+	/* Enough tiles for a misaligned screenful, so that drawing never evicts a visible tile */
+	minTiles = (newV->xres / TILE + 2) * (newV->yres / TILE + 2);
+	newV->nTiles = (memTiles > minTiles)? memTiles : minTiles;
+	newV->tiles = calloc(newV->nTiles, sizeof(tile));
+	ASSERT(newV->tiles, rv = VIEWER_NO_MEMORY);
+
+	/* Tiles are kept per image identity: a changed file gets a new directory */
+	if(cacheDir) {
+		ASSERT(0 == stat(path, &st), rv = VIEWER_FILE_ERROR);
+		len = snprintf(key, sizeof(key), "%s|%llu|%llu|%lld|%lld.%09ld", path, (unsigned long long) st.st_dev,
+				(unsigned long long) st.st_ino, (long long) st.st_size, (long long) st.st_mtim.tv_sec,
+				st.st_mtim.tv_nsec);
+		for(i = 0; i < len && i < sizeof(key); i++)
+			h = (h ^ (unsigned char) key[i]) * 1099511628211ull;
+
+		ASSERT(0 == mkdir(cacheDir, 0755) || EEXIST == errno, rv = VIEWER_FILE_ERROR);
+		ASSERT(asprintf(&(newV->tileDir), "%s/%016llx", cacheDir, (unsigned long long) h) != -1,
+				newV->tileDir = NULL; rv = VIEWER_NO_MEMORY);
+		ASSERT(0 == mkdir(newV->tileDir, 0755) || EEXIST == errno, rv = VIEWER_FILE_ERROR);
+	}
+
+	newV->level = newV->levels - 1;
+	*v = newV;
+
+_err:
+	if(rv != VIEWER_OK && newV)
+		viewer_close(newV);
+
+	return rv;
+}
+
+/**
+ * @brief Get image information.
+ */
+void viewer_get_info(viewer *v, unsigned int *width, unsigned int *height, unsigned int *levels) {
+	*width = v->width;
+	*height = v->height;
+	*levels = v->levels;
+}
+
+/**
+ * @brief Get current view.
+ */
+void viewer_get_view(viewer *v, unsigned int *level, long *x, long *y) {
+	*level = v->level;
+	*x = v->x;
+	*y = v->y;
+}
+
+/**
+ * @brief Set view and redraw the whole screen.
+ */
+int viewer_set_view(viewer *v, unsigned int level, long x, long y) {
+	int rv;
+
+	if(level >= v->levels)
+		return VIEWER_INVALID_ARGS;
+
+	_clamp(v, level, &x, &y);
+	v->level = level;
+	v->x = x;
+	v->y = y;
+
+	rv = _draw(v, 0, 0, v->xres, v->yres);
+	v->drawn = (VIEWER_OK == rv);
+
+	return rv;
+}
+
+/**
+ * @brief Move the view.
+ */
+int viewer_pan(viewer *v, long dx, long dy) {
+	int rv, scroll;
+	long x = v->x + dx;
+	long y = v->y + dy;
+
+	_clamp(v, v->level, &x, &y);
+	dx = x - v->x;
+	dy = y - v->y;
+
+	if(!dx && !dy && v->drawn)
+		return VIEWER_OK;
+
+	/* Vertical moves cannot be scrolled by the controller: redraw from the tile cache */
+	if(dy || !(v->drawn) || dx >= v->xres || -dx >= v->xres)
+		return viewer_set_view(v, v->level, x, y);
+
+	/* Drivers that cannot scroll (e.g. a canvas spanning several panels) get the whole view redrawn */
+	scroll = (int) (((v->scroll + dx) % v->xres + v->xres) % v->xres);
+	if(DISPLAY_OK != v->driver->scroll(scroll))
+		return viewer_set_view(v, v->level, x, y);
+	v->scroll = scroll;
+	v->x = x;
+
+	/* Only the exposed columns need drawing */
+	rv = (dx > 0)? _draw(v, v->xres - dx, 0, dx, v->yres) : _draw(v, 0, 0, -dx, v->yres);
+	v->drawn = (VIEWER_OK == rv);
+
+	return rv;
+}
+
+/**
+ * @brief Zoom around the centre of the screen.
+ */
+int viewer_zoom(viewer *v, int steps) {
+	long level = (long) v->level - steps;
+	long cx = v->x + v->xres / 2;
+	long cy = v->y + v->yres / 2;
+
+	if(level < 0)
+		level = 0;
+	if(level >= (long) v->levels)
+		level = v->levels - 1;
+
+	if((unsigned int) level < v->level) {
+		cx <<= v->level - level;
+		cy <<= v->level - level;
+	}
+	else {
+		cx >>= level - v->level;
+		cy >>= level - v->level;
+	}
+
+	return viewer_set_view(v, level, cx - v->xres / 2, cy - v->yres / 2);
+}
+
+/**
+ * @brief Close viewer.
+ */
+void viewer_close(viewer *v) {
+	if(v->scroll)
+		v->driver->scroll(0);
+	if(v->tiles)
+		free(v->tiles);
+	if(v->tileDir)
+		free(v->tileDir);
+	if(v->path)
+		free(v->path);
+	free(v);
+}